@@ -0,0 +1,117 @@
+#include "up_codec.hpp"
+#include "up_exception.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto text(const up::buffer& buffer) -> up::unique_string
+    {
+        return up::unique_string(buffer.warm(), buffer.available());
+    }
+
+    auto bytes(std::size_t size) -> up::unique_string
+    {
+        up::unique_string result;
+        uint32_t state = 1;
+        for (std::size_t i = 0; i != size; ++i) {
+            state = state * UINT32_C(1103515245) + 12345;
+            result.append(1, static_cast<char>(state >> 24));
+        }
+        return result;
+    }
+
+    // straightforward implementation for comparison
+    auto reference_base64(const up::unique_string& input, const char* chars) -> up::unique_string
+    {
+        up::unique_string result;
+        uint32_t bits = 0;
+        int count = 0;
+        for (char c : input) {
+            bits = bits << 8 | static_cast<unsigned char>(c);
+            count += 8;
+            while (count >= 6) {
+                count -= 6;
+                result.append(1, chars[(bits >> count) & 63]);
+            }
+        }
+        if (count) {
+            result.append(1, chars[(bits << (6 - count)) & 63]);
+        }
+        while (result.size() % 4) {
+            result.append(1, '=');
+        }
+        return result;
+    }
+
+    UP_TEST_CASE {
+        // test vectors from RFC 4648
+        auto&& vectors = {
+            std::make_pair("", ""),
+            std::make_pair("f", "Zg=="),
+            std::make_pair("fo", "Zm8="),
+            std::make_pair("foo", "Zm9v"),
+            std::make_pair("foob", "Zm9vYg=="),
+            std::make_pair("fooba", "Zm9vYmE="),
+            std::make_pair("foobar", "Zm9vYmFy"),
+        };
+        for (auto&& item : vectors) {
+            up::chunk::from chunk(up::string_view(item.first));
+            UP_TEST_EQUAL(up::base64_encode(chunk), item.second);
+            UP_TEST_EQUAL(text(up::base64_decode(item.second)), item.first);
+        }
+        UP_TEST_EQUAL(up::base64_encode(up::chunk::from("fo", 2), up::base64_alphabet::url, false), "Zm8");
+        UP_TEST_EQUAL(text(up::base64_decode("Zm8")), "fo");
+        UP_TEST_EQUAL(up::hex_encode(up::chunk::from("\x01\xab\xff", 3)), "01abff");
+        UP_TEST_EQUAL(text(up::hex_decode("01ABfF")), "\x01\xab\xff");
+    };
+
+    UP_TEST_CASE {
+        const char* standard = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const char* url = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        for (std::size_t size = 0; size != 100; ++size) {
+            auto input = bytes(size);
+            up::chunk::from chunk(input.data(), input.size());
+            auto hex = up::hex_encode(chunk);
+            UP_TEST_EQUAL(text(up::hex_decode(hex)), input);
+            auto encoded = up::base64_encode(chunk);
+            UP_TEST_EQUAL(encoded, reference_base64(input, standard));
+            UP_TEST_EQUAL(text(up::base64_decode(encoded)), input);
+            auto encoded_url = up::base64_encode(chunk, up::base64_alphabet::url);
+            UP_TEST_EQUAL(encoded_url, reference_base64(input, url));
+            UP_TEST_EQUAL(text(up::base64_decode(encoded_url, up::base64_alphabet::url)), input);
+            up::buffer buffer;
+            up::base64_encode(chunk, buffer, up::base64_alphabet::standard, false);
+            UP_TEST_EQUAL(text(buffer), up::base64_encode(chunk).substr(0, buffer.available()));
+        }
+    };
+
+    UP_TEST_CASE {
+        /* Invalid characters must be detected at all positions, i.e. both
+         * in the vectorized and in the scalar parts. */
+        auto input = bytes(60);
+        auto hex = up::hex_encode(up::chunk::from(input.data(), input.size()));
+        auto base64 = up::base64_encode(up::chunk::from(input.data(), input.size()));
+        for (std::size_t i = 0; i != hex.size(); ++i) {
+            auto copy = hex;
+            copy.replace(i, 1, "g");
+            UP_TEST_THROWS(up::exception, [&]() { up::hex_decode(copy); });
+        }
+        for (std::size_t i = 0; i != base64.size(); ++i) {
+            for (char c : {'=', ' ', '-', '\xff'}) {
+                if (c == '=' && i == base64.size() - 1) {
+                    continue; // valid padding
+                }
+                auto copy = base64;
+                copy.replace(i, 1, up::string_view(&c, 1));
+                UP_TEST_THROWS(up::exception, [&]() { up::base64_decode(copy); });
+            }
+            auto copy = base64;
+            copy.replace(i, 1, "+");
+            UP_TEST_THROWS(up::exception, [&]() { up::base64_decode(copy, up::base64_alphabet::url); });
+        }
+        UP_TEST_THROWS(up::exception, []() { up::hex_decode("abc"); });
+        UP_TEST_THROWS(up::exception, []() { up::base64_decode("Zm9vY"); });
+    };
+
+}
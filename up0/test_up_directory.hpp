@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ * This file provides temporary directories for tests working with the file
+ * system. The directories are created below /tmp, and removed with all
+ * their contents.
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#include "up_fs.hpp"
+
+namespace up_test
+{
+
+    inline void remove_tree(const up::fs::location& location)
+    {
+        for (auto&& entry : location.list()) {
+            auto nested = location.joined(entry.name());
+            if (entry.type() == up::fs::kind::directory) {
+                remove_tree(nested);
+            } else {
+                nested.unlink();
+            }
+        }
+        location.rmdir();
+    }
+
+    inline auto make_directory(const char* name) -> up::shared_string
+    {
+        auto pathname = std::string("/tmp/").append(name).append(".XXXXXX");
+        if (::mkdtemp(&pathname[0]) == nullptr) {
+            throw std::runtime_error("mkdtemp");
+        }
+        return up::shared_string(pathname);
+    }
+
+    inline void remove_directory(const up::shared_string& pathname)
+    {
+        remove_tree(up::fs::location(up::fs::origin(up::fs::context("test")), pathname));
+    }
+
+}
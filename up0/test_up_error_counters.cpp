@@ -0,0 +1,87 @@
+#include <sstream>
+#include <thread>
+
+#include "up_error_counters.hpp"
+#include "up_exception.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    void raise(bool suppress)
+    {
+        try {
+            throw up::make_exception("test-error-counters");
+        } catch (...) {
+            if (suppress) {
+                up::suppress_current_exception("test-error-counters-suppress");
+            }
+        }
+    }
+
+    auto find(up::string_view label) -> up::error_counters::entry
+    {
+        for (auto&& entry : up::error_counters::snapshot()) {
+            if (entry.label() == label) {
+                return entry;
+            }
+        }
+        return up::error_counters::entry(label, 0, 0);
+    }
+
+    UP_TEST_CASE {
+        raise(true);
+        raise(false);
+        std::thread([]() {
+            raise(true);
+            raise(true);
+        }).join();
+        auto entry = find("test-error-counters");
+        UP_TEST_EQUAL(entry.thrown(), 4u);
+        UP_TEST_EQUAL(entry.caught(), 3u);
+        std::thread([]() { raise(false); }).join();
+        raise(false);
+        UP_TEST_EQUAL(find("test-error-counters").thrown(), 6u);
+        bool found = false;
+        auto insight = up::error_counters::to_insight();
+        for (auto&& nested : insight.nested()) {
+            found = found || nested.value() == "test-error-counters";
+        }
+        UP_TEST_TRUE(found);
+    };
+
+    UP_TEST_CASE {
+        up::report_limiter limiter(2, std::chrono::hours(1));
+        UP_TEST_TRUE(bool(limiter.admit("test-limiter-a")));
+        UP_TEST_TRUE(bool(limiter.admit("test-limiter-a")));
+        UP_TEST_FALSE(bool(limiter.admit("test-limiter-a")));
+        UP_TEST_TRUE(bool(limiter.admit("test-limiter-b")));
+        UP_TEST_FALSE(bool(limiter.admit("test-limiter-a")));
+        up::report_limiter zero(0, std::chrono::hours(1));
+        UP_TEST_FALSE(bool(zero.admit("test-limiter-a")));
+    };
+
+    UP_TEST_CASE {
+        // rejected occurrences are reported in the next interval
+        up::report_limiter limiter(1, std::chrono::milliseconds(20));
+        auto log = [&]() {
+            std::ostringstream os;
+            try {
+                throw up::make_exception("test-limiter-log");
+            } catch (...) {
+                limiter.log_current_exception(os);
+            }
+            return os.str();
+        };
+        UP_TEST_TRUE(log().find("test-limiter-log") != std::string::npos);
+        std::size_t rejected = 0;
+        std::string next;
+        while ((next = log()).empty()) {
+            ++rejected;
+        }
+        auto prefix = "suppressed " + std::to_string(rejected) + " similar exceptions\n";
+        UP_TEST_EQUAL(next.compare(0, prefix.size(), prefix) == 0, rejected != 0);
+        UP_TEST_TRUE(next.find("test-limiter-log") != std::string::npos);
+    };
+
+}
@@ -0,0 +1,119 @@
+#include <thread>
+
+#include "up_exception.hpp"
+#include "up_executor.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto fibonacci(const up::executor& executor, unsigned n) -> std::size_t
+    {
+        if (n < 12) {
+            return n < 2 ? n : fibonacci(executor, n - 1) + fibonacci(executor, n - 2);
+        }
+        auto task = executor.spawn([&executor, n]() { return fibonacci(executor, n - 1); });
+        auto result = fibonacci(executor, n - 2);
+        return result + task.join();
+    }
+
+    // busy waits until the flag is set
+    class flag_patience final : public up::stream::patience
+    {
+    private: // --- state ---
+        std::atomic<bool>& _flag;
+    public: // --- life ---
+        explicit flag_patience(std::atomic<bool>& flag)
+            : _flag(flag)
+        { }
+    private: // --- operations ---
+        void _wait(up::stream::native_handle, operation) override
+        {
+            while (!_flag.load()) {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    UP_TEST_CASE {
+        up::executor executor(4);
+        UP_TEST_EQUAL(executor.concurrency(), 4u);
+        auto text = executor.spawn([]() { return std::string("hello"); });
+        std::atomic<int> count(0);
+        auto nothing = executor.spawn([&]() { ++count; });
+        UP_TEST_EQUAL(fibonacci(executor, 25), 75025u);
+        UP_TEST_EQUAL(text.join(), "hello");
+        nothing.join();
+        UP_TEST_EQUAL(count.load(), 1);
+        UP_TEST_FALSE(nothing.valid());
+        // a task, that is not joined, is waited for on destruction
+        executor.spawn([&]() { ++count; });
+        UP_TEST_EQUAL(count.load(), 2);
+    };
+
+    UP_TEST_CASE {
+        up::executor executor(3);
+        for (std::size_t size : {0, 1, 2, 7, 1000, 100000}) {
+            std::vector<std::atomic<int>> hits(size);
+            executor.parallel_for(0, size, [&](std::size_t i) { ++hits[i]; });
+            bool okay = true;
+            for (auto&& hit : hits) {
+                okay = okay && hit.load() == 1;
+            }
+            UP_TEST_TRUE(okay);
+        }
+        // nested parallel_for within tasks
+        std::atomic<std::size_t> sum(0);
+        auto task = executor.spawn([&]() {
+            executor.parallel_for(0, 100, [&](std::size_t i) {
+                executor.parallel_for(0, 100, [&](std::size_t j) { sum += i * j; });
+            });
+        });
+        task.join();
+        UP_TEST_EQUAL(sum.load(), 4950u * 4950u);
+    };
+
+    UP_TEST_CASE {
+        up::executor executor(2);
+        auto task = executor.spawn([]() -> int { throw up::make_exception("test-executor-failure"); });
+        UP_TEST_THROWS(up::exception, [&]() { task.join(); });
+        std::atomic<std::size_t> count(0);
+        UP_TEST_THROWS(std::out_of_range, [&]() {
+            executor.parallel_for(0, 10000, [&](std::size_t i) {
+                ++count;
+                if (i == 5000) {
+                    throw std::out_of_range("test");
+                }
+            });
+        });
+        UP_TEST_TRUE(count.load() <= 10000);
+        // the executor remains usable
+        UP_TEST_EQUAL(executor.spawn([]() { return 42; }).join(), 42);
+    };
+
+    UP_TEST_CASE {
+        /* The only worker blocks until the second task has run. The second
+         * task is not joined, so that only a spare worker can run it. */
+        up::executor executor(1);
+        std::atomic<bool> started(false);
+        std::atomic<bool> flag(false);
+        auto blocked = executor.spawn([&]() {
+            started = true;
+            flag_patience inner(flag);
+            up::executor::patience patience(executor, inner);
+            patience(up::stream::native_handle::invalid, up::stream::patience::operation::read);
+        });
+        while (!started.load()) {
+            std::this_thread::yield();
+        }
+        auto releaser = executor.spawn([&]() { flag = true; });
+        for (std::size_t i = 0; i != 10000 && !releaser.ready(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        UP_TEST_TRUE(releaser.ready());
+        flag = true;
+        blocked.join();
+        releaser.join();
+    };
+
+}
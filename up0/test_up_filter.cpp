@@ -0,0 +1,147 @@
+#include <limits>
+
+#include "up_exception.hpp"
+#include "up_filter.hpp"
+#include "up_string.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    template <typename Filter>
+    auto false_positives(const Filter& filter, std::size_t first, std::size_t count) -> std::size_t
+    {
+        std::size_t result = 0;
+        for (std::size_t i = first; i != first + count; ++i) {
+            result += filter.contains(i);
+        }
+        return result;
+    }
+
+    UP_TEST_CASE {
+        up::bloom_filter<std::size_t> filter(10000);
+        for (std::size_t i = 0; i != 10000; ++i) {
+            filter.insert(i * 3);
+        }
+        UP_TEST_EQUAL(filter.size(), 10000u);
+        for (std::size_t i = 0; i != 10000; ++i) {
+            UP_TEST_TRUE(filter.contains(i * 3));
+        }
+        // expected about 1%
+        UP_TEST_TRUE(false_positives(filter, 1000000, 100000) < 2000);
+        up::buffer buffer;
+        filter.serialize(buffer);
+        up::bloom_filter<std::size_t>::view view(buffer);
+        UP_TEST_EQUAL(view.size(), 10000u);
+        for (std::size_t i = 0; i != 10000; ++i) {
+            UP_TEST_TRUE(view.contains(i * 3));
+        }
+        UP_TEST_EQUAL(false_positives(view, 1000000, 100000), false_positives(filter, 1000000, 100000));
+        auto copy = filter;
+        filter.clear();
+        UP_TEST_FALSE(filter.contains(3));
+        UP_TEST_TRUE(copy.contains(3));
+        // moved-from filters can be cleared
+        auto moved = std::move(copy);
+        copy.clear();
+        UP_TEST_EQUAL(copy.size(), 0u);
+        UP_TEST_TRUE(moved.contains(3));
+        filter = std::move(moved);
+        moved.clear();
+        UP_TEST_TRUE(filter.contains(3));
+    };
+
+    UP_TEST_CASE {
+        up::cuckoo_filter<up::shared_string> filter(10000);
+        auto key = [](std::size_t i) { return up::shared_string(std::to_string(i)); };
+        for (std::size_t i = 0; i != 10000; ++i) {
+            UP_TEST_TRUE(filter.insert(key(i)));
+        }
+        for (std::size_t i = 0; i != 10000; ++i) {
+            UP_TEST_TRUE(filter.contains(key(i)));
+        }
+        std::size_t positives = 0;
+        for (std::size_t i = 10000; i != 110000; ++i) {
+            positives += filter.contains(key(i));
+        }
+        // expected about 0.01%
+        UP_TEST_TRUE(positives < 100);
+        up::buffer buffer;
+        filter.serialize(buffer);
+        for (std::size_t i = 0; i < 10000; i += 2) {
+            UP_TEST_TRUE(filter.erase(key(i)));
+        }
+        UP_TEST_EQUAL(filter.size(), 5000u);
+        for (std::size_t i = 1; i < 10000; i += 2) {
+            UP_TEST_TRUE(filter.contains(key(i)));
+        }
+        up::cuckoo_filter<up::shared_string>::view view(buffer);
+        UP_TEST_EQUAL(view.size(), 10000u);
+        for (std::size_t i = 0; i != 10000; ++i) {
+            UP_TEST_TRUE(view.contains(key(i)));
+        }
+    };
+
+    UP_TEST_CASE {
+        // insert until full, and check that nothing is lost
+        up::cuckoo_filter<uint64_t> filter(1000);
+        std::size_t count = 0;
+        while (filter.insert(count)) {
+            ++count;
+        }
+        UP_TEST_TRUE(count >= filter.table().bucket_count() * 4 * 9 / 10);
+        UP_TEST_EQUAL(filter.size(), count);
+        for (std::size_t i = 0; i != count; ++i) {
+            UP_TEST_TRUE(filter.contains(i));
+        }
+        for (std::size_t i = 0; i < count; i += 3) {
+            UP_TEST_TRUE(filter.erase(i));
+        }
+        for (std::size_t i = 0; i != count; ++i) {
+            if (i % 3) {
+                UP_TEST_TRUE(filter.contains(i));
+            }
+        }
+        UP_TEST_TRUE(filter.insert(count));
+        UP_TEST_TRUE(filter.contains(count));
+        // moved-from filters can be cleared and copied
+        auto moved = std::move(filter);
+        filter.clear();
+        UP_TEST_EQUAL(filter.size(), 0u);
+        UP_TEST_EQUAL(filter.table().bucket_count(), 0u);
+        auto copy = filter;
+        UP_TEST_EQUAL(copy.table().bucket_count(), 0u);
+        UP_TEST_TRUE(moved.contains(count));
+        filter = std::move(moved);
+        moved.clear();
+        UP_TEST_TRUE(filter.contains(count));
+    };
+
+    UP_TEST_CASE {
+        up::buffer buffer;
+        up::bloom_filter<int>(10).serialize(buffer);
+        bool failed = false;
+        try {
+            up::cuckoo_filter<int>::view view(buffer);
+        } catch (const up::exception&) {
+            failed = true;
+        }
+        UP_TEST_TRUE(failed);
+        failed = false;
+        try {
+            up::bloom_filter<int>::view view(up::chunk::from(buffer.warm(), buffer.available() - 1));
+        } catch (const up::exception&) {
+            failed = true;
+        }
+        UP_TEST_TRUE(failed);
+        // the number of bits overflows (to zero)
+        failed = false;
+        try {
+            up::bloom_filter<int> filter((std::numeric_limits<std::size_t>::max() >> 3) + 1, 8);
+        } catch (const up::exception&) {
+            failed = true;
+        }
+        UP_TEST_TRUE(failed);
+    };
+
+}
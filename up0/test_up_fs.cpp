@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "test_up_directory.hpp"
+#include "up_defer.hpp"
+#include "up_fs.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto names(const up::fs::origin& origin) -> std::string
+    {
+        std::vector<std::string> values;
+        for (auto&& entry : up::fs::location(origin, ".").list()) {
+            values.emplace_back(entry.name().data(), entry.name().size());
+        }
+        std::sort(values.begin(), values.end());
+        std::string result;
+        for (auto&& value : values) {
+            result.append(value).append(1, ' ');
+        }
+        return result;
+    }
+
+    void touch(const up::fs::location& location)
+    {
+        up::fs::file(location, {up::fs::file::option::write, up::fs::file::option::create});
+    }
+
+    UP_TEST_CASE {
+        // hits and misses for nested directories and the capacity
+        auto pathname = up_test::make_directory("test_up_fs");
+        auto root = up::fs::origin(up::fs::context("test"), pathname);
+        UP_DEFER { up_test::remove_directory(pathname); };
+        up::fs::location(root, "a").mkdir(0700);
+        up::fs::location(root, "a/b").mkdir(0700);
+        up::fs::location(root, "a/b/c").mkdir(0700);
+        up::fs::location(root, "d").mkdir(0700);
+        touch(up::fs::location(root, "a/b/c/x"));
+        auto cache = up::fs::origin_cache(root, 2);
+        UP_TEST_EQUAL(cache.capacity(), 2u);
+        UP_TEST_EQUAL(names(cache.resolved("a/b/c")), "x ");
+        UP_TEST_EQUAL(cache.hits(), 0u);
+        UP_TEST_EQUAL(cache.misses(), 1u);
+        UP_TEST_EQUAL(names(cache.resolved("a/b/c/")), "x ");
+        UP_TEST_EQUAL(names(cache.resolved("./a//b/c")), "x ");
+        UP_TEST_EQUAL(cache.hits(), 2u);
+        UP_TEST_EQUAL(cache.misses(), 1u);
+        // prefix of a cached entry requires a (single) lookup
+        UP_TEST_EQUAL(names(cache.resolved("a")), "b ");
+        UP_TEST_EQUAL(names(cache.resolved("a/b/c")), "x ");
+        UP_TEST_EQUAL(cache.size(), 2u);
+        UP_TEST_EQUAL(cache.hits(), 3u);
+        UP_TEST_EQUAL(cache.misses(), 2u);
+        // the least recently used entry "a" is evicted
+        UP_TEST_EQUAL(names(cache.resolved("d")), "");
+        UP_TEST_EQUAL(names(cache.resolved("a/b")), "c ");
+        UP_TEST_EQUAL(cache.size(), 2u);
+        UP_TEST_EQUAL(cache.misses(), 4u);
+        UP_TEST_TRUE(cache.located("a/b/c/x").exists());
+        // parent references and absolute pathnames bypass the cache
+        UP_TEST_EQUAL(names(cache.resolved("a/b/../b/c")), "x ");
+        UP_TEST_EQUAL(names(cache.resolved(std::string(pathname.data(), pathname.size()) + "/a/b/c")), "x ");
+        UP_TEST_EQUAL(cache.size(), 2u);
+        cache.clear();
+        UP_TEST_EQUAL(cache.size(), 0u);
+    };
+
+    UP_TEST_CASE {
+        // stale entries refer to the previous directory until invalidated
+        auto pathname = up_test::make_directory("test_up_fs");
+        auto root = up::fs::origin(up::fs::context("test"), pathname);
+        UP_DEFER { up_test::remove_directory(pathname); };
+        up::fs::location(root, "a").mkdir(0700);
+        up::fs::location(root, "a/b").mkdir(0700);
+        up::fs::location(root, "ab").mkdir(0700);
+        up::fs::location(root, "e").mkdir(0700);
+        touch(up::fs::location(root, "a/b/old"));
+        auto cache = up::fs::origin_cache(root, 8);
+        UP_TEST_EQUAL(names(cache.resolved("a/b")), "old ");
+        UP_TEST_EQUAL(names(cache.resolved("ab")), "");
+        UP_TEST_EQUAL(names(cache.resolved("e")), "");
+        up::fs::location(root, "a").rename(up::fs::location(root, "previous"), false);
+        up::fs::location(root, "a").mkdir(0700);
+        up::fs::location(root, "a/b").mkdir(0700);
+        touch(up::fs::location(root, "a/b/new"));
+        UP_TEST_EQUAL(names(cache.resolved("a/b")), "old ");
+        UP_TEST_EQUAL(names(root.resolved("a/b")), "new ");
+        // entries with similar prefixes are kept
+        cache.invalidate("a/");
+        UP_TEST_EQUAL(cache.size(), 2u);
+        UP_TEST_EQUAL(names(cache.resolved("a/b")), "new ");
+        UP_TEST_EQUAL(cache.hits(), 1u);
+        UP_TEST_EQUAL(names(cache.resolved("ab")), "");
+        UP_TEST_EQUAL(cache.hits(), 2u);
+        cache.invalidate("");
+        UP_TEST_EQUAL(cache.size(), 0u);
+    };
+
+}
@@ -1,6 +1,11 @@
 #include "up_hash.hpp"
 #include "up_test.hpp"
 
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
 namespace
 {
 
@@ -12,4 +17,91 @@ namespace
         UP_TEST_EQUAL(up::fnv1a("test", 4), UINTMAX_C(18007334074686647077));
     };
 
+    UP_TEST_CASE {
+        up::chunk::from check("123456789", 9);
+        UP_TEST_EQUAL(up::crc32({nullptr, 0}), UINT32_C(0));
+        UP_TEST_EQUAL(up::crc32(check), UINT32_C(0xcbf43926));
+        UP_TEST_EQUAL(up::crc32c({nullptr, 0}), UINT32_C(0));
+        UP_TEST_EQUAL(up::crc32c(check), UINT32_C(0xe3069283));
+        UP_TEST_EQUAL(up::adler32({nullptr, 0}), UINT32_C(1));
+        UP_TEST_EQUAL(up::adler32(check), UINT32_C(0x091e01de));
+    };
+
+    // bitwise implementation following the definition
+    auto crc32c_reference(const char* data, std::size_t size) -> uint32_t
+    {
+        uint32_t crc = ~UINT32_C(0);
+        for (std::size_t i = 0; i != size; ++i) {
+            crc ^= static_cast<unsigned char>(data[i]);
+            for (int bit = 0; bit != 8; ++bit) {
+                crc = (crc >> 1) ^ (crc & 1 ? UINT32_C(0x82f63b78) : 0);
+            }
+        }
+        return ~crc;
+    }
+
+    UP_TEST_CASE {
+        // test vectors from RFC 3720 (B.4)
+        std::string data(32, '\0');
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x8a9136aa));
+        data.assign(32, '\xff');
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x62a8ab43));
+        for (int i = 0; i != 32; ++i) {
+            data[i] = static_cast<char>(i);
+        }
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x46dd794e));
+        for (int i = 0; i != 32; ++i) {
+            data[i] = static_cast<char>(31 - i);
+        }
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x113fdb5c));
+        // the same patterns for inputs covering the long and short streams
+        data.assign(65536 + 1000, '\0');
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x5080ef0a));
+        data.assign(65536 + 1000, '\xff');
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x6eaf6ec5));
+        for (std::size_t i = 0; i != data.size(); ++i) {
+            data[i] = static_cast<char>(i);
+        }
+        UP_TEST_EQUAL(up::crc32c({data.data(), data.size()}), UINT32_C(0x2adea3cd));
+    };
+
+    UP_TEST_CASE {
+        /* Compare with zlib for different sizes and alignments, so that all
+         * code paths are covered. */
+        std::vector<char> data(3 * 8192 * 2 + 1000);
+        uint32_t state = 1;
+        for (auto&& c : data) {
+            state = state * UINT32_C(1103515245) + 12345;
+            c = static_cast<char>(state >> 24);
+        }
+        auto p = reinterpret_cast<const Bytef*>(data.data());
+        for (std::size_t offset : {0, 1, 7}) {
+            for (std::size_t size : {1, 15, 64, 100, 767, 768, 4096, 24576, 24576 * 2 + 999}) {
+                up::chunk::from chunk(data.data() + offset, size);
+                uInt n = static_cast<uInt>(size);
+                UP_TEST_EQUAL(up::crc32(chunk), ::crc32(0, p + offset, n));
+                UP_TEST_EQUAL(up::crc32(chunk, 0x12345678), ::crc32(0x12345678, p + offset, n));
+                UP_TEST_EQUAL(up::adler32(chunk), ::adler32(1, p + offset, n));
+                UP_TEST_EQUAL(up::crc32c(chunk), crc32c_reference(data.data() + offset, size));
+                UP_TEST_EQUAL(up::crc32c(chunk), up::crc32c({data.data() + offset + 1, size - 1},
+                        up::crc32c({data.data() + offset, 1})));
+            }
+        }
+    };
+
+    UP_TEST_CASE {
+        std::string a = "The quick brown fox ";
+        std::string b = "jumps over the lazy dog";
+        std::string ab = a + b;
+        up::chunk::from ca(a.data(), a.size());
+        up::chunk::from cb(b.data(), b.size());
+        up::chunk::from cab(ab.data(), ab.size());
+        UP_TEST_EQUAL(up::crc32_combine(up::crc32(ca), up::crc32(cb), b.size()), up::crc32(cab));
+        UP_TEST_EQUAL(up::crc32c_combine(up::crc32c(ca), up::crc32c(cb), b.size()), up::crc32c(cab));
+        UP_TEST_EQUAL(up::adler32_combine(up::adler32(ca), up::adler32(cb), b.size()), up::adler32(cab));
+        UP_TEST_EQUAL(up::crc32(up::chunk::from_bulk(ca, cb)), up::crc32(cab));
+        UP_TEST_EQUAL(up::crc32c(up::chunk::from_bulk(ca, up::chunk::from(nullptr, 0), cb)), up::crc32c(cab));
+        UP_TEST_EQUAL(up::adler32(up::chunk::from_bulk(ca, cb)), up::adler32(cab));
+    };
+
 }
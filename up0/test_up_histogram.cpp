@@ -0,0 +1,90 @@
+#include <limits>
+#include <thread>
+
+#include "up_histogram.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    using ns = std::chrono::nanoseconds;
+
+    UP_TEST_CASE {
+        // buckets are contiguous, and the relative error is bounded
+        using h = up::latency_histogram;
+        UP_TEST_EQUAL(h::bucket_index(0), 0u);
+        UP_TEST_EQUAL(h::bucket_index(std::numeric_limits<uint64_t>::max()), h::bucket_count - 1);
+        UP_TEST_EQUAL(h::bucket_upper_bound(h::bucket_count - 1), std::numeric_limits<uint64_t>::max());
+        bool okay = true;
+        for (std::size_t i = 0; i != h::bucket_count; ++i) {
+            auto lower = h::bucket_lower_bound(i), upper = h::bucket_upper_bound(i);
+            okay = okay && h::bucket_index(lower) == i && h::bucket_index(upper) == i;
+            okay = okay && (i == 0 || h::bucket_upper_bound(i - 1) + 1 == lower);
+            okay = okay && (upper - lower) * 32 <= lower;
+        }
+        UP_TEST_TRUE(okay);
+    };
+
+    UP_TEST_CASE {
+        up::latency_histogram histogram;
+        UP_TEST_EQUAL(histogram.count(), 0u);
+        UP_TEST_TRUE(histogram.percentile(50) == ns(0));
+        UP_TEST_TRUE(histogram.min() == ns(0));
+        // recording nothing leaves the histogram empty
+        histogram.record(ns(5), 0);
+        UP_TEST_EQUAL(histogram.count(), 0u);
+        UP_TEST_TRUE(histogram.max() == ns(0));
+        histogram.record(ns(200000), 0);
+        for (int i = 1; i <= 100; ++i) {
+            histogram.record(ns(i * 1000));
+        }
+        histogram.record(ns(-5));
+        UP_TEST_EQUAL(histogram.count(), 101u);
+        UP_TEST_TRUE(histogram.min() == ns(0));
+        UP_TEST_TRUE(histogram.max() == ns(100000));
+        UP_TEST_TRUE(histogram.mean() == ns(5050000 / 101));
+        auto p50 = histogram.percentile(50).count();
+        UP_TEST_TRUE(p50 >= 50000 && p50 <= 50000 + 50000 / 32);
+        auto p99 = histogram.percentile(99).count();
+        UP_TEST_TRUE(p99 >= 99000 && p99 <= 100000);
+        UP_TEST_TRUE(histogram.percentile(100) == ns(100000));
+        UP_TEST_TRUE(histogram.percentile(0) == ns(0));
+        UP_TEST_EQUAL(histogram.to_insight().nested().size(), 8u);
+        UP_TEST_EQUAL(histogram.to_insight().nested()[0].value(), "count");
+        UP_TEST_EQUAL(histogram.to_insight().nested()[0].nested()[0].value(), "101");
+        UP_TEST_EQUAL(histogram.to_insight().nested()[7].nested()[0].value(), "100000");
+        histogram.reset();
+        UP_TEST_EQUAL(histogram.count(), 0u);
+        UP_TEST_TRUE(histogram.max() == ns(0));
+    };
+
+    UP_TEST_CASE {
+        // per-thread histograms and a shared one give the same result
+        up::latency_histogram shared, merged;
+        std::vector<std::unique_ptr<up::latency_histogram>> locals;
+        std::vector<std::thread> threads;
+        for (int t = 0; t != 4; ++t) {
+            locals.push_back(std::make_unique<up::latency_histogram>());
+            threads.emplace_back([&, t, local = locals.back().get()]() {
+                for (int i = 0; i != 10000; ++i) {
+                    auto value = ns(t * 1000000 + i * 7);
+                    shared.record(value);
+                    local->record(value);
+                }
+            });
+        }
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+        for (auto&& local : locals) {
+            merged.merge(*local);
+        }
+        UP_TEST_EQUAL(shared.count(), 40000u);
+        UP_TEST_EQUAL(merged.count(), 40000u);
+        UP_TEST_TRUE(merged.min() == shared.min());
+        UP_TEST_TRUE(merged.max() == shared.max());
+        UP_TEST_TRUE(merged.mean() == shared.mean());
+        UP_TEST_TRUE(merged.percentile(99.9) == shared.percentile(99.9));
+    };
+
+}
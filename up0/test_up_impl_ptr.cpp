@@ -0,0 +1,91 @@
+#include <stdexcept>
+
+#include "up_impl_ptr.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    class base
+    {
+    public: // --- life ---
+        explicit base() noexcept = default;
+        base(base&& rhs) noexcept = default;
+        virtual ~base() noexcept = default;
+    public: // --- operations ---
+        virtual auto value() const -> int = 0;
+    };
+
+    class derived final : public base
+    {
+    private: // --- state ---
+        int* _counter;
+        int _value;
+    public: // --- life ---
+        explicit derived(int* counter, int value)
+            : _counter(counter), _value(value)
+        {
+            if (value < 0) {
+                throw std::invalid_argument("negative value");
+            }
+            ++*_counter;
+        }
+        derived(derived&& rhs) noexcept
+            : base(std::move(rhs)), _counter(rhs._counter), _value(rhs._value)
+        {
+            ++*_counter;
+        }
+        ~derived() noexcept override
+        {
+            --*_counter;
+        }
+    public: // --- operations ---
+        auto value() const -> int override
+        {
+            return _value;
+        }
+    };
+
+    using storage = up::fast_impl<base, 2 * sizeof(void*) + 2 * sizeof(int), alignof(void*)>;
+
+    UP_TEST_CASE {
+        int counter = 0;
+        {
+            storage a;
+            UP_TEST_FALSE(bool(a));
+            a.emplace<derived>(&counter, 1);
+            UP_TEST_TRUE(bool(a));
+            UP_TEST_EQUAL(a->value(), 1);
+            UP_TEST_EQUAL(counter, 1);
+            storage b(std::move(a));
+            UP_TEST_FALSE(bool(a));
+            UP_TEST_EQUAL(b->value(), 1);
+            UP_TEST_EQUAL(counter, 1);
+            a.emplace<derived>(&counter, 2);
+            UP_TEST_EQUAL(counter, 2);
+            swap(a, b);
+            UP_TEST_EQUAL(a->value(), 1);
+            UP_TEST_EQUAL(b->value(), 2);
+            UP_TEST_EQUAL(counter, 2);
+            a = std::move(b);
+            UP_TEST_EQUAL(a->value(), 2);
+            UP_TEST_EQUAL(counter, 1);
+            a.emplace<derived>(&counter, 3);
+            UP_TEST_EQUAL(a->value(), 3);
+            UP_TEST_EQUAL(counter, 1);
+            // strong exception guarantee
+            bool thrown = false;
+            try {
+                a.emplace<derived>(&counter, -1);
+            } catch (const std::invalid_argument&) {
+                thrown = true;
+            }
+            UP_TEST_TRUE(thrown);
+            UP_TEST_TRUE(bool(a));
+            UP_TEST_EQUAL(a->value(), 3);
+            UP_TEST_EQUAL(counter, 1);
+        }
+        UP_TEST_EQUAL(counter, 0);
+    };
+
+}
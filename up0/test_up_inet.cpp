@@ -0,0 +1,181 @@
+#include <cstring>
+
+#include <arpa/inet.h>
+
+#include "up_exception.hpp"
+#include "up_inet.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    class random final
+    {
+    private: // --- state ---
+        uint64_t _state = 42;
+    public: // --- operations ---
+        auto operator()() -> uint32_t
+        {
+            _state = _state * 6364136223846793005ull + 1442695040888963407ull;
+            return uint32_t(_state >> 32);
+        }
+    };
+
+    auto make_ipv4(uint32_t bits) -> up::ipv4::endpoint
+    {
+        auto text = std::to_string(bits >> 24) + '.' + std::to_string(bits >> 16 & 0xff)
+            + '.' + std::to_string(bits >> 8 & 0xff) + '.' + std::to_string(bits & 0xff);
+        return up::ipv4::endpoint(text);
+    }
+
+    auto matches(uint32_t prefix, std::size_t length, uint32_t bits) -> bool
+    {
+        return length == 0 || (prefix ^ bits) >> (32 - length) == 0;
+    }
+
+    UP_TEST_CASE {
+        using table = up::ipv4::prefix_table;
+        UP_TEST_EQUAL(table().find(up::ipv4::endpoint::loopback), table::npos);
+        table t({
+                table::entry(up::ipv4::endpoint("0.0.0.0"), 0, 0),
+                table::entry(up::ipv4::endpoint("10.0.0.0"), 8, 1),
+                table::entry(up::ipv4::endpoint("10.1.2.0"), 24, 2),
+                table::entry(up::ipv4::endpoint("10.1.2.3"), 32, 3),
+                table::entry(up::ipv4::endpoint("10.1.2.255"), 25, 4), // host bits are ignored
+                table::entry(up::ipv4::endpoint("192.168.0.0"), 16, 5),
+                table::entry(up::ipv4::endpoint("192.168.0.0"), 16, 6), // replaces the previous entry
+            });
+        UP_TEST_EQUAL(t.size(), 6u);
+        UP_TEST_EQUAL(t.find(up::ipv4::endpoint("1.2.3.4")), 0u);
+        UP_TEST_EQUAL(t.find(up::ipv4::endpoint("10.200.0.1")), 1u);
+        UP_TEST_EQUAL(t.find(up::ipv4::endpoint("10.1.2.4")), 2u);
+        UP_TEST_EQUAL(t.find(up::ipv4::endpoint("10.1.2.3")), 3u);
+        UP_TEST_EQUAL(t.find(up::ipv4::endpoint("10.1.2.200")), 4u);
+        UP_TEST_EQUAL(t.find(up::ipv4::endpoint("192.168.100.1")), 6u);
+        table::atomic holder(t);
+        UP_TEST_EQUAL(holder.load().find(up::ipv4::endpoint("10.1.2.3")), 3u);
+        holder.store(table());
+        UP_TEST_EQUAL(holder.load().find(up::ipv4::endpoint("10.1.2.3")), table::npos);
+    };
+
+    UP_TEST_CASE {
+        // compare with a linear search over random prefixes
+        using table = up::ipv4::prefix_table;
+        random next;
+        std::vector<std::pair<uint32_t, std::size_t>> prefixes;
+        std::vector<table::entry> entries;
+        for (uint32_t i = 0; i != 2000; ++i) {
+            // cluster the prefixes, so that they are nested
+            auto bits = (next() & 0x0f0f0fff) | 0x0a000000;
+            auto length = std::size_t(next() % 33);
+            prefixes.emplace_back(bits, length);
+            entries.emplace_back(make_ipv4(bits), length, i);
+        }
+        table t(entries);
+        for (std::size_t i = 0; i != 20000; ++i) {
+            auto bits = (next() & (i % 2 ? 0x0f0f0fff : ~0u)) | (i % 4 < 2 ? 0x0a000000 : 0);
+            auto expected = table::npos;
+            std::size_t longest = 0;
+            for (std::size_t j = 0; j != prefixes.size(); ++j) {
+                if (matches(prefixes[j].first, prefixes[j].second, bits)
+                    && (expected == table::npos || prefixes[j].second >= longest)) {
+                    expected = uint32_t(j);
+                    longest = prefixes[j].second;
+                }
+            }
+            UP_TEST_EQUAL(t.find(make_ipv4(bits)), expected);
+        }
+    };
+
+    UP_TEST_CASE {
+        using table = up::ipv6::prefix_table;
+        table t({
+                table::entry(up::ipv6::endpoint("::"), 0, 0),
+                table::entry(up::ipv6::endpoint("2001:db8::"), 32, 1),
+                table::entry(up::ipv6::endpoint("2001:db8:0:1::"), 64, 2),
+                table::entry(up::ipv6::endpoint("2001:db8:0:1::1"), 128, 3),
+                table::entry(up::ipv6::endpoint("2001:db8:0:1::1"), 127, 4),
+            });
+        UP_TEST_EQUAL(t.find(up::ipv6::endpoint("::1")), 0u);
+        UP_TEST_EQUAL(t.find(up::ipv6::endpoint("2001:db8:ffff::1")), 1u);
+        UP_TEST_EQUAL(t.find(up::ipv6::endpoint("2001:db8:0:1:ffff::1")), 2u);
+        UP_TEST_EQUAL(t.find(up::ipv6::endpoint("2001:db8:0:1::1")), 3u);
+        UP_TEST_EQUAL(t.find(up::ipv6::endpoint("2001:db8:0:1::")), 4u);
+        UP_TEST_EQUAL(t.find(up::ipv6::endpoint("2001:db8:0:1::2")), 2u);
+        UP_TEST_EQUAL(table(std::vector<table::entry>()).find(up::ipv6::endpoint("::1")), table::npos);
+        bool failed = false;
+        try {
+            table({table::entry(up::ipv6::endpoint("::"), 129, 0)});
+        } catch (const up::exception&) {
+            failed = true;
+        }
+        UP_TEST_TRUE(failed);
+    };
+
+
+    template <typename Endpoint>
+    void test_parse_and_format(int af, const std::string& text)
+    {
+        unsigned char expected[sizeof(Endpoint)];
+        bool valid = ::inet_pton(af, text.c_str(), expected) == 1;
+        auto endpoint = Endpoint::parse(text);
+        UP_TEST_EQUAL(bool(endpoint), valid);
+        if (endpoint && valid) {
+            UP_TEST_EQUAL(std::memcmp(&*endpoint, expected, sizeof(expected)), 0);
+            char buffer[Endpoint::max_size + 1];
+            UP_TEST_TRUE(::inet_ntop(af, expected, buffer, sizeof(buffer)) != nullptr);
+            UP_TEST_EQUAL(endpoint->to_string(), up::string_view(buffer));
+        }
+    }
+
+    UP_TEST_CASE {
+        // compare with inet_pton and inet_ntop
+        for (auto&& text : {
+                "", "1", "1.2.3", "1.2.3.4", "1.2.3.4.", ".1.2.3.4", "1.2.3.4.5", "1..2.3", "0.0.0.0",
+                "255.255.255.255", "256.1.1.1", "1.2.3.04", "1.2.3.0", "01.2.3.4", "1.2.3.-4", "1.2.3.4 ",
+                "1234.1.1.1", "1.2.3.4x", "00.0.0.0", "192.168.100.200", "1.2.3.\x004"}) {
+            test_parse_and_format<up::ipv4::endpoint>(AF_INET, text);
+        }
+        for (auto&& text : {
+                "", ":", "::", ":::", "::1", "1::", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9", "1:2:3:4:5:6:7::",
+                "::2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8::", "1::2::3", ":1::2", "1::2:", "12345::", "01234::",
+                "abcd:ef01:2345:6789:ABCD:EF01:2345:6789", "g::", "::ffff:1.2.3.4", "::1.2.3.4", "1.2.3.4",
+                "::ffff:1.2.3", "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4", "::1.2.3.4:5", "0:0:0:0:0:0:0:0",
+                "1:0:0:2:0:0:0:3", "1:0:0:2:0:0:3:4", "0:0:1::", "fe80::1%eth0", "::0:0:0:1", "::ffff:0:1.2.3.4"}) {
+            test_parse_and_format<up::ipv6::endpoint>(AF_INET6, text);
+        }
+        random next;
+        for (std::size_t i = 0; i != 20000; ++i) {
+            // random addresses with runs of zeros
+            unsigned char bytes[16];
+            for (std::size_t j = 0; j != 16; j += 2) {
+                auto r = next();
+                bytes[j] = r % 3 ? 0 : uint8_t(r >> 8);
+                bytes[j + 1] = r % 5 ? 0 : uint8_t(r >> 16);
+            }
+            if (i % 4 == 0) {
+                std::memset(bytes, 0, 10);
+                bytes[10] = bytes[11] = i % 8 ? 0xff : 0;
+            }
+            char buffer[INET6_ADDRSTRLEN];
+            ::inet_ntop(AF_INET6, bytes, buffer, sizeof(buffer));
+            test_parse_and_format<up::ipv6::endpoint>(AF_INET6, buffer);
+            ::inet_ntop(AF_INET, bytes + 12, buffer, sizeof(buffer));
+            test_parse_and_format<up::ipv4::endpoint>(AF_INET, buffer);
+            // random strings from a small alphabet
+            std::string text;
+            for (std::size_t j = next() % 20; j != 0; --j) {
+                text += "0123456789af:.:."[next() % 16];
+            }
+            test_parse_and_format<up::ipv4::endpoint>(AF_INET, text);
+            test_parse_and_format<up::ipv6::endpoint>(AF_INET6, text);
+        }
+        up::buffer buffer;
+        up::ip::endpoint(up::ipv4::endpoint::loopback).format(buffer);
+        up::ip::endpoint(up::ipv6::endpoint::loopback).format(buffer);
+        UP_TEST_EQUAL(up::string_view(buffer.warm(), buffer.available()), "127.0.0.1::1");
+        UP_TEST_EQUAL(up::ip::endpoint("::ffff:10.0.0.1").version(), up::ip::version::v6);
+        UP_TEST_EQUAL(up::ip::endpoint("10.0.0.1").version(), up::ip::version::v4);
+    };
+
+}
@@ -0,0 +1,40 @@
+#include "up_buffer.hpp"
+#include "up_insight.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto sample() -> up::insight
+    {
+        return up::insight(typeid(int), up::shared_string("q\"\\\n\x01\xc3\xa4\xff\xed\xa0\x80!"),
+            up::insight(typeid(bool), up::shared_string(std::string(200, 'x'))),
+            up::insight(typeid(long), up::shared_string("")));
+    }
+
+    UP_TEST_CASE {
+        up::buffer buffer;
+        {
+            up::buffer_sink sink(buffer);
+            sample().to_json(sink);
+        }
+        UP_TEST_EQUAL(std::string(buffer.warm(), buffer.available()),
+            "{\"type\":\"int\",\"value\":\"q\\\"\\\\\\n\\u0001\xc3\xa4\\ufffd\\ufffd\\ufffd\\ufffd!\","
+            "\"nested\":[{\"type\":\"bool\",\"value\":\"" + std::string(200, 'x') + "\"},"
+            "{\"type\":\"long\",\"value\":\"\"}]}");
+    };
+
+    UP_TEST_CASE {
+        up::buffer buffer;
+        {
+            up::buffer_sink sink(buffer);
+            sample().to_binary(sink);
+        }
+        auto value = std::string("q\"\\\n\x01\xc3\xa4\xff\xed\xa0\x80!");
+        auto expected = std::string("\x03int") + char(value.size()) + value + '\x02'
+            + "\x04" "bool" "\x81\x48" + std::string(200, 'x') + '\0'
+            + "\x04" "long" + '\0' + '\0';
+        UP_TEST_EQUAL(std::string(buffer.warm(), buffer.available()), expected);
+    };
+
+}
@@ -17,4 +17,87 @@ namespace
         };
     };
 
+
+    UP_TEST_CASE {
+        // arrays grow beyond the flat representation
+        up::json::value v = up::json::array{};
+        std::vector<up::json::value> versions;
+        for (std::size_t i = 0; i != 2000; ++i) {
+            versions.push_back(v);
+            v = v.with_index(i, double(i));
+        }
+        UP_TEST_EQUAL(v.get_size(), 2000u);
+        UP_TEST_TRUE(v.get_element(1234).get_number() == 1234.0);
+        auto w = v.with_index(1234, "changed");
+        UP_TEST_EQUAL(w.get_element(1234).get_string(), "changed");
+        UP_TEST_TRUE(v.get_element(1234).get_number() == 1234.0);
+        UP_TEST_EQUAL(versions[1000].get_size(), 1000u);
+        UP_TEST_EQUAL(versions[20].get_array().size(), 20u);
+        auto&& array = w.get_array();
+        UP_TEST_EQUAL(array.size(), 2000u);
+        bool okay = true;
+        for (std::size_t i = 0; i != array.size(); ++i) {
+            okay = okay && (i == 1234 || array[i].get_number() == double(i));
+        }
+        UP_TEST_TRUE(okay);
+        UP_TEST_THROWS(std::out_of_range, [&]() { v.get_element(2000); });
+        UP_TEST_THROWS(std::out_of_range, [&]() { v.with_index(2001, nullptr); });
+        UP_TEST_THROWS(std::bad_cast, [&]() { v.with("key", nullptr); });
+    };
+
+    UP_TEST_CASE {
+        // objects keep the insertion order, also in the persistent representation
+        up::json::value v = up::json::object{};
+        for (std::size_t i = 0; i != 1000; ++i) {
+            v = v.with(up::shared_string(std::to_string(i)), double(i));
+        }
+        auto w = v.with("500", true).without("10").without("missing").with("10", "again");
+        UP_TEST_EQUAL(v.get_size(), 1000u);
+        UP_TEST_EQUAL(w.get_size(), 1000u);
+        UP_TEST_TRUE(v.find_member("500")->get_number() == 500.0);
+        UP_TEST_EQUAL(w.find_member("500")->get_boolean(), true);
+        UP_TEST_TRUE(w.find_member("1000") == nullptr);
+        std::vector<std::string> keys;
+        for (auto&& pair : w.get_object()) {
+            keys.push_back(std::string(up::string_view(pair.first)));
+        }
+        UP_TEST_EQUAL(keys.size(), 1000u);
+        UP_TEST_EQUAL(keys[9], "9");
+        UP_TEST_EQUAL(keys[10], "11");
+        UP_TEST_EQUAL(keys[500], "501");
+        UP_TEST_EQUAL(keys[999], "10");
+        // removing all members
+        for (std::size_t i = 0; i != 1000; ++i) {
+            v = v.without(std::to_string(i));
+        }
+        UP_TEST_EQUAL(v.get_size(), 0u);
+        UP_TEST_TRUE(v.get_object().empty());
+        // small objects keep the flat representation
+        up::json::value s = up::json::builder::object{{"foo", 1.0}, {"bar", true}};
+        auto t = s.with("foo", 2.0).with("baz", nullptr);
+        UP_TEST_EQUAL(t.get_object().size(), 3u);
+        UP_TEST_TRUE(t.get_object().begin()->second.get_number() == 2.0);
+        UP_TEST_TRUE(s.find_member("foo")->get_number() == 1.0);
+    };
+
+    UP_TEST_CASE {
+        // removing members from large flat objects results in persistent objects
+        up::json::object members;
+        for (std::size_t i = 0; i != 100; ++i) {
+            members.emplace(up::shared_string(std::to_string(i)), double(i));
+        }
+        up::json::value v = std::move(members);
+        auto w = v.without("0");
+        auto x = w.without("1");
+        UP_TEST_EQUAL(v.get_size(), 100u);
+        UP_TEST_EQUAL(w.get_size(), 99u);
+        UP_TEST_EQUAL(x.get_size(), 98u);
+        UP_TEST_TRUE(w.find_member("0") == nullptr);
+        UP_TEST_TRUE(x.find_member("1") == nullptr);
+        // the persistent objects share the unchanged members
+        UP_TEST_TRUE(w.find_member("50") == x.find_member("50"));
+        UP_TEST_TRUE(v.find_member("50") != w.find_member("50"));
+        UP_TEST_EQUAL(x.get_object().begin()->first, "2");
+    };
+
 }
@@ -0,0 +1,169 @@
+#include "up_exception.hpp"
+#include "up_json_schema.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    using jb = up::json::builder;
+    using token = up::json::token;
+    using status = up::json_schema::status;
+
+    auto pattern(const char* source) -> up::json_schema
+    {
+        return up::json_schema(jb::object{{"type", "string"}, {"pattern", source}});
+    }
+
+    UP_TEST_CASE {
+        up::json_schema schema(jb::object{
+            {"type", "object"},
+            {"properties", jb::object{
+                {"id", true},
+                {"name", jb::object{{"type", "string"}, {"minLength", 1.0}, {"maxLength", 8.0}}},
+                {"age", jb::object{{"type", "integer"}, {"minimum", 0.0}, {"exclusiveMaximum", 150.0}}},
+                {"tags", jb::object{
+                    {"type", "array"},
+                    {"items", jb::object{{"enum", jb::array{"a", "b", nullptr}}}},
+                    {"maxItems", 3.0},
+                }},
+            }},
+            {"required", jb::array{"name", "id"}},
+            {"patternProperties", jb::object{{"^x-", jb::object{{"type", "boolean"}}}}},
+            {"additionalProperties", false},
+        });
+        UP_TEST_TRUE(schema.accepts(jb::object{{"name", "n\xc3\xa4me"}, {"id", 1.0}, {"age", 42.0}}));
+        UP_TEST_TRUE(schema.accepts(jb::object{{"id", nullptr}, {"name", "x"}, {"x-flag", true}}));
+        UP_TEST_TRUE(schema.accepts(jb::object{{"id", 0.0}, {"name", "x"}, {"tags", jb::array{"a", nullptr}}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}})); // missing id
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", ""}, {"id", 1.0}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "123456789"}, {"id", 1.0}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}, {"id", 1.0}, {"age", 1.5}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}, {"id", 1.0}, {"age", 150.0}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}, {"id", 1.0}, {"x-flag", 1.0}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}, {"id", 1.0}, {"other", 1.0}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}, {"id", 1.0}, {"tags", jb::array{"c"}}}));
+        UP_TEST_FALSE(schema.accepts(jb::object{{"name", "x"}, {"id", 1.0}, {"tags", jb::array{"a", "a", "a", "a"}}}));
+        UP_TEST_FALSE(schema.accepts(jb::array{}));
+    };
+
+    UP_TEST_CASE {
+        // draft-04 boolean exclusiveMinimum and exclusiveMaximum apply to their own bound
+        up::json_schema lower(jb::object{{"minimum", 0.0}, {"exclusiveMinimum", true}, {"maximum", 10.0}});
+        UP_TEST_FALSE(lower.accepts(0.0));
+        UP_TEST_TRUE(lower.accepts(5.0));
+        UP_TEST_TRUE(lower.accepts(10.0));
+        UP_TEST_FALSE(lower.accepts(10.5));
+        up::json_schema upper(jb::object{{"minimum", 0.0}, {"maximum", 10.0}, {"exclusiveMaximum", true}});
+        UP_TEST_TRUE(upper.accepts(0.0));
+        UP_TEST_FALSE(upper.accepts(10.0));
+        up::json_schema neither(jb::object{{"minimum", 0.0}, {"exclusiveMinimum", false}, {"maximum", 10.0}});
+        UP_TEST_TRUE(neither.accepts(0.0));
+        UP_TEST_TRUE(neither.accepts(10.0));
+    };
+
+    UP_TEST_CASE {
+        // combinators and recursive references
+        up::json_schema schema(jb::object{
+            {"definitions", jb::object{
+                {"tree", jb::object{
+                    {"type", "array"},
+                    {"items", jb::object{{"anyOf", jb::array{
+                        jb::object{{"$ref", "#/definitions/tree"}},
+                        jb::object{{"type", "number"}, {"multipleOf", 0.5}},
+                    }}}},
+                }},
+            }},
+            {"oneOf", jb::array{
+                jb::object{{"$ref", "#/definitions/tree"}},
+                jb::object{{"type", "string"}, {"not", jb::object{{"const", "forbidden"}}}},
+            }},
+        });
+        UP_TEST_TRUE(schema.accepts(jb::array{1.0, jb::array{2.5, jb::array{}}, 3.0}));
+        UP_TEST_FALSE(schema.accepts(jb::array{1.0, jb::array{2.25}}));
+        UP_TEST_FALSE(schema.accepts(jb::array{"text"}));
+        UP_TEST_TRUE(schema.accepts("allowed"));
+        UP_TEST_FALSE(schema.accepts("forbidden"));
+        UP_TEST_FALSE(schema.accepts(true));
+        UP_TEST_THROWS(up::exception, []() {
+            up::json_schema(jb::object{{"$ref", "#/definitions/missing"}});
+        });
+        UP_TEST_THROWS(up::exception, []() {
+            up::json_schema(jb::object{{"allOf", jb::array{jb::object{{"$ref", "#"}}}}});
+        });
+        UP_TEST_THROWS(up::exception, []() { up::json_schema(jb::object{{"uniqueItems", true}}); });
+    };
+
+    UP_TEST_CASE {
+        UP_TEST_TRUE(pattern("^[a-z][a-z0-9_-]*$").accepts("abc_1-2"));
+        UP_TEST_FALSE(pattern("^[a-z][a-z0-9_-]*$").accepts("1abc"));
+        UP_TEST_TRUE(pattern("b+c").accepts("abbbcd"));
+        UP_TEST_FALSE(pattern("b+c").accepts("ac"));
+        UP_TEST_TRUE(pattern("^(?:ab|cd){2,3}$").accepts("abcdab"));
+        UP_TEST_FALSE(pattern("^(?:ab|cd){2,3}$").accepts("ab"));
+        UP_TEST_FALSE(pattern("^(?:ab|cd){2,3}$").accepts("abababab"));
+        UP_TEST_TRUE(pattern("^\\d{3}-\\d{4}$").accepts("555-1234"));
+        UP_TEST_TRUE(pattern("^.$").accepts("\xc3\xa4"));
+        UP_TEST_FALSE(pattern("^.$").accepts("ab"));
+        UP_TEST_TRUE(pattern("^[^a]$").accepts("\xe2\x82\xac"));
+        UP_TEST_TRUE(pattern("^x|y$").accepts("xz"));
+        UP_TEST_FALSE(pattern("^x|y$").accepts("zx"));
+        UP_TEST_TRUE(pattern("\\.json$").accepts("a.json"));
+        UP_TEST_FALSE(pattern("\\.json$").accepts("ajson"));
+        UP_TEST_THROWS(up::exception, []() { pattern("(a"); });
+        UP_TEST_THROWS(up::exception, []() { pattern("(a)\\1"); });
+        UP_TEST_THROWS(up::exception, []() { pattern("(?=a)"); });
+    };
+
+    UP_TEST_CASE {
+        // streaming rejects on the first offending token
+        up::json_schema schema(jb::object{
+            {"type", "array"},
+            {"items", jb::object{{"type", "object"}, {"required", jb::array{"id"}}}},
+        });
+        auto session = schema.start();
+        UP_TEST_TRUE(session.feed(token(token::kind::begin_array)) == status::pending);
+        UP_TEST_TRUE(session.feed(token(token::kind::begin_object)) == status::pending);
+        UP_TEST_TRUE(session.feed(token(token::kind::key, "id")) == status::pending);
+        UP_TEST_TRUE(session.feed(token(1.0)) == status::pending);
+        UP_TEST_TRUE(session.feed(token(token::kind::end_object)) == status::pending);
+        UP_TEST_TRUE(session.feed(token(token::kind::begin_object)) == status::pending);
+        UP_TEST_TRUE(session.feed(token(token::kind::end_object)) == status::rejected);
+        UP_TEST_TRUE(session.feed(token(token::kind::end_array)) == status::rejected);
+        session = schema.start();
+        session.feed(token(token::kind::begin_array));
+        UP_TEST_TRUE(session.feed(token(token::kind::end_array)) == status::accepted);
+        UP_TEST_TRUE(session.feed(token(token::kind::null)) == status::rejected);
+        // malformed token sequences
+        session = schema.start();
+        session.feed(token(token::kind::begin_array));
+        UP_TEST_TRUE(session.feed(token(token::kind::end_object)) == status::rejected);
+        session = up::json_schema(jb::object{}).start();
+        session.feed(token(token::kind::begin_object));
+        UP_TEST_TRUE(session.feed(token(true)) == status::rejected);
+    };
+
+    UP_TEST_CASE {
+        up::json_schema schema(jb::object{
+            {"type", "object"},
+            {"properties", jb::object{{"name", jb::object{{"pattern", "^[a-z]+$"}}}}},
+            {"required", jb::array{"name"}},
+        });
+        auto insight = schema.to_insight();
+        UP_TEST_EQUAL(insight.value(), "json-schema");
+        UP_TEST_EQUAL(insight.nested().size(), 3u);
+        auto&& keywords = insight.nested()[0].nested();
+        UP_TEST_EQUAL(keywords.size(), 3u);
+        UP_TEST_EQUAL(keywords[0].value(), "type");
+        UP_TEST_EQUAL(keywords[1].value(), "properties");
+        UP_TEST_EQUAL(keywords[2].value(), "required");
+        UP_TEST_EQUAL(insight.nested()[1].value(), "nodes");
+        UP_TEST_EQUAL(insight.nested()[1].nested()[0].value(), "2");
+        UP_TEST_EQUAL(insight.nested()[2].value(), "patterns");
+        UP_TEST_EQUAL(insight.nested()[2].nested()[0].value(), "1");
+        auto never = up::json_schema(false).to_insight();
+        UP_TEST_TRUE(never.nested()[0].nested().empty());
+        UP_TEST_EQUAL(never.nested()[1].value(), "nodes");
+        UP_TEST_EQUAL(never.nested()[1].nested()[0].value(), "1");
+    };
+
+}
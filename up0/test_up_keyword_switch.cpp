@@ -0,0 +1,63 @@
+#include "up_exception.hpp"
+#include "up_keyword_switch.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    using namespace up::literals;
+
+    UP_TEST_CASE {
+        static constexpr auto headers = up::make_keyword_switch(
+            "accept"_sl, "accept-encoding"_sl, "accept-language"_sl, "authorization"_sl,
+            "cache-control"_sl, "connection"_sl, "content-encoding"_sl, "content-language"_sl,
+            "content-length"_sl, "content-location"_sl, "content-type"_sl, "cookie"_sl,
+            "date"_sl, "etag"_sl, "expect"_sl, "expires"_sl, "host"_sl, "if-match"_sl,
+            "if-modified-since"_sl, "if-none-match"_sl, "if-unmodified-since"_sl,
+            "last-modified"_sl, "location"_sl, "range"_sl, "referer"_sl, "server"_sl,
+            "set-cookie"_sl, "transfer-encoding"_sl, "upgrade"_sl, "user-agent"_sl, "vary"_sl,
+            "via"_sl, "x-forwarded-for"_sl, "x-forwarded-host"_sl, "x-forwarded-proto"_sl,
+            ""_sl, "a"_sl, "ab"_sl, "abc"_sl);
+        static_assert(headers.size() == 39);
+        for (std::size_t i = 0; i != headers.size(); ++i) {
+            up::string_view keyword(headers[i].data(), headers[i].size());
+            UP_TEST_EQUAL(headers.find(keyword), i);
+            auto other = up::unique_string(keyword);
+            other += 'x';
+            UP_TEST_EQUAL(headers.find(other), headers.npos);
+            if (!keyword.empty()) {
+                other = keyword.substr(0, keyword.size() - 1);
+                UP_TEST_TRUE(headers.find(other) != i);
+            }
+        }
+        UP_TEST_EQUAL(headers.find("Accept"), headers.npos);
+        UP_TEST_EQUAL(headers.find("acceptx"), headers.npos);
+    };
+
+    UP_TEST_CASE {
+        // keywords that differ only in the middle require hashing all bytes
+        static constexpr auto names = up::make_keyword_switch(
+            "prefix-0-and-a-long-suffix"_sl, "prefix-1-and-a-long-suffix"_sl,
+            "prefix-2-and-a-long-suffix"_sl, "prefix-and-a-long-suffix"_sl);
+        UP_TEST_EQUAL(names.find("prefix-0-and-a-long-suffix"), 0u);
+        UP_TEST_EQUAL(names.find("prefix-1-and-a-long-suffix"), 1u);
+        UP_TEST_EQUAL(names.find("prefix-2-and-a-long-suffix"), 2u);
+        UP_TEST_EQUAL(names.find("prefix-and-a-long-suffix"), 3u);
+        UP_TEST_EQUAL(names.find("prefix-3-and-a-long-suffix"), names.npos);
+    };
+
+    UP_TEST_CASE {
+        enum class verb { get, put, post, unknown, };
+        static constexpr auto verbs = up::make_keyword_switch("GET"_sl, "PUT"_sl, "POST"_sl);
+        UP_TEST_TRUE(verbs.find("GET", verb::get, verb::unknown) == verb::get);
+        UP_TEST_TRUE(verbs.find("PUT", verb::get, verb::unknown) == verb::put);
+        UP_TEST_TRUE(verbs.find("POST", verb::get, verb::unknown) == verb::post);
+        UP_TEST_TRUE(verbs.find("HEAD", verb::get, verb::unknown) == verb::unknown);
+    };
+
+    UP_TEST_CASE {
+        // duplicates are rejected (at runtime, if not constructed in a constant expression)
+        UP_TEST_THROWS(up::exception, []() { up::make_keyword_switch("GET"_sl, "PUT"_sl, "GET"_sl); });
+    };
+
+}
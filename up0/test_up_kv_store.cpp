@@ -0,0 +1,177 @@
+#include <thread>
+
+#include "test_up_directory.hpp"
+#include "up_defer.hpp"
+#include "up_exception.hpp"
+#include "up_kv_store.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto get(const up::kv_store& store, const up::string_view& key) -> std::string
+    {
+        auto value = store.get(key);
+        return value ? std::string(value->warm(), value->available()) : std::string("<none>");
+    }
+
+    void put(const up::kv_store& store, const up::string_view& key, const std::string& value)
+    {
+        store.put(key, up::chunk::from(value.data(), value.size()));
+    }
+
+    auto data_size(const up::fs::origin& directory) -> off_t
+    {
+        return up::fs::location(directory, "data").stat().size();
+    }
+
+    UP_TEST_CASE {
+        auto pathname = up_test::make_directory("test_up_kv_store");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        {
+            auto store = up::kv_store(directory);
+            UP_TEST_EQUAL(store.size(), 0u);
+            UP_TEST_EQUAL(get(store, "a"), "<none>");
+            UP_TEST_FALSE(store.erase("a"));
+            put(store, "a", "alpha");
+            put(store, "b", "");
+            put(store, "", "empty");
+            UP_TEST_EQUAL(store.size(), 3u);
+            UP_TEST_EQUAL(store.garbage(), 0u);
+            UP_TEST_EQUAL(get(store, "a"), "alpha");
+            UP_TEST_EQUAL(get(store, "b"), "");
+            UP_TEST_EQUAL(get(store, ""), "empty");
+            put(store, "a", "again");
+            UP_TEST_EQUAL(get(store, "a"), "again");
+            UP_TEST_TRUE(store.garbage() != 0);
+            UP_TEST_TRUE(store.erase("b"));
+            UP_TEST_FALSE(store.erase("b"));
+            UP_TEST_EQUAL(get(store, "b"), "<none>");
+            UP_TEST_EQUAL(store.size(), 2u);
+            store.sync();
+        }
+        auto store = up::kv_store(directory);
+        UP_TEST_EQUAL(store.size(), 2u);
+        UP_TEST_EQUAL(get(store, "a"), "again");
+        UP_TEST_EQUAL(get(store, "b"), "<none>");
+        UP_TEST_EQUAL(get(store, ""), "empty");
+    };
+
+    UP_TEST_CASE {
+        // reopen after a crash in the middle of a record
+        auto pathname = up_test::make_directory("test_up_kv_store");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        off_t size;
+        uint64_t garbage;
+        {
+            auto store = up::kv_store(directory);
+            put(store, "a", "alpha");
+            put(store, "a", "first");
+            size = data_size(directory);
+            garbage = store.garbage();
+            put(store, "b", std::string(1000, 'b'));
+            store.sync();
+        }
+        up::fs::file(up::fs::location(directory, "data"), {up::fs::file::option::write}).truncate(size + 500);
+        {
+            auto store = up::kv_store(directory);
+            UP_TEST_TRUE(data_size(directory) == size);
+            UP_TEST_EQUAL(store.size(), 1u);
+            UP_TEST_EQUAL(store.garbage(), garbage);
+            UP_TEST_EQUAL(get(store, "a"), "first");
+            UP_TEST_EQUAL(get(store, "b"), "<none>");
+            put(store, "c", "gamma");
+            store.sync();
+        }
+        // the snapshot of the index is used, and the later records are scanned
+        {
+            auto store = up::kv_store(directory);
+            store.save_index();
+            put(store, "d", "delta");
+            store.sync();
+        }
+        auto store = up::kv_store(directory);
+        UP_TEST_EQUAL(store.size(), 3u);
+        UP_TEST_EQUAL(get(store, "c"), "gamma");
+        UP_TEST_EQUAL(get(store, "d"), "delta");
+    };
+
+    UP_TEST_CASE {
+        // corrupt records are only truncated at the end of the data file
+        auto pathname = up_test::make_directory("test_up_kv_store");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        off_t offset;
+        off_t size;
+        {
+            auto store = up::kv_store(directory);
+            put(store, "a", "alpha");
+            offset = data_size(directory);
+            put(store, "b", "beta");
+            put(store, "c", "gamma");
+            store.sync();
+            size = data_size(directory);
+        }
+        // overwrite the first byte of the value (after framing, sizes and key)
+        auto file = up::fs::file(up::fs::location(directory, "data"), {up::fs::file::option::write});
+        file.write_all(up::chunk::from("X", 1), offset + 5 + 2 + 1);
+        UP_TEST_THROWS(up::exception, [&]() { auto store = up::kv_store(directory); });
+        UP_TEST_TRUE(data_size(directory) == size);
+        file.write_all(up::chunk::from("b", 1), offset + 5 + 2 + 1);
+        auto store = up::kv_store(directory);
+        UP_TEST_EQUAL(store.size(), 3u);
+        UP_TEST_EQUAL(get(store, "b"), "beta");
+    };
+
+    UP_TEST_CASE {
+        // compaction with overwritten and erased keys
+        auto pathname = up_test::make_directory("test_up_kv_store");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        uint64_t garbage;
+        {
+            auto store = up::kv_store(directory);
+            for (int i = 0; i != 100; ++i) {
+                put(store, std::to_string(i % 10), std::to_string(i));
+            }
+            UP_TEST_TRUE(store.erase("3"));
+            auto before = data_size(directory);
+            store.compact();
+            UP_TEST_EQUAL(store.garbage(), 0u);
+            UP_TEST_TRUE(data_size(directory) < before);
+            UP_TEST_EQUAL(store.size(), 9u);
+            UP_TEST_EQUAL(get(store, "3"), "<none>");
+            UP_TEST_EQUAL(get(store, "7"), "97");
+            // overwrite keys concurrently with another compaction
+            std::thread thread([&]() {
+                for (int i = 0; i != 1000; ++i) {
+                    put(store, std::to_string(i % 20), std::to_string(i));
+                    if (i % 7 == 0) {
+                        store.erase(std::to_string(i % 20));
+                    }
+                }
+            });
+            store.compact();
+            thread.join();
+            UP_TEST_EQUAL(get(store, "19"), "999");
+            UP_TEST_EQUAL(get(store, "1"), "981");
+            UP_TEST_EQUAL(get(store, "7"), "<none>");
+            store.sync();
+            garbage = store.garbage();
+        }
+        // the garbage is consistent with the snapshot and with a full scan
+        {
+            auto store = up::kv_store(directory);
+            UP_TEST_EQUAL(store.garbage(), garbage);
+            UP_TEST_EQUAL(store.size(), 17u);
+        }
+        up::fs::location(directory, "index").unlink();
+        auto store = up::kv_store(directory);
+        UP_TEST_EQUAL(store.garbage(), garbage);
+        UP_TEST_EQUAL(store.size(), 17u);
+        UP_TEST_EQUAL(get(store, "19"), "999");
+    };
+
+}
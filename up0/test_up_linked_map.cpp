@@ -10,4 +10,67 @@ namespace
         map.emplace("bar", 2);
     };
 
+    UP_TEST_CASE {
+        using map = up::linked_map<int, int>;
+        map values;
+        for (int i = 0; i != 20; ++i) {
+            values.emplace(i * 31, i);
+            UP_TEST_EQUAL(values.size(), std::size_t(i + 1));
+            UP_TEST_EQUAL(values.bucket_count() == 0, values.size() <= map::small_size);
+            for (int j = 0; j <= i; ++j) {
+                UP_TEST_EQUAL(values.at(j * 31), j);
+            }
+            UP_TEST_EQUAL(values.count(-1), 0u);
+        }
+        map other(std::move(values));
+        UP_TEST_TRUE(values.begin() == values.end());
+        int expected = 0;
+        for (auto&& entry : other) {
+            UP_TEST_EQUAL(entry.second, expected++);
+        }
+        UP_TEST_EQUAL(expected, 20);
+        values.emplace(1, 1);
+        swap(values, other);
+        UP_TEST_EQUAL(values.size(), 20u);
+        UP_TEST_EQUAL(std::distance(values.begin(), values.end()), 20);
+        UP_TEST_EQUAL(std::distance(other.begin(), other.end()), 1);
+        UP_TEST_EQUAL(values.erase(31), 1u);
+        UP_TEST_EQUAL(values.count(31), 0u);
+        UP_TEST_EQUAL(values.size(), 19u);
+    };
+
+    class view_hash final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        auto operator()(const up::string_view& value) const noexcept -> std::size_t
+        {
+            return std::hash<up::string_view>()(value);
+        }
+    };
+
+    class view_equal final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        bool operator()(const up::string_view& lhs, const up::string_view& rhs) const noexcept
+        {
+            return lhs == rhs;
+        }
+    };
+
+    UP_TEST_CASE {
+        // heterogeneous lookups with transparent hasher and predicate
+        up::linked_map<up::shared_string, int, view_hash, view_equal> map;
+        UP_TEST_TRUE(map.find(up::string_view("a")) == map.end());
+        for (int i = 0; i != 20; ++i) {
+            map.emplace(up::shared_string(std::to_string(i)), i);
+            UP_TEST_EQUAL(map.find(up::string_view(std::to_string(i)))->second, i);
+        }
+        UP_TEST_EQUAL(map.count(up::string_view("13")), 1u);
+        UP_TEST_EQUAL(map.count(up::string_view("20")), 0u);
+    };
+
 }
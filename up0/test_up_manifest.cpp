@@ -0,0 +1,152 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "test_up_directory.hpp"
+#include "up_defer.hpp"
+#include "up_exception.hpp"
+#include "up_hash.hpp"
+#include "up_manifest.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    void write(const up::fs::origin& root, const up::shared_string& path, const std::string& content)
+    {
+        auto file = up::fs::file(up::fs::location(root, path),
+            {up::fs::file::option::write, up::fs::file::option::create, up::fs::file::option::truncate});
+        file.write_all({content.data(), content.size()}, 0);
+    }
+
+    /* The resolution of modification times might be coarse, so that the
+     * following modifications might not be visible otherwise. */
+    void backdate(const up::shared_string& pathname, const char* path)
+    {
+        auto absolute = std::string(pathname.data(), pathname.size()).append(1, '/').append(path);
+        struct timespec times[2] = {{1000000000, 0}, {1000000000, 0}};
+        UP_TEST_EQUAL(::utimensat(AT_FDCWD, absolute.c_str(), times, AT_SYMLINK_NOFOLLOW), 0);
+    }
+
+    auto paths(const up::manifest& manifest) -> std::string
+    {
+        std::string result;
+        for (auto&& entry : manifest.entries()) {
+            result.append(entry.path().data(), entry.path().size()).append(1, ' ');
+        }
+        return result;
+    }
+
+    auto changes(const up::manifest::changes& values) -> std::string
+    {
+        std::string result;
+        for (auto&& value : values) {
+            result.append(1, "+-*"[static_cast<int>(value.second)]);
+            result.append(value.first.data(), value.first.size()).append(1, ' ');
+        }
+        return result;
+    }
+
+    auto digest(const up::manifest& manifest, const up::string_view& path) -> std::string
+    {
+        auto entry = manifest.find(path);
+        if (entry == nullptr || !entry->digest()) {
+            return "<none>";
+        }
+        auto hex = entry->digest()->to_hex();
+        return std::string(hex.data(), hex.size());
+    }
+
+    auto sha256(const std::string& content) -> std::string
+    {
+        auto hex = up::sha256::hash({content.data(), content.size()}).to_hex();
+        return std::string(hex.data(), hex.size());
+    }
+
+    UP_TEST_CASE {
+        // build, store and load, and verify against a modified tree
+        auto pathname = up_test::make_directory("test_up_manifest");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto root = up::fs::origin(up::fs::context("test"), pathname);
+        up::fs::location(root, "d").mkdir(0700);
+        up::fs::location(root, "d/e").mkdir(0700);
+        write(root, "a", "alpha");
+        write(root, "d/b", "beta");
+        write(root, "d/e/c", "gamma");
+        write(root, "d-", "");
+        for (auto path : {"d", "d/e", "d/b"}) {
+            backdate(pathname, path);
+        }
+        auto manifest = up::manifest::scan(root, up::manifest(), 2);
+        UP_TEST_EQUAL(paths(manifest), "a d d/b d/e d/e/c d- ");
+        UP_TEST_EQUAL(digest(manifest, "a"), sha256("alpha"));
+        UP_TEST_EQUAL(digest(manifest, "d/e/c"), sha256("gamma"));
+        UP_TEST_EQUAL(digest(manifest, "d"), "<none>");
+        UP_TEST_TRUE(manifest.find("x") == nullptr);
+        UP_TEST_EQUAL(changes(manifest.compare(manifest)), "");
+        manifest.store(root, "manifest");
+        auto loaded = up::manifest::load(root, "manifest");
+        up::fs::location(root, "manifest").unlink();
+        UP_TEST_EQUAL(paths(loaded), paths(manifest));
+        UP_TEST_EQUAL(digest(loaded, "d/b"), sha256("beta"));
+        UP_TEST_EQUAL(changes(loaded.compare(manifest)), "");
+        // without digests, only the metadata is compared
+        auto plain = up::manifest::scan(root, up::manifest(), 0);
+        UP_TEST_EQUAL(digest(plain, "a"), "<none>");
+        UP_TEST_EQUAL(changes(plain.compare(manifest)), "");
+        // verify the tree after some changes
+        write(root, "d/b", "BETA");
+        write(root, "d/e/f", "");
+        up::fs::location(root, "a").unlink();
+        auto current = up::manifest::scan(root, manifest, 1);
+        UP_TEST_EQUAL(paths(current), "d d/b d/e d/e/c d/e/f d- ");
+        UP_TEST_EQUAL(changes(current.compare(manifest)), "-a *d/b +d/e/f ");
+        UP_TEST_EQUAL(digest(current, "d/b"), sha256("BETA"));
+        UP_TEST_EQUAL(digest(current, "d/e/c"), sha256("gamma"));
+    };
+
+    UP_TEST_CASE {
+        // entries vanishing during the scan are skipped
+        auto pathname = up_test::make_directory("test_up_manifest");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto root = up::fs::origin(up::fs::context("test"), pathname);
+        up::fs::location(root, "d").mkdir(0700);
+        up::fs::location(root, "d/e").mkdir(0700);
+        write(root, "d/b", "beta");
+        write(root, "d/c", "gamma");
+        write(root, "d/e/f", "");
+        auto previous = up::manifest::scan(root, up::manifest(), 1);
+        /* Names of unchanged directories are taken from the previous
+         * manifest. Restoring the modification time of the directory after
+         * removing entries simulates the removal between the listing and
+         * the following stat. */
+        auto directory = std::string(pathname.data(), pathname.size()) + "/d";
+        struct stat st;
+        UP_TEST_EQUAL(::stat(directory.c_str(), &st), 0);
+        up::fs::location(root, "d/b").unlink();
+        up::fs::location(root, "d/e/f").unlink();
+        up::fs::location(root, "d/e").rmdir();
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+        UP_TEST_EQUAL(::utimensat(AT_FDCWD, directory.c_str(), times, 0), 0);
+        auto current = up::manifest::scan(root, previous, 1);
+        UP_TEST_EQUAL(paths(current), "d d/c ");
+        UP_TEST_EQUAL(digest(current, "d/c"), sha256("gamma"));
+        UP_TEST_EQUAL(changes(current.compare(previous)), "-d/b -d/e -d/e/f ");
+    };
+
+    UP_TEST_CASE {
+        // reject unknown kinds
+        auto decode = [](char kind) {
+            // magic, count, shared, suffix, path, kind, inode, size, mtime, flag
+            std::string data("manifest\x01\x00\x01" "a", 12);
+            data.append(1, kind).append(4, '\0');
+            uint32_t crc = up::crc32({data.data(), data.size()});
+            for (std::size_t i = 0; i != 4; ++i) {
+                data.append(1, char(crc >> (8 * i)));
+            }
+            return up::manifest::decode({data.data(), data.size()});
+        };
+        UP_TEST_EQUAL(paths(decode(char(up::fs::kind::regular_file))), "a ");
+        UP_TEST_THROWS(up::exception, [&]() { decode(char(up::fs::kind::socket) + 1); });
+    };
+
+}
@@ -0,0 +1,46 @@
+#include <cstring>
+
+#include "up_nts.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    UP_TEST_CASE {
+        for (std::size_t size : {0, 1, 15, 16, 63, 64, 65, 1000}) {
+            auto expected = std::string(size, 'x');
+            up::shared_string shared(expected);
+            up::nts nts(shared);
+            UP_TEST_EQUAL(std::strlen(nts), size);
+            UP_TEST_EQUAL(up::string_view(nts), expected);
+            // long strings with shared storage are not copied
+            UP_TEST_EQUAL(static_cast<const char*>(nts) == shared.data(), size >= 64);
+            up::unique_string unique(expected);
+            UP_TEST_EQUAL(up::string_view(up::nts(unique)), expected);
+            UP_TEST_TRUE(static_cast<const char*>(up::nts(unique)) != unique.data());
+        }
+    };
+
+    UP_TEST_CASE {
+        // the storage outlives the string
+        auto nts = up::nts(up::shared_string(std::string(100, 'y')));
+        UP_TEST_EQUAL(up::string_view(nts), std::string(100, 'y'));
+        up::nts other;
+        other = std::move(nts);
+        UP_TEST_EQUAL(up::string_view(other), std::string(100, 'y'));
+        // modifications of unique strings keep the storage terminated
+        up::unique_string unique(std::string(200, 'z'));
+        unique.resize(150);
+        up::shared_string shared(std::move(unique));
+        UP_TEST_EQUAL(std::strlen(up::nts(shared)), 150u);
+    };
+
+    UP_TEST_CASE {
+        // nullable representations
+        using nullable = up::string_repr::handle<false, true>;
+        UP_TEST_TRUE(static_cast<const char*>(up::nts(nullable(nullptr))) == nullptr);
+        nullable value(up::shared_string(std::string(80, 'v')).repr());
+        UP_TEST_EQUAL(up::string_view(up::nts(value)), std::string(80, 'v'));
+    };
+
+}
@@ -0,0 +1,252 @@
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "up_ordered_map.hpp"
+#include "up_string.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    template <typename Map, typename Expected>
+    bool check_map(const Map& map, const Expected& expected)
+    {
+        auto equal = [](auto&& lhs, auto&& rhs) {
+            return lhs.first == rhs.first && lhs.second == rhs.second;
+        };
+        if (map.size() != expected.size()
+            || !std::equal(map.begin(), map.end(), expected.begin(), expected.end(), equal)
+            || !std::equal(map.rbegin(), map.rend(), expected.rbegin(), expected.rend(), equal)) {
+            return false;
+        }
+        for (auto&& entry : expected) {
+            auto p = map.find(entry.first);
+            if (p == map.end() || p->second != entry.second) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Key>
+    auto make_key(std::size_t value) -> Key
+    {
+        if constexpr (std::is_arithmetic<Key>::value) {
+            return Key(value);
+        } else {
+            return Key(std::to_string(value));
+        }
+    }
+
+    template <typename Map>
+    void test_random(std::size_t rounds, std::size_t range)
+    {
+        using key_type = typename Map::key_type;
+        Map map;
+        std::map<key_type, int, typename Map::key_compare> expected;
+        uint64_t state = 42;
+        auto next = [&] {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            return std::size_t(state >> 33) % range;
+        };
+        for (std::size_t i = 0; i != rounds; ++i) {
+            auto key = make_key<key_type>(next());
+            if (i % 5 < 3) {
+                auto result = map.emplace(key, int(i));
+                UP_TEST_EQUAL(result.second, expected.emplace(key, int(i)).second);
+                UP_TEST_TRUE(result.first->first == key);
+            } else if (i % 5 == 3) {
+                UP_TEST_EQUAL(map.erase(key), expected.erase(key));
+            } else {
+                auto p = map.lower_bound(key);
+                auto q = expected.lower_bound(key);
+                if (q == expected.end()) {
+                    UP_TEST_TRUE(p == map.end());
+                } else {
+                    UP_TEST_TRUE(p->first == q->first);
+                    // the result points to the entry after the erased one
+                    auto r = map.erase(p);
+                    auto s = expected.erase(q);
+                    UP_TEST_TRUE(s == expected.end() ? r == map.end() : r->first == s->first);
+                }
+            }
+            if (i % 97 == 0) {
+                UP_TEST_TRUE(check_map(map, expected));
+            }
+        }
+        UP_TEST_TRUE(check_map(map, expected));
+        auto copy = map;
+        UP_TEST_TRUE(check_map(copy, expected));
+        UP_TEST_TRUE(copy == map);
+        while (!copy.empty()) {
+            copy.erase(std::prev(copy.end()));
+        }
+        for (auto&& entry : expected) {
+            UP_TEST_EQUAL(map.erase(entry.first), 1u);
+        }
+        UP_TEST_TRUE(map.empty());
+        UP_TEST_TRUE(map.begin() == map.end());
+    }
+
+    UP_TEST_CASE {
+        test_random<up::ordered_map<int, int>>(20000, 2000);
+        test_random<up::ordered_map<int, int, std::less<int>, 64>>(20000, 2000);
+        test_random<up::ordered_map<int, int, std::greater<int>, 64>>(20000, 500);
+        test_random<up::ordered_map<up::shared_string, int, std::less<up::shared_string>, 128>>(5000, 1000);
+    };
+
+    UP_TEST_CASE {
+        for (int n : {0, 1, 2, 3, 4, 5, 8, 9, 100, 1000, 5000}) {
+            std::map<int, int> expected;
+            for (int i = 0; i != n; ++i) {
+                expected.emplace(i * 2, i);
+            }
+            auto map = up::ordered_map<int, int, std::less<int>, 64>::from_sorted(expected.begin(), expected.end());
+            UP_TEST_TRUE(check_map(map, expected));
+            for (int i = 0; i < n; i += 3) {
+                UP_TEST_EQUAL(map.erase(i * 2), 1u);
+                expected.erase(i * 2);
+                map.emplace(i * 2 + 1, i);
+                expected.emplace(i * 2 + 1, i);
+            }
+            UP_TEST_TRUE(check_map(map, expected));
+        }
+        std::vector<std::pair<int, int>> unsorted = {{1, 1}, {3, 3}, {2, 2}};
+        UP_TEST_THROWS(std::invalid_argument, [&] {
+                    up::ordered_map<int, int>::from_sorted(unsorted.begin(), unsorted.end());
+                });
+        std::vector<std::pair<int, int>> duplicate = {{1, 1}, {1, 2}};
+        UP_TEST_THROWS(std::invalid_argument, [&] {
+                    up::ordered_map<int, int>::from_sorted(duplicate.begin(), duplicate.end());
+                });
+    };
+
+    // key, whose copy constructor throws on request
+    class fragile_key final
+    {
+    public: // --- scope ---
+        static inline bool throwing = false;
+    public: // --- state ---
+        int _value;
+    public: // --- life ---
+        explicit fragile_key(int value) noexcept
+            : _value(value)
+        { }
+        fragile_key(const fragile_key& rhs)
+            : _value(rhs._value)
+        {
+            if (throwing) {
+                throw std::runtime_error("fragile-key-copy");
+            }
+        }
+        fragile_key(fragile_key&& rhs) noexcept = default;
+        ~fragile_key() noexcept = default;
+    public: // --- operations ---
+        friend bool operator<(const fragile_key& lhs, const fragile_key& rhs) noexcept
+        {
+            return lhs._value < rhs._value;
+        }
+    };
+
+    template <typename Map>
+    auto to_std_map(const Map& map) -> std::map<int, int>
+    {
+        std::map<int, int> result;
+        for (auto&& entry : map) {
+            result.emplace(entry.first._value, entry.second);
+        }
+        return result;
+    }
+
+    UP_TEST_CASE {
+        // failed copies of separator keys leave the map unchanged
+        up::ordered_map<fragile_key, int, std::less<fragile_key>, 128> map;
+        std::map<int, int> expected;
+        std::size_t failures[2] = {0, 0};
+        bool unchanged = true;
+        for (int i = 0; i != 2000; ++i) {
+            int key = (i * 7919) % 1000;
+            fragile_key::throwing = i % 3 == 0;
+            try {
+                if (i < 1000) {
+                    map.emplace(fragile_key(key), key);
+                    expected.emplace(key, key);
+                } else {
+                    map.erase(fragile_key(key));
+                    expected.erase(key);
+                }
+            } catch (const std::runtime_error&) {
+                ++failures[i < 1000 ? 0 : 1];
+                unchanged = unchanged && to_std_map(map) == expected && map.size() == expected.size();
+            }
+        }
+        fragile_key::throwing = false;
+        UP_TEST_TRUE(failures[0] != 0 && failures[1] != 0);
+        UP_TEST_TRUE(unchanged);
+        UP_TEST_TRUE(to_std_map(map) == expected);
+    };
+
+    UP_TEST_CASE {
+        // keys are moved (not copied) when entries are relocated between nodes
+        up::ordered_map<std::string, int, std::less<std::string>, 128> map;
+        std::map<std::string, const char*> addresses;
+        for (int i = 0; i != 1000; ++i) {
+            auto key = std::string(32, 'k') + std::to_string((i * 7919) % 1000);
+            auto p = map.emplace(std::move(key), i).first;
+            addresses.emplace(p->first, p->first.data());
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            auto key = std::string(32, 'k') + std::to_string(i);
+            map.erase(key);
+            addresses.erase(key);
+        }
+        bool moved = map.size() == addresses.size();
+        for (auto&& entry : addresses) {
+            moved = moved && map.find(entry.first)->first.data() == entry.second;
+        }
+        UP_TEST_TRUE(moved);
+    };
+
+    UP_TEST_CASE {
+        up::ordered_map<up::shared_string, int> map = {{"b", 2}, {"d", 4}, {"a", 1}};
+        map["c"] = 3;
+        ++map["a"];
+        UP_TEST_EQUAL(map.at("a"), 2);
+        UP_TEST_EQUAL(map.count("c"), 1u);
+        UP_TEST_EQUAL(map.count("e"), 0u);
+        UP_TEST_THROWS(std::out_of_range, [&] { map.at("e"); });
+        UP_TEST_EQUAL(map.lower_bound("bb")->first, "c");
+        UP_TEST_EQUAL(map.upper_bound("c")->first, "d");
+        UP_TEST_TRUE(map.upper_bound("d") == map.end());
+        auto range = map.equal_range("b");
+        UP_TEST_EQUAL(std::distance(range.first, range.second), 1);
+        range = map.equal_range("bb");
+        UP_TEST_TRUE(range.first == range.second);
+        auto p = map.erase(std::next(map.begin()), std::prev(map.end()));
+        UP_TEST_EQUAL(p->first, "d");
+        UP_TEST_EQUAL(map.size(), 2u);
+        decltype(map) other;
+        swap(map, other);
+        UP_TEST_TRUE(map.empty());
+        UP_TEST_EQUAL(other.begin()->first, "a");
+    };
+
+    UP_TEST_CASE {
+        // iterators refer to the stored key and mapped value through proxies
+        up::ordered_map<int, int> map = {{1, 10}, {2, 20}, {3, 30}};
+        map.begin()->second = 11;
+        (*std::next(map.begin())).second += 2;
+        for (auto&& entry : map) {
+            entry.second += entry.first;
+        }
+        const auto& cmap = map;
+        UP_TEST_EQUAL(cmap.find(1)->second, 12);
+        UP_TEST_EQUAL((*cmap.find(2)).second, 24);
+        UP_TEST_EQUAL(cmap.rbegin()->first, 3);
+        UP_TEST_EQUAL(cmap.at(3), 33);
+        auto copy = up::ordered_map<int, int>(map.begin(), map.end());
+        UP_TEST_TRUE(copy == map);
+    };
+
+}
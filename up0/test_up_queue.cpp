@@ -0,0 +1,159 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "up_buffer.hpp"
+#include "up_exception.hpp"
+#include "up_queue.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    template <typename Queue>
+    void single_threaded()
+    {
+        Queue queue(5);
+        UP_TEST_EQUAL(queue.capacity(), 8u);
+        UP_TEST_FALSE(bool(queue.try_pop()));
+        for (int i = 0; i != 8; ++i) {
+            UP_TEST_TRUE(queue.try_push(std::make_unique<int>(i)));
+        }
+        auto extra = std::make_unique<int>(8);
+        UP_TEST_FALSE(queue.try_push(std::move(extra)));
+        UP_TEST_TRUE(bool(extra)); // not moved
+        UP_TEST_EQUAL(queue.size(), 8u);
+        UP_TEST_EQUAL(**queue.try_pop(), 0);
+        std::vector<int> values;
+        auto collect = [&](std::unique_ptr<int>&& value) { values.push_back(*value); };
+        UP_TEST_EQUAL(queue.try_pop_bulk(3, collect), 3u);
+        UP_TEST_TRUE((values == std::vector<int>{1, 2, 3}));
+        std::unique_ptr<int> batch[] = {
+            std::make_unique<int>(8), std::make_unique<int>(9), std::make_unique<int>(10),
+            std::make_unique<int>(11), std::make_unique<int>(12),
+        };
+        UP_TEST_EQUAL(queue.try_push_bulk(batch, 5), 4u);
+        UP_TEST_FALSE(bool(batch[0]));
+        UP_TEST_TRUE(bool(batch[4]));
+        values.clear();
+        UP_TEST_EQUAL(queue.try_pop_bulk(100, collect), 8u);
+        UP_TEST_TRUE((values == std::vector<int>{4, 5, 6, 7, 8, 9, 10, 11}));
+        // a failing consumer loses only the current value
+        for (int i = 0; i != 3; ++i) {
+            queue.try_push(std::make_unique<int>(i));
+        }
+        UP_TEST_THROWS(std::runtime_error, [&]() {
+            queue.try_pop_bulk(3, [](std::unique_ptr<int>&&) { throw std::runtime_error("test"); });
+        });
+        UP_TEST_EQUAL(queue.size(), 2u);
+        // timeouts are reported by the patience
+        queue.try_pop_bulk(100, collect);
+        UP_TEST_THROWS(up::stream::timeout, [&]() {
+            queue.pop(up::stream::deadline_patience(std::chrono::milliseconds(1)));
+        });
+        // remaining elements are destroyed with the queue
+        queue.try_push(std::make_unique<int>(42));
+    }
+
+    auto make_buffer(std::size_t producer, std::size_t index) -> up::buffer
+    {
+        auto text = std::to_string(producer) + ":" + std::to_string(index);
+        return up::buffer(text.data(), text.size());
+    }
+
+    template <typename Queue>
+    void multi_threaded(std::size_t producers, std::size_t count)
+    {
+        Queue queue(64);
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p != producers; ++p) {
+            threads.emplace_back([&queue, p, count]() {
+                up::stream::infinite_patience patience;
+                for (std::size_t i = 0; i < count; i += 4) {
+                    if (i % 8) {
+                        up::buffer batch[4];
+                        for (std::size_t j = 0; j != 4; ++j) {
+                            batch[j] = make_buffer(p, i + j);
+                        }
+                        for (std::size_t done = 0; done != 4; std::this_thread::yield()) {
+                            done += queue.try_push_bulk(batch + done, 4 - done);
+                        }
+                    } else {
+                        for (std::size_t j = 0; j != 4; ++j) {
+                            queue.push(make_buffer(p, i + j), patience);
+                        }
+                    }
+                }
+            });
+        }
+        std::vector<std::size_t> next(producers);
+        bool okay = true;
+        auto check = [&](up::buffer&& buffer) {
+            auto text = std::string(buffer.warm(), buffer.available());
+            auto colon = text.find(':');
+            auto p = std::stoul(text.substr(0, colon));
+            auto i = std::stoul(text.substr(colon + 1));
+            okay = okay && p < producers && i == next[p]++;
+        };
+        up::stream::infinite_patience patience;
+        for (std::size_t received = 0; received != producers * count; ) {
+            if (received % 3) {
+                check(queue.pop(patience));
+                ++received;
+            } else if (auto n = queue.try_pop_bulk(16, check)) {
+                received += n;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+        UP_TEST_TRUE(okay);
+        UP_TEST_EQUAL(queue.size(), 0u);
+    }
+
+    UP_TEST_CASE {
+        single_threaded<up::spsc_queue<std::unique_ptr<int>>>();
+        single_threaded<up::mpsc_queue<std::unique_ptr<int>>>();
+    };
+
+    UP_TEST_CASE {
+        multi_threaded<up::spsc_queue<up::buffer>>(1, 20000);
+        multi_threaded<up::mpsc_queue<up::buffer>>(1, 20000);
+        multi_threaded<up::mpsc_queue<up::buffer>>(4, 5000);
+    };
+
+    UP_TEST_CASE {
+        // wake-ups reach all blocked producers (without running into their deadlines)
+        up::mpsc_queue<int> queue(1);
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> timeouts = {0};
+        for (int p = 0; p != 8; ++p) {
+            threads.emplace_back([&queue, &timeouts]() {
+                for (int i = 0; i != 1000; ++i) {
+                    try {
+                        queue.push(int(i), up::stream::deadline_patience(std::chrono::seconds(10)));
+                    } catch (const up::exception&) {
+                        ++timeouts;
+                        return;
+                    }
+                }
+            });
+        }
+        std::size_t received = 0;
+        for (; received != 8000 && timeouts.load() == 0; ++received) {
+            queue.pop(up::stream::deadline_patience(std::chrono::seconds(10)));
+        }
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+        UP_TEST_EQUAL(timeouts.load(), 0u);
+        UP_TEST_EQUAL(received, 8000u);
+    };
+
+    UP_TEST_CASE {
+        UP_TEST_THROWS(up::exception, []() { up::spsc_queue<int> queue(0); });
+    };
+
+}
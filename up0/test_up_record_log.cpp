@@ -0,0 +1,140 @@
+#include <csignal>
+#include <cstring>
+
+#include <sys/resource.h>
+
+#include "test_up_directory.hpp"
+#include "up_defer.hpp"
+#include "up_exception.hpp"
+#include "up_ints.hpp"
+#include "up_record_log.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto read(up::record_log::reader& reader) -> std::string
+    {
+        auto chunk = reader.read();
+        UP_TEST_TRUE(chunk.data() != nullptr);
+        return std::string(chunk.data(), chunk.size());
+    }
+
+    UP_TEST_CASE {
+        auto pathname = up_test::make_directory("test_up_record_log");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        auto large = std::string(100000, 'x');
+        std::vector<uint64_t> offsets;
+        {
+            auto log = up::record_log(directory, 1024);
+            offsets.push_back(log.append(up::chunk::from("hello", 5)));
+            offsets.push_back(log.append(up::chunk::from("", 0)));
+            log.commit(false);
+            offsets.push_back(log.append(up::chunk::from(large.data(), large.size())));
+            for (std::size_t i = 0; i != 100; ++i) {
+                auto value = std::to_string(i);
+                offsets.push_back(log.append(up::chunk::from(value.data(), value.size())));
+            }
+            log.commit();
+            UP_TEST_EQUAL(offsets[1], 5u + 1u + 4u);
+        }
+        auto log = up::record_log(directory, 1024);
+        auto reader = up::record_log::reader(directory, 0);
+        UP_TEST_EQUAL(read(reader), "hello");
+        UP_TEST_EQUAL(read(reader), "");
+        UP_TEST_EQUAL(read(reader), large);
+        for (std::size_t i = 0; i != 100; ++i) {
+            UP_TEST_EQUAL(reader.offset(), offsets[i + 3]);
+            UP_TEST_EQUAL(read(reader), std::to_string(i));
+        }
+        UP_TEST_TRUE(reader.read().data() == nullptr);
+        // tailing reader
+        auto offset = log.append(up::chunk::from("tail", 4));
+        UP_TEST_TRUE(reader.read().data() == nullptr);
+        log.commit(false);
+        UP_TEST_EQUAL(reader.offset(), offset);
+        UP_TEST_EQUAL(read(reader), "tail");
+        // remove old segments, and read from the middle
+        log.remove_before(offsets[50]);
+        auto other = up::record_log::reader(directory, offsets[50]);
+        UP_TEST_EQUAL(read(other), "47");
+    };
+
+    UP_TEST_CASE {
+        // failed writes (injected with a file size limit)
+        auto pathname = up_test::make_directory("test_up_record_log");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        auto large = std::string(5000, 'x');
+        uint64_t end;
+        {
+            auto log = up::record_log(directory, 1 << 20);
+            log.append(up::chunk::from("hello", 5));
+            log.commit();
+            end = log.end();
+            log.append(up::chunk::from(large.data(), large.size()));
+            {
+                struct rlimit previous;
+                UP_TEST_EQUAL(::getrlimit(RLIMIT_FSIZE, &previous), 0);
+                auto handler = std::signal(SIGXFSZ, SIG_IGN);
+                struct rlimit limit = previous;
+                limit.rlim_cur = 1000;
+                UP_TEST_EQUAL(::setrlimit(RLIMIT_FSIZE, &limit), 0);
+                UP_DEFER {
+                    ::setrlimit(RLIMIT_FSIZE, &previous);
+                    std::signal(SIGXFSZ, handler);
+                };
+                UP_TEST_THROWS(up::exception, [&]() { log.commit(); });
+            }
+            UP_TEST_EQUAL(log.end(), end);
+            UP_TEST_THROWS(up::exception, [&]() { log.append(up::chunk::from("world", 5)); });
+            log.commit(); // previous records are still durable
+            UP_TEST_EQUAL(log.end(), end);
+        }
+        // the partially written record is truncated on recovery
+        auto log = up::record_log(directory, 1 << 20);
+        UP_TEST_EQUAL(log.end(), end);
+        log.append(up::chunk::from("world", 5));
+        log.commit();
+        auto reader = up::record_log::reader(directory, 0);
+        UP_TEST_EQUAL(read(reader), "hello");
+        UP_TEST_EQUAL(read(reader), "world");
+        UP_TEST_TRUE(reader.read().data() == nullptr);
+    };
+
+    UP_TEST_CASE {
+        // corrupt records are only truncated at the end of the log
+        auto pathname = up_test::make_directory("test_up_record_log");
+        UP_DEFER { up_test::remove_directory(pathname); };
+        auto directory = up::fs::origin(up::fs::context("test"), pathname);
+        std::vector<uint64_t> offsets;
+        {
+            auto log = up::record_log(directory, 1 << 20);
+            for (auto&& value : {"alpha", "beta", "gamma"}) {
+                offsets.push_back(log.append(up::chunk::from(value, std::strlen(value))));
+            }
+            log.commit();
+        }
+        auto segment = up::fs::location(directory, "0000000000000000.log");
+        // overwrites the first byte of the payload
+        auto overwrite = [&segment](uint64_t offset, const char* data) {
+            auto file = up::fs::file(segment, {up::fs::file::option::write});
+            file.write_all(up::chunk::from(data, 1), up::ints::caster(offset + 1 + 4));
+        };
+        auto size = segment.stat().size();
+        overwrite(offsets[1], "X");
+        UP_TEST_THROWS(up::exception, [&]() { up::record_log(directory, 1 << 20); });
+        UP_TEST_TRUE(segment.stat().size() == size);
+        // a torn write of the last record
+        overwrite(offsets[1], "b");
+        overwrite(offsets[2], "X");
+        auto log = up::record_log(directory, 1 << 20);
+        UP_TEST_EQUAL(log.end(), offsets[2]);
+        auto reader = up::record_log::reader(directory, 0);
+        UP_TEST_EQUAL(read(reader), "alpha");
+        UP_TEST_EQUAL(read(reader), "beta");
+        UP_TEST_TRUE(reader.read().data() == nullptr);
+    };
+
+}
@@ -0,0 +1,174 @@
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "up_defer.hpp"
+#include "up_exception.hpp"
+#include "up_ring.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    void produce(const up::ring& ring, const std::string& value)
+    {
+        auto chunk = ring.reserve(value.size());
+        std::memcpy(chunk.data(), value.data(), value.size());
+        ring.commit(chunk);
+    }
+
+    auto consume(const up::ring& ring) -> std::string
+    {
+        auto chunk = ring.peek();
+        std::string result(chunk.data(), chunk.size());
+        ring.consume();
+        return result;
+    }
+
+    UP_TEST_CASE {
+        auto ring = up::ring(up::fs::context("test"), "ring", 4096);
+        UP_TEST_TRUE(ring.peek(false).data() == nullptr);
+        produce(ring, "hello");
+        produce(ring, "");
+        produce(ring, "world");
+        UP_TEST_EQUAL(consume(ring), "hello");
+        UP_TEST_EQUAL(consume(ring), "");
+        UP_TEST_EQUAL(consume(ring), "world");
+        UP_TEST_TRUE(ring.peek(false).data() == nullptr);
+    };
+
+    UP_TEST_CASE {
+        // wrap around with padding records
+        auto ring = up::ring(up::fs::context("test"), "ring", 4096);
+        for (std::size_t i = 0; i != 100; ++i) {
+            auto value = std::string(i * 37 % ring.max_message_size(), char('a' + i % 26));
+            produce(ring, value);
+            UP_TEST_EQUAL(consume(ring), value);
+        }
+        auto chunk = ring.reserve(ring.max_message_size(), false);
+        UP_TEST_TRUE(chunk.data() != nullptr);
+        UP_TEST_TRUE(ring.reserve(ring.max_message_size(), false).data() == nullptr);
+    };
+
+    UP_TEST_CASE {
+        // commits have to match previous reservations
+        auto ring = up::ring(up::fs::context("test"), "ring", 4096);
+        auto chunk = ring.reserve(16);
+        UP_TEST_THROWS(up::exception, [&]() {
+            ring.commit(up::chunk::into(chunk.data() + 8, 8));
+        });
+        UP_TEST_THROWS(up::exception, [&]() {
+            ring.commit(up::chunk::into(chunk.data(), 8));
+        });
+        char other[16];
+        UP_TEST_THROWS(up::exception, [&]() {
+            ring.commit(up::chunk::into(other, sizeof(other)));
+        });
+        ring.commit(chunk);
+        UP_TEST_THROWS(up::exception, [&]() { ring.commit(chunk); });
+        UP_TEST_EQUAL(consume(ring).size(), 16u);
+        UP_TEST_THROWS(up::exception, [&]() { ring.commit(chunk); });
+    };
+
+    UP_TEST_CASE {
+        // attach to files with corrupt headers
+        auto attach = [](uint64_t capacity, std::size_t length) {
+            auto file = up::fs::file(up::fs::file::memory, up::fs::context("test"), "ring");
+            file.truncate(off_t(length));
+            {
+                auto mapping = file.map(length, 0, true);
+                uint64_t magic = 0x676e69722d7075;
+                uint32_t version = 1;
+                std::memcpy(mapping.data(), &magic, sizeof(magic));
+                std::memcpy(mapping.data() + 8, &version, sizeof(version));
+                std::memcpy(mapping.data() + 16, &capacity, sizeof(capacity));
+            }
+            using seal = up::fs::file::seal;
+            file.add_seals({seal::shrink, seal::grow, seal::seal});
+            return up::ring(std::move(file)).capacity();
+        };
+        UP_TEST_EQUAL(attach(8192, 4096 + 8192), 8192u);
+        UP_TEST_THROWS(up::exception, [&]() { attach(6144, 4096 + 6144); });
+        UP_TEST_THROWS(up::exception, [&]() { attach(1024, 4096 + 1024); });
+        UP_TEST_THROWS(up::exception, [&]() { attach(8192, 4096 + 4096); });
+    };
+
+    UP_TEST_CASE {
+        // reject record headers that exceed the ring
+        auto ring = up::ring(up::fs::context("test"), "ring", 4096);
+        auto corrupt = [&](std::size_t offset, uint32_t value) {
+            auto mapping = ring.file().map(4096 + 4096, 0, true);
+            std::memcpy(mapping.data() + 4096 + offset, &value, sizeof(value));
+        };
+        produce(ring, "hello");
+        corrupt(0, (uint32_t(1) << 31) | 4096);
+        UP_TEST_THROWS(up::exception, [&]() { ring.peek(false); });
+        UP_TEST_THROWS(up::exception, [&]() { ring.consume(); });
+        corrupt(0, (uint32_t(1) << 31) | (uint32_t(1) << 30) | 8);
+        UP_TEST_THROWS(up::exception, [&]() { ring.peek(false); });
+        corrupt(0, (uint32_t(1) << 31) | 5);
+        UP_TEST_EQUAL(consume(ring), "hello");
+    };
+
+    UP_TEST_CASE {
+        // close descriptors of truncated messages
+        int sockets[2];
+        UP_TEST_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets), 0);
+        UP_DEFER {
+            ::close(sockets[0]);
+            ::close(sockets[1]);
+        };
+        auto lowest = []() {
+            int fd = ::dup(0);
+            ::close(fd);
+            return fd;
+        };
+        int fds[2] = {sockets[0], sockets[1]};
+        char byte = 0;
+        iovec iov{&byte, sizeof(byte)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+        msghdr message{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(header), fds, sizeof(fds));
+        UP_TEST_EQUAL(::sendmsg(sockets[0], &message, 0), 1);
+        int expected = lowest();
+        UP_TEST_THROWS(up::exception, [&]() {
+            up::fs::file(up::fs::file::received, up::fs::context("test"), sockets[1]);
+        });
+        UP_TEST_EQUAL(lowest(), expected);
+    };
+
+    UP_TEST_CASE {
+        // attach over unix domain socket and wait for each other
+        int sockets[2];
+        UP_TEST_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets), 0);
+        UP_DEFER {
+            ::close(sockets[0]);
+            ::close(sockets[1]);
+        };
+        auto producer = up::ring(up::fs::context("test"), "ring", 4096);
+        producer.file().send(sockets[0]);
+        auto consumer = up::ring(up::fs::file(up::fs::file::received, up::fs::context("test"), sockets[1]));
+        UP_TEST_EQUAL(consumer.capacity(), producer.capacity());
+        std::size_t count = 10000;
+        std::thread thread([&]() {
+            for (std::size_t i = 0; i != count; ++i) {
+                produce(producer, std::to_string(i));
+            }
+        });
+        UP_DEFER { thread.join(); };
+        for (std::size_t i = 0; i != count; ++i) {
+            UP_TEST_EQUAL(consume(consumer), std::to_string(i));
+        }
+    };
+
+}
@@ -0,0 +1,53 @@
+#include "up_secure_hash.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    auto pattern(std::size_t size) -> up::unique_string
+    {
+        up::unique_string result;
+        for (std::size_t i = 0; i != size; ++i) {
+            result.append(1, static_cast<char>(i % 251));
+        }
+        return result;
+    }
+
+    UP_TEST_CASE {
+        UP_TEST_EQUAL(up::sha256::hash({"abc", 3}).to_hex(),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        UP_TEST_EQUAL(up::blake3::hash({nullptr, 0}).to_hex(),
+            "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+        UP_TEST_EQUAL(up::blake3::hash({"abc", 3}).to_hex(),
+            "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+        UP_TEST_EQUAL(up::secure_hash(up_secure_hash::secure_hash_mechanism::blake3, {"abc", 3}).to_hex(),
+            "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+    };
+
+    UP_TEST_CASE {
+        /* Inputs with multiple chunks cover the tree structure, and the
+         * different code paths must produce the same results. */
+        auto&& expected = {
+            std::make_pair(1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444"),
+            std::make_pair(65537, "7c99f9840a73dfcb6e5bfe4ff6d1558acab7e015640790c26411818bdbe17eca"),
+        };
+        for (auto&& item : expected) {
+            auto input = pattern(item.first);
+            up::chunk::from chunk(input.data(), input.size());
+            UP_TEST_EQUAL(up::blake3::hash(chunk).to_hex(), item.second);
+            UP_TEST_EQUAL(up::blake3_parallel(chunk, 4).to_hex(), item.second);
+            up::chunk::from head(input.data(), 100);
+            up::chunk::from tail(input.data() + 100, input.size() - 100);
+            UP_TEST_EQUAL(up::blake3::hashv(head, tail).to_hex(), item.second);
+            up::blake3::hasher hasher;
+            for (std::size_t i = 0; i < input.size(); i += 777) {
+                hasher.update({input.data() + i, std::min<std::size_t>(777, input.size() - i)});
+            }
+            UP_TEST_EQUAL(hasher.finish().to_hex(), item.second);
+        }
+        auto input = pattern(1 << 20);
+        up::chunk::from chunk(input.data(), input.size());
+        UP_TEST_EQUAL(up::blake3_parallel(chunk, 3).to_hex(), up::blake3::hash(chunk).to_hex());
+    };
+
+}
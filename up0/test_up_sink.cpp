@@ -0,0 +1,174 @@
+#include <iomanip>
+#include <sstream>
+
+#include "up_buffer.hpp"
+#include "up_out.hpp"
+#include "up_string_literal.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    using namespace up::literals;
+
+    class legacy final
+    {
+    public: // --- operations ---
+        void out(std::ostream& os) const
+        {
+            os << "legacy" << std::setw(4) << 42;
+        }
+    };
+
+    // stream buffer without storage, that fails on all writes
+    class failing_buffer final : public std::streambuf
+    {
+    };
+
+    // stream buffer, that fails on the first write and records all others
+    class flaky_buffer final : public std::streambuf
+    {
+    public: // --- state ---
+        bool _failed = false;
+        std::string _written;
+    protected:
+        auto xsputn(const char* data, std::streamsize size) -> std::streamsize override
+        {
+            if (!_failed) {
+                _failed = true;
+                return 0;
+            }
+            _written.append(data, std::size_t(size));
+            return size;
+        }
+    };
+
+    // same as std::ostream with the classic locale
+    template <typename... Args>
+    auto via_ostream(Args&&... args) -> std::string
+    {
+        std::ostringstream os;
+        up::out(os, std::forward<Args>(args)...);
+        return os.str();
+    }
+
+    template <typename... Args>
+    auto via_sink(Args&&... args) -> std::string
+    {
+        up::fixed_sink<256> sink;
+        up::out(sink, std::forward<Args>(args)...);
+        return sink.to_string_view().to_string();
+    }
+
+    UP_TEST_CASE {
+        const char* null = nullptr;
+        int value = 0;
+        UP_TEST_EQUAL(via_sink('c', "str", std::string("ing"), up::shared_string("!"), "lit"_sl, null),
+            "cstring!lit");
+        UP_TEST_EQUAL(via_sink(-1, 0u, std::numeric_limits<long long>::min(), std::numeric_limits<unsigned long>::max()),
+            via_ostream(-1, 0u, std::numeric_limits<long long>::min(), std::numeric_limits<unsigned long>::max()));
+        for (double d : {0.0, -0.5, 0.1, 1.0 / 3, 123456.0, 1234567.0, 1e-5, 1e100}) {
+            UP_TEST_EQUAL(via_sink(d, ' ', float(d), ' ', static_cast<long double>(d)),
+                via_ostream(d, ' ', float(d), ' ', static_cast<long double>(d)));
+        }
+        UP_TEST_EQUAL(via_sink(true, false), "10");
+        UP_TEST_EQUAL(via_sink(&value), via_ostream(&value));
+        UP_TEST_EQUAL(via_sink(static_cast<void*>(nullptr)), via_ostream(static_cast<void*>(nullptr)));
+    };
+
+    UP_TEST_CASE {
+        // types with std::ostream and up::sink support work with both
+        auto insight = up::insight(typeid(int), up::shared_string("1"), up::insight(typeid(int), up::shared_string("2")));
+        UP_TEST_EQUAL(via_sink(insight), "int:1{int:2}");
+        UP_TEST_EQUAL(via_ostream(insight), "int:1{int:2}");
+        UP_TEST_EQUAL(via_sink(legacy(), '|', 7), "legacy  42|7");
+        UP_TEST_EQUAL(via_ostream(legacy(), '|', 7), "legacy  42|7");
+    };
+
+    UP_TEST_CASE {
+        up::fixed_sink<8> sink;
+        up::out(sink, "abc", 12345);
+        UP_TEST_EQUAL(sink.to_string_view(), "abc12345");
+        UP_TEST_FALSE(sink.truncated());
+        up::out(sink, 'x');
+        UP_TEST_EQUAL(sink.to_string_view(), "abc12345");
+        UP_TEST_TRUE(sink.truncated());
+        // partially written data
+        up::fixed_sink<8> other;
+        up::out(other, "abc", std::string(10, 'x'), 'y');
+        UP_TEST_EQUAL(other.to_string_view(), "abcxxxxx");
+        UP_TEST_TRUE(other.truncated());
+    };
+
+    UP_TEST_CASE {
+        up::buffer buffer("head:", 5);
+        {
+            up::buffer_sink sink(buffer);
+            for (int i = 0; i != 1000; ++i) {
+                up::out(sink, i, ',');
+            }
+            sink.flush();
+            UP_TEST_EQUAL(buffer.available(), 5u + 3890u);
+            buffer.consume(5);
+            up::out(sink, std::string(300, 'x'));
+        }
+        std::string expected;
+        for (int i = 0; i != 1000; ++i) {
+            expected += std::to_string(i) + ',';
+        }
+        expected += std::string(300, 'x');
+        UP_TEST_EQUAL(std::string(buffer.warm(), buffer.available()), expected);
+    };
+
+    UP_TEST_CASE {
+        std::ostringstream os;
+        {
+            up::ostream_sink sink(os);
+            up::out(sink, std::string(100, 'a'), std::string(1000, 'b'), 'c');
+        }
+        UP_TEST_EQUAL(os.str(), std::string(100, 'a') + std::string(1000, 'b') + 'c');
+    };
+
+    UP_TEST_CASE {
+        // errors are only reported by explicit flushes
+        failing_buffer buffer;
+        std::ostream os(&buffer);
+        os.exceptions(std::ios::badbit);
+        bool thrown = false;
+        {
+            up::ostream_sink sink(os);
+            up::out(sink, "abc");
+            try {
+                sink.flush();
+            } catch (const std::ios::failure&) {
+                thrown = true;
+            }
+            os.clear();
+            up::out(sink, "def");
+        }
+        UP_TEST_TRUE(thrown);
+        UP_TEST_TRUE(os.bad());
+    };
+
+    UP_TEST_CASE {
+        // data of failed flushes is not written again
+        flaky_buffer buffer;
+        std::ostream os(&buffer);
+        os.exceptions(std::ios::badbit);
+        bool thrown = false;
+        {
+            up::ostream_sink sink(os);
+            up::out(sink, "abc");
+            try {
+                sink.flush();
+            } catch (const std::ios::failure&) {
+                thrown = true;
+            }
+            os.clear();
+            up::out(sink, "def");
+        }
+        UP_TEST_TRUE(thrown);
+        UP_TEST_EQUAL(buffer._written, "def");
+    };
+
+}
@@ -17,4 +17,22 @@ namespace
         UP_TEST_EQUAL(up::unique_string("ba") + 'r', "bar");
     };
 
+    UP_TEST_CASE {
+        auto&& expected = [](up::string_view s) { return std::hash<up::string_view>()(s); };
+        for (auto&& s : {"", "short", "long enough to require heap-allocated storage"}) {
+            up::shared_string shared(s);
+            UP_TEST_EQUAL(shared.hash(), expected(s));
+            UP_TEST_EQUAL(shared.hash(), expected(s)); // memoized
+            UP_TEST_EQUAL(std::hash<up::shared_string>()(shared), expected(s));
+            up::unique_string unique(std::move(shared));
+            UP_TEST_EQUAL(unique.hash(), expected(s));
+            if (!unique.empty()) {
+                unique[0] = '!'; // in-place modification of the adopted storage
+            }
+            UP_TEST_EQUAL(unique.hash(), expected(unique));
+            shared = std::move(unique);
+            UP_TEST_EQUAL(shared.hash(), expected(shared));
+        }
+    };
+
 }
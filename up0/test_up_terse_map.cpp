@@ -0,0 +1,140 @@
+#include <map>
+
+#include "up_string.hpp"
+#include "up_terse_map.hpp"
+#include "up_test.hpp"
+
+namespace
+{
+
+    template <typename Map>
+    bool check_map(const Map& map, const std::map<std::string, int>& expected)
+    {
+        if (map.size() != expected.size() || std::size_t(std::distance(map.begin(), map.end())) != expected.size()) {
+            return false;
+        }
+        for (auto&& entry : expected) {
+            auto p = map.find(up::shared_string(entry.first));
+            if (p == map.end() || p->second != entry.second) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Map>
+    void test_map()
+    {
+        Map map;
+        std::map<std::string, int> expected;
+        for (int i = 0; i != 40; ++i) {
+            auto key = std::to_string(i * 7919);
+            map.emplace(up::shared_string(key), i);
+            expected.emplace(key, i);
+            UP_TEST_TRUE(check_map(map, expected));
+            if (i % 3 == 0) {
+                auto other = std::to_string(i / 3 * 7919);
+                map.erase(up::shared_string(other));
+                expected.erase(other);
+                UP_TEST_TRUE(check_map(map, expected));
+            }
+            Map copy(map);
+            UP_TEST_TRUE(check_map(copy, expected));
+            Map moved(std::move(copy));
+            UP_TEST_TRUE(check_map(moved, expected));
+            UP_TEST_TRUE(copy.empty());
+            Map small;
+            small.emplace(up::shared_string("x"), -1);
+            swap(small, moved);
+            UP_TEST_TRUE(check_map(small, expected));
+            UP_TEST_TRUE(check_map(moved, {{"x", -1}}));
+            moved = std::move(small);
+            UP_TEST_TRUE(check_map(moved, expected));
+        }
+        map.clear();
+        map.rehash(0);
+        UP_TEST_TRUE(check_map(map, {}));
+    }
+
+    UP_TEST_CASE {
+        test_map<up::terse_map<up::shared_string, int>>();
+    };
+
+    UP_TEST_CASE {
+        using map = up::terse_map<up::shared_string, int, std::hash<up::shared_string>, std::equal_to<up::shared_string>, 4>;
+        test_map<map>();
+        map small;
+        for (int i = 0; i != 4; ++i) {
+            small[up::shared_string(std::to_string(i))] = i;
+        }
+        UP_TEST_EQUAL(small.size(), 4u);
+        // entries are stored within the object
+        auto address = reinterpret_cast<const char*>(&*small.begin());
+        UP_TEST_TRUE(address > reinterpret_cast<const char*>(&small));
+        UP_TEST_TRUE(address < reinterpret_cast<const char*>(&small + 1));
+    };
+
+    UP_TEST_CASE {
+        // lookups in empty maps, and reserve before the first insertion
+        up::terse_map<up::shared_string, int> map;
+        UP_TEST_TRUE(map.find(up::shared_string("x")) == map.end());
+        UP_TEST_EQUAL(map.count(up::shared_string("x")), 0u);
+        map.reserve(100);
+        UP_TEST_TRUE(map.find(up::shared_string("x")) == map.end());
+        std::map<std::string, int> expected;
+        for (int i = 0; i != 100; ++i) {
+            map.emplace(up::shared_string(std::to_string(i)), i);
+            expected.emplace(std::to_string(i), i);
+        }
+        UP_TEST_TRUE(check_map(map, expected));
+    };
+
+    UP_TEST_CASE {
+        // removed slots are reused or cleaned up, if they fill the table
+        up::terse_map<up::shared_string, int> map;
+        map.emplace(up::shared_string("fixed"), -1);
+        for (int i = 0; i != 1000; ++i) {
+            auto key = up::shared_string(std::to_string(i));
+            UP_TEST_TRUE(map.emplace(key, i).second);
+            UP_TEST_EQUAL(map.erase(key), 1u);
+        }
+        UP_TEST_TRUE(check_map(map, {{"fixed", -1}}));
+    };
+
+    class view_hash final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        auto operator()(const up::string_view& value) const noexcept -> std::size_t
+        {
+            return std::hash<up::string_view>()(value);
+        }
+    };
+
+    class view_equal final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        bool operator()(const up::string_view& lhs, const up::string_view& rhs) const noexcept
+        {
+            return lhs == rhs;
+        }
+    };
+
+    UP_TEST_CASE {
+        // heterogeneous lookups with transparent hasher and predicate
+        up::terse_map<up::shared_string, int, view_hash, view_equal> map;
+        UP_TEST_TRUE(map.find(up::string_view("a")) == map.end());
+        for (int i = 0; i != 20; ++i) {
+            map.emplace(up::shared_string(std::to_string(i)), i);
+        }
+        auto p = map.find(up::string_view("13"));
+        UP_TEST_TRUE(p != map.end());
+        UP_TEST_EQUAL(p->second, 13);
+        UP_TEST_EQUAL(map.count(up::string_view("20")), 0u);
+        UP_TEST_EQUAL(map.count(up::shared_string("19")), 1u);
+    };
+
+}
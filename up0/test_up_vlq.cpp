@@ -0,0 +1,38 @@
+#include "up_buffer.hpp"
+#include "up_exception.hpp"
+#include "up_test.hpp"
+#include "up_vlq.hpp"
+
+#include <limits>
+
+namespace
+{
+
+    UP_TEST_CASE {
+        up::buffer buffer;
+        for (uint64_t value : {uint64_t(0), uint64_t(127), uint64_t(128), std::numeric_limits<uint64_t>::max()}) {
+            buffer.append(up::vlq::encoded<uint64_t>(value));
+        }
+        UP_TEST_EQUAL(buffer.available(), 1u + 1u + 2u + up::vlq::max_size<uint64_t>());
+        up::chunk::from chunk = buffer;
+        for (uint64_t value : {uint64_t(0), uint64_t(127), uint64_t(128), std::numeric_limits<uint64_t>::max()}) {
+            auto&& decoded = up::vlq::try_decode<uint64_t>(chunk);
+            UP_TEST_TRUE(std::get<0>(decoded) == up::vlq_status::complete);
+            UP_TEST_EQUAL(std::get<1>(decoded), value);
+            chunk.drain(std::get<2>(decoded));
+        }
+    };
+
+    UP_TEST_CASE {
+        // incomplete and overflowed input is reported without exceptions
+        UP_TEST_TRUE(std::get<0>(up::vlq::try_decode<uint64_t>({nullptr, 0})) == up::vlq_status::incomplete);
+        UP_TEST_TRUE(std::get<0>(up::vlq::try_decode<uint64_t>({"\x81\x80", 2})) == up::vlq_status::incomplete);
+        UP_TEST_TRUE(std::get<0>(up::vlq::try_decode<uint8_t>({"\x82\x00", 2})) == up::vlq_status::overflow);
+        // no more than the maximal size is examined
+        auto zeros = std::string(up::vlq::max_size<uint64_t>() + 1, '\x80');
+        UP_TEST_TRUE(std::get<0>(up::vlq::try_decode<uint64_t>({zeros.data(), zeros.size()})) == up::vlq_status::overflow);
+        UP_TEST_THROWS(std::overflow_error, [&]() { up::vlq::decode<uint64_t>({zeros.data(), zeros.size()}); });
+        UP_TEST_THROWS(std::underflow_error, []() { up::vlq::decode<uint64_t>({"\x81", 1}); });
+    };
+
+}
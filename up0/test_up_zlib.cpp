@@ -1,6 +1,6 @@
 #include <cstring>
 
-#include "up_char_cast.hpp"
+#include "up_codec.hpp"
 #include "up_exception.hpp"
 #include "up_test.hpp"
 #include "up_zlib.hpp"
@@ -8,7 +8,6 @@
 namespace
 {
 
-    /* TODO: Add a new module that supports commonly used codecs. */
     class bytes final
     {
     public: // --- scope ---
@@ -19,30 +18,7 @@ namespace
         }
         static auto hex(const char* text) -> self
         {
-            std::size_t size = std::strlen(text);
-            if (size % 2 != 0) {
-                throw up::make_exception("bad-hex-size").with(size);
-            }
-            up::buffer buffer;
-            buffer.reserve(size / 2);
-            auto cold = buffer.cold();
-            for (std::size_t i = 0; i != size; i += 2) {
-                cold[i / 2] = (_hex_value(text[i]) << 4) + _hex_value(text[i + 1]);
-            }
-            buffer.produce(size / 2);
-            return self(std::move(buffer));
-        }
-        static auto _hex_value(char c) -> char
-        {
-            if (c >= '0' && c <= '9') {
-                return c - '0';
-            } else if (c >= 'A' && c <= 'F') {
-                return c - 'A' + 10;
-            } else if (c >= 'a' && c <= 'f') {
-                return c - 'a' + 10;
-            } else {
-                throw up::make_exception("bad-hex-char").with(c);
-            }
+            return self(up::hex_decode(text));
         }
     private: // --- fields ---
         up::buffer _buffer;
@@ -53,17 +29,7 @@ namespace
     public: // --- operations ---
         auto to_string() const -> up::unique_string
         {
-            const char* chars = "0123456789abcdef";
-            unsigned char _16 = 16;
-            up::unique_string result;
-            result.reserve(_buffer.available() * 2);
-            const unsigned char* p = up::char_cast<unsigned char>(_buffer.warm());
-            const unsigned char* q = p + _buffer.available();
-            for (; p != q; ++p) {
-                result.push_back(chars[*p / _16]);
-                result.push_back(chars[*p % _16]);
-            }
-            return result;
+            return up::hex_encode(_buffer);
         }
         friend bool operator==(const self& lhs, const self& rhs)
         {
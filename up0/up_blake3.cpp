@@ -0,0 +1,399 @@
+#include "up_blake3.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "up_char_cast.hpp"
+
+
+namespace
+{
+
+    using cv_type = std::array<uint32_t, 8>;
+    using block_type = std::array<uint32_t, 16>;
+
+    const std::size_t block_size = 64;
+    const std::size_t chunk_size = 1024;
+    const std::size_t chunk_blocks = chunk_size / block_size;
+
+    const uint32_t chunk_start = 1 << 0;
+    const uint32_t chunk_end = 1 << 1;
+    const uint32_t parent = 1 << 2;
+    const uint32_t root = 1 << 3;
+
+    const cv_type iv = {{
+        UINT32_C(0x6a09e667), UINT32_C(0xbb67ae85), UINT32_C(0x3c6ef372), UINT32_C(0xa54ff53a),
+        UINT32_C(0x510e527f), UINT32_C(0x9b05688c), UINT32_C(0x1f83d9ab), UINT32_C(0x5be0cd19),
+    }};
+
+    // message word order for each round, derived from the permutation
+    using schedule_type = std::array<std::array<uint8_t, 16>, 7>;
+
+    constexpr auto make_schedule() -> schedule_type
+    {
+        const uint8_t permutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+        schedule_type result = {};
+        for (uint8_t i = 0; i != 16; ++i) {
+            result[0][i] = i;
+        }
+        for (std::size_t r = 1; r != result.size(); ++r) {
+            for (std::size_t i = 0; i != 16; ++i) {
+                result[r][i] = result[r - 1][permutation[i]];
+            }
+        }
+        return result;
+    }
+
+    constexpr const schedule_type schedule = make_schedule();
+
+
+    /* Multi-lane compression uses the vector extensions of GCC and clang.
+     * The width is chosen based on the target, so that the operations map
+     * directly to the available vector instructions. */
+#if defined(__AVX512F__)
+    const std::size_t lanes = 16;
+#elif defined(__AVX2__)
+    const std::size_t lanes = 8;
+#else
+    const std::size_t lanes = 4;
+#endif
+
+    using vector = uint32_t __attribute__((vector_size(4 * lanes)));
+
+
+    auto load32(const unsigned char* data) -> uint32_t
+    {
+        return uint32_t(data[0])
+            | uint32_t(data[1]) << 8
+            | uint32_t(data[2]) << 16
+            | uint32_t(data[3]) << 24;
+    }
+
+    void store32(unsigned char* data, uint32_t value)
+    {
+        data[0] = static_cast<unsigned char>(value);
+        data[1] = static_cast<unsigned char>(value >> 8);
+        data[2] = static_cast<unsigned char>(value >> 16);
+        data[3] = static_cast<unsigned char>(value >> 24);
+    }
+
+    auto load_block(const unsigned char* data) -> block_type
+    {
+        block_type result;
+        for (std::size_t i = 0; i != result.size(); ++i) {
+            result[i] = load32(data + 4 * i);
+        }
+        return result;
+    }
+
+    template <typename Type>
+    auto rotr(Type x, int n) -> Type
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    // works both for scalars and for vectors
+    template <typename Type>
+    void g(Type& a, Type& b, Type& c, Type& d, const Type& x, const Type& y)
+    {
+        a = a + b + x;
+        d = rotr(d ^ a, 16);
+        c = c + d;
+        b = rotr(b ^ c, 12);
+        a = a + b + y;
+        d = rotr(d ^ a, 8);
+        c = c + d;
+        b = rotr(b ^ c, 7);
+    }
+
+    /* The round number is a template parameter, so that all indexes are
+     * constant, and the state can be kept in registers. */
+    template <std::size_t R, typename Type>
+    void round(Type* v, const Type* m)
+    {
+        constexpr auto&& s = schedule[R];
+        g(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+        g(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+        g(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+        g(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+        g(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+        g(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        g(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+        g(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+    }
+
+    template <typename Type>
+    void rounds(Type* v, const Type* m)
+    {
+        round<0>(v, m);
+        round<1>(v, m);
+        round<2>(v, m);
+        round<3>(v, m);
+        round<4>(v, m);
+        round<5>(v, m);
+        round<6>(v, m);
+    }
+
+    auto compress(const cv_type& cv, const block_type& block, uint64_t counter, uint32_t size, uint32_t flags) -> block_type
+    {
+        block_type v = {{
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            iv[0], iv[1], iv[2], iv[3],
+            static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), size, flags,
+        }};
+        rounds(v.data(), block.data());
+        for (std::size_t i = 0; i != 8; ++i) {
+            v[i] ^= v[i + 8];
+            v[i + 8] ^= cv[i];
+        }
+        return v;
+    }
+
+    auto truncate(const block_type& block) -> cv_type
+    {
+        cv_type result;
+        std::copy_n(block.begin(), result.size(), result.begin());
+        return result;
+    }
+
+    /* Compresses complete chunks in parallel, one chunk per lane. Unused
+     * lanes repeat the first input. */
+    void compress_chunks(const unsigned char* const* inputs, std::size_t count, uint64_t counter, cv_type* result)
+    {
+        vector h[8];
+        for (std::size_t i = 0; i != 8; ++i) {
+            h[i] = vector{} + iv[i];
+        }
+        vector counter_low;
+        vector counter_high;
+        for (std::size_t j = 0; j != lanes; ++j) {
+            uint64_t value = counter + std::min(j, count - 1);
+            counter_low[j] = static_cast<uint32_t>(value);
+            counter_high[j] = static_cast<uint32_t>(value >> 32);
+        }
+        for (std::size_t b = 0; b != chunk_blocks; ++b) {
+            /* Transpose the message words, so that each vector contains
+             * the same word of all lanes. */
+            alignas(vector) uint32_t words[16][lanes];
+            for (std::size_t j = 0; j != lanes; ++j) {
+                auto block = load_block(inputs[j < count ? j : 0] + b * block_size);
+                for (std::size_t i = 0; i != 16; ++i) {
+                    words[i][j] = block[i];
+                }
+            }
+            vector m[16];
+            std::memcpy(m, words, sizeof(m));
+            uint32_t flags = (b == 0 ? chunk_start : 0) | (b == chunk_blocks - 1 ? chunk_end : 0);
+            vector v[16] = {
+                h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                vector{} + iv[0], vector{} + iv[1], vector{} + iv[2], vector{} + iv[3],
+                counter_low, counter_high, vector{} + uint32_t(block_size), vector{} + flags,
+            };
+            rounds(v, m);
+            for (std::size_t i = 0; i != 8; ++i) {
+                h[i] = v[i] ^ v[i + 8];
+            }
+        }
+        for (std::size_t j = 0; j != count; ++j) {
+            for (std::size_t i = 0; i != 8; ++i) {
+                result[j][i] = h[i][j];
+            }
+        }
+    }
+
+
+    // input of the last compression of a node
+    class output final
+    {
+    public: // --- state ---
+        cv_type _cv;
+        block_type _block;
+        uint64_t _counter;
+        uint32_t _size;
+        uint32_t _flags;
+    public: // --- operations ---
+        auto chaining_value() const -> cv_type
+        {
+            return truncate(compress(_cv, _block, _counter, _size, _flags));
+        }
+        void root_bytes(up::chunk::into result) const
+        {
+            auto p = up::char_cast<unsigned char>(result.data());
+            std::size_t n = result.size();
+            for (uint64_t i = 0; n; ++i) {
+                auto words = compress(_cv, _block, i, _size, _flags | root);
+                unsigned char bytes[block_size];
+                for (std::size_t k = 0; k != words.size(); ++k) {
+                    store32(bytes + 4 * k, words[k]);
+                }
+                std::size_t m = std::min(n, block_size);
+                std::memcpy(p, bytes, m);
+                p += m;
+                n -= m;
+            }
+        }
+    };
+
+    auto parent_output(const cv_type& left, const cv_type& right) -> output
+    {
+        output result{iv, {}, 0, block_size, parent};
+        std::copy(left.begin(), left.end(), result._block.begin());
+        std::copy(right.begin(), right.end(), result._block.begin() + 8);
+        return result;
+    }
+
+    // output of a chunk of at most chunk_size bytes
+    auto chunk_output(const unsigned char* data, std::size_t size, uint64_t counter) -> output
+    {
+        cv_type cv = iv;
+        uint32_t start = chunk_start;
+        for (; size > block_size; data += block_size, size -= block_size) {
+            cv = truncate(compress(cv, load_block(data), counter, block_size, start));
+            start = 0;
+        }
+        unsigned char last[block_size] = {};
+        std::memcpy(last, data, size);
+        return output{cv, load_block(last), counter, static_cast<uint32_t>(size), start | chunk_end};
+    }
+
+
+    // largest power of two less than n (for n >= 2)
+    auto left_count(uint64_t n) -> uint64_t
+    {
+        uint64_t result = 1;
+        while (result * 2 < n) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    auto reduce(const cv_type* cvs, std::size_t count) -> cv_type
+    {
+        if (count == 1) {
+            return cvs[0];
+        }
+        std::size_t left = left_count(count);
+        return parent_output(reduce(cvs, left), reduce(cvs + left, count - left)).chaining_value();
+    }
+
+    // minimum number of bytes for each thread
+    const std::size_t parallel_threshold = 1 << 17;
+
+    /* Computes the output of the subtree containing the given data. The
+     * left subtree always contains the largest power of two number of
+     * chunks, such that the right subtree is not empty. */
+    auto subtree_output(const unsigned char* data, std::size_t size, uint64_t counter, std::size_t threads) -> output
+    {
+        std::size_t count = std::max<std::size_t>((size + chunk_size - 1) / chunk_size, 1);
+        if (count == 1) {
+            return chunk_output(data, size, counter);
+        } else if (count <= lanes) {
+            std::size_t full = size / chunk_size;
+            const unsigned char* inputs[lanes];
+            for (std::size_t i = 0; i != full; ++i) {
+                inputs[i] = data + i * chunk_size;
+            }
+            cv_type cvs[lanes];
+            compress_chunks(inputs, full, counter, cvs);
+            if (full != count) {
+                cvs[full] = chunk_output(data + full * chunk_size, size - full * chunk_size, counter + full).chaining_value();
+            }
+            std::size_t left = left_count(count);
+            return parent_output(reduce(cvs, left), reduce(cvs + left, count - left));
+        }
+        std::size_t left = left_count(count) * chunk_size;
+        cv_type left_cv;
+        cv_type right_cv;
+        if (threads > 1 && size >= 2 * parallel_threshold) {
+            std::size_t left_threads = threads / 2;
+            std::thread thread([&]() {
+                left_cv = subtree_output(data, left, counter, left_threads).chaining_value();
+            });
+            right_cv = subtree_output(data + left, size - left, counter + left / chunk_size, threads - left_threads).chaining_value();
+            thread.join();
+        } else {
+            left_cv = subtree_output(data, left, counter, 1).chaining_value();
+            right_cv = subtree_output(data + left, size - left, counter + left / chunk_size, 1).chaining_value();
+        }
+        return parent_output(left_cv, right_cv);
+    }
+
+}
+
+
+up_blake3::blake3_hasher::blake3_hasher()
+    : _cv(iv), _counter(0), _block(), _block_size(0), _blocks(0), _depth(0), _stack()
+{ }
+
+void up_blake3::blake3_hasher::update(up::chunk::from chunk)
+{
+    auto data = up::char_cast<unsigned char>(chunk.data());
+    std::size_t size = chunk.size();
+    auto&& push = [this](cv_type cv, uint64_t total) {
+        /* Merge complete subtrees. The number of trailing zeros of the
+         * number of chunks is the number of completed subtrees. */
+        for (; (total & 1) == 0; total >>= 1) {
+            cv = parent_output(_stack[--_depth], cv).chaining_value();
+        }
+        _stack[_depth++] = cv;
+    };
+    while (size) {
+        std::size_t current = _blocks * block_size + _block_size;
+        if (current == chunk_size) {
+            /* The chunk is only finished when more data follows, because
+             * the last chunk might be the root. */
+            uint32_t flags = (_blocks == 0 ? chunk_start : 0) | chunk_end;
+            auto cv = truncate(compress(_cv, load_block(_block.data()), _counter, block_size, flags));
+            push(cv, ++_counter);
+            _cv = iv;
+            _block_size = 0;
+            _blocks = 0;
+            current = 0;
+        }
+        if (current == 0 && size > chunk_size) {
+            std::size_t count = std::min(lanes, (size - 1) / chunk_size);
+            const unsigned char* inputs[lanes];
+            for (std::size_t i = 0; i != count; ++i) {
+                inputs[i] = data + i * chunk_size;
+            }
+            cv_type cvs[lanes];
+            compress_chunks(inputs, count, _counter, cvs);
+            for (std::size_t i = 0; i != count; ++i) {
+                push(cvs[i], ++_counter);
+            }
+            data += count * chunk_size;
+            size -= count * chunk_size;
+            continue;
+        }
+        if (_block_size == block_size) {
+            uint32_t flags = _blocks == 0 ? chunk_start : 0;
+            _cv = truncate(compress(_cv, load_block(_block.data()), _counter, block_size, flags));
+            ++_blocks;
+            _block_size = 0;
+        }
+        std::size_t n = std::min(block_size - _block_size, size);
+        std::memcpy(_block.data() + _block_size, data, n);
+        _block_size += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void up_blake3::blake3_hasher::finish(up::chunk::into result) const
+{
+    unsigned char last[block_size] = {};
+    std::memcpy(last, _block.data(), _block_size);
+    uint32_t flags = (_blocks == 0 ? chunk_start : 0) | chunk_end;
+    output out{_cv, load_block(last), _counter, _block_size, flags};
+    for (std::size_t i = _depth; i != 0; --i) {
+        out = parent_output(_stack[i - 1], out.chaining_value());
+    }
+    out.root_bytes(result);
+}
+
+void up_blake3::blake3_hasher::hash(up::chunk::from chunk, up::chunk::into result, std::size_t threads)
+{
+    auto data = up::char_cast<unsigned char>(chunk.data());
+    subtree_output(data, chunk.size(), 0, std::max<std::size_t>(threads, 1)).root_bytes(result);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/**
+ * Implementation of the BLAKE3 hash function. See the following URL for the
+ * specification:
+ *
+ * https://github.com/BLAKE3-team/BLAKE3-specs
+ *
+ * The input is split into chunks of 1 KiB, that form the leaves of a binary
+ * tree. Chunks are independent, and they are compressed in parallel using
+ * the vector extensions of the compiler (one chunk per lane). Subtrees of
+ * large inputs can additionally be processed by multiple threads.
+ *
+ * This module provides the implementation for up_secure_hash, which should
+ * be used instead of this module.
+ */
+
+#include <array>
+
+#include "up_chunk.hpp"
+
+
+namespace up_blake3
+{
+
+    class blake3_hasher final
+    {
+    public: // --- scope ---
+        using self = blake3_hasher;
+        static const constexpr std::size_t digest_size = 32;
+        static const constexpr std::size_t max_depth = 54;
+    private: // --- state ---
+        std::array<uint32_t, 8> _cv;
+        uint64_t _counter;
+        std::array<unsigned char, 64> _block;
+        uint8_t _block_size;
+        uint8_t _blocks;
+        uint8_t _depth;
+        std::array<std::array<uint32_t, 8>, max_depth> _stack;
+    public: // --- life ---
+        explicit blake3_hasher();
+    public: // --- operations ---
+        void update(up::chunk::from chunk);
+        void finish(up::chunk::into result) const;
+        // one-shot hashing, that splits large inputs between threads
+        static void hash(up::chunk::from chunk, up::chunk::into result, std::size_t threads);
+    };
+
+}
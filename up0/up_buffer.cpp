@@ -246,6 +246,16 @@ void up_buffer::buffer::produce(size_type n)
     } // else: nothing
 }
 
+auto up_buffer::buffer::append(up::chunk::from chunk) -> self&
+{
+    if (chunk.size()) {
+        reserve(chunk.size());
+        std::memcpy(cold(), chunk.data(), chunk.size());
+        produce(chunk.size());
+    }
+    return *this;
+}
+
 up_buffer::buffer::operator up::chunk::into()
 {
     return {cold(), capacity()};
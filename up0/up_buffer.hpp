@@ -77,6 +77,8 @@ namespace up_buffer
         auto reserve(size_type required_cold_size) -> self&;
         // move the point between warm and cold range
         void produce(size_type n);
+        // copy the chunk to the end of the warm range (reserving space if necessary)
+        auto append(up::chunk::from chunk) -> self&;
         // implicit conversion for typical usage of cold range
         operator up::chunk::into();
     };
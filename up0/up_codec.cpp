@@ -0,0 +1,414 @@
+#include "up_codec.hpp"
+
+#include <array>
+#include <cstring>
+
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+
+#include "up_char_cast.hpp"
+#include "up_exception.hpp"
+#include "up_ints.hpp"
+
+
+namespace
+{
+
+    using sizes = up::ints::domain<std::size_t>;
+
+    const char hex_digits[] = "0123456789abcdef";
+    const char base64_standard[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char base64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    // values of all characters, with 0xff for invalid characters
+    using decode_table = std::array<uint8_t, 256>;
+
+    constexpr auto make_decode_table(const char* alphabet, std::size_t size) -> decode_table
+    {
+        decode_table result = {};
+        for (auto&& value : result) {
+            value = 0xff;
+        }
+        for (std::size_t i = 0; i != size; ++i) {
+            result[static_cast<unsigned char>(alphabet[i])] = static_cast<uint8_t>(i);
+        }
+        return result;
+    }
+
+    constexpr auto make_hex_table() -> decode_table
+    {
+        decode_table result = make_decode_table(hex_digits, 16);
+        for (uint8_t i = 10; i != 16; ++i) {
+            result['A' + i - 10] = i;
+        }
+        return result;
+    }
+
+    constexpr const decode_table hex_values = make_hex_table();
+    constexpr const decode_table base64_standard_table = make_decode_table(base64_standard, 64);
+    constexpr const decode_table base64_url_table = make_decode_table(base64_url, 64);
+
+
+    [[noreturn]]
+    void raise_bad_hex_char(const up::string_view& text, std::size_t position)
+    {
+        throw up::make_exception("bad-hex-char").with(position, text[position]);
+    }
+
+    [[noreturn]]
+    void raise_bad_base64_char(const up::string_view& text, std::size_t position)
+    {
+        throw up::make_exception("bad-base64-char").with(position, text[position]);
+    }
+
+
+    void hex_encode_aux(const unsigned char* p, std::size_t n, char* q)
+    {
+#ifdef __SSSE3__
+        const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits));
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        for (; n >= 16; p += 16, n -= 16, q += 32) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+            __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(x, mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(q), _mm_unpacklo_epi8(high, low));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(q + 16), _mm_unpackhi_epi8(high, low));
+        }
+#endif
+        for (; n; ++p, --n) {
+            *q++ = hex_digits[*p >> 4];
+            *q++ = hex_digits[*p & 15];
+        }
+    }
+
+#ifdef __SSSE3__
+    // returns false if any character is not a hex digit
+    bool hex_values_16(const char* p, __m128i& result)
+    {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+        __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+        result = _mm_or_si128(
+            _mm_and_si128(is_digit, digit),
+            _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+        return _mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) == 0xffff;
+    }
+#endif
+
+    void hex_decode_aux(const up::string_view& text, unsigned char* q)
+    {
+        const char* p = text.data();
+        std::size_t n = text.size();
+#ifdef __SSSE3__
+        /* Each pair of digits is combined with a multiply-add. */
+        const __m128i weights = _mm_set1_epi16(0x0110);
+        for (; n >= 32; p += 32, n -= 32, q += 16) {
+            __m128i a, b;
+            if (!hex_values_16(p, a) || !hex_values_16(p + 16, b)) {
+                break;
+            }
+            __m128i x = _mm_packus_epi16(_mm_maddubs_epi16(a, weights), _mm_maddubs_epi16(b, weights));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(q), x);
+        }
+#endif
+        for (; n; p += 2, n -= 2) {
+            uint8_t high = hex_values[static_cast<unsigned char>(p[0])];
+            uint8_t low = hex_values[static_cast<unsigned char>(p[1])];
+            if ((high | low) == 0xff) {
+                raise_bad_hex_char(text, p - text.data() + (high == 0xff ? 0 : 1));
+            }
+            *q++ = static_cast<unsigned char>(high << 4 | low);
+        }
+    }
+
+
+    void base64_encode_aux(const unsigned char* p, std::size_t n, char* q, up::base64_alphabet alphabet, bool padding)
+    {
+        const char* chars = alphabet == up::base64_alphabet::url ? base64_url : base64_standard;
+#ifdef __SSSE3__
+        /* See "Faster Base64 Encoding and Decoding using AVX2 Instructions"
+         * by Wojciech Muła and Daniel Lemire. Each iteration reads 16 bytes,
+         * but only uses 12 of them. */
+        const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+        const __m128i offsets = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52,
+            static_cast<char>(chars[62] - 62), static_cast<char>(chars[63] - 63), 'A', 0, 0);
+        for (; n >= 16; p += 12, n -= 12, q += 16) {
+            __m128i x = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), shuffle);
+            __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(x, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+            __m128i t1 = _mm_mullo_epi16(_mm_and_si128(x, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+            __m128i indexes = _mm_or_si128(t0, t1);
+            // map the ranges of the alphabet to the offsets above
+            __m128i ranges = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+            ranges = _mm_or_si128(ranges,
+                _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes), _mm_set1_epi8(13)));
+            __m128i result = _mm_add_epi8(_mm_shuffle_epi8(offsets, ranges), indexes);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(q), result);
+        }
+#endif
+        for (; n >= 3; p += 3, n -= 3) {
+            uint32_t x = uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2];
+            *q++ = chars[x >> 18];
+            *q++ = chars[(x >> 12) & 63];
+            *q++ = chars[(x >> 6) & 63];
+            *q++ = chars[x & 63];
+        }
+        if (n) {
+            uint32_t x = uint32_t(p[0]) << 16 | (n == 2 ? uint32_t(p[1]) << 8 : 0);
+            *q++ = chars[x >> 18];
+            *q++ = chars[(x >> 12) & 63];
+            if (n == 2) {
+                *q++ = chars[(x >> 6) & 63];
+            }
+            if (padding) {
+                *q++ = '=';
+                if (n == 1) {
+                    *q++ = '=';
+                }
+            }
+        }
+    }
+
+    // size without padding
+    auto base64_content_size(const up::string_view& text) -> std::size_t
+    {
+        std::size_t n = text.size();
+        if (n % 4 == 0 && n && text[n - 1] == '=') {
+            n -= text[n - 2] == '=' ? 2 : 1;
+        }
+        if (n % 4 == 1) {
+            throw up::make_exception("bad-base64-size").with(text.size());
+        }
+        return n;
+    }
+
+#ifdef __SSSE3__
+    /* Decodes 16 characters of the standard alphabet into 12 bytes (stored
+     * in the lower part of the result). Returns false if there are invalid
+     * characters. See the paper mentioned above. */
+    bool base64_decode_16(__m128i input, __m128i& result)
+    {
+        const __m128i lut_low = _mm_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+        const __m128i lut_high = _mm_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        const __m128i slash = _mm_set1_epi8('/');
+        __m128i high = _mm_and_si128(_mm_srli_epi32(input, 4), mask);
+        __m128i low = _mm_and_si128(input, mask);
+        __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lut_low, low), _mm_shuffle_epi8(lut_high, high));
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(invalid, _mm_setzero_si128()))) {
+            return false;
+        }
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(input, slash), high));
+        __m128i values = _mm_add_epi8(input, roll);
+        __m128i merged = _mm_madd_epi16(
+            _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+        result = _mm_shuffle_epi8(merged,
+            _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        return true;
+    }
+#endif
+
+    void base64_decode_aux(const up::string_view& text, std::size_t n, unsigned char* q, up::base64_alphabet alphabet)
+    {
+        const char* p = text.data();
+        bool url = alphabet == up::base64_alphabet::url;
+#ifdef __SSSE3__
+        for (; n >= 16; p += 16, n -= 16, q += 12) {
+            __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if (url) {
+                /* Map the URL-safe alphabet to the standard alphabet, after
+                 * rejecting the characters that differ. */
+                __m128i standard = _mm_or_si128(
+                    _mm_cmpeq_epi8(input, _mm_set1_epi8('+')), _mm_cmpeq_epi8(input, _mm_set1_epi8('/')));
+                if (_mm_movemask_epi8(standard)) {
+                    break;
+                }
+                __m128i minus = _mm_cmpeq_epi8(input, _mm_set1_epi8('-'));
+                __m128i underscore = _mm_cmpeq_epi8(input, _mm_set1_epi8('_'));
+                input = _mm_add_epi8(input, _mm_or_si128(
+                        _mm_and_si128(minus, _mm_set1_epi8('+' - '-')),
+                        _mm_and_si128(underscore, _mm_set1_epi8('/' - '_'))));
+            }
+            __m128i result;
+            if (!base64_decode_16(input, result)) {
+                break;
+            }
+            alignas(16) unsigned char bytes[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(bytes), result);
+            std::memcpy(q, bytes, 12);
+        }
+#endif
+        auto&& table = url ? base64_url_table : base64_standard_table;
+        auto&& value = [&](std::size_t i) -> uint32_t {
+            uint8_t result = table[static_cast<unsigned char>(p[i])];
+            if (result == 0xff) {
+                raise_bad_base64_char(text, p - text.data() + i);
+            }
+            return result;
+        };
+        for (; n >= 4; p += 4, n -= 4) {
+            uint32_t x = value(0) << 18 | value(1) << 12 | value(2) << 6 | value(3);
+            *q++ = static_cast<unsigned char>(x >> 16);
+            *q++ = static_cast<unsigned char>(x >> 8);
+            *q++ = static_cast<unsigned char>(x);
+        }
+        if (n) {
+            uint32_t x = value(0) << 18 | value(1) << 12 | (n == 3 ? value(2) << 6 : 0);
+            *q++ = static_cast<unsigned char>(x >> 16);
+            if (n == 3) {
+                *q++ = static_cast<unsigned char>(x >> 8);
+            }
+        }
+    }
+
+
+    void check_size(up::chunk::into result, std::size_t size)
+    {
+        if (result.size() != size) {
+            throw up::make_exception("bad-codec-result-size").with(result.size(), size);
+        }
+    }
+
+    template <typename Function>
+    void append(up::buffer& buffer, std::size_t size, Function&& function)
+    {
+        buffer.reserve(size);
+        function(up::chunk::into(buffer.cold(), size));
+        buffer.produce(size);
+    }
+
+    template <typename Function>
+    auto make_string(std::size_t size, Function&& function) -> up::unique_string
+    {
+        up::unique_string result;
+        result.resize(size);
+        function(up::chunk::into(result.data(), size));
+        return result;
+    }
+
+    template <typename Function>
+    auto make_buffer(std::size_t size, Function&& function) -> up::buffer
+    {
+        up::buffer result;
+        append(result, size, std::forward<Function>(function));
+        return result;
+    }
+
+}
+
+
+auto up_codec::hex_encoded_size(std::size_t size) -> std::size_t
+{
+    return sizes::or_length_error::mul(size, 2);
+}
+
+void up_codec::hex_encode(up::chunk::from chunk, up::chunk::into result)
+{
+    check_size(result, hex_encoded_size(chunk.size()));
+    hex_encode_aux(up::char_cast<unsigned char>(chunk.data()), chunk.size(), result.data());
+}
+
+void up_codec::hex_encode(up::chunk::from chunk, up::buffer& buffer)
+{
+    append(buffer, hex_encoded_size(chunk.size()), [&](up::chunk::into result) {
+        hex_encode(chunk, result);
+    });
+}
+
+auto up_codec::hex_encode(up::chunk::from chunk) -> up::unique_string
+{
+    return make_string(hex_encoded_size(chunk.size()), [&](up::chunk::into result) {
+        hex_encode(chunk, result);
+    });
+}
+
+auto up_codec::hex_decoded_size(const up::string_view& text) -> std::size_t
+{
+    if (text.size() % 2 != 0) {
+        throw up::make_exception("bad-hex-size").with(text.size());
+    }
+    return text.size() / 2;
+}
+
+void up_codec::hex_decode(const up::string_view& text, up::chunk::into result)
+{
+    check_size(result, hex_decoded_size(text));
+    hex_decode_aux(text, up::char_cast<unsigned char>(result.data()));
+}
+
+void up_codec::hex_decode(const up::string_view& text, up::buffer& buffer)
+{
+    append(buffer, hex_decoded_size(text), [&](up::chunk::into result) {
+        hex_decode(text, result);
+    });
+}
+
+auto up_codec::hex_decode(const up::string_view& text) -> up::buffer
+{
+    return make_buffer(hex_decoded_size(text), [&](up::chunk::into result) {
+        hex_decode(text, result);
+    });
+}
+
+
+auto up_codec::base64_encoded_size(std::size_t size, bool padding) -> std::size_t
+{
+    std::size_t blocks = size / 3;
+    std::size_t rest = size % 3;
+    return sizes::or_length_error::sum(
+        sizes::or_length_error::mul(blocks, 4),
+        rest == 0 ? 0 : padding ? 4 : rest + 1);
+}
+
+void up_codec::base64_encode(up::chunk::from chunk, up::chunk::into result, base64_alphabet alphabet, bool padding)
+{
+    check_size(result, base64_encoded_size(chunk.size(), padding));
+    base64_encode_aux(up::char_cast<unsigned char>(chunk.data()), chunk.size(), result.data(), alphabet, padding);
+}
+
+void up_codec::base64_encode(up::chunk::from chunk, up::buffer& buffer, base64_alphabet alphabet, bool padding)
+{
+    append(buffer, base64_encoded_size(chunk.size(), padding), [&](up::chunk::into result) {
+        base64_encode(chunk, result, alphabet, padding);
+    });
+}
+
+auto up_codec::base64_encode(up::chunk::from chunk, base64_alphabet alphabet, bool padding) -> up::unique_string
+{
+    return make_string(base64_encoded_size(chunk.size(), padding), [&](up::chunk::into result) {
+        base64_encode(chunk, result, alphabet, padding);
+    });
+}
+
+auto up_codec::base64_decoded_size(const up::string_view& text) -> std::size_t
+{
+    std::size_t n = base64_content_size(text);
+    return n / 4 * 3 + (n % 4 ? n % 4 - 1 : 0);
+}
+
+void up_codec::base64_decode(const up::string_view& text, up::chunk::into result, base64_alphabet alphabet)
+{
+    check_size(result, base64_decoded_size(text));
+    base64_decode_aux(text, base64_content_size(text), up::char_cast<unsigned char>(result.data()), alphabet);
+}
+
+void up_codec::base64_decode(const up::string_view& text, up::buffer& buffer, base64_alphabet alphabet)
+{
+    append(buffer, base64_decoded_size(text), [&](up::chunk::into result) {
+        base64_decode(text, result, alphabet);
+    });
+}
+
+auto up_codec::base64_decode(const up::string_view& text, base64_alphabet alphabet) -> up::buffer
+{
+    return make_buffer(base64_decoded_size(text), [&](up::chunk::into result) {
+        base64_decode(text, result, alphabet);
+    });
+}
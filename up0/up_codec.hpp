@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+ * Encoding and decoding of binary data as hexadecimal digits and as base64
+ * (RFC 4648, both with the standard and the URL-safe alphabet).
+ *
+ * The output size is always computed in advance, so that the result is
+ * written in a single pass into exactly presized storage. If SSSE3 is
+ * available, blocks of 16 bytes are processed with vector instructions.
+ *
+ * Encoding produces lowercase hex digits and padded base64 (unless padding
+ * is disabled). Decoding accepts both cases for hex digits, and base64 with
+ * or without padding. Any other character (including whitespace) is an
+ * error.
+ */
+
+#include "up_buffer.hpp"
+#include "up_string.hpp"
+
+
+namespace up_codec
+{
+
+    auto hex_encoded_size(std::size_t size) -> std::size_t;
+    // the result must have exactly the encoded size
+    void hex_encode(up::chunk::from chunk, up::chunk::into result);
+    // appends to the buffer
+    void hex_encode(up::chunk::from chunk, up::buffer& buffer);
+    auto hex_encode(up::chunk::from chunk) -> up::unique_string;
+
+    auto hex_decoded_size(const up::string_view& text) -> std::size_t;
+    // the result must have exactly the decoded size
+    void hex_decode(const up::string_view& text, up::chunk::into result);
+    // appends to the buffer
+    void hex_decode(const up::string_view& text, up::buffer& buffer);
+    auto hex_decode(const up::string_view& text) -> up::buffer;
+
+
+    enum class base64_alphabet : uint8_t { standard, url, };
+
+    auto base64_encoded_size(std::size_t size, bool padding = true) -> std::size_t;
+    void base64_encode(up::chunk::from chunk, up::chunk::into result,
+        base64_alphabet alphabet = base64_alphabet::standard, bool padding = true);
+    void base64_encode(up::chunk::from chunk, up::buffer& buffer,
+        base64_alphabet alphabet = base64_alphabet::standard, bool padding = true);
+    auto base64_encode(up::chunk::from chunk,
+        base64_alphabet alphabet = base64_alphabet::standard, bool padding = true) -> up::unique_string;
+
+    auto base64_decoded_size(const up::string_view& text) -> std::size_t;
+    void base64_decode(const up::string_view& text, up::chunk::into result,
+        base64_alphabet alphabet = base64_alphabet::standard);
+    void base64_decode(const up::string_view& text, up::buffer& buffer,
+        base64_alphabet alphabet = base64_alphabet::standard);
+    auto base64_decode(const up::string_view& text,
+        base64_alphabet alphabet = base64_alphabet::standard) -> up::buffer;
+
+}
+
+namespace up
+{
+
+    using up_codec::hex_encoded_size;
+    using up_codec::hex_encode;
+    using up_codec::hex_decoded_size;
+    using up_codec::hex_decode;
+    using up_codec::base64_alphabet;
+    using up_codec::base64_encoded_size;
+    using up_codec::base64_encode;
+    using up_codec::base64_decoded_size;
+    using up_codec::base64_decode;
+
+}
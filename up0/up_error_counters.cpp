@@ -0,0 +1,282 @@
+#include "up_error_counters.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "up_exception.hpp"
+#include "up_out.hpp"
+
+namespace
+{
+
+    using event = up_error_counters::error_counters::event;
+    using entry = up_error_counters::error_counters::entry;
+
+    const constexpr std::size_t slot_count = 64;
+
+    auto hash_label(const char* label) noexcept -> std::size_t
+    {
+        return std::size_t((reinterpret_cast<std::uintptr_t>(label) >> 3) * 0x9e3779b97f4a7c15u);
+    }
+
+
+    class slot final
+    {
+    public: // --- state ---
+        std::atomic<const char*> _label{nullptr};
+        std::size_t _size = 0;
+        std::atomic<uint64_t> _counts[2] = {{0}, {0}};
+    };
+
+    /* Counters of a single thread. The owning thread adds slots and
+     * increments the counters, and other threads only read them. The slots
+     * are never moved. If a table is full, the following labels are stored
+     * in a chained table. */
+    class table final
+    {
+    public: // --- state ---
+        slot _slots[slot_count];
+        std::atomic<table*> _next{nullptr};
+    public: // --- life ---
+        explicit table() = default;
+        table(const table& rhs) = delete;
+        ~table() noexcept
+        {
+            delete _next.load(std::memory_order_relaxed);
+        }
+    public: // --- operations ---
+        auto find(const up::source& source) -> slot&
+        {
+            auto label = source.label_c_str();
+            for (table* t = this; ; ) {
+                for (std::size_t i = 0, h = hash_label(label); i != slot_count; ++i) {
+                    auto&& s = t->_slots[(h + i) % slot_count];
+                    auto current = s._label.load(std::memory_order_relaxed);
+                    if (current == label) {
+                        return s;
+                    } else if (current == nullptr) {
+                        s._size = source.label().size();
+                        s._label.store(label, std::memory_order_release);
+                        return s;
+                    }
+                }
+                auto next = t->_next.load(std::memory_order_relaxed);
+                if (next == nullptr) {
+                    next = new table();
+                    t->_next.store(next, std::memory_order_release);
+                }
+                t = next;
+            }
+        }
+        template <typename Callable>
+        void for_each(Callable&& callable) const
+        {
+            for (const table* t = this; t; t = t->_next.load(std::memory_order_acquire)) {
+                for (auto&& s : t->_slots) {
+                    if (auto label = s._label.load(std::memory_order_acquire)) {
+                        callable(up::string_view(label, s._size),
+                            s._counts[0].load(std::memory_order_relaxed),
+                            s._counts[1].load(std::memory_order_relaxed));
+                    }
+                }
+            }
+        }
+    };
+
+
+    using totals = std::map<up::string_view, std::pair<uint64_t, uint64_t>>;
+
+    void add_totals(totals& result, const table& t)
+    {
+        t.for_each([&](up::string_view label, uint64_t thrown, uint64_t caught) {
+            auto&& value = result[label];
+            value.first += thrown;
+            value.second += caught;
+        });
+    }
+
+
+    class registry final
+    {
+    private: // --- state ---
+        std::mutex _mutex;
+        std::vector<const table*> _tables;
+        totals _retired; // from terminated threads
+    public: // --- operations ---
+        void enter(const table& t)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tables.push_back(&t);
+        }
+        void leave(const table& t) noexcept
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tables.erase(std::find(_tables.begin(), _tables.end(), &t));
+            try {
+                add_totals(_retired, t);
+            } catch (...) {
+                // ignore, because the counters of the thread are destroyed
+            }
+        }
+        auto collect() -> totals
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            totals result = _retired;
+            for (auto&& t : _tables) {
+                add_totals(result, *t);
+            }
+            return result;
+        }
+    };
+
+    auto get_registry() -> registry&
+    {
+        // intentionally leaked, because threads might terminate late
+        static registry* instance = new registry();
+        return *instance;
+    }
+
+
+    class local_table final
+    {
+    public: // --- state ---
+        table _table;
+    public: // --- life ---
+        explicit local_table()
+        {
+            get_registry().enter(_table);
+        }
+        local_table(const local_table& rhs) = delete;
+        ~local_table() noexcept
+        {
+            get_registry().leave(_table);
+        }
+    };
+
+}
+
+
+void up_error_counters::error_counters::count(const up::source& source, event e) noexcept
+{
+    try {
+        static thread_local local_table local;
+        auto&& counter = local._table.find(source)._counts[e == event::caught];
+        // single writer, i.e. no read-modify-write required
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } catch (...) {
+        // ignore, i.e. no suppress_current_exception to avoid recursion
+    }
+}
+
+auto up_error_counters::error_counters::snapshot() -> std::vector<entry>
+{
+    std::vector<entry> result;
+    for (auto&& item : get_registry().collect()) {
+        result.emplace_back(item.first, item.second.first, item.second.second);
+    }
+    return result;
+}
+
+auto up_error_counters::error_counters::to_insight() -> up::insight
+{
+    up::insights nested;
+    for (auto&& item : snapshot()) {
+        nested.push_back(item.to_insight());
+    }
+    return up::insight(typeid(self), "error-counters", std::move(nested));
+}
+
+
+auto up_error_counters::error_counters::entry::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), up::shared_string(_label),
+        up::invoke_to_insight_with_fallback(_thrown),
+        up::invoke_to_insight_with_fallback(_caught));
+}
+
+
+class up_error_counters::report_limiter::impl final
+{
+private: // --- scope ---
+    static const constexpr std::size_t capacity = 256;
+    class state final
+    {
+    public: // --- state ---
+        std::atomic<const char*> _label{nullptr};
+        std::atomic<int64_t> _window{std::numeric_limits<int64_t>::min()};
+        std::atomic<uint64_t> _count{0};
+    };
+private: // --- state ---
+    uint64_t _limit;
+    int64_t _interval;
+    // the last state is shared by all labels, that do not fit
+    state _states[capacity + 1];
+public: // --- life ---
+    explicit impl(std::size_t limit, const up::duration& interval)
+        : _limit(limit), _interval(std::max<int64_t>(interval.count(), 1))
+    { }
+public: // --- operations ---
+    auto admit(const up::source& source) noexcept -> admission
+    {
+        auto&& s = _find(source.label_c_str());
+        auto window = up::steady_clock::now().time_since_epoch().count() / _interval;
+        auto current = s._window.load(std::memory_order_relaxed);
+        if (current != window && s._window.compare_exchange_strong(current, window, std::memory_order_relaxed)) {
+            auto previous = s._count.exchange(1, std::memory_order_relaxed);
+            return admission(_limit != 0, previous > _limit ? previous - _limit : 0);
+        } else {
+            auto n = s._count.fetch_add(1, std::memory_order_relaxed) + 1;
+            return admission(n <= _limit, 0);
+        }
+    }
+private:
+    auto _find(const char* label) noexcept -> state&
+    {
+        for (std::size_t i = 0, h = hash_label(label); i != capacity; ++i) {
+            auto&& s = _states[(h + i) % capacity];
+            const char* current = s._label.load(std::memory_order_relaxed);
+            if (current == nullptr
+                && s._label.compare_exchange_strong(current, label, std::memory_order_relaxed)) {
+                return s;
+            } else if (current == label) {
+                return s;
+            }
+        }
+        return _states[capacity];
+    }
+};
+
+void up_error_counters::report_limiter::destroy(impl* ptr)
+{
+    std::default_delete<impl>()(ptr);
+}
+
+up_error_counters::report_limiter::report_limiter(std::size_t limit, const up::duration& interval)
+    : _impl(up::impl_make(limit, interval))
+{ }
+
+auto up_error_counters::report_limiter::admit(const up::source& source) noexcept -> admission
+{
+    return _impl->admit(source);
+}
+
+void up_error_counters::report_limiter::log_current_exception(std::ostream& os)
+{
+    auto result = [&]() {
+        try {
+            throw;
+        } catch (const up::throwable& e) {
+            return admit(e.source());
+        } catch (...) {
+            return admit("unknown-exception");
+        }
+    }();
+    if (result) {
+        if (result.suppressed()) {
+            up::out(os, "suppressed ", result.suppressed(), " similar exceptions\n");
+        }
+        up::log_current_exception(os);
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+/**
+ * Process-wide counters for exceptions per source label, and a limiter for
+ * reporting exceptions at high rates.
+ *
+ * Exceptions created with up::make_exception are counted as thrown, and
+ * exceptions passed to up::suppress_current_exception are counted as
+ * caught. The counters are maintained per thread without locks or shared
+ * cache lines, and they are only aggregated on demand. Labels are compared
+ * by address for counting, and by value for the aggregation.
+ */
+
+#include "up_chrono.hpp"
+#include "up_impl_ptr.hpp"
+#include "up_insight.hpp"
+#include "up_source.hpp"
+#include "up_swap.hpp"
+
+namespace up_error_counters
+{
+
+    class error_counters final
+    {
+    public: // --- scope ---
+        using self = error_counters;
+        enum class event : uint8_t { thrown, caught };
+        class entry;
+    public: // --- operations ---
+        // best effort, i.e. occurrences might be lost on memory exhaustion
+        static void count(const up::source& source, event e) noexcept;
+        // sorted by label, including counters of terminated threads
+        static auto snapshot() -> std::vector<entry>;
+        static auto to_insight() -> up::insight;
+    };
+
+
+    class error_counters::entry final
+    {
+    private: // --- state ---
+        up::string_view _label;
+        uint64_t _thrown;
+        uint64_t _caught;
+    public: // --- life ---
+        explicit entry(up::string_view label, uint64_t thrown, uint64_t caught) noexcept
+            : _label(label), _thrown(thrown), _caught(caught)
+        { }
+    public: // --- operations ---
+        auto label() const noexcept { return _label; }
+        auto thrown() const noexcept { return _thrown; }
+        auto caught() const noexcept { return _caught; }
+        auto to_insight() const -> up::insight;
+    };
+
+
+    /**
+     * Admits the first occurrences per source label and interval, so that
+     * the (expensive) insights are only created for a bounded number of
+     * exceptions. The number of the rejected occurrences is reported with
+     * the first admitted occurrence of a later interval. The limiter can be
+     * used concurrently. It is approximate at the boundaries of intervals,
+     * and all labels beyond an internal capacity share their state.
+     */
+    class report_limiter final
+    {
+    public: // --- scope ---
+        using self = report_limiter;
+        class impl;
+        static void destroy(impl* ptr);
+        class admission;
+    private: // --- state ---
+        up::impl_ptr<impl, destroy> _impl;
+    public: // --- life ---
+        explicit report_limiter(std::size_t limit, const up::duration& interval);
+        report_limiter(const self& rhs) = delete;
+        report_limiter(self&& rhs) noexcept = default;
+        ~report_limiter() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = default;
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto admit(const up::source& source) noexcept -> admission;
+        /* Logs the current exception (see up::log_current_exception), if it
+         * is admitted, preceded by the number of rejected occurrences. */
+        void log_current_exception(std::ostream& os);
+    };
+
+
+    class report_limiter::admission final
+    {
+    private: // --- state ---
+        bool _admitted;
+        uint64_t _suppressed;
+    public: // --- life ---
+        explicit admission(bool admitted, uint64_t suppressed) noexcept
+            : _admitted(admitted), _suppressed(suppressed)
+        { }
+    public: // --- operations ---
+        explicit operator bool() const noexcept { return _admitted; }
+        // rejected occurrences in earlier intervals (only if admitted)
+        auto suppressed() const noexcept { return _suppressed; }
+    };
+
+}
+
+namespace up
+{
+
+    using up_error_counters::error_counters;
+    using up_error_counters::report_limiter;
+
+}
@@ -33,16 +33,18 @@ namespace
     }
 
 
-    void log_insight(std::ostream& os, const up::insight& insight, std::size_t depth)
+    void log_insight(up::sink& s, const up::insight& insight, std::size_t depth)
     {
-        up::out(os,
-            up::unique_string(depth * 4, ' '),
+        for (std::size_t i = 0; i != depth * 4; ++i) {
+            s.put(' ');
+        }
+        up::out(s,
             up::type_display_name(insight.type_info()),
             ':',
             insight.value(),
             '\n');
         for (auto&& nested : insight.nested()) {
-            log_insight(os, nested, depth + 1);
+            log_insight(s, nested, depth + 1);
         }
     }
 
@@ -75,8 +77,9 @@ void up_exception::log_current_exception_aux(std::ostream& os)
         throw;
     } catch (const up::exception& e) {
         auto&& s = e.source();
-        up::out(os, s.file(), ':', s.line(), ": ", s.label(), '\n');
-        log_insight(os, e.to_insight(), 1);
+        up::ostream_sink sink(os);
+        up::out(sink, s.file(), ':', s.line(), ": ", s.label(), '\n');
+        log_insight(sink, e.to_insight(), 1);
     } catch (const up::throwable& e) {
         auto&& s = e.source();
         up::out(os, s.file(), ':', s.line(), ": ", s.label(), '\n');
@@ -94,6 +97,8 @@ void up_exception::suppress_current_exception(const up::source& source __attribu
      * actually called with an active exception. */
     try {
         throw;
+    } catch (const up::throwable& e) {
+        up::error_counters::count(e.source(), up::error_counters::event::caught);
     } catch (...) {
         // nothing
     }
@@ -14,6 +14,7 @@
  * (c) make it easy to add exception types.
  */
 
+#include "up_error_counters.hpp"
 #include "up_insight.hpp"
 #include "up_out.hpp"
 #include "up_throwable.hpp"
@@ -145,6 +146,7 @@ namespace up_exception
     template <typename Exception = std::exception, typename..., typename... Args>
     auto make_exception(up::source source, Args&&... args)
     {
+        up::error_counters::count(source, up::error_counters::event::thrown);
         return typename hierarchy<Exception, std::decay_t<Args>...>::template bundle<>(
             std::move(source), {}, std::forward<Args>(args)...);
     }
@@ -191,9 +193,10 @@ namespace up_exception
      * because it is converted to an error code. That means the error is still
      * signaled. However, the information from the exception is lost.
      *
-     * The function does basically nothing. The idea is to use this function
-     * to mark all locations where exceptions are suppressed. In the future, a
-     * handler for suppressed exceptions might be registered.
+     * The function does basically nothing, except for counting the
+     * exception as caught (see up::error_counters). The idea is to use this
+     * function to mark all locations where exceptions are suppressed. In the
+     * future, a handler for suppressed exceptions might be registered.
      */
     void suppress_current_exception(const up::source& source);
 
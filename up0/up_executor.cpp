@@ -0,0 +1,654 @@
+#include "up_executor.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+namespace
+{
+
+    using job = up_executor::executor::job;
+
+    // upper limit for the workers, that replace blocked workers
+    const std::size_t max_spare_workers = 64;
+
+    // parallel_for processes at least 1/32 of the share of each worker at once
+    const std::size_t chunks_per_worker = 32;
+
+
+    /* Chase-Lev work-stealing deque with the memory orderings from "Correct
+     * and Efficient Work-Stealing for Weak Memory Models" (Lê et al., 2013).
+     * Only the owner pushes and pops at the bottom, the other threads steal
+     * from the top. Replaced rings are kept until the deque is destroyed,
+     * because thieves might still read from them. */
+    class work_deque final
+    {
+    private: // --- scope ---
+        using self = work_deque;
+        class ring final
+        {
+        private: // --- state ---
+            std::size_t _mask;
+            std::unique_ptr<std::atomic<job*>[]> _items;
+        public: // --- life ---
+            explicit ring(std::size_t size)
+                : _mask(size - 1), _items(new std::atomic<job*>[size])
+            { }
+        public: // --- operations ---
+            auto size() const noexcept -> std::size_t
+            {
+                return _mask + 1;
+            }
+            auto get(int64_t index) const noexcept -> job*
+            {
+                return _items[static_cast<std::size_t>(index) & _mask].load(std::memory_order_relaxed);
+            }
+            void put(int64_t index, job* item) noexcept
+            {
+                _items[static_cast<std::size_t>(index) & _mask].store(item, std::memory_order_relaxed);
+            }
+        };
+        static const constexpr std::size_t initial_size = 256;
+    private: // --- state ---
+        alignas(64) std::atomic<int64_t> _top = {0};
+        alignas(64) std::atomic<int64_t> _bottom = {0};
+        std::atomic<ring*> _ring;
+        std::vector<std::unique_ptr<ring>> _rings;
+    public: // --- life ---
+        explicit work_deque()
+        {
+            _rings.push_back(std::make_unique<ring>(initial_size));
+            _ring.store(_rings.back().get(), std::memory_order_relaxed);
+        }
+        work_deque(const self& rhs) = delete;
+        work_deque(self&& rhs) noexcept = delete;
+        ~work_deque() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        // only a hint, if not invoked by the owner
+        bool empty() const noexcept
+        {
+            return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+        }
+        void push(job* item)
+        {
+            auto bottom = _bottom.load(std::memory_order_relaxed);
+            auto top = _top.load(std::memory_order_acquire);
+            auto items = _ring.load(std::memory_order_relaxed);
+            if (bottom - top > static_cast<int64_t>(items->size()) - 1) {
+                items = _grow(items, top, bottom);
+            }
+            items->put(bottom, item);
+            _bottom.store(bottom + 1, std::memory_order_release);
+        }
+        auto pop() noexcept -> job*
+        {
+            auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+            auto items = _ring.load(std::memory_order_relaxed);
+            _bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto top = _top.load(std::memory_order_relaxed);
+            if (top > bottom) {
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            auto item = items->get(bottom);
+            if (top == bottom) {
+                // last item, race with thieves
+                if (!_top.compare_exchange_strong(top, top + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+        auto steal() noexcept -> job*
+        {
+            for (;;) {
+                auto top = _top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto bottom = _bottom.load(std::memory_order_acquire);
+                if (top >= bottom) {
+                    return nullptr;
+                }
+                auto item = _ring.load(std::memory_order_acquire)->get(top);
+                if (_top.compare_exchange_strong(top, top + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    return item;
+                }
+            }
+        }
+    private:
+        auto _grow(ring* items, int64_t top, int64_t bottom) -> ring*
+        {
+            _rings.reserve(_rings.size() + 1);
+            _rings.push_back(std::make_unique<ring>(items->size() * 2));
+            auto result = _rings.back().get();
+            for (auto i = top; i != bottom; ++i) {
+                result->put(i, items->get(i));
+            }
+            _ring.store(result, std::memory_order_release);
+            return result;
+        }
+    };
+
+}
+
+
+class up_executor::executor::impl final
+{
+public: // --- scope ---
+    using self = impl;
+    class worker;
+    class group;
+    class range;
+    static thread_local worker* current;
+private: // --- state ---
+    const std::size_t _concurrency;
+    const std::size_t _capacity;
+    std::unique_ptr<worker[]> _workers;
+    std::atomic<std::size_t> _count = {0};
+    // number of workers, that are neither blocked nor parked
+    std::atomic<std::size_t> _running;
+    std::atomic<std::size_t> _sleepers = {0};
+    std::atomic<uint64_t> _epoch = {0};
+    std::atomic<bool> _stop = {false};
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::condition_variable _unpark;
+    std::size_t _parked = 0;
+    std::size_t _unparks = 0;
+    std::atomic<std::size_t> _injected_size = {0};
+    std::mutex _injected_mutex;
+    std::deque<job*> _injected;
+public: // --- life ---
+    explicit impl(std::size_t concurrency);
+    impl(const self& rhs) = delete;
+    impl(self&& rhs) noexcept = delete;
+    ~impl() noexcept;
+public: // --- operations ---
+    auto operator=(const self& rhs) & -> self& = delete;
+    auto operator=(self&& rhs) & noexcept -> self& = delete;
+    auto to_insight() -> up::insight
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return up::insight(typeid(*this), "executor-impl",
+            up::invoke_to_insight_with_fallback(_concurrency),
+            up::invoke_to_insight_with_fallback(_count.load()),
+            up::invoke_to_insight_with_fallback(_running.load()),
+            up::invoke_to_insight_with_fallback(_parked));
+    }
+    auto concurrency() const noexcept -> std::size_t
+    {
+        return _concurrency;
+    }
+    void submit(job* item);
+    void wait(job& item) noexcept
+    {
+        if (item.await()) {
+            _help(_local(), [&]() { return item.done(); });
+        }
+    }
+    void parallel_for(std::size_t first, std::size_t last,
+        void* context, void (*invoke)(void*, std::size_t, std::size_t));
+    // returns false, if the current thread is no worker of this executor
+    bool block();
+    void unblock() noexcept
+    {
+        _running.fetch_add(1);
+    }
+    void signal() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _epoch.fetch_add(1);
+        }
+        _wakeup.notify_all();
+    }
+    // whether there is no pending work, that could be stolen from the current thread
+    bool starving() const noexcept;
+private:
+    auto _local() const noexcept -> worker*;
+    void _start();
+    void _work(worker& self);
+    void _run(job* item) noexcept
+    {
+        item->run();
+        if (item->awaited()) {
+            signal();
+        }
+        item->release();
+    }
+    auto _find(worker* self) noexcept -> job*;
+    template <typename Done>
+    auto _sleep(worker* self, Done&& done) noexcept -> job*
+    {
+        // see _notify: either the sleeper or the submitter sees the other
+        _sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto seen = _epoch.load();
+        auto item = _find(self);
+        if (!item && !done()) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [&]() { return _epoch.load() != seen || done(); });
+        }
+        _sleepers.fetch_sub(1);
+        return item;
+    }
+    template <typename Done>
+    void _help(worker* self, Done&& done) noexcept
+    {
+        while (!done()) {
+            auto item = _find(self);
+            if (!item) {
+                item = _sleep(self, done);
+            }
+            if (item) {
+                _run(item);
+            }
+        }
+    }
+    void _notify() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleepers.load(std::memory_order_relaxed) != 0) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _epoch.fetch_add(1);
+            }
+            _wakeup.notify_one();
+        }
+    }
+    void _park();
+};
+
+
+class up_executor::executor::impl::worker final
+{
+public: // --- state ---
+    impl* _owner = nullptr;
+    work_deque _deque;
+    std::thread _thread;
+    uint64_t _random = 0;
+public: // --- operations ---
+    auto random() noexcept -> uint64_t
+    {
+        _random ^= _random << 13;
+        _random ^= _random >> 7;
+        _random ^= _random << 17;
+        return _random;
+    }
+};
+
+
+thread_local up_executor::executor::impl::worker* up_executor::executor::impl::current = nullptr;
+
+
+// shared state of a parallel_for
+class up_executor::executor::impl::group final
+{
+private: // --- state ---
+    impl& _owner;
+    void* _context;
+    void (*_invoke)(void*, std::size_t, std::size_t);
+    std::size_t _grain;
+    std::atomic<std::size_t> _remaining;
+    std::atomic<bool> _failed = {false};
+    std::mutex _mutex;
+    std::exception_ptr _error;
+public: // --- life ---
+    explicit group(impl& owner, void* context, void (*invoke)(void*, std::size_t, std::size_t),
+        std::size_t size)
+        : _owner(owner), _context(context), _invoke(invoke)
+        , _grain(std::max<std::size_t>(1, size / (owner.concurrency() * chunks_per_worker)))
+        , _remaining(size)
+    { }
+public: // --- operations ---
+    bool done() const noexcept
+    {
+        return _remaining.load(std::memory_order_acquire) == 0;
+    }
+    void rethrow() const
+    {
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+    }
+    void process(std::size_t first, std::size_t last) noexcept;
+private:
+    bool _split(std::size_t first, std::size_t last) noexcept;
+    void _complete(std::size_t count) noexcept
+    {
+        // the group might be destroyed as soon as the counter reaches zero
+        auto& owner = _owner;
+        if (_remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+            owner.signal();
+        }
+    }
+};
+
+
+class up_executor::executor::impl::range final : public job
+{
+private: // --- state ---
+    group& _group;
+    std::size_t _first;
+    std::size_t _last;
+public: // --- life ---
+    explicit range(group& group, std::size_t first, std::size_t last)
+        : job(0), _group(group), _first(first), _last(last)
+    { }
+private: // --- operations ---
+    void _execute() override
+    {
+        _group.process(_first, _last);
+    }
+};
+
+
+void up_executor::executor::impl::group::process(std::size_t first, std::size_t last) noexcept
+{
+    while (first != last) {
+        // lazy binary splitting: split off the upper half, if nobody has work to steal
+        if (last - first > _grain && _owner.starving()) {
+            auto middle = first + (last - first) / 2;
+            if (_split(middle, last)) {
+                last = middle;
+                continue;
+            }
+        }
+        auto end = std::min(last, first + _grain);
+        if (!_failed.load(std::memory_order_relaxed)) {
+            try {
+                _invoke(_context, first, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+                _failed.store(true, std::memory_order_relaxed);
+            }
+        }
+        _complete(end - first);
+        first = end;
+    }
+}
+
+bool up_executor::executor::impl::group::_split(std::size_t first, std::size_t last) noexcept
+{
+    try {
+        _owner.submit(new range(*this, first, last));
+        return true;
+    } catch (...) {
+        // process the range without splitting
+        return false;
+    }
+}
+
+
+up_executor::executor::impl::impl(std::size_t concurrency)
+    : _concurrency(concurrency ? concurrency : std::max(1u, std::thread::hardware_concurrency()))
+    , _capacity(_concurrency + max_spare_workers)
+    , _workers(new worker[_capacity])
+    , _running(_concurrency)
+{
+    try {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (std::size_t i = 0; i != _concurrency; ++i) {
+            _start();
+        }
+    } catch (...) {
+        // note: the lock is released, because the started workers acquire it
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop.store(true);
+            _epoch.fetch_add(1);
+        }
+        _wakeup.notify_all();
+        _unpark.notify_all();
+        for (std::size_t i = 0, count = _count.load(); i != count; ++i) {
+            _workers[i]._thread.join();
+        }
+        throw;
+    }
+}
+
+up_executor::executor::impl::~impl() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop.store(true);
+        _epoch.fetch_add(1);
+    }
+    _wakeup.notify_all();
+    _unpark.notify_all();
+    // note: blocked workers might start further workers in the meantime
+    for (std::size_t i = 0; ; ++i) {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (i == _count.load()) {
+                break;
+            }
+            thread = std::move(_workers[i]._thread);
+        }
+        thread.join();
+    }
+}
+
+void up_executor::executor::impl::submit(job* item)
+{
+    item->acquire();
+    try {
+        auto self = _local();
+        if (self) {
+            self->_deque.push(item);
+        } else {
+            std::lock_guard<std::mutex> lock(_injected_mutex);
+            _injected.push_back(item);
+            _injected_size.store(_injected.size(), std::memory_order_relaxed);
+        }
+    } catch (...) {
+        item->release();
+        throw;
+    }
+    _notify();
+}
+
+void up_executor::executor::impl::parallel_for(std::size_t first, std::size_t last,
+    void* context, void (*invoke)(void*, std::size_t, std::size_t))
+{
+    if (first >= last) {
+        return;
+    }
+    group items(*this, context, invoke, last - first);
+    items.process(first, last);
+    _help(_local(), [&]() { return items.done(); });
+    items.rethrow();
+}
+
+bool up_executor::executor::impl::block()
+{
+    if (!_local()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_running.fetch_sub(1) <= _concurrency && !_stop.load()) {
+        // another worker takes the place of the blocked one
+        if (_parked > _unparks) {
+            ++_unparks;
+            _running.fetch_add(1);
+            _unpark.notify_one();
+        } else if (_count.load() < _capacity) {
+            /* If the start fails, the caller does not block (and it does not
+             * unblock), i.e. the count is kept for the calling worker. */
+            _running.fetch_add(1);
+            _start();
+        }
+    }
+    return true;
+}
+
+bool up_executor::executor::impl::starving() const noexcept
+{
+    auto self = _local();
+    if (self) {
+        return self->_deque.empty();
+    } else {
+        return _injected_size.load(std::memory_order_relaxed) == 0;
+    }
+}
+
+auto up_executor::executor::impl::_local() const noexcept -> worker*
+{
+    return current && current->_owner == this ? current : nullptr;
+}
+
+// the mutex must be locked
+void up_executor::executor::impl::_start()
+{
+    auto index = _count.load();
+    auto&& item = _workers[index];
+    item._owner = this;
+    item._random = 0x9e3779b97f4a7c15ull * (index + 1);
+    // the worker itself might steal before the thread has been created
+    _count.store(index + 1, std::memory_order_release);
+    try {
+        item._thread = std::thread([this, &item]() { _work(item); });
+    } catch (...) {
+        _count.store(index, std::memory_order_release);
+        throw;
+    }
+}
+
+void up_executor::executor::impl::_work(worker& self)
+{
+    current = &self;
+    auto stopped = [this]() { return _stop.load(); };
+    for (;;) {
+        if (_running.load(std::memory_order_relaxed) > _concurrency) {
+            _park();
+        }
+        auto item = _find(&self);
+        if (!item) {
+            if (_stop.load()) {
+                return;
+            }
+            item = _sleep(&self, stopped);
+        }
+        if (item) {
+            _run(item);
+        }
+    }
+}
+
+auto up_executor::executor::impl::_find(worker* self) noexcept -> job*
+{
+    if (self) {
+        if (auto item = self->_deque.pop()) {
+            return item;
+        }
+    }
+    if (_injected_size.load(std::memory_order_relaxed) != 0) {
+        std::lock_guard<std::mutex> lock(_injected_mutex);
+        if (!_injected.empty()) {
+            auto item = _injected.front();
+            _injected.pop_front();
+            _injected_size.store(_injected.size(), std::memory_order_relaxed);
+            return item;
+        }
+    }
+    auto count = _count.load(std::memory_order_acquire);
+    auto start = self ? static_cast<std::size_t>(self->random() % count) : 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        auto&& victim = _workers[(start + i) % count];
+        if (&victim != self) {
+            if (auto item = victim._deque.steal()) {
+                return item;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// surplus workers (after blocked workers have continued) wait until they are needed
+void up_executor::executor::impl::_park()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_running.load() <= _concurrency || _stop.load()) {
+        return;
+    }
+    _running.fetch_sub(1);
+    ++_parked;
+    _unpark.wait(lock, [this]() { return _unparks != 0 || _stop.load(); });
+    if (_unparks != 0) {
+        --_unparks;
+    } else {
+        _running.fetch_add(1);
+    }
+    --_parked;
+}
+
+
+void up_executor::executor::destroy(impl* ptr)
+{
+    std::default_delete<impl>()(ptr);
+}
+
+void up_executor::executor::_release(job* ptr)
+{
+    ptr->release();
+}
+
+up_executor::executor::executor(std::size_t concurrency)
+    : _impl(up::impl_make(concurrency))
+{ }
+
+auto up_executor::executor::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "executor", _impl->to_insight());
+}
+
+auto up_executor::executor::concurrency() const noexcept -> std::size_t
+{
+    return _impl->concurrency();
+}
+
+void up_executor::executor::_submit(job* item) const
+{
+    _impl->submit(item);
+}
+
+void up_executor::executor::_wait(impl* owner, job& item) noexcept
+{
+    owner->wait(item);
+}
+
+void up_executor::executor::_parallel_for(std::size_t first, std::size_t last,
+    void* context, void (*invoke)(void*, std::size_t, std::size_t)) const
+{
+    _impl->parallel_for(first, last, context, invoke);
+}
+
+
+void up_executor::executor::patience::_wait(up::stream::native_handle handle, operation op)
+{
+    auto&& owner = *_executor._impl;
+    bool blocked = owner.block();
+    try {
+        _patience(handle, op);
+    } catch (...) {
+        if (blocked) {
+            owner.unblock();
+        }
+        throw;
+    }
+    if (blocked) {
+        owner.unblock();
+    }
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+/**
+ * An executor runs CPU-bound work on a fixed number of worker threads (by
+ * default one per hardware thread). Each worker has its own deque (Chase-Lev
+ * work-stealing deque): it pushes and pops jobs at the bottom, and idle
+ * workers steal from the top of the others. Jobs submitted from other
+ * threads go through a shared queue.
+ *
+ *     up::executor executor;
+ *     auto task = executor.spawn([&]() { return compute(left); });
+ *     auto result = compute(right) + task.join();
+ *     executor.parallel_for(0, items.size(), [&](std::size_t i) { process(items[i]); });
+ *
+ * A thread that waits for a task (or a parallel_for) runs other jobs in the
+ * meantime, so nested spawns and joins do not block workers. An exception
+ * raised by a job is rethrown by join (or parallel_for) in the waiting
+ * thread, i.e. up::exception keeps its type and fields.
+ *
+ * parallel_for uses lazy binary splitting: a worker splits off half of its
+ * remaining range only if its own deque is empty, i.e. if the previously
+ * split off work has been stolen. The chunks adapt to the load without a
+ * user-supplied grain size.
+ *
+ * Jobs that wait for I/O should wrap their stream patience in an
+ * executor::patience: while the thread is blocked, a spare worker takes its
+ * place, so that the CPU-bound jobs are not starved.
+ *
+ * All tasks must be joined (or destroyed) before the executor is destroyed.
+ * The destructor of the executor waits until all queued jobs have finished.
+ */
+
+#include <atomic>
+#include <exception>
+
+#include "up_impl_ptr.hpp"
+#include "up_optional.hpp"
+#include "up_stream.hpp"
+#include "up_swap.hpp"
+
+
+namespace up_executor
+{
+
+    class executor final
+    {
+    public: // --- scope ---
+        using self = executor;
+        class impl;
+        class job;
+        template <typename Type>
+        class outcome;
+        template <typename Type, typename Function>
+        class invocation;
+        template <typename Type>
+        class task;
+        class patience;
+        static void destroy(impl* ptr);
+    private:
+        static void _release(job* ptr);
+        using job_ptr = up::impl_ptr<job, _release>;
+    private: // --- state ---
+        up::impl_ptr<impl, destroy> _impl;
+    public: // --- life ---
+        // zero means one worker per hardware thread
+        explicit executor(std::size_t concurrency = 0);
+        executor(const self& rhs) = delete;
+        executor(self&& rhs) noexcept = default;
+        ~executor() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = default;
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        // number of workers that run jobs at the same time
+        auto concurrency() const noexcept -> std::size_t;
+        template <typename Function>
+        auto spawn(Function&& function) const
+            -> task<std::decay_t<std::invoke_result_t<std::decay_t<Function>&>>>;
+        // invokes the function for each index in [first, last), and waits for all
+        template <typename Function>
+        void parallel_for(std::size_t first, std::size_t last, Function&& function) const
+        {
+            using function_type = std::remove_reference_t<Function>;
+            auto invoke = [](void* context, std::size_t begin, std::size_t end) {
+                auto&& target = *static_cast<function_type*>(context);
+                for (std::size_t index = begin; index != end; ++index) {
+                    target(index);
+                }
+            };
+            _parallel_for(first, last,
+                const_cast<void*>(static_cast<const void*>(std::addressof(function))), invoke);
+        }
+    private:
+        void _submit(job* item) const;
+        static void _wait(impl* owner, job& item) noexcept;
+        void _parallel_for(std::size_t first, std::size_t last,
+            void* context, void (*invoke)(void*, std::size_t, std::size_t)) const;
+    };
+
+
+    // type-erased unit of work (implementation detail)
+    class executor::job
+    {
+    public: // --- scope ---
+        using self = job;
+    private: // --- state ---
+        std::atomic<std::size_t> _refs;
+        std::atomic<bool> _done = {false};
+        std::atomic<bool> _awaited = {false};
+        std::exception_ptr _error;
+    public: // --- life ---
+        explicit job(std::size_t refs)
+            : _refs(refs)
+        { }
+        job(const self& rhs) = delete;
+        job(self&& rhs) noexcept = delete;
+        virtual ~job() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        void acquire() noexcept
+        {
+            _refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        void release() noexcept
+        {
+            if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+        void run() noexcept
+        {
+            try {
+                _execute();
+            } catch (...) {
+                _error = std::current_exception();
+            }
+            _done.store(true);
+        }
+        bool done() const noexcept
+        {
+            return _done.load(std::memory_order_acquire);
+        }
+        // announces a waiting thread, returns whether it has to be woken up
+        bool await() noexcept
+        {
+            _awaited.store(true);
+            return !_done.load();
+        }
+        bool awaited() const noexcept
+        {
+            return _awaited.load();
+        }
+        void rethrow() const
+        {
+            if (_error) {
+                std::rethrow_exception(_error);
+            }
+        }
+    private:
+        virtual void _execute() = 0;
+    };
+
+
+    template <typename Type>
+    class executor::outcome : public executor::job
+    {
+    protected: // --- state ---
+        up::optional<Type> _value;
+    protected: // --- life ---
+        using job::job;
+    public: // --- operations ---
+        auto take() -> Type
+        {
+            return std::move(*_value);
+        }
+    };
+
+    template <>
+    class executor::outcome<void> : public executor::job
+    {
+    protected: // --- life ---
+        using job::job;
+    public: // --- operations ---
+        void take() { }
+    };
+
+
+    template <typename Type, typename Function>
+    class executor::invocation final : public executor::outcome<Type>
+    {
+    private: // --- state ---
+        Function _function;
+    public: // --- life ---
+        template <typename Arg>
+        explicit invocation(Arg&& function)
+            : outcome<Type>(1), _function(std::forward<Arg>(function))
+        { }
+    private: // --- operations ---
+        void _execute() override
+        {
+            if constexpr (std::is_void<Type>::value) {
+                _function();
+            } else {
+                this->_value.emplace(_function());
+            }
+        }
+    };
+
+
+    template <typename Type>
+    class executor::task final
+    {
+    public: // --- scope ---
+        using self = task;
+        using value_type = Type;
+    private: // --- state ---
+        impl* _owner;
+        job_ptr _job;
+    public: // --- life ---
+        explicit task(impl* owner, job_ptr job)
+            : _owner(owner), _job(std::move(job))
+        { }
+        task(const self& rhs) = delete;
+        task(self&& rhs) noexcept = default;
+        // waits for the job (without rethrowing its exception)
+        ~task() noexcept
+        {
+            if (_job) {
+                executor::_wait(_owner, *_job);
+            }
+        }
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self&
+        {
+            self(std::move(rhs)).swap(*this);
+            return *this;
+        }
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_owner, rhs._owner);
+            up::swap_noexcept(_job, rhs._job);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        bool valid() const noexcept
+        {
+            return bool(_job);
+        }
+        bool ready() const noexcept
+        {
+            return _job->done();
+        }
+        // waits for the job, and returns its result or rethrows its exception
+        auto join() -> Type
+        {
+            executor::_wait(_owner, *_job);
+            job_ptr item = std::move(_job);
+            item->rethrow();
+            return static_cast<outcome<Type>&>(*item).take();
+        }
+    };
+
+
+    template <typename Function>
+    auto executor::spawn(Function&& function) const
+        -> task<std::decay_t<std::invoke_result_t<std::decay_t<Function>&>>>
+    {
+        using type = std::decay_t<std::invoke_result_t<std::decay_t<Function>&>>;
+        job_ptr item(new invocation<type, std::decay_t<Function>>(std::forward<Function>(function)));
+        _submit(item.get());
+        return task<type>(_impl.get(), std::move(item));
+    }
+
+
+    /**
+     * Decorator for a stream patience, that shall be used for blocking
+     * operations within jobs. While the worker waits, another worker runs
+     * the queued jobs.
+     */
+    class executor::patience final : public up::stream::patience
+    {
+    public: // --- scope ---
+        using self = patience;
+    private: // --- state ---
+        const executor& _executor;
+        up::stream::patience& _patience;
+    public: // --- life ---
+        explicit patience(const executor& executor, up::stream::patience& patience)
+            : _executor(executor), _patience(patience)
+        { }
+        // the decorated patience is referenced (and not copied)
+        explicit patience(const executor& executor, up::stream::patience&& patience) = delete;
+    private: // --- operations ---
+        void _wait(up::stream::native_handle handle, operation op) override;
+    };
+
+}
+
+namespace up
+{
+
+    using up_executor::executor;
+
+}
@@ -0,0 +1,414 @@
+#include "up_filter.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "up_exception.hpp"
+#include "up_ints.hpp"
+
+
+namespace
+{
+
+    /* The serialized format starts with a header of 64 bytes (with a magic
+     * string and the parameters), followed by the table. */
+    const std::size_t header_size = 64;
+    const char bloom_magic[8] = {'u', 'p', 'b', 'l', 'o', 'o', 'm', '1'};
+    const char cuckoo_magic[8] = {'u', 'p', 'c', 'u', 'c', 'k', 'o', '1'};
+
+    class header final
+    {
+    public: // --- state ---
+        char _magic[8];
+        uint64_t _count;
+        uint64_t _size;
+        uint64_t _victim;
+        char _reserved[header_size - 32];
+    };
+
+    static_assert(sizeof(header) == header_size);
+
+    void serialize_aux(up::buffer& buffer, const char (&magic)[8], std::size_t count, std::size_t size,
+        uint64_t victim, const void* data, std::size_t data_size)
+    {
+        header h = {};
+        std::memcpy(h._magic, magic, sizeof(magic));
+        h._count = count;
+        h._size = size;
+        h._victim = victim;
+        buffer.reserve(header_size + data_size);
+        std::memcpy(buffer.cold(), &h, header_size);
+        std::memcpy(buffer.cold() + header_size, data, data_size);
+        buffer.produce(header_size + data_size);
+    }
+
+    auto parse_aux(up::chunk::from data, const char (&magic)[8], std::size_t item_size) -> header
+    {
+        header h;
+        if (data.size() < header_size) {
+            throw up::make_exception("bad-filter-size").with(data.size());
+        }
+        std::memcpy(&h, data.data(), header_size);
+        if (std::memcmp(h._magic, magic, sizeof(magic)) != 0) {
+            throw up::make_exception("bad-filter-magic").with(up::string_view(h._magic, sizeof(h._magic)));
+        } else if (h._count == 0 || h._count > (data.size() - header_size) / item_size
+            || data.size() != header_size + h._count * item_size) {
+            throw up::make_exception("bad-filter-size").with(data.size(), h._count);
+        }
+        return h;
+    }
+
+
+    /* Each key sets one bit in each of the eight words of its block. The bit
+     * positions are computed from the lower half of the hash with eight odd
+     * multipliers (the same as in the split block bloom filter of Parquet).
+     * The vector extensions of GCC and clang are used, so that the operations
+     * map to the available vector instructions. */
+    using lanes32 = uint32_t __attribute__((vector_size(32)));
+    using lanes64 = uint64_t __attribute__((vector_size(64)));
+
+    const std::size_t block_size = 64;
+
+    // note: keep vectors within functions, to avoid ABI dependencies on the target
+    __attribute__((always_inline))
+    inline void bloom_mask(uint64_t hash, lanes64* mask)
+    {
+        const lanes32 salts = {
+            0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+            0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+        };
+        lanes32 bits = (static_cast<uint32_t>(hash) * salts) >> 26;
+        *mask = lanes64{1, 1, 1, 1, 1, 1, 1, 1} << __builtin_convertvector(bits, lanes64);
+    }
+
+    auto bloom_index(uint64_t hash, std::size_t count) -> std::size_t
+    {
+        return static_cast<std::size_t>(((hash >> 32) * count) >> 32);
+    }
+
+    bool bloom_contains(const char* blocks, std::size_t count, uint64_t hash)
+    {
+        lanes64 mask;
+        bloom_mask(hash, &mask);
+        lanes64 block;
+        std::memcpy(&block, blocks + bloom_index(hash, count) * block_size, block_size);
+        lanes64 missing = mask & ~block;
+        uint64_t result = 0;
+        for (std::size_t i = 0; i != 8; ++i) {
+            result |= missing[i];
+        }
+        return result == 0;
+    }
+
+
+    /* Each bucket consists of four 16-bit fingerprints (where zero marks
+     * free slots). The alternative bucket is computed from the bucket and
+     * the fingerprint, so that the original bucket is not required for
+     * relocations. The evicted fingerprint (if any) is stored in the victim
+     * together with its bucket. */
+    const std::size_t bucket_slots = 4;
+    const std::size_t max_kicks = 500;
+    const uint64_t victim_used = uint64_t(1) << 63;
+
+    auto cuckoo_fingerprint(uint64_t hash) -> uint16_t
+    {
+        auto result = static_cast<uint16_t>(hash);
+        return result ? result : 1;
+    }
+
+    auto cuckoo_index(uint64_t hash, std::size_t mask) -> std::size_t
+    {
+        return static_cast<std::size_t>(hash >> 32) & mask;
+    }
+
+    auto cuckoo_alternative(std::size_t index, uint16_t fingerprint, std::size_t mask) -> std::size_t
+    {
+        return (index ^ static_cast<std::size_t>(fingerprint * 0x5bd1e995u)) & mask;
+    }
+
+    auto cuckoo_victim(std::size_t index, uint16_t fingerprint) -> uint64_t
+    {
+        return victim_used | uint64_t(index) << 16 | fingerprint;
+    }
+
+    // SWAR search of the fingerprint in the bucket
+    bool cuckoo_match(uint64_t bucket, uint16_t fingerprint)
+    {
+        const uint64_t ones = 0x0001000100010001ull;
+        const uint64_t highs = 0x8000800080008000ull;
+        auto t = bucket ^ (ones * fingerprint);
+        return ((t - ones) & ~t & highs) != 0;
+    }
+
+    bool cuckoo_contains(const char* buckets, std::size_t mask, uint64_t victim, uint64_t hash)
+    {
+        auto fingerprint = cuckoo_fingerprint(hash);
+        auto i1 = cuckoo_index(hash, mask);
+        auto i2 = cuckoo_alternative(i1, fingerprint, mask);
+        uint64_t b1;
+        uint64_t b2;
+        std::memcpy(&b1, buckets + i1 * sizeof(uint64_t), sizeof(uint64_t));
+        std::memcpy(&b2, buckets + i2 * sizeof(uint64_t), sizeof(uint64_t));
+        return cuckoo_match(b1, fingerprint) || cuckoo_match(b2, fingerprint)
+            || victim == cuckoo_victim(i1, fingerprint) || victim == cuckoo_victim(i2, fingerprint);
+    }
+
+}
+
+
+class up_filter::bloom_table::block final
+{
+public: // --- state ---
+    alignas(block_size) uint64_t _words[8];
+};
+
+up_filter::bloom_table::bloom_table(std::size_t capacity, std::size_t bits_per_key)
+    : _block_count(0)
+{
+    static_assert(sizeof(block) == block_size);
+    using sizes = up::ints::domain<std::size_t>::is_valid;
+    if (!sizes::mul(capacity, bits_per_key)) {
+        throw up::make_exception("bad-bloom-filter-capacity").with(capacity, bits_per_key);
+    }
+    auto bits = capacity * bits_per_key;
+    _block_count = std::max(std::size_t(1), bits / (block_size * 8) + (bits % (block_size * 8) != 0));
+    if (_block_count > std::numeric_limits<uint32_t>::max()) {
+        throw up::make_exception("bad-bloom-filter-capacity").with(capacity, bits_per_key);
+    }
+    _blocks.reset(new block[_block_count]());
+}
+
+up_filter::bloom_table::bloom_table(const self& rhs)
+    : _blocks(new block[rhs._block_count]), _block_count(rhs._block_count), _size(rhs._size)
+{
+    std::memcpy(_blocks.get(), rhs._blocks.get(), _block_count * block_size);
+}
+
+up_filter::bloom_table::bloom_table(self&& rhs) noexcept
+    : _blocks(std::move(rhs._blocks))
+    , _block_count(std::exchange(rhs._block_count, 0))
+    , _size(std::exchange(rhs._size, 0))
+{ }
+
+up_filter::bloom_table::~bloom_table() noexcept = default;
+
+auto up_filter::bloom_table::operator=(const self& rhs) & -> self&
+{
+    self(rhs).swap(*this);
+    return *this;
+}
+
+auto up_filter::bloom_table::operator=(self&& rhs) & noexcept -> self&
+{
+    self(std::move(rhs)).swap(*this);
+    return *this;
+}
+
+void up_filter::bloom_table::insert(uint64_t hash) noexcept
+{
+    lanes64 mask;
+    bloom_mask(hash, &mask);
+    auto&& words = _blocks[bloom_index(hash, _block_count)]._words;
+    lanes64 block;
+    std::memcpy(&block, words, block_size);
+    block |= mask;
+    std::memcpy(words, &block, block_size);
+    ++_size;
+}
+
+bool up_filter::bloom_table::contains(uint64_t hash) const noexcept
+{
+    return bloom_contains(reinterpret_cast<const char*>(_blocks.get()), _block_count, hash);
+}
+
+void up_filter::bloom_table::clear() noexcept
+{
+    std::fill_n(_blocks.get(), _block_count, block());
+    _size = 0;
+}
+
+void up_filter::bloom_table::serialize(up::buffer& buffer) const
+{
+    serialize_aux(buffer, bloom_magic, _block_count, _size, 0, _blocks.get(), _block_count * block_size);
+}
+
+
+up_filter::bloom_table::view::view(up::chunk::from data)
+{
+    auto h = parse_aux(data, bloom_magic, block_size);
+    if (h._count > std::numeric_limits<uint32_t>::max()) {
+        throw up::make_exception("bad-filter-size").with(data.size(), h._count);
+    }
+    _blocks = data.data() + header_size;
+    _block_count = h._count;
+    _size = h._size;
+}
+
+bool up_filter::bloom_table::view::contains(uint64_t hash) const noexcept
+{
+    return bloom_contains(_blocks, _block_count, hash);
+}
+
+
+up_filter::cuckoo_table::cuckoo_table(std::size_t capacity)
+{
+    // at most 95% of the slots are used
+    auto count = std::size_t(1);
+    while (count * bucket_slots * 95 / 100 < capacity) {
+        if (count > (std::numeric_limits<uint32_t>::max() >> 1)) {
+            throw up::make_exception("bad-cuckoo-filter-capacity").with(capacity);
+        }
+        count <<= 1;
+    }
+    _buckets.reset(new uint64_t[count]());
+    _mask = count - 1;
+}
+
+up_filter::cuckoo_table::cuckoo_table(const self& rhs)
+    : _buckets(new uint64_t[rhs._mask + 1]), _mask(rhs._mask), _size(rhs._size),
+      _victim(rhs._victim), _random(rhs._random)
+{
+    std::copy_n(rhs._buckets.get(), _mask + 1, _buckets.get());
+}
+
+/* A moved-from table has no buckets left. The mask wraps around, so that
+ * the bucket count is zero. */
+up_filter::cuckoo_table::cuckoo_table(self&& rhs) noexcept
+    : _buckets(std::move(rhs._buckets))
+    , _mask(std::exchange(rhs._mask, ~std::size_t(0)))
+    , _size(std::exchange(rhs._size, 0))
+    , _victim(std::exchange(rhs._victim, 0))
+    , _random(rhs._random)
+{ }
+
+up_filter::cuckoo_table::~cuckoo_table() noexcept = default;
+
+auto up_filter::cuckoo_table::operator=(const self& rhs) & -> self&
+{
+    self(rhs).swap(*this);
+    return *this;
+}
+
+auto up_filter::cuckoo_table::operator=(self&& rhs) & noexcept -> self&
+{
+    self(std::move(rhs)).swap(*this);
+    return *this;
+}
+
+bool up_filter::cuckoo_table::insert(uint64_t hash) noexcept
+{
+    if (_victim) {
+        return false;
+    }
+    _insert(cuckoo_index(hash, _mask), cuckoo_fingerprint(hash));
+    ++_size;
+    return true;
+}
+
+bool up_filter::cuckoo_table::contains(uint64_t hash) const noexcept
+{
+    return cuckoo_contains(reinterpret_cast<const char*>(_buckets.get()), _mask, _victim, hash);
+}
+
+bool up_filter::cuckoo_table::erase(uint64_t hash) noexcept
+{
+    auto fingerprint = cuckoo_fingerprint(hash);
+    auto i1 = cuckoo_index(hash, _mask);
+    auto i2 = cuckoo_alternative(i1, fingerprint, _mask);
+    if (_remove(i1, fingerprint) || _remove(i2, fingerprint)) {
+        --_size;
+        if (_victim) {
+            // there is a free slot now
+            auto index = static_cast<std::size_t>((_victim & ~victim_used) >> 16);
+            auto evicted = static_cast<uint16_t>(_victim);
+            _victim = 0;
+            _insert(index, evicted);
+        }
+        return true;
+    } else if (_victim == cuckoo_victim(i1, fingerprint) || _victim == cuckoo_victim(i2, fingerprint)) {
+        _victim = 0;
+        --_size;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void up_filter::cuckoo_table::clear() noexcept
+{
+    std::fill_n(_buckets.get(), _mask + 1, 0);
+    _size = 0;
+    _victim = 0;
+}
+
+void up_filter::cuckoo_table::serialize(up::buffer& buffer) const
+{
+    serialize_aux(buffer, cuckoo_magic, _mask + 1, _size, _victim, _buckets.get(), (_mask + 1) * sizeof(uint64_t));
+}
+
+void up_filter::cuckoo_table::_insert(std::size_t index, uint16_t fingerprint) noexcept
+{
+    if (_place(index, fingerprint)) {
+        return;
+    }
+    index = cuckoo_alternative(index, fingerprint, _mask);
+    for (std::size_t kick = 0; kick != max_kicks; ++kick) {
+        if (_place(index, fingerprint)) {
+            return;
+        }
+        // replace a random fingerprint, and move it to its alternative bucket
+        _random ^= _random << 13;
+        _random ^= _random >> 7;
+        _random ^= _random << 17;
+        auto shift = 16 * (_random % bucket_slots);
+        auto&& bucket = _buckets[index];
+        auto evicted = static_cast<uint16_t>(bucket >> shift);
+        bucket = (bucket & ~(uint64_t(0xffff) << shift)) | uint64_t(fingerprint) << shift;
+        fingerprint = evicted;
+        index = cuckoo_alternative(index, fingerprint, _mask);
+    }
+    _victim = cuckoo_victim(index, fingerprint);
+}
+
+bool up_filter::cuckoo_table::_place(std::size_t index, uint16_t fingerprint) noexcept
+{
+    auto&& bucket = _buckets[index];
+    for (std::size_t shift = 0; shift != 16 * bucket_slots; shift += 16) {
+        if ((bucket >> shift & 0xffff) == 0) {
+            bucket |= uint64_t(fingerprint) << shift;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool up_filter::cuckoo_table::_remove(std::size_t index, uint16_t fingerprint) noexcept
+{
+    auto&& bucket = _buckets[index];
+    for (std::size_t shift = 0; shift != 16 * bucket_slots; shift += 16) {
+        if ((bucket >> shift & 0xffff) == fingerprint) {
+            bucket &= ~(uint64_t(0xffff) << shift);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+up_filter::cuckoo_table::view::view(up::chunk::from data)
+{
+    auto h = parse_aux(data, cuckoo_magic, sizeof(uint64_t));
+    if ((h._count & (h._count - 1)) != 0 || h._count > std::numeric_limits<uint32_t>::max()) {
+        throw up::make_exception("bad-filter-size").with(data.size(), h._count);
+    }
+    _buckets = data.data() + header_size;
+    _mask = h._count - 1;
+    _size = h._size;
+    _victim = h._victim;
+}
+
+bool up_filter::cuckoo_table::view::contains(uint64_t hash) const noexcept
+{
+    return cuckoo_contains(_buckets, _mask, _victim, hash);
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+/**
+ * Approximate membership filters: A filter answers, whether a key might
+ * have been inserted. There are no false negatives, but false positives
+ * with a small probability.
+ *
+ * bloom_filter is a blocked bloom filter: each key sets 8 bits in a single
+ * block of 64 bytes (one bit in each 64-bit word), so that a lookup touches
+ * a single cache line, and the bits are checked with vector operations. The
+ * false positive rate is about 1% with 10 bits per key.
+ *
+ * cuckoo_filter stores 16-bit fingerprints in buckets of four, where each
+ * key has two candidate buckets. The false positive rate is about 0.01%, and
+ * keys (that have been inserted) can also be removed. An insertion fails, if
+ * the filter is full (at a load factor of about 95%).
+ *
+ * The keys are hashed with a hash functor (std::hash by default), and the
+ * result is mixed, because for example std::hash of integers is the
+ * identity. The filters can be serialized into a flat format (in native
+ * byte order), which the view classes use in place, e.g. in a memory-mapped
+ * file. A view must use the same hash functor as the serialized filter.
+ *
+ * The const operations can be used concurrently.
+ */
+
+#include "up_buffer.hpp"
+#include "up_swap.hpp"
+
+
+namespace up_filter
+{
+
+    // finalizer of splitmix64
+    constexpr auto mix_hash(uint64_t value) noexcept -> uint64_t
+    {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+
+    // bloom filter on mixed hashes
+    class bloom_table final
+    {
+    public: // --- scope ---
+        using self = bloom_table;
+        class block;
+        class view;
+    private: // --- state ---
+        std::unique_ptr<block[]> _blocks;
+        std::size_t _block_count;
+        std::size_t _size = 0;
+    public: // --- life ---
+        explicit bloom_table(std::size_t capacity, std::size_t bits_per_key = 10);
+        bloom_table(const self& rhs);
+        bloom_table(self&& rhs) noexcept;
+        ~bloom_table() noexcept;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self&;
+        auto operator=(self&& rhs) & noexcept -> self&;
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_blocks, rhs._blocks);
+            up::swap_noexcept(_block_count, rhs._block_count);
+            up::swap_noexcept(_size, rhs._size);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        // number of insertions
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        auto block_count() const noexcept -> std::size_t
+        {
+            return _block_count;
+        }
+        void insert(uint64_t hash) noexcept;
+        bool contains(uint64_t hash) const noexcept;
+        void clear() noexcept;
+        // appends to the buffer
+        void serialize(up::buffer& buffer) const;
+    };
+
+
+    class bloom_table::view final
+    {
+    public: // --- scope ---
+        using self = view;
+    private: // --- state ---
+        const char* _blocks;
+        std::size_t _block_count;
+        std::size_t _size;
+    public: // --- life ---
+        // the data must outlive the view
+        explicit view(up::chunk::from data);
+    public: // --- operations ---
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        bool contains(uint64_t hash) const noexcept;
+    };
+
+
+    // cuckoo filter on mixed hashes
+    class cuckoo_table final
+    {
+    public: // --- scope ---
+        using self = cuckoo_table;
+        class view;
+    private: // --- state ---
+        std::unique_ptr<uint64_t[]> _buckets;
+        std::size_t _mask; // bucket count minus one
+        std::size_t _size = 0;
+        uint64_t _victim = 0; // evicted fingerprint (that did not fit)
+        uint64_t _random = 0x2545f4914f6cdd1dull;
+    public: // --- life ---
+        explicit cuckoo_table(std::size_t capacity);
+        cuckoo_table(const self& rhs);
+        cuckoo_table(self&& rhs) noexcept;
+        ~cuckoo_table() noexcept;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self&;
+        auto operator=(self&& rhs) & noexcept -> self&;
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_buckets, rhs._buckets);
+            up::swap_noexcept(_mask, rhs._mask);
+            up::swap_noexcept(_size, rhs._size);
+            up::swap_noexcept(_victim, rhs._victim);
+            up::swap_noexcept(_random, rhs._random);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        // number of stored fingerprints
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        auto bucket_count() const noexcept -> std::size_t
+        {
+            return _mask + 1;
+        }
+        // returns false (without changes) if the filter is full
+        bool insert(uint64_t hash) noexcept;
+        bool contains(uint64_t hash) const noexcept;
+        // the hash must have been inserted before
+        bool erase(uint64_t hash) noexcept;
+        void clear() noexcept;
+        // appends to the buffer
+        void serialize(up::buffer& buffer) const;
+    private:
+        void _insert(std::size_t index, uint16_t fingerprint) noexcept;
+        bool _place(std::size_t index, uint16_t fingerprint) noexcept;
+        bool _remove(std::size_t index, uint16_t fingerprint) noexcept;
+    };
+
+
+    class cuckoo_table::view final
+    {
+    public: // --- scope ---
+        using self = view;
+    private: // --- state ---
+        const char* _buckets;
+        std::size_t _mask;
+        std::size_t _size;
+        uint64_t _victim;
+    public: // --- life ---
+        // the data must outlive the view
+        explicit view(up::chunk::from data);
+    public: // --- operations ---
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        bool contains(uint64_t hash) const noexcept;
+    };
+
+
+    template <typename Key, typename Hash, typename Table>
+    class basic_filter
+    {
+    public: // --- scope ---
+        using self = basic_filter;
+        using key_type = Key;
+        using hasher = Hash;
+        class view final
+        {
+        private: // --- state ---
+            typename Table::view _view;
+            Hash _hash;
+        public: // --- life ---
+            // the data must outlive the view
+            explicit view(up::chunk::from data, const Hash& hash = Hash())
+                : _view(data), _hash(hash)
+            { }
+        public: // --- operations ---
+            auto size() const noexcept -> std::size_t
+            {
+                return _view.size();
+            }
+            bool contains(const Key& key) const
+            {
+                return _view.contains(mix_hash(_hash(key)));
+            }
+        };
+    protected: // --- state ---
+        Table _table;
+        Hash _hash;
+    protected: // --- life ---
+        template <typename... Args>
+        explicit basic_filter(const Hash& hash, Args&&... args)
+            : _table(std::forward<Args>(args)...), _hash(hash)
+        { }
+    public: // --- operations ---
+        auto size() const noexcept -> std::size_t
+        {
+            return _table.size();
+        }
+        bool contains(const Key& key) const
+        {
+            return _table.contains(mix_hash(_hash(key)));
+        }
+        void clear() noexcept
+        {
+            _table.clear();
+        }
+        // appends to the buffer
+        void serialize(up::buffer& buffer) const
+        {
+            _table.serialize(buffer);
+        }
+        auto table() const noexcept -> const Table&
+        {
+            return _table;
+        }
+    };
+
+
+    template <typename Key, typename Hash = std::hash<Key>>
+    class bloom_filter final : public basic_filter<Key, Hash, bloom_table>
+    {
+    public: // --- scope ---
+        using self = bloom_filter;
+        using base = basic_filter<Key, Hash, bloom_table>;
+    public: // --- life ---
+        explicit bloom_filter(std::size_t capacity, std::size_t bits_per_key = 10, const Hash& hash = Hash())
+            : base(hash, capacity, bits_per_key)
+        { }
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(base::_table, rhs._table);
+            up::swap_noexcept(base::_hash, rhs._hash);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        void insert(const Key& key)
+        {
+            base::_table.insert(mix_hash(base::_hash(key)));
+        }
+    };
+
+
+    template <typename Key, typename Hash = std::hash<Key>>
+    class cuckoo_filter final : public basic_filter<Key, Hash, cuckoo_table>
+    {
+    public: // --- scope ---
+        using self = cuckoo_filter;
+        using base = basic_filter<Key, Hash, cuckoo_table>;
+    public: // --- life ---
+        explicit cuckoo_filter(std::size_t capacity, const Hash& hash = Hash())
+            : base(hash, capacity)
+        { }
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(base::_table, rhs._table);
+            up::swap_noexcept(base::_hash, rhs._hash);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        // returns false (without changes) if the filter is full
+        bool insert(const Key& key)
+        {
+            return base::_table.insert(mix_hash(base::_hash(key)));
+        }
+        // the key must have been inserted before (otherwise another key might be removed)
+        bool erase(const Key& key)
+        {
+            return base::_table.erase(mix_hash(base::_hash(key)));
+        }
+    };
+
+}
+
+namespace up
+{
+
+    using up_filter::bloom_filter;
+    using up_filter::cuckoo_filter;
+
+}
@@ -2,10 +2,13 @@
 
 #include <algorithm>
 #include <cstring>
+#include <mutex>
 
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <sys/syscall.h>
@@ -20,7 +23,9 @@
 #include "up_defer.hpp"
 #include "up_exception.hpp"
 #include "up_ints.hpp"
+#include "up_linked_map.hpp"
 #include "up_nts.hpp"
+#include "up_optional.hpp"
 #include "up_terminate.hpp"
 
 
@@ -441,6 +446,39 @@ namespace
     }
 
 
+    /**
+     * Normalize a relative pathname for the use as key in the origin
+     * cache, i.e. remove empty and "." segments. Absolute pathnames and
+     * pathnames with ".." segments are not supported, because their
+     * prefixes can not be resolved independently.
+     */
+    auto pathname_cache_key(const up::string_view& pathname) -> up::optional<up::unique_string>
+    {
+        if (!pathname.empty() && pathname[0] == '/') {
+            return up::nullopt;
+        }
+        up::unique_string result;
+        result.reserve(pathname.size());
+        up::string_view::size_type p = 0, q;
+        do {
+            q = std::min(pathname.find('/', p), pathname.size());
+            auto s = pathname.substr(p, q - p);
+            if (s.empty() || s == up::string_view(".", 1)) {
+                // nothing
+            } else if (s == up::string_view("..", 2)) {
+                return up::nullopt;
+            } else {
+                if (!result.empty()) {
+                    result.push_back('/');
+                }
+                result.append(s);
+            }
+            p = q + 1;
+        } while (q != pathname.size());
+        return result;
+    }
+
+
     constexpr mode_t ignored_mode = 0;
 
 
@@ -532,6 +570,13 @@ public: // --- state ---
 };
 
 
+class up_fs::fs::file::mapping::init final
+{
+public: // --- state ---
+    std::shared_ptr<const impl> _impl;
+};
+
+
 auto up_fs::to_string(fs::kind value) -> up::shared_string
 {
     switch (value) {
@@ -580,6 +625,17 @@ auto up_fs::fs::stats::size() const -> off_t
     return _impl->_stat.st_size;
 }
 
+auto up_fs::fs::stats::inode() const -> ino_t
+{
+    return _impl->_stat.st_ino;
+}
+
+auto up_fs::fs::stats::mtime() const -> up::system_time_point
+{
+    auto&& value = _impl->_stat.st_mtim;
+    return up::system_time_point(std::chrono::seconds(value.tv_sec) + std::chrono::nanoseconds(value.tv_nsec));
+}
+
 bool up_fs::fs::stats::is_kind(kind value) const
 {
     switch (value) {
@@ -767,6 +823,48 @@ public: // --- operations ---
         handle(pipefd[0]).swap(read);
         handle(pipefd[1]).swap(write);
     }
+    auto receive(int socket) const -> int
+    {
+        /* The payload is a single byte, because some implementations do not
+         * transfer ancillary data without regular data. */
+        char byte = 0;
+        iovec iov{&byte, sizeof(byte)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr message{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        int flags = (_additional_open_flags & O_CLOEXEC) ? MSG_CMSG_CLOEXEC : 0;
+        ssize_t rv;
+        do {
+            rv = ::recvmsg(socket, &message, flags);
+        } while (rv == -1 && errno == EINTR);
+        check(rv, "fs-receive-error", socket);
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (rv == 0 || header == nullptr
+            || header->cmsg_level != SOL_SOCKET
+            || header->cmsg_type != SCM_RIGHTS
+            || header->cmsg_len != CMSG_LEN(sizeof(int))
+            || (message.msg_flags & MSG_CTRUNC)) {
+            /* The kernel might have installed file descriptors in spite of
+             * the error. They are closed to avoid leaking them. */
+            for (; header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+                if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                    std::size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    for (std::size_t i = 0; i != count; ++i) {
+                        int fd;
+                        std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(fd));
+                        handle closer(fd); // closes on destruction
+                    }
+                }
+            }
+            throw up::make_exception("fs-receive-error").with(socket, rv, message.msg_flags);
+        }
+        int result;
+        std::memcpy(&result, CMSG_DATA(header), sizeof(result));
+        return result;
+    }
 };
 
 
@@ -971,6 +1069,198 @@ auto up_fs::fs::origin::resolved(const up::string_view& pathname, bool follow) c
 }
 
 
+class up_fs::fs::origin_cache::impl final
+{
+public: // --- scope ---
+    using self = impl;
+private:
+    class entry final
+    {
+    public: // --- state ---
+        up::shared_string _pathname;
+        std::shared_ptr<const origin::impl> _origin;
+    public: // --- life ---
+        explicit entry(up::shared_string pathname, std::shared_ptr<const origin::impl> origin)
+            : _pathname(std::move(pathname)), _origin(std::move(origin))
+        { }
+    };
+    /* The keys refer to the pathnames stored in the (immutable) entries, so
+     * that lookups for prefixes require no memory allocations. The order of
+     * the linked_map is used for the LRU eviction. */
+    using entries = up::linked_map<up::string_view, std::shared_ptr<const entry>>;
+private: // --- state ---
+    std::shared_ptr<const origin::impl> _origin;
+    std::size_t _capacity;
+    std::mutex _mutex;
+    entries _entries;
+    std::size_t _hits = 0;
+    std::size_t _misses = 0;
+public: // --- life ---
+    explicit impl(std::shared_ptr<const origin::impl> origin, std::size_t capacity)
+        : _origin(std::move(origin)), _capacity(capacity)
+    { }
+public: // --- operations ---
+    auto to_insight() -> up::insight
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return up::insight(typeid(*this), "fs-origin-cache-impl",
+            up::invoke_to_insight_with_fallback(*_origin),
+            up::invoke_to_insight_with_fallback(_capacity),
+            up::invoke_to_insight_with_fallback(_entries.size()),
+            up::invoke_to_insight_with_fallback(_hits),
+            up::invoke_to_insight_with_fallback(_misses));
+    }
+    auto get_origin() const -> const std::shared_ptr<const origin::impl>&
+    {
+        return _origin;
+    }
+    auto capacity() const -> std::size_t
+    {
+        return _capacity;
+    }
+    auto size() -> std::size_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+    auto hits() -> std::size_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _hits;
+    }
+    auto misses() -> std::size_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _misses;
+    }
+    auto resolved(const up::string_view& pathname) -> std::shared_ptr<const origin::impl>
+    {
+        auto key = pathname_cache_key(pathname);
+        if (!key) {
+            return _origin->resolved(pathname, true);
+        } else if (key->empty()) {
+            return _origin;
+        }
+        up::string_view view = *key;
+        std::shared_ptr<const origin::impl> base = _origin;
+        up::string_view::size_type offset = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto n = view.size(); n != up::string_view::npos; n = view.rfind('/', n - 1)) {
+                auto p = _entries.find(view.substr(0, n));
+                if (p != _entries.end()) {
+                    _entries.splice(_entries.end(), _entries, p);
+                    base = p->second->_origin;
+                    offset = n;
+                    break;
+                }
+            }
+            if (offset == view.size()) {
+                ++_hits;
+                return base;
+            } else {
+                ++_misses;
+            }
+        }
+        /* The remaining segments are resolved with a single system call
+         * (without holding the lock). */
+        auto remaining = offset == 0 ? view : view.substr(offset + 1);
+        auto result = base->resolved(remaining, true);
+        auto e = std::make_shared<const entry>(std::move(*key), result);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_entries.emplace(e->_pathname, e).second) {
+            while (_entries.size() > _capacity) {
+                _entries.pop_front();
+            }
+        } // else: concurrently resolved by another thread
+        return result;
+    }
+    void invalidate(const up::string_view& pathname)
+    {
+        auto key = pathname_cache_key(pathname);
+        if (!key) {
+            // nothing (never cached)
+        } else if (key->empty()) {
+            clear();
+        } else {
+            up::string_view view = *key;
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto i = _entries.begin(), j = _entries.end(); i != j;) {
+                auto&& k = i->first;
+                if (k.substr(0, view.size()) == view
+                    && (k.size() == view.size() || k[view.size()] == '/')) {
+                    i = _entries.erase(i);
+                } else {
+                    ++i;
+                }
+            }
+        }
+    }
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+    }
+};
+
+
+up_fs::fs::origin_cache::origin_cache(origin origin, std::size_t capacity)
+    : _impl(std::make_shared<impl>(origin::accessor::get_impl(std::move(origin)), capacity))
+{ }
+
+auto up_fs::fs::origin_cache::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "fs-origin-cache", _impl->to_insight());
+}
+
+auto up_fs::fs::origin_cache::capacity() const -> std::size_t
+{
+    return _impl->capacity();
+}
+
+auto up_fs::fs::origin_cache::size() const -> std::size_t
+{
+    return _impl->size();
+}
+
+auto up_fs::fs::origin_cache::hits() const -> std::size_t
+{
+    return _impl->hits();
+}
+
+auto up_fs::fs::origin_cache::misses() const -> std::size_t
+{
+    return _impl->misses();
+}
+
+auto up_fs::fs::origin_cache::resolved(const up::string_view& pathname) const -> origin
+{
+    return origin(origin::init{_impl->resolved(pathname)});
+}
+
+auto up_fs::fs::origin_cache::located(const up::string_view& pathname, bool follow) const -> location
+{
+    auto p = pathname.rfind('/');
+    if (p == up::string_view::npos || p == 0 || p + 1 == pathname.size()) {
+        // no parent directory, absolute parent directory, or trailing slash
+        return location(origin(origin::init{_impl->get_origin()}), pathname, follow);
+    } else {
+        auto&& parent = _impl->resolved(pathname.substr(0, p));
+        return location(origin(origin::init{parent}), pathname.substr(p + 1), follow);
+    }
+}
+
+void up_fs::fs::origin_cache::invalidate(const up::string_view& pathname) const
+{
+    _impl->invalidate(pathname);
+}
+
+void up_fs::fs::origin_cache::clear() const
+{
+    _impl->clear();
+}
+
+
 class up_fs::fs::location::impl final
 {
 public: // --- scope ---
@@ -1032,7 +1322,7 @@ public: // --- operations ---
     auto stat() const -> std::shared_ptr<const stats::impl>
     {
         auto result = std::make_shared<stats::impl>();
-        auto flags = flags_follow(AT_SYMLINK_FOLLOW);
+        auto flags = flags_nofollow(AT_SYMLINK_NOFOLLOW);
         /* Version 4.05 of the documentation does not mention EINTR. However,
          * the operation is potentially blocking, and so the specification
          * might change in the future. */
@@ -1043,6 +1333,20 @@ public: // --- operations ---
         check(rv, "fs-stat-error", *this, flags);
         return result;
     }
+    auto exists() const -> bool
+    {
+        struct stat st;
+        int flags = flags_nofollow(AT_SYMLINK_NOFOLLOW);
+        int rv;
+        do {
+            rv = ::fstatat(_origin->dir_fd(), up::nts(_pathname), &st, flags);
+        } while (rv == -1 && errno == EINTR);
+        if (rv == -1 && errno == ENOENT) {
+            return false;
+        }
+        check(rv, "fs-stat-error", *this, flags);
+        return true;
+    }
     void chmod(mode_t mode) const
     {
         int flags = flags_nofollow(AT_SYMLINK_NOFOLLOW);
@@ -1265,6 +1569,11 @@ auto up_fs::fs::location::stat() const -> stats
     return stats(stats::init{_impl->stat()});
 }
 
+bool up_fs::fs::location::exists() const
+{
+    return _impl->exists();
+}
+
 void up_fs::fs::location::chmod(mode_t mode) const
 {
     _impl->chmod(mode);
@@ -1559,7 +1868,16 @@ up_fs::fs::file::file(memory_t, context context, const up::string_view& name)
     : _impl(nullptr)
 {
     auto&& c = context::accessor::get_impl(std::move(context));
-    _impl = std::make_shared<const impl>(handle(c->memfd_create(up::nts(name), 0)), std::move(c));
+    _impl = std::make_shared<const impl>(
+        handle(c->memfd_create(up::nts(name), MFD_ALLOW_SEALING)), std::move(c));
+}
+
+up_fs::fs::file::file(received_t, context context, const int socket)
+    : _impl(nullptr)
+{
+    auto&& c = context::accessor::get_impl(std::move(context));
+    auto h = handle(c->receive(socket));
+    _impl = std::make_shared<const impl>(std::move(h), std::move(c));
 }
 
 up_fs::fs::file::operator object() const
@@ -1708,6 +2026,54 @@ auto up_fs::fs::file::make_channel() const -> channel
     return channel(channel::init{up::impl_make(_impl)});
 }
 
+void up_fs::fs::file::add_seals(seals seals) const
+{
+    int value = 0;
+    value |= seals.all(seal::seal) ? F_SEAL_SEAL : 0;
+    value |= seals.all(seal::shrink) ? F_SEAL_SHRINK : 0;
+    value |= seals.all(seal::grow) ? F_SEAL_GROW : 0;
+    value |= seals.all(seal::write) ? F_SEAL_WRITE : 0;
+    check(::fcntl(_impl->fd(), F_ADD_SEALS, value), "fs-seal-error", _impl->fd(), value);
+}
+
+bool up_fs::fs::file::has_seals(seals seals) const
+{
+    int value = check(::fcntl(_impl->fd(), F_GET_SEALS), "fs-seal-error", _impl->fd());
+    return (seals.none(seal::seal) || (value & F_SEAL_SEAL))
+        && (seals.none(seal::shrink) || (value & F_SEAL_SHRINK))
+        && (seals.none(seal::grow) || (value & F_SEAL_GROW))
+        && (seals.none(seal::write) || (value & F_SEAL_WRITE));
+}
+
+auto up_fs::fs::file::map(std::size_t length, off_t offset, bool writable) const -> mapping
+{
+    return mapping(mapping::init{std::make_shared<const mapping::impl>(*_impl, length, offset, writable)});
+}
+
+void up_fs::fs::file::send(int socket) const
+{
+    /* See fs::context::impl::receive regarding the payload. */
+    char byte = 0;
+    iovec iov{&byte, sizeof(byte)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    int fd = _impl->fd();
+    std::memcpy(CMSG_DATA(header), &fd, sizeof(fd));
+    ssize_t rv;
+    do {
+        rv = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+    } while (rv == -1 && errno == EINTR);
+    check(rv, "fs-send-error", socket, fd);
+}
+
 
 class up_fs::fs::file::lock::impl final
 {
@@ -1822,6 +2188,73 @@ auto up_fs::fs::file::channel::drain(std::size_t size, off_t offset) -> std::siz
 }
 
 
+class up_fs::fs::file::mapping::impl final
+{
+public: // --- scope ---
+    using self = impl;
+private: // --- state ---
+    char* _data;
+    std::size_t _size;
+public: // --- life ---
+    explicit impl(const file::impl& file, std::size_t size, off_t offset, bool writable)
+        : _data(nullptr), _size(size)
+    {
+        int protection = PROT_READ | (writable ? PROT_WRITE : 0);
+        void* rv = ::mmap(nullptr, _size, protection, MAP_SHARED, file.fd(), offset);
+        if (rv == MAP_FAILED) {
+            fail("fs-mmap-error", file.fd(), size, offset, protection);
+        }
+        _data = static_cast<char*>(rv);
+    }
+    impl(const self& rhs) = delete;
+    impl(self&& rhs) noexcept = delete;
+    ~impl() noexcept
+    {
+        int rv = ::munmap(_data, _size);
+        if (rv != 0) {
+            up::terminate("bad-munmap", _size, errno);
+        }
+    }
+public: // --- operations ---
+    auto operator=(const self& rhs) & -> self& = delete;
+    auto operator=(self&& rhs) & noexcept -> self& = delete;
+    auto to_insight() const -> up::insight
+    {
+        return up::insight(typeid(*this), "fs-file-mapping-impl",
+            up::invoke_to_insight_with_fallback(reinterpret_cast<uintptr_t>(_data)),
+            up::invoke_to_insight_with_fallback(_size));
+    }
+    auto data() const -> char*
+    {
+        return _data;
+    }
+    auto size() const -> std::size_t
+    {
+        return _size;
+    }
+};
+
+
+up_fs::fs::file::mapping::mapping(init&& arg)
+    : _impl(std::move(arg._impl))
+{ }
+
+auto up_fs::fs::file::mapping::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "fs-file-mapping", _impl->to_insight());
+}
+
+auto up_fs::fs::file::mapping::data() const -> char*
+{
+    return _impl->data();
+}
+
+auto up_fs::fs::file::mapping::size() const -> std::size_t
+{
+    return _impl->size();
+}
+
+
 class up_fs::fs::directory::impl final : public object::impl
 {
 public: // --- scope ---
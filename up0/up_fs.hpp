@@ -1,5 +1,6 @@
 #pragma once
 
+#include "up_chrono.hpp"
 #include "up_chunk.hpp"
 #include "up_impl_ptr.hpp"
 #include "up_utility.hpp"
@@ -17,6 +18,7 @@ namespace up_fs
         class directory_entry;
         class context;
         class origin;
+        class origin_cache;
         class location;
         class object;
         class locked_file;
@@ -67,6 +69,8 @@ namespace up_fs
             lhs.swap(rhs);
         }
         auto size() const -> off_t;
+        auto inode() const -> ino_t;
+        auto mtime() const -> up::system_time_point;
         bool is_kind(kind value) const;
         bool is_block_device() const;
         bool is_character_device() const;
@@ -200,6 +204,54 @@ namespace up_fs
     };
 
 
+    /**
+     * Cache for directory handles, that can be used to avoid repeated path
+     * lookups for deep and frequently used directory trees. Directories are
+     * resolved relative to the given origin, starting from the longest
+     * cached prefix, so that a cache hit requires no system call at all, and
+     * a cache miss requires a single one. The least recently used handles
+     * are evicted, when the capacity is exceeded.
+     *
+     * Note that all path components are followed, including the last one.
+     * Pathnames containing ".." or absolute pathnames bypass the cache.
+     * Cached handles keep referring to the same directory, even if it has
+     * been renamed or replaced in the meantime (in contrast to a fresh
+     * lookup). Use the function invalidate in such cases.
+     */
+    class fs::origin_cache final
+    {
+    public: // --- scope ---
+        using self = origin_cache;
+        class impl;
+    private: // --- state ---
+        std::shared_ptr<impl> _impl;
+    public: // --- life ---
+        explicit origin_cache(origin origin, std::size_t capacity);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        auto capacity() const -> std::size_t;
+        // number of cached directory handles
+        auto size() const -> std::size_t;
+        // number of resolutions with and without all segments cached
+        auto hits() const -> std::size_t;
+        auto misses() const -> std::size_t;
+        auto resolved(const up::string_view& pathname) const -> origin;
+        // location with the parent directory resolved through the cache
+        auto located(const up::string_view& pathname, bool follow = false) const -> location;
+        // remove all cached handles for the given directory and its descendants
+        void invalidate(const up::string_view& pathname) const;
+        void clear() const;
+    };
+
+
     class fs::location final
     {
     public: // --- scope ---
@@ -229,6 +281,7 @@ namespace up_fs
         auto joined(const up::string_view& pathname) const -> self;
         auto resolved() const -> origin;
         auto stat() const -> stats;
+        bool exists() const;
         void chmod(mode_t mode) const;
         void chown(uid_t owner, gid_t group) const;
         void mkdir(mode_t mode) const;
@@ -306,13 +359,21 @@ namespace up_fs
         using options = up::enum_set<option>;
         enum class memory_t { };
         static constexpr const memory_t memory = memory_t();
+        enum class received_t { };
+        static constexpr const received_t received = received_t();
+        enum class seal : uint8_t { seal, shrink, grow, write, };
+        using seals = up::enum_set<seal>;
         class lock;
         class channel;
+        class mapping;
     private: // --- state ---
         std::shared_ptr<const impl> _impl;
     public: // --- life ---
         explicit file(const location& location, options options);
+        // memory files are created with support for seals
         explicit file(memory_t, context context, const up::string_view& name);
+        // receive file descriptor passed over the given unix domain socket
+        explicit file(received_t, context context, int socket);
         file(const self& rhs) = delete;
         file(self&& rhs) noexcept = default;
         ~file() noexcept = default;
@@ -350,6 +411,11 @@ namespace up_fs
         void linkto(const location& target) const;
         auto acquire_lock(bool exclusive, bool blocking = true) const -> lock;
         auto make_channel() const -> channel;
+        void add_seals(seals seals) const;
+        bool has_seals(seals seals) const;
+        auto map(std::size_t length, off_t offset, bool writable) const -> mapping;
+        // pass file descriptor over the given unix domain socket
+        void send(int socket) const;
     };
 
 
@@ -410,6 +476,37 @@ namespace up_fs
     };
 
 
+    /**
+     * Shared memory mapping of a range of a file. The mapping stays valid as
+     * long as there are references to it, even if the file has been closed
+     * in the meantime. Modifications are visible to all processes, that have
+     * mapped the same file.
+     */
+    class fs::file::mapping final
+    {
+    public: // --- scope ---
+        using self = mapping;
+        class impl;
+        class init;
+    private: // --- state ---
+        std::shared_ptr<const impl> _impl;
+    public: // --- life ---
+        explicit mapping(init&& arg);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        auto data() const -> char*;
+        auto size() const -> std::size_t;
+    };
+
+
     class fs::directory final
     {
     public: // --- scope ---
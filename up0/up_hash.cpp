@@ -1,5 +1,13 @@
 #include "up_hash.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE4_2__) || defined(__PCLMUL__)
+#include <immintrin.h>
+#endif
+
 #include "up_char_cast.hpp"
 
 
@@ -40,6 +48,308 @@ namespace
         return result;
     }
 
+
+    /* Polynomials over GF(2) are represented in the reflected bit order of
+     * the CRCs, i.e. the most significant bit represents x^0. Multiplication
+     * modulo the polynomial is used for combining and for the precomputed
+     * shift tables. See crc32.c of zlib for more information. */
+
+    constexpr auto crc_multiply(uint32_t poly, uint32_t a, uint32_t b) -> uint32_t
+    {
+        uint32_t result = 0;
+        for (uint32_t m = UINT32_C(1) << 31; m; m >>= 1) {
+            if (a & m) {
+                result ^= b;
+            }
+            b = b & 1 ? (b >> 1) ^ poly : b >> 1;
+        }
+        return result;
+    }
+
+    // x^(8 * n) modulo the polynomial
+    constexpr auto crc_x8n(uint32_t poly, uint64_t n) -> uint32_t
+    {
+        uint32_t result = UINT32_C(1) << 31;
+        uint32_t square = UINT32_C(1) << (31 - 8);
+        for (; n; n >>= 1) {
+            if (n & 1) {
+                result = crc_multiply(poly, square, result);
+            }
+            square = crc_multiply(poly, square, square);
+        }
+        return result;
+    }
+
+    constexpr auto crc_combine(uint32_t poly, uint32_t crc1, uint32_t crc2, uint64_t size2) -> uint32_t
+    {
+        return crc_multiply(poly, crc_x8n(poly, size2), crc1) ^ crc2;
+    }
+
+
+    // tables for slicing-by-8
+    using crc_table = std::array<std::array<uint32_t, 256>, 8>;
+
+    constexpr auto make_crc_table(uint32_t poly) -> crc_table
+    {
+        crc_table result = {};
+        for (uint32_t i = 0; i != 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k != 8; ++k) {
+                c = c & 1 ? (c >> 1) ^ poly : c >> 1;
+            }
+            result[0][i] = c;
+        }
+        for (uint32_t i = 0; i != 256; ++i) {
+            for (std::size_t k = 1; k != result.size(); ++k) {
+                uint32_t c = result[k - 1][i];
+                result[k][i] = (c >> 8) ^ result[0][c & 0xff];
+            }
+        }
+        return result;
+    }
+
+    const uint32_t crc32_poly = UINT32_C(0xedb88320);
+    const uint32_t crc32c_poly = UINT32_C(0x82f63b78);
+    constexpr const crc_table crc32_table = make_crc_table(crc32_poly);
+    constexpr const crc_table crc32c_table = make_crc_table(crc32c_poly);
+
+    // updates the CRC register (i.e. without the final inversion)
+    auto crc_update(const crc_table& table, uint32_t crc, const unsigned char* data, std::size_t size) noexcept -> uint32_t
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            word ^= crc;
+            crc = table[7][word & 0xff]
+                ^ table[6][(word >> 8) & 0xff]
+                ^ table[5][(word >> 16) & 0xff]
+                ^ table[4][(word >> 24) & 0xff]
+                ^ table[3][(word >> 32) & 0xff]
+                ^ table[2][(word >> 40) & 0xff]
+                ^ table[1][(word >> 48) & 0xff]
+                ^ table[0][word >> 56];
+        }
+#endif
+        for (; size; ++data, --size) {
+            crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xff];
+        }
+        return crc;
+    }
+
+
+#ifdef __SSE4_2__
+
+    /* The crc32 instruction has a latency of three cycles, but a throughput
+     * of one per cycle. Therefore, large inputs are split into three
+     * streams, that are processed in parallel, and combined afterwards by
+     * shifting the register over the length of a stream. The shift is a
+     * multiplication with a constant, and uses precomputed tables. */
+    using crc_shift_table = std::array<std::array<uint32_t, 256>, 4>;
+
+    constexpr auto make_crc_shift_table(uint32_t poly, std::size_t size) -> crc_shift_table
+    {
+        crc_shift_table result = {};
+        uint32_t op = crc_x8n(poly, size);
+        for (uint32_t i = 0; i != 256; ++i) {
+            for (std::size_t k = 0; k != result.size(); ++k) {
+                result[k][i] = crc_multiply(poly, op, i << (8 * k));
+            }
+        }
+        return result;
+    }
+
+    auto crc_shift(const crc_shift_table& table, uint32_t crc) noexcept -> uint32_t
+    {
+        return table[0][crc & 0xff]
+            ^ table[1][(crc >> 8) & 0xff]
+            ^ table[2][(crc >> 16) & 0xff]
+            ^ table[3][crc >> 24];
+    }
+
+    const std::size_t crc32c_long = 8192;
+    const std::size_t crc32c_short = 256;
+    constexpr const crc_shift_table crc32c_long_table = make_crc_shift_table(crc32c_poly, crc32c_long);
+    constexpr const crc_shift_table crc32c_short_table = make_crc_shift_table(crc32c_poly, crc32c_short);
+
+    auto crc32c_load(const unsigned char* data) noexcept -> uint64_t
+    {
+        uint64_t result;
+        std::memcpy(&result, data, sizeof(result));
+        return result;
+    }
+
+    auto crc32c_streams(const crc_shift_table& table, std::size_t length,
+        uint64_t crc, const unsigned char*& data, std::size_t& size) noexcept -> uint64_t
+    {
+        for (; size >= 3 * length; data += 3 * length, size -= 3 * length) {
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+            for (std::size_t i = 0; i != length; i += 8) {
+                crc = _mm_crc32_u64(crc, crc32c_load(data + i));
+                crc1 = _mm_crc32_u64(crc1, crc32c_load(data + length + i));
+                crc2 = _mm_crc32_u64(crc2, crc32c_load(data + 2 * length + i));
+            }
+            crc = crc_shift(table, static_cast<uint32_t>(crc)) ^ crc1;
+            crc = crc_shift(table, static_cast<uint32_t>(crc)) ^ crc2;
+        }
+        return crc;
+    }
+
+    auto crc32c_update(uint32_t crc, const unsigned char* data, std::size_t size) noexcept -> uint32_t
+    {
+        uint64_t result = crc;
+        for (; size && (reinterpret_cast<uintptr_t>(data) & 7); ++data, --size) {
+            result = _mm_crc32_u8(static_cast<uint32_t>(result), *data);
+        }
+        result = crc32c_streams(crc32c_long_table, crc32c_long, result, data, size);
+        result = crc32c_streams(crc32c_short_table, crc32c_short, result, data, size);
+        for (; size >= 8; data += 8, size -= 8) {
+            result = _mm_crc32_u64(result, crc32c_load(data));
+        }
+        for (; size; ++data, --size) {
+            result = _mm_crc32_u8(static_cast<uint32_t>(result), *data);
+        }
+        return static_cast<uint32_t>(result);
+    }
+
+#else
+
+    auto crc32c_update(uint32_t crc, const unsigned char* data, std::size_t size) noexcept -> uint32_t
+    {
+        return crc_update(crc32c_table, crc, data, size);
+    }
+
+#endif
+
+
+#if defined(__PCLMUL__) && defined(__SSE4_1__)
+
+    /* Folding with carry-less multiplication as described in "Fast CRC
+     * Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+     * (Intel, 2009). The constants are the bit-reflected values for the
+     * polynomial of zlib, given at the end of the paper. Four blocks of 16
+     * bytes are folded in parallel, and the remaining data is processed
+     * with the tables. */
+    alignas(16) const uint64_t crc32_k1k2[] = {UINT64_C(0x0154442bd4), UINT64_C(0x01c6e41596)};
+    alignas(16) const uint64_t crc32_k3k4[] = {UINT64_C(0x01751997d0), UINT64_C(0x00ccaa009e)};
+    alignas(16) const uint64_t crc32_k5k0[] = {UINT64_C(0x0163cd6124), UINT64_C(0x0000000000)};
+    alignas(16) const uint64_t crc32_barrett[] = {UINT64_C(0x01db710641), UINT64_C(0x01f7011641)};
+
+    auto crc32_load(const unsigned char* data) noexcept -> __m128i
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    auto crc32_constants(const uint64_t* data) noexcept -> __m128i
+    {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    // folds x with the constants k onto y
+    auto crc32_fold(__m128i x, __m128i k, __m128i y) noexcept -> __m128i
+    {
+        return _mm_xor_si128(_mm_xor_si128(
+                _mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), y);
+    }
+
+    // requires at least 64 bytes, and processes a multiple of 16 bytes
+    auto crc32_fold_all(uint32_t crc, const unsigned char*& data, std::size_t& size) noexcept -> uint32_t
+    {
+        __m128i x1 = _mm_xor_si128(crc32_load(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+        __m128i x2 = crc32_load(data + 16);
+        __m128i x3 = crc32_load(data + 32);
+        __m128i x4 = crc32_load(data + 48);
+        __m128i k = crc32_constants(crc32_k1k2);
+        for (data += 64, size -= 64; size >= 64; data += 64, size -= 64) {
+            x1 = crc32_fold(x1, k, crc32_load(data));
+            x2 = crc32_fold(x2, k, crc32_load(data + 16));
+            x3 = crc32_fold(x3, k, crc32_load(data + 32));
+            x4 = crc32_fold(x4, k, crc32_load(data + 48));
+        }
+        k = crc32_constants(crc32_k3k4);
+        x1 = crc32_fold(x1, k, x2);
+        x1 = crc32_fold(x1, k, x3);
+        x1 = crc32_fold(x1, k, x4);
+        for (; size >= 16; data += 16, size -= 16) {
+            x1 = crc32_fold(x1, k, crc32_load(data));
+        }
+        // fold 128 bits to 64 bits
+        __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+        x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+        k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(crc32_k5k0));
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00), x2);
+        // Barrett reduction to 32 bits
+        k = crc32_constants(crc32_barrett);
+        x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+        x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), k, 0x00);
+        return static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x1, x2), 1));
+    }
+
+    auto crc32_update(uint32_t crc, const unsigned char* data, std::size_t size) noexcept -> uint32_t
+    {
+        if (size >= 64) {
+            crc = crc32_fold_all(crc, data, size);
+        }
+        return crc_update(crc32_table, crc, data, size);
+    }
+
+#else
+
+    auto crc32_update(uint32_t crc, const unsigned char* data, std::size_t size) noexcept -> uint32_t
+    {
+        return crc_update(crc32_table, crc, data, size);
+    }
+
+#endif
+
+
+    const uint32_t adler_base = 65521;
+    // largest n such that 255 n (n + 1) / 2 + (n + 1) (base - 1) fits into 32 bits
+    const std::size_t adler_nmax = 5552;
+
+    auto adler_update(uint32_t adler, const unsigned char* data, std::size_t size) noexcept -> uint32_t
+    {
+        uint32_t a = adler & 0xffff;
+        uint32_t b = adler >> 16;
+        while (size) {
+            /* The modulo operation is deferred as long as possible. */
+            std::size_t n = std::min(size, adler_nmax);
+            size -= n;
+            for (; n >= 4; data += 4, n -= 4) {
+                a += data[0];
+                b += a;
+                a += data[1];
+                b += a;
+                a += data[2];
+                b += a;
+                a += data[3];
+                b += a;
+            }
+            for (; n; ++data, --n) {
+                a += *data;
+                b += a;
+            }
+            a %= adler_base;
+            b %= adler_base;
+        }
+        return (b << 16) | a;
+    }
+
+
+    template <typename Function>
+    auto for_each_chunk(up::chunk::from_bulk_t&& chunks, uint32_t value, Function&& function) -> uint32_t
+    {
+        while (chunks.count()) {
+            up::chunk::from head = chunks.head();
+            value = function(head, value);
+            chunks.drain(head.size());
+        }
+        return value;
+    }
+
 }
 
 
@@ -62,3 +372,55 @@ auto up_hash::fnv1a(up::string_view string) noexcept -> std::size_t
 {
     return fnv1a(string.data(), string.size());
 }
+
+
+auto up_hash::crc32(up::chunk::from chunk, uint32_t crc) noexcept -> uint32_t
+{
+    return ~crc32_update(~crc, up::char_cast<unsigned char>(chunk.data()), chunk.size());
+}
+
+auto up_hash::crc32(up::chunk::from_bulk_t&& chunks, uint32_t crc) -> uint32_t
+{
+    return for_each_chunk(std::move(chunks), crc, [](auto&& chunk, auto crc) { return crc32(chunk, crc); });
+}
+
+auto up_hash::crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t size2) noexcept -> uint32_t
+{
+    return crc_combine(crc32_poly, crc1, crc2, size2);
+}
+
+auto up_hash::crc32c(up::chunk::from chunk, uint32_t crc) noexcept -> uint32_t
+{
+    return ~crc32c_update(~crc, up::char_cast<unsigned char>(chunk.data()), chunk.size());
+}
+
+auto up_hash::crc32c(up::chunk::from_bulk_t&& chunks, uint32_t crc) -> uint32_t
+{
+    return for_each_chunk(std::move(chunks), crc, [](auto&& chunk, auto crc) { return crc32c(chunk, crc); });
+}
+
+auto up_hash::crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t size2) noexcept -> uint32_t
+{
+    return crc_combine(crc32c_poly, crc1, crc2, size2);
+}
+
+auto up_hash::adler32(up::chunk::from chunk, uint32_t adler) noexcept -> uint32_t
+{
+    return adler_update(adler, up::char_cast<unsigned char>(chunk.data()), chunk.size());
+}
+
+auto up_hash::adler32(up::chunk::from_bulk_t&& chunks, uint32_t adler) -> uint32_t
+{
+    return for_each_chunk(std::move(chunks), adler, [](auto&& chunk, auto adler) { return adler32(chunk, adler); });
+}
+
+auto up_hash::adler32_combine(uint32_t adler1, uint32_t adler2, uint64_t size2) noexcept -> uint32_t
+{
+    /* See adler32.c of zlib. */
+    uint64_t rem = size2 % adler_base;
+    uint64_t sum1 = adler1 & 0xffff;
+    uint64_t sum2 = rem * sum1 % adler_base;
+    sum1 += (adler2 & 0xffff) + adler_base - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + adler_base - rem;
+    return static_cast<uint32_t>((sum1 % adler_base) | ((sum2 % adler_base) << 16));
+}
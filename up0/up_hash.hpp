@@ -25,11 +25,46 @@ namespace up_hash
     auto fnv1a(up::chunk::from chunk) noexcept -> std::size_t;
     auto fnv1a(up::string_view string) noexcept -> std::size_t;
 
+
+    /**
+     * Checksums for storage and wire framing. The functions continue the
+     * computation of the given value, i.e. checksum(b, checksum(a)) is the
+     * checksum of the concatenation of a and b. The default value is the
+     * checksum of the empty sequence.
+     *
+     * The combine functions compute the checksum of a concatenation from
+     * the checksums of the parts (and the size of the second part), so that
+     * the parts can be processed independently.
+     *
+     * crc32 uses the polynomial of zlib and Ethernet, and crc32c the
+     * Castagnoli polynomial (as used by iSCSI and ext4). If available, they
+     * are computed with PCLMULQDQ and the crc32 instruction of SSE4.2,
+     * respectively. Otherwise, table-driven implementations are used.
+     */
+
+    auto crc32(up::chunk::from chunk, uint32_t crc = 0) noexcept -> uint32_t;
+    auto crc32(up::chunk::from_bulk_t&& chunks, uint32_t crc = 0) -> uint32_t;
+    auto crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t size2) noexcept -> uint32_t;
+
+    auto crc32c(up::chunk::from chunk, uint32_t crc = 0) noexcept -> uint32_t;
+    auto crc32c(up::chunk::from_bulk_t&& chunks, uint32_t crc = 0) -> uint32_t;
+    auto crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t size2) noexcept -> uint32_t;
+
+    auto adler32(up::chunk::from chunk, uint32_t adler = 1) noexcept -> uint32_t;
+    auto adler32(up::chunk::from_bulk_t&& chunks, uint32_t adler = 1) -> uint32_t;
+    auto adler32_combine(uint32_t adler1, uint32_t adler2, uint64_t size2) noexcept -> uint32_t;
+
 }
 
 namespace up
 {
 
     using up_hash::fnv1a;
+    using up_hash::crc32;
+    using up_hash::crc32_combine;
+    using up_hash::crc32c;
+    using up_hash::crc32c_combine;
+    using up_hash::adler32;
+    using up_hash::adler32_combine;
 
 }
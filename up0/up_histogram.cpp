@@ -0,0 +1,115 @@
+#include "up_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+auto up_histogram::latency_histogram::bucket_lower_bound(std::size_t index) noexcept -> uint64_t
+{
+    if (index < linear_count) {
+        return index;
+    } else {
+        std::size_t shift = (index - linear_count) / octave_count + 1;
+        uint64_t mantissa = (index - linear_count) % octave_count + octave_count;
+        return mantissa << shift;
+    }
+}
+
+auto up_histogram::latency_histogram::bucket_upper_bound(std::size_t index) noexcept -> uint64_t
+{
+    if (index < linear_count) {
+        return index;
+    } else {
+        std::size_t shift = (index - linear_count) / octave_count + 1;
+        return bucket_lower_bound(index) + ((uint64_t(1) << shift) - 1);
+    }
+}
+
+
+void up_histogram::latency_histogram::merge(const self& other) noexcept
+{
+    for (std::size_t i = 0; i != bucket_count; ++i) {
+        if (auto n = other._buckets[i].load(std::memory_order_relaxed)) {
+            _buckets[i].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+    _sum.fetch_add(other._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _update_extremes(other._min.load(std::memory_order_relaxed), other._max.load(std::memory_order_relaxed));
+}
+
+void up_histogram::latency_histogram::reset() noexcept
+{
+    for (auto&& bucket : _buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    _min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+}
+
+auto up_histogram::latency_histogram::count() const noexcept -> uint64_t
+{
+    uint64_t result = 0;
+    for (auto&& bucket : _buckets) {
+        result += bucket.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+auto up_histogram::latency_histogram::min() const noexcept -> up::duration
+{
+    auto value = _min.load(std::memory_order_relaxed);
+    return up::duration(value <= _max.load(std::memory_order_relaxed) ? int64_t(value) : 0);
+}
+
+auto up_histogram::latency_histogram::max() const noexcept -> up::duration
+{
+    return up::duration(int64_t(_max.load(std::memory_order_relaxed)));
+}
+
+auto up_histogram::latency_histogram::mean() const noexcept -> up::duration
+{
+    auto n = count();
+    return up::duration(n ? int64_t(_sum.load(std::memory_order_relaxed) / n) : 0);
+}
+
+auto up_histogram::latency_histogram::percentile(double p) const noexcept -> up::duration
+{
+    auto total = count();
+    if (total == 0) {
+        return up::duration(0);
+    }
+    p = std::min(std::max(p, 0.0), 100.0);
+    auto rank = std::max(uint64_t(1), uint64_t(std::ceil(p * double(total) / 100.0)));
+    uint64_t seen = 0;
+    std::size_t i = 0;
+    for (; i != bucket_count - 1; ++i) {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            break;
+        }
+    }
+    auto value = std::min(bucket_upper_bound(i), uint64_t(max().count()));
+    return std::max(up::duration(int64_t(value)), min());
+}
+
+auto up_histogram::latency_histogram::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "latency-histogram",
+        up::insight(typeid(uint64_t), "count",
+            up::invoke_to_insight_with_fallback(count())),
+        up::insight(typeid(up::duration), "min-ns",
+            up::invoke_to_insight_with_fallback(min().count())),
+        up::insight(typeid(up::duration), "mean-ns",
+            up::invoke_to_insight_with_fallback(mean().count())),
+        up::insight(typeid(up::duration), "p50-ns",
+            up::invoke_to_insight_with_fallback(percentile(50).count())),
+        up::insight(typeid(up::duration), "p90-ns",
+            up::invoke_to_insight_with_fallback(percentile(90).count())),
+        up::insight(typeid(up::duration), "p99-ns",
+            up::invoke_to_insight_with_fallback(percentile(99).count())),
+        up::insight(typeid(up::duration), "p99.9-ns",
+            up::invoke_to_insight_with_fallback(percentile(99.9).count())),
+        up::insight(typeid(up::duration), "max-ns",
+            up::invoke_to_insight_with_fallback(max().count())));
+}
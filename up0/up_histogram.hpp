@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * Latency histogram with log-linear buckets (similar to HdrHistogram). All
+ * durations from zero to the maximum are recorded with a relative error of
+ * less than 1/32, and the memory is part of the object (i.e. no dynamic
+ * memory allocation at all).
+ *
+ * Recording uses relaxed atomics, so that a single histogram can be shared
+ * by several threads. For heavily contended paths, use one histogram per
+ * thread and merge them for queries. Queries are consistent only if there
+ * are no concurrent modifications.
+ */
+
+#include <atomic>
+#include <limits>
+
+#include "up_chrono.hpp"
+#include "up_insight.hpp"
+
+namespace up_histogram
+{
+
+    class latency_histogram final
+    {
+    public: // --- scope ---
+        using self = latency_histogram;
+        // values below are recorded exactly, and each octave above is split
+        static const constexpr std::size_t linear_count = 64;
+        static const constexpr std::size_t octave_count = 32;
+        static const constexpr std::size_t bucket_count = linear_count + (64 - 6) * octave_count;
+        static auto bucket_index(uint64_t value) noexcept -> std::size_t
+        {
+            if (value < linear_count) {
+                return std::size_t(value);
+            } else {
+                std::size_t exponent = std::size_t(63 - __builtin_clzll(value)); // at least 6
+                std::size_t shift = exponent - 5;
+                return linear_count + (exponent - 6) * octave_count + std::size_t(value >> shift) - octave_count;
+            }
+        }
+        // range of values recorded in the bucket
+        static auto bucket_lower_bound(std::size_t index) noexcept -> uint64_t;
+        static auto bucket_upper_bound(std::size_t index) noexcept -> uint64_t;
+    private: // --- state ---
+        std::atomic<uint64_t> _buckets[bucket_count] = {};
+        std::atomic<uint64_t> _min{std::numeric_limits<uint64_t>::max()};
+        std::atomic<uint64_t> _max{0};
+        std::atomic<uint64_t> _sum{0};
+    public: // --- life ---
+        explicit latency_histogram() noexcept = default;
+        latency_histogram(const self& rhs) = delete;
+        latency_histogram(self&& rhs) noexcept = delete;
+        ~latency_histogram() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        // negative durations are recorded as zero
+        void record(const up::duration& value, uint64_t count = 1) noexcept
+        {
+            if (count == 0) {
+                return;
+            }
+            uint64_t ns = value.count() > 0 ? uint64_t(value.count()) : 0;
+            _buckets[bucket_index(ns)].fetch_add(count, std::memory_order_relaxed);
+            _sum.fetch_add(ns * count, std::memory_order_relaxed);
+            _update_extremes(ns, ns);
+        }
+        void merge(const self& other) noexcept;
+        void reset() noexcept;
+        auto count() const noexcept -> uint64_t;
+        // all of the following return zero for empty histograms
+        auto min() const noexcept -> up::duration;
+        auto max() const noexcept -> up::duration;
+        auto mean() const noexcept -> up::duration;
+        /* Returns the highest value equivalent to the recorded value at the
+         * given percentile (clamped to [0,100]), but at most the maximum. */
+        auto percentile(double p) const noexcept -> up::duration;
+        auto to_insight() const -> up::insight;
+    private:
+        void _update_extremes(uint64_t min, uint64_t max) noexcept
+        {
+            auto current = _min.load(std::memory_order_relaxed);
+            while (min < current && !_min.compare_exchange_weak(current, min, std::memory_order_relaxed)) { }
+            current = _max.load(std::memory_order_relaxed);
+            while (max > current && !_max.compare_exchange_weak(current, max, std::memory_order_relaxed)) { }
+        }
+    };
+
+}
+
+namespace up
+{
+
+    using up_histogram::latency_histogram;
+
+}
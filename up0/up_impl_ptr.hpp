@@ -1,5 +1,8 @@
 #pragma once
 
+#include <exception>
+#include <new>
+
 
 namespace up_impl_ptr
 {
@@ -70,6 +73,126 @@ namespace up_impl_ptr
         return impl_maker<Type, Args...>(std::forward<Args>(args)...);
     }
 
+    /**
+     * Alternative to impl_ptr, that stores the implementation object within
+     * the owning object instead of on the heap. The size and the alignment
+     * of the storage are part of the type, and they are checked at compile
+     * time when the implementation is created (i.e. in the source file, where
+     * the implementation class is complete).
+     *
+     * The implementation may also be a class derived from Impl, which allows
+     * to select between different implementations at runtime. In this case,
+     * Impl must be the (only) primary base class. The implementation must be
+     * nothrow move constructible, because moving the owner relocates it.
+     *
+     * The destructor and the move operations are dispatched through a single
+     * function pointer, so that the owning class can use defaulted special
+     * member functions in the header file.
+     */
+    template <typename Impl, std::size_t Size, std::size_t Align = alignof(std::max_align_t)>
+    class fast_impl final
+    {
+    public: // --- scope ---
+        using self = fast_impl;
+    private:
+        using manager = void (*)(void* source, void* target) noexcept;
+        template <typename Type>
+        static void _manage(void* source, void* target) noexcept
+        {
+            auto&& ptr = static_cast<Type*>(source);
+            if (target) {
+                new (target) Type(std::move(*ptr));
+            }
+            ptr->~Type();
+        }
+    private: // --- state ---
+        manager _manager;
+        alignas(Align) unsigned char _storage[Size];
+    public: // --- life ---
+        explicit fast_impl() noexcept
+            : _manager(nullptr)
+        { }
+        fast_impl(const self& rhs) = delete;
+        fast_impl(self&& rhs) noexcept
+            : _manager(std::exchange(rhs._manager, nullptr))
+        {
+            if (_manager) {
+                _manager(rhs._storage, _storage);
+            }
+        }
+        ~fast_impl() noexcept
+        {
+            reset();
+        }
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self&
+        {
+            if (this != &rhs) {
+                reset();
+                if ((_manager = std::exchange(rhs._manager, nullptr))) {
+                    _manager(rhs._storage, _storage);
+                }
+            }
+            return *this;
+        }
+        void swap(self& rhs) noexcept
+        {
+            self temp(std::move(rhs));
+            rhs = std::move(*this);
+            *this = std::move(temp);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        template <typename Type = Impl, typename... Args>
+        auto emplace(Args&&... args) -> Type&
+        {
+            static_assert(std::is_base_of<Impl, Type>::value);
+            static_assert(sizeof(Type) <= Size, "storage too small for implementation");
+            static_assert(Align % alignof(Type) == 0, "storage insufficiently aligned for implementation");
+            static_assert(std::is_nothrow_move_constructible<Type>::value);
+            /* The object is constructed outside of the storage, so that the
+             * current implementation is kept if the constructor throws. */
+            Type value(std::forward<Args>(args)...);
+            reset();
+            auto&& result = *new (_storage) Type(std::move(value));
+            if (static_cast<void*>(static_cast<Impl*>(&result)) != _storage) {
+                std::terminate(); // Impl is not the primary base class
+            }
+            _manager = &_manage<Type>;
+            return result;
+        }
+        void reset() noexcept
+        {
+            if (_manager) {
+                std::exchange(_manager, nullptr)(_storage, nullptr);
+            }
+        }
+        explicit operator bool() const noexcept
+        {
+            return _manager != nullptr;
+        }
+        auto get() const noexcept -> Impl*
+        {
+            return _manager ? _get() : nullptr;
+        }
+        auto operator*() const noexcept -> Impl&
+        {
+            return *_get();
+        }
+        auto operator->() const noexcept -> Impl*
+        {
+            return _get();
+        }
+    private:
+        auto _get() const noexcept -> Impl*
+        {
+            return std::launder(reinterpret_cast<Impl*>(const_cast<unsigned char*>(_storage)));
+        }
+    };
+
 }
 
 namespace up
@@ -77,5 +200,6 @@ namespace up
 
     using up_impl_ptr::impl_ptr;
     using up_impl_ptr::impl_make;
+    using up_impl_ptr::fast_impl;
 
 }
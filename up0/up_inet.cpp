@@ -1,5 +1,6 @@
 #include "up_inet.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 #include <arpa/inet.h>
@@ -99,31 +100,234 @@ namespace
         return up::invoke_to_string(up::to_underlying_type(value));
     }
 
-    void ip_address_parse(address_family af, const up::string_view& text, void* result)
+    // SWAR helpers for 8 chars (with the first char in the lowest byte)
+    const constexpr uint64_t swar_ones = 0x0101010101010101ull;
+    const constexpr uint64_t swar_highs = 0x8080808080808080ull;
+
+    auto swar_load(const char* data) -> uint64_t
     {
-        int rv = ::inet_pton(up::to_underlying_type(af), up::nts(text), result);
-        if (rv == 1) {
-            // okay
-        } else if (rv == 0) {
-            throw up::make_exception("invalid-ip-address", up_inet::invalid_endpoint())
-                .with(af, text);
-        } else {
-            throw up::make_exception("ip-address-parser-error")
-                .with(af, text, up::errno_info(errno));
+        uint64_t result;
+        std::memcpy(&result, data, sizeof(result));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        result = __builtin_bswap64(result);
+#endif
+        return result;
+    }
+
+    // high bits of all bytes, that are equal to the char
+    auto swar_equal(uint64_t word, char c) -> uint64_t
+    {
+        auto t = word ^ (swar_ones * static_cast<unsigned char>(c));
+        return ~(((t & ~swar_highs) + ~swar_highs) | t) & swar_highs;
+    }
+
+    // high bits of all bytes, that are decimal digits
+    auto swar_digits(uint64_t word) -> uint64_t
+    {
+        auto t = word ^ (swar_ones * '0');
+        return ~(((t & ~swar_highs) + swar_ones * (0x80 - 10)) | t) & swar_highs;
+    }
+
+    // one bit per byte (as with _mm_movemask_epi8)
+    auto swar_mask(uint64_t highs) -> unsigned
+    {
+        return static_cast<unsigned>((highs * 0x02040810204081ull) >> 56);
+    }
+
+    // same as inet_pton (without leading zeros)
+    bool ipv4_parse(const char* data, std::size_t size, uint8_t* result)
+    {
+        if (size < 7 || size > 15) {
+            return false;
         }
+        char text[16] = {};
+        std::memcpy(text, data, size);
+        auto lo = swar_load(text);
+        auto hi = swar_load(text + 8);
+        auto dots = swar_mask(swar_equal(lo, '.')) | swar_mask(swar_equal(hi, '.')) << 8;
+        auto digits = swar_mask(swar_digits(lo)) | swar_mask(swar_digits(hi)) << 8;
+        if ((dots | digits) != (1u << size) - 1 || __builtin_popcount(dots) != 3) {
+            return false;
+        }
+        std::size_t start = 0;
+        for (std::size_t i = 0; i != 4; ++i) {
+            std::size_t end = i == 3 ? size : __builtin_ctz(dots);
+            dots &= dots - 1;
+            auto length = end - start;
+            if (length == 0 || length > 3 || (length > 1 && text[start] == '0')) {
+                return false;
+            }
+            unsigned value = 0;
+            for (auto p = text + start, q = text + end; p != q; ++p) {
+                value = value * 10 + unsigned(*p - '0');
+            }
+            if (value > 255) {
+                return false;
+            }
+            result[i] = static_cast<uint8_t>(value);
+            start = end + 1;
+        }
+        return true;
     }
 
-    auto ip_address_to_string(address_family af, address_length length, const void* address)
+    auto hex_value(char c) -> int
     {
-        auto buffer = std::make_unique<char[]>(up::to_underlying_type(length));
-        const char* rv = ::inet_ntop(up::to_underlying_type(af), address,
-            buffer.get(), up::to_underlying_type(length));
-        if (rv != nullptr) {
-            return up::unique_string(rv);
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
         } else {
-            throw up::make_exception("ip-address-conversion-error")
-                .with(af, length, up::errno_info(errno));
+            return -1;
+        }
+    }
+
+    // same as inet_pton (including embedded IPv4 addresses)
+    bool ipv6_parse(const char* data, std::size_t size, uint8_t* result)
+    {
+        uint8_t bytes[16] = {};
+        std::size_t count = 0;
+        const std::size_t none = std::size_t(-1);
+        std::size_t gap = none; // position of '::'
+        std::size_t i = 0;
+        if (size != 0 && data[0] == ':') {
+            if (size == 1 || data[1] != ':') {
+                return false;
+            }
+            i = 1;
+        }
+        std::size_t token = i;
+        std::size_t digits = 0;
+        unsigned value = 0;
+        for (; i != size; ++i) {
+            auto c = data[i];
+            auto x = hex_value(c);
+            if (x >= 0) {
+                if (++digits > 4) {
+                    return false;
+                }
+                value = value << 4 | unsigned(x);
+            } else if (c == ':') {
+                token = i + 1;
+                if (digits == 0) {
+                    if (gap != none) {
+                        return false;
+                    }
+                    gap = count;
+                    continue;
+                } else if (token == size || count + 2 > 16) {
+                    return false;
+                }
+                bytes[count++] = static_cast<uint8_t>(value >> 8);
+                bytes[count++] = static_cast<uint8_t>(value);
+                digits = 0;
+                value = 0;
+            } else if (c == '.' && count + 4 <= 16 && ipv4_parse(data + token, size - token, bytes + count)) {
+                count += 4;
+                digits = 0;
+                break;
+            } else {
+                return false;
+            }
+        }
+        if (digits != 0) {
+            if (count + 2 > 16) {
+                return false;
+            }
+            bytes[count++] = static_cast<uint8_t>(value >> 8);
+            bytes[count++] = static_cast<uint8_t>(value);
+        }
+        if (gap != none) {
+            if (count == 16) {
+                return false;
+            }
+            auto n = count - gap;
+            std::memmove(bytes + 16 - n, bytes + gap, n);
+            std::memset(bytes + gap, 0, 16 - n - gap);
+            count = 16;
+        }
+        if (count != 16) {
+            return false;
+        }
+        std::memcpy(result, bytes, sizeof(bytes));
+        return true;
+    }
+
+    auto ipv4_format(const uint8_t* data, char* result) -> std::size_t
+    {
+        auto p = result;
+        for (std::size_t i = 0; i != 4; ++i) {
+            if (i != 0) {
+                *p++ = '.';
+            }
+            unsigned value = data[i];
+            if (value >= 100) {
+                *p++ = char('0' + value / 100);
+                value %= 100;
+                *p++ = char('0' + value / 10);
+            } else if (value >= 10) {
+                *p++ = char('0' + value / 10);
+            }
+            *p++ = char('0' + value % 10);
+        }
+        return std::size_t(p - result);
+    }
+
+    // same as inet_ntop (i.e. the longest run of zeros is compressed)
+    auto ipv6_format(const uint8_t* data, char* result) -> std::size_t
+    {
+        unsigned words[8];
+        for (std::size_t i = 0; i != 8; ++i) {
+            words[i] = unsigned(data[2 * i]) << 8 | data[2 * i + 1];
+        }
+        std::size_t best_base = 8;
+        std::size_t best_length = 0;
+        for (std::size_t i = 0; i != 8; ) {
+            if (words[i] == 0) {
+                auto j = i;
+                while (j != 8 && words[j] == 0) {
+                    ++j;
+                }
+                if (j - i > best_length) {
+                    best_base = i;
+                    best_length = j - i;
+                }
+                i = j;
+            } else {
+                ++i;
+            }
+        }
+        if (best_length < 2) {
+            best_base = 8;
+            best_length = 0;
+        }
+        static const constexpr char hex[] = "0123456789abcdef";
+        auto p = result;
+        for (std::size_t i = 0; i != 8; ++i) {
+            if (i >= best_base && i < best_base + best_length) {
+                if (i == best_base) {
+                    *p++ = ':';
+                }
+                continue;
+            }
+            if (i != 0) {
+                *p++ = ':';
+            }
+            // IPv4-compatible and IPv4-mapped addresses
+            if (i == 6 && best_base == 0 && (best_length == 6 || (best_length == 5 && words[5] == 0xffff))) {
+                p += ipv4_format(data + 12, p);
+                return std::size_t(p - result);
+            }
+            auto value = words[i];
+            for (int shift = value >= 0x1000 ? 12 : value >= 0x100 ? 8 : value >= 0x10 ? 4 : 0; shift >= 0; shift -= 4) {
+                *p++ = hex[value >> shift & 0xf];
+            }
         }
+        if (best_length != 0 && best_base + best_length == 8) {
+            *p++ = ':';
+        }
+        return std::size_t(p - result);
     }
 
 
@@ -278,6 +482,15 @@ public:
     {
         std::memcpy(&target, &source._data, sizeof(target));
     }
+    // address in host byte order
+    static auto bits(const endpoint& source) -> uint32_t
+    {
+        uint32_t result = 0;
+        for (auto&& byte : source._data) {
+            result = result << 8 | byte;
+        }
+        return result;
+    }
 };
 
 class up_inet::ipv4::endpoint::init final
@@ -324,9 +537,22 @@ const up_inet::ipv4::endpoint up_inet::ipv4::endpoint::any(
 const up_inet::ipv4::endpoint up_inet::ipv4::endpoint::loopback(
     up_inet::ipv4::endpoint::init{in_addr{byte_order_host_to_network(INADDR_LOOPBACK)}});
 
+auto up_inet::ipv4::endpoint::parse(const up::string_view& value) noexcept -> up::optional<self>
+{
+    in_addr data;
+    if (ipv4_parse(value.data(), value.size(), reinterpret_cast<uint8_t*>(&data))) {
+        return self(init{data});
+    } else {
+        return up::nullopt;
+    }
+}
+
 up_inet::ipv4::endpoint::endpoint(const up::string_view& value)
 {
-    ip_address_parse(address_family::v4, value, &_data);
+    if (!ipv4_parse(value.data(), value.size(), _data)) {
+        throw up::make_exception("invalid-ip-address", up_inet::invalid_endpoint())
+            .with(address_family::v4, value);
+    }
 }
 
 up_inet::ipv4::endpoint::endpoint(init&& arg)
@@ -336,7 +562,19 @@ up_inet::ipv4::endpoint::endpoint(init&& arg)
 
 auto up_inet::ipv4::endpoint::to_string() const -> up::unique_string
 {
-    return ip_address_to_string(address_family::v4, address_length::v4, &_data);
+    char result[max_size];
+    return up::unique_string(result, format(result));
+}
+
+auto up_inet::ipv4::endpoint::format(char* result) const noexcept -> std::size_t
+{
+    return ipv4_format(_data, result);
+}
+
+void up_inet::ipv4::endpoint::format(up::buffer& buffer) const
+{
+    buffer.reserve(max_size);
+    buffer.produce(format(buffer.cold()));
 }
 
 
@@ -349,6 +587,15 @@ public:
     {
         std::memcpy(&target, &source._data, sizeof(target));
     }
+    // address in host byte order
+    static auto bits(const endpoint& source) -> unsigned __int128
+    {
+        unsigned __int128 result = 0;
+        for (auto&& byte : source._data) {
+            result = result << 8 | byte;
+        }
+        return result;
+    }
 };
 
 class up_inet::ipv6::endpoint::init final
@@ -394,9 +641,22 @@ const up_inet::ipv6::endpoint up_inet::ipv6::endpoint::any(
 const up_inet::ipv6::endpoint up_inet::ipv6::endpoint::loopback(
     up_inet::ipv6::endpoint::init{in6_addr IN6ADDR_LOOPBACK_INIT});
 
+auto up_inet::ipv6::endpoint::parse(const up::string_view& value) noexcept -> up::optional<self>
+{
+    in6_addr data;
+    if (ipv6_parse(value.data(), value.size(), reinterpret_cast<uint8_t*>(&data))) {
+        return self(init{data});
+    } else {
+        return up::nullopt;
+    }
+}
+
 up_inet::ipv6::endpoint::endpoint(const up::string_view& value)
 {
-    ip_address_parse(address_family::v6, value, &_data);
+    if (!ipv6_parse(value.data(), value.size(), _data)) {
+        throw up::make_exception("invalid-ip-address", up_inet::invalid_endpoint())
+            .with(address_family::v6, value);
+    }
 }
 
 up_inet::ipv6::endpoint::endpoint(init&& arg)
@@ -406,7 +666,315 @@ up_inet::ipv6::endpoint::endpoint(init&& arg)
 
 auto up_inet::ipv6::endpoint::to_string() const -> up::unique_string
 {
-    return ip_address_to_string(address_family::v6, address_length::v6, &_data);
+    char result[max_size];
+    return up::unique_string(result, format(result));
+}
+
+auto up_inet::ipv6::endpoint::format(char* result) const noexcept -> std::size_t
+{
+    return ipv6_format(_data, result);
+}
+
+void up_inet::ipv6::endpoint::format(up::buffer& buffer) const
+{
+    buffer.reserve(max_size);
+    buffer.produce(format(buffer.cold()));
+}
+
+
+namespace
+{
+
+    /**
+     * Poptrie with direct indexing of the first bits. Each node covers the
+     * next 6 bits, and it contains two bitmaps: one for the slots with child
+     * nodes, and one for the slots, where a run of equal leaves starts. The
+     * children and the leaves of a node are stored consecutively, and they
+     * are located by counting the bits before the slot.
+     */
+    template <typename Bits>
+    class prefix_trie final
+    {
+    public: // --- scope ---
+        using self = prefix_trie;
+        static const constexpr std::size_t width = sizeof(Bits) * 8;
+        static const constexpr std::size_t direct_bits = 16;
+        static const constexpr std::size_t stride = 6;
+        static const constexpr uint32_t none = uint32_t(-1);
+        // direct entries contain either leaf indexes or node indexes with this flag
+        static const constexpr uint32_t internal = uint32_t(1) << 31;
+        class entry final
+        {
+        public: // --- state ---
+            Bits _bits;
+            std::size_t _length;
+            uint32_t _value;
+        };
+    private:
+        class node final
+        {
+        public: // --- state ---
+            uint64_t _vector = 0; // slots with child nodes
+            uint64_t _leafvec = 0; // slots starting a new run of leaves
+            uint32_t _base0 = 0; // first leaf
+            uint32_t _base1 = 0; // first child
+        };
+        using range = std::pair<const entry*, const entry*>;
+    private: // --- state ---
+        std::vector<uint32_t> _direct;
+        std::vector<node> _nodes;
+        std::vector<uint32_t> _leaves;
+        std::size_t _size = 0;
+    public: // --- life ---
+        explicit prefix_trie(std::vector<entry> entries)
+        {
+            for (auto&& e : entries) {
+                e._bits &= _mask(e._length);
+            }
+            // shorter prefixes come before longer prefixes, that they contain
+            std::stable_sort(entries.begin(), entries.end(), [](const entry& lhs, const entry& rhs) {
+                    return lhs._bits < rhs._bits || (lhs._bits == rhs._bits && lhs._length < rhs._length);
+                });
+            // the last of equal prefixes wins
+            auto same = [](const entry& lhs, const entry& rhs) {
+                return lhs._bits == rhs._bits && lhs._length == rhs._length;
+            };
+            std::size_t count = 0;
+            for (std::size_t i = 0; i != entries.size(); ++i) {
+                if (i + 1 == entries.size() || !same(entries[i], entries[i + 1])) {
+                    entries[count++] = entries[i];
+                }
+            }
+            entries.resize(count);
+            _size = count;
+            _build_direct(range(entries.data(), entries.data() + count));
+            _nodes.shrink_to_fit();
+            _leaves.shrink_to_fit();
+        }
+    public: // --- operations ---
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        auto memory() const noexcept -> std::size_t
+        {
+            return _direct.size() * sizeof(uint32_t) + _nodes.size() * sizeof(node) + _leaves.size() * sizeof(uint32_t);
+        }
+        auto find(Bits bits) const noexcept -> uint32_t
+        {
+            auto d = _direct[_chunk(bits, 0, direct_bits)];
+            if ((d & internal) == 0) {
+                return _leaves[d];
+            }
+            auto n = &_nodes[d & ~internal];
+            for (std::size_t offset = direct_bits; ; offset += stride) {
+                auto bit = uint64_t(1) << _chunk(bits, offset, stride);
+                if (n->_vector & bit) {
+                    n = &_nodes[n->_base1 + __builtin_popcountll(n->_vector & (bit - 1))];
+                } else {
+                    // note: for the last slot, the mask wraps around to all bits
+                    return _leaves[n->_base0 + __builtin_popcountll(n->_leafvec & ((bit << 1) - 1)) - 1];
+                }
+            }
+        }
+    private:
+        static auto _mask(std::size_t length) noexcept -> Bits
+        {
+            return length == 0 ? Bits(0) : ~Bits(0) << (width - length);
+        }
+        // bits at the offset from the most significant bit (padded with zeros)
+        static auto _chunk(Bits bits, std::size_t offset, std::size_t size) noexcept -> std::size_t
+        {
+            return static_cast<std::size_t>((bits << offset) >> (width - size));
+        }
+        /* Computes the values of all slots below a prefix, and the ranges of
+         * the longer prefixes for the slots, that require child nodes. All
+         * entries in the range are longer than the depth. Due to the order of
+         * the entries, contained prefixes override containing prefixes. */
+        static void _slots(range entries, std::size_t depth, std::size_t size, uint32_t inherited,
+            uint32_t* values, std::vector<std::pair<std::size_t, range>>& children)
+        {
+            std::fill(values, values + (std::size_t(1) << size), inherited);
+            for (auto p = entries.first; p != entries.second; ) {
+                auto slot = _chunk(p->_bits, depth, size);
+                if (p->_length <= depth + size) {
+                    auto count = std::size_t(1) << (depth + size - p->_length);
+                    std::fill(values + slot, values + slot + count, p->_value);
+                    ++p;
+                } else {
+                    auto q = p;
+                    while (q != entries.second && _chunk(q->_bits, depth, size) == slot) {
+                        ++q;
+                    }
+                    children.emplace_back(slot, range(p, q));
+                    p = q;
+                }
+            }
+        }
+        void _build_direct(range entries)
+        {
+            std::vector<uint32_t> values(std::size_t(1) << direct_bits);
+            std::vector<std::pair<std::size_t, range>> children;
+            _slots(entries, 0, direct_bits, none, values.data(), children);
+            _direct.resize(values.size());
+            auto child = children.begin();
+            for (std::size_t slot = 0; slot != values.size(); ++slot) {
+                if (child != children.end() && child->first == slot) {
+                    _direct[slot] = internal | static_cast<uint32_t>(_nodes.size());
+                    _nodes.emplace_back();
+                    _build_node(_nodes.size() - 1, child->second, direct_bits, values[slot]);
+                    ++child;
+                } else if (_leaves.empty() || _leaves.back() != values[slot]) {
+                    _direct[slot] = static_cast<uint32_t>(_leaves.size());
+                    _leaves.push_back(values[slot]);
+                } else {
+                    _direct[slot] = static_cast<uint32_t>(_leaves.size() - 1);
+                }
+            }
+        }
+        void _build_node(std::size_t index, range entries, std::size_t depth, uint32_t inherited)
+        {
+            uint32_t values[std::size_t(1) << stride];
+            std::vector<std::pair<std::size_t, range>> children;
+            _slots(entries, depth, stride, inherited, values, children);
+            node n;
+            n._base0 = static_cast<uint32_t>(_leaves.size());
+            n._base1 = static_cast<uint32_t>(_nodes.size());
+            auto child = children.begin();
+            bool first = true;
+            for (std::size_t slot = 0; slot != std::size(values); ++slot) {
+                if (child != children.end() && child->first == slot) {
+                    n._vector |= uint64_t(1) << slot;
+                    ++child;
+                } else if (first || _leaves.back() != values[slot]) {
+                    n._leafvec |= uint64_t(1) << slot;
+                    _leaves.push_back(values[slot]);
+                    first = false;
+                }
+            }
+            _nodes.resize(_nodes.size() + children.size());
+            _nodes[index] = n;
+            for (std::size_t i = 0; i != children.size(); ++i) {
+                auto slot = children[i].first;
+                _build_node(n._base1 + i, children[i].second, depth + stride, values[slot]);
+            }
+        }
+    };
+
+
+    template <typename Endpoint, typename Bits, typename Entry>
+    auto make_prefix_entries(const std::vector<Entry>& entries, uint32_t npos)
+        -> std::vector<typename prefix_trie<Bits>::entry>
+    {
+        std::vector<typename prefix_trie<Bits>::entry> result;
+        result.reserve(entries.size());
+        for (auto&& entry : entries) {
+            if (entry.length() > prefix_trie<Bits>::width) {
+                throw up::make_exception("invalid-ip-prefix-length").with(entry.address().to_string(), entry.length());
+            } else if (entry.value() == npos) {
+                throw up::make_exception("invalid-ip-prefix-value").with(entry.address().to_string(), entry.length());
+            }
+            result.push_back({Endpoint::accessor::bits(entry.address()), entry.length(), entry.value()});
+        }
+        return result;
+    }
+
+}
+
+
+class up_inet::ipv4::prefix_table::impl final
+{
+public: // --- state ---
+    prefix_trie<uint32_t> _trie;
+};
+
+up_inet::ipv4::prefix_table::prefix_table(const std::vector<entry>& entries)
+    : _impl(std::make_shared<const impl>(impl{
+                prefix_trie<uint32_t>(make_prefix_entries<endpoint, uint32_t>(entries, npos))}))
+{ }
+
+up_inet::ipv4::prefix_table::prefix_table(std::shared_ptr<const impl> impl) noexcept
+    : _impl(std::move(impl))
+{ }
+
+auto up_inet::ipv4::prefix_table::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "ipv4-prefix-table",
+        up::invoke_to_insight_with_fallback(size()),
+        up::invoke_to_insight_with_fallback(_impl ? _impl->_trie.memory() : 0));
+}
+
+auto up_inet::ipv4::prefix_table::size() const noexcept -> std::size_t
+{
+    return _impl ? _impl->_trie.size() : 0;
+}
+
+auto up_inet::ipv4::prefix_table::find(const ipv4::endpoint& endpoint) const noexcept -> uint32_t
+{
+    return _impl ? _impl->_trie.find(endpoint::accessor::bits(endpoint)) : npos;
+}
+
+
+up_inet::ipv4::prefix_table::atomic::atomic(const prefix_table& table)
+    : _impl(table._impl)
+{ }
+
+auto up_inet::ipv4::prefix_table::atomic::load() const noexcept -> prefix_table
+{
+    return prefix_table(std::atomic_load_explicit(&_impl, std::memory_order_acquire));
+}
+
+void up_inet::ipv4::prefix_table::atomic::store(const prefix_table& table) noexcept
+{
+    std::atomic_store_explicit(&_impl, table._impl, std::memory_order_release);
+}
+
+
+class up_inet::ipv6::prefix_table::impl final
+{
+public: // --- state ---
+    prefix_trie<unsigned __int128> _trie;
+};
+
+up_inet::ipv6::prefix_table::prefix_table(const std::vector<entry>& entries)
+    : _impl(std::make_shared<const impl>(impl{
+                prefix_trie<unsigned __int128>(make_prefix_entries<endpoint, unsigned __int128>(entries, npos))}))
+{ }
+
+up_inet::ipv6::prefix_table::prefix_table(std::shared_ptr<const impl> impl) noexcept
+    : _impl(std::move(impl))
+{ }
+
+auto up_inet::ipv6::prefix_table::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "ipv6-prefix-table",
+        up::invoke_to_insight_with_fallback(size()),
+        up::invoke_to_insight_with_fallback(_impl ? _impl->_trie.memory() : 0));
+}
+
+auto up_inet::ipv6::prefix_table::size() const noexcept -> std::size_t
+{
+    return _impl ? _impl->_trie.size() : 0;
+}
+
+auto up_inet::ipv6::prefix_table::find(const ipv6::endpoint& endpoint) const noexcept -> uint32_t
+{
+    return _impl ? _impl->_trie.find(endpoint::accessor::bits(endpoint)) : npos;
+}
+
+
+up_inet::ipv6::prefix_table::atomic::atomic(const prefix_table& table)
+    : _impl(table._impl)
+{ }
+
+auto up_inet::ipv6::prefix_table::atomic::load() const noexcept -> prefix_table
+{
+    return prefix_table(std::atomic_load_explicit(&_impl, std::memory_order_acquire));
+}
+
+void up_inet::ipv6::prefix_table::atomic::store(const prefix_table& table) noexcept
+{
+    std::atomic_store_explicit(&_impl, table._impl, std::memory_order_release);
 }
 
 
@@ -476,9 +1044,9 @@ auto up_inet::to_string(ip::version value) -> up::unique_string
 up_inet::ip::endpoint::endpoint(const up::string_view& value)
     : _version(ip::version::v4)
 {
-    try {
-        new (&_v4) ipv4::endpoint(value);
-    } catch (const invalid_endpoint&) {
+    if (auto v4 = ipv4::endpoint::parse(value)) {
+        new (&_v4) ipv4::endpoint(*v4);
+    } else {
         _version = ip::version::v6;
         new (&_v6) ipv6::endpoint(value);
     }
@@ -597,6 +1165,23 @@ auto up_inet::ip::endpoint::to_string() const -> up::unique_string
     throw up::make_exception("unexpected-tcp-endpoint-ip-address-version").with(_version);
 }
 
+auto up_inet::ip::endpoint::format(char* result) const noexcept -> std::size_t
+{
+    switch (_version) {
+    case ip::version::v4:
+        return _v4.format(result);
+    case ip::version::v6:
+        return _v6.format(result);
+    }
+    up::terminate("unexpected-tcp-endpoint-ip-address-version", _version);
+}
+
+void up_inet::ip::endpoint::format(up::buffer& buffer) const
+{
+    buffer.reserve(max_size);
+    buffer.produce(format(buffer.cold()));
+}
+
 auto up_inet::ip::endpoint::version() const noexcept -> ip::version
 {
     return _version;
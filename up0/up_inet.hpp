@@ -2,7 +2,9 @@
 
 #include <cstdint>
 
+#include "up_buffer.hpp"
 #include "up_impl_ptr.hpp"
+#include "up_optional.hpp"
 #include "up_stream.hpp"
 #include "up_utility.hpp"
 
@@ -16,6 +18,7 @@ namespace up_inet
     {
     public: // --- scope ---
         class endpoint;
+        class prefix_table;
     };
 
 
@@ -29,6 +32,10 @@ namespace up_inet
         class order;
         static const self any;
         static const self loopback;
+        // maximal size of the text representation
+        static const constexpr std::size_t max_size = 15;
+        // returns nullopt for invalid addresses
+        static auto parse(const up::string_view& value) noexcept -> up::optional<self>;
     private: // --- state ---
         uint8_t _data[4];
     public: // --- life ---
@@ -38,6 +45,10 @@ namespace up_inet
         explicit endpoint(const up::string_view& value);
     public: // --- operations ---
         auto to_string() const -> up::unique_string;
+        // writes at most max_size chars, and returns the number of chars
+        auto format(char* result) const noexcept -> std::size_t;
+        // appends to the buffer
+        void format(up::buffer& buffer) const;
     };
 
 
@@ -51,10 +62,93 @@ namespace up_inet
     };
 
 
+    /**
+     * Immutable table for longest prefix matches of IPv4 endpoints (e.g. for
+     * access control lists with CIDR blocks). The table is built at once from
+     * a list of prefixes with values, where later entries replace earlier
+     * entries with the same prefix. Copies share the same data, and updates
+     * are done by building a new table and replacing it in an atomic holder.
+     *
+     * The lookup uses direct indexing for the first 16 bits, and a multibit
+     * trie with a stride of 6 bits below (Poptrie), where the children and
+     * leaves of each node are stored consecutively and located by counting
+     * the bits of two bitmaps.
+     */
+    class ipv4::prefix_table final
+    {
+    public: // --- scope ---
+        using self = prefix_table;
+        class entry;
+        class atomic;
+        class impl;
+        static const constexpr uint32_t npos = uint32_t(-1);
+    private: // --- state ---
+        std::shared_ptr<const impl> _impl;
+    public: // --- life ---
+        prefix_table() noexcept = default;
+        // throws for prefix lengths above 32 and values equal to npos
+        explicit prefix_table(const std::vector<entry>& entries);
+    private:
+        explicit prefix_table(std::shared_ptr<const impl> impl) noexcept;
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        // number of distinct prefixes
+        auto size() const noexcept -> std::size_t;
+        // value of the longest matching prefix, or npos
+        auto find(const ipv4::endpoint& endpoint) const noexcept -> uint32_t;
+    };
+
+
+    class ipv4::prefix_table::entry final
+    {
+    private: // --- state ---
+        ipv4::endpoint _address;
+        std::size_t _length;
+        uint32_t _value;
+    public: // --- life ---
+        explicit entry(const ipv4::endpoint& address, std::size_t length, uint32_t value)
+            : _address(address), _length(length), _value(value)
+        { }
+    public: // --- operations ---
+        auto address() const -> const ipv4::endpoint& { return _address; }
+        auto length() const -> std::size_t { return _length; }
+        auto value() const -> uint32_t { return _value; }
+    };
+
+
+    // holder of a table for concurrent lookups and replacements
+    class ipv4::prefix_table::atomic final
+    {
+    public: // --- scope ---
+        using self = atomic;
+    private: // --- state ---
+        std::shared_ptr<const impl> _impl;
+    public: // --- life ---
+        explicit atomic(const prefix_table& table);
+        atomic(const self& rhs) = delete;
+        atomic(self&& rhs) noexcept = delete;
+        ~atomic() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        auto load() const noexcept -> prefix_table;
+        void store(const prefix_table& table) noexcept;
+    };
+
+
     class ipv6 final
     {
     public: // --- scope ---
         class endpoint;
+        class prefix_table;
     };
 
 
@@ -68,6 +162,10 @@ namespace up_inet
         class order;
         static const self any;
         static const self loopback;
+        // maximal size of the text representation
+        static const constexpr std::size_t max_size = 45;
+        // returns nullopt for invalid addresses
+        static auto parse(const up::string_view& value) noexcept -> up::optional<self>;
     private: // --- state ---
         uint8_t _data[16];
     public: // --- life ---
@@ -77,6 +175,10 @@ namespace up_inet
         explicit endpoint(const up::string_view& value);
     public: // --- operations ---
         auto to_string() const -> up::unique_string;
+        // writes at most max_size chars, and returns the number of chars
+        auto format(char* result) const noexcept -> std::size_t;
+        // appends to the buffer
+        void format(up::buffer& buffer) const;
     };
 
 
@@ -90,6 +192,77 @@ namespace up_inet
     };
 
 
+    // same as ipv4::prefix_table (with prefix lengths up to 128)
+    class ipv6::prefix_table final
+    {
+    public: // --- scope ---
+        using self = prefix_table;
+        class entry;
+        class atomic;
+        class impl;
+        static const constexpr uint32_t npos = uint32_t(-1);
+    private: // --- state ---
+        std::shared_ptr<const impl> _impl;
+    public: // --- life ---
+        prefix_table() noexcept = default;
+        // throws for prefix lengths above 128 and values equal to npos
+        explicit prefix_table(const std::vector<entry>& entries);
+    private:
+        explicit prefix_table(std::shared_ptr<const impl> impl) noexcept;
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        // number of distinct prefixes
+        auto size() const noexcept -> std::size_t;
+        // value of the longest matching prefix, or npos
+        auto find(const ipv6::endpoint& endpoint) const noexcept -> uint32_t;
+    };
+
+
+    class ipv6::prefix_table::entry final
+    {
+    private: // --- state ---
+        ipv6::endpoint _address;
+        std::size_t _length;
+        uint32_t _value;
+    public: // --- life ---
+        explicit entry(const ipv6::endpoint& address, std::size_t length, uint32_t value)
+            : _address(address), _length(length), _value(value)
+        { }
+    public: // --- operations ---
+        auto address() const -> const ipv6::endpoint& { return _address; }
+        auto length() const -> std::size_t { return _length; }
+        auto value() const -> uint32_t { return _value; }
+    };
+
+
+    // holder of a table for concurrent lookups and replacements
+    class ipv6::prefix_table::atomic final
+    {
+    public: // --- scope ---
+        using self = atomic;
+    private: // --- state ---
+        std::shared_ptr<const impl> _impl;
+    public: // --- life ---
+        explicit atomic(const prefix_table& table);
+        atomic(const self& rhs) = delete;
+        atomic(self&& rhs) noexcept = delete;
+        ~atomic() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        auto load() const noexcept -> prefix_table;
+        void store(const prefix_table& table) noexcept;
+    };
+
+
     class ip final
     {
     public: // --- scope ---
@@ -108,6 +281,7 @@ namespace up_inet
     public: // --- scope ---
         using self = endpoint;
         class accessor;
+        static const constexpr std::size_t max_size = ipv6::endpoint::max_size;
     private: // --- state ---
         union
         {
@@ -129,6 +303,10 @@ namespace up_inet
         auto operator=(const ipv4::endpoint& rhs) & -> self&;
         auto operator=(const ipv6::endpoint& rhs) & -> self&;
         auto to_string() const -> up::unique_string;
+        // writes at most max_size chars, and returns the number of chars
+        auto format(char* result) const noexcept -> std::size_t;
+        // appends to the buffer
+        void format(up::buffer& buffer) const;
         auto version() const noexcept -> ip::version;
         explicit operator const ipv4::endpoint&() const;
         explicit operator const ipv6::endpoint&() const;
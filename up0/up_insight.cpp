@@ -1,18 +1,148 @@
 #include "up_insight.hpp"
 
+#include <typeindex>
+#include <unordered_map>
+
+#include "up_char_cast.hpp"
 #include "up_out.hpp"
 #include "up_utility.hpp"
+#include "up_vlq.hpp"
+
+namespace
+{
+
+    auto display_name(const std::type_info& type_info) -> up::string_view
+    {
+        // demangling is expensive, and the number of types is small
+        static thread_local std::unordered_map<std::type_index, up::unique_string> cache;
+        auto p = cache.find(type_info);
+        if (p == cache.end()) {
+            p = cache.emplace(type_info, up::type_display_name(type_info)).first;
+        }
+        return p->second;
+    }
+
+
+    void write_vlq(up::sink& s, std::size_t value)
+    {
+        auto&& encoded = up::vlq::encode(uint64_t(value));
+        s.write(up::char_cast<char>(std::get<1>(encoded).data()), std::get<0>(encoded));
+    }
+
+    void write_binary(up::sink& s, up::string_view value)
+    {
+        write_vlq(s, value.size());
+        s.write(value.data(), value.size());
+    }
+
+
+    // length of the valid UTF-8 sequence at the beginning (or zero)
+    auto utf8_length(const unsigned char* p, const unsigned char* q) -> std::size_t
+    {
+        unsigned char c = *p, lo = 0x80, hi = 0xbf;
+        std::size_t n;
+        if (c < 0x80) {
+            return 1;
+        } else if (c < 0xc2) {
+            return 0;
+        } else if (c < 0xe0) {
+            n = 2;
+        } else if (c < 0xf0) {
+            n = 3;
+            lo = c == 0xe0 ? 0xa0 : lo; // overlong
+            hi = c == 0xed ? 0x9f : hi; // surrogates
+        } else if (c < 0xf5) {
+            n = 4;
+            lo = c == 0xf0 ? 0x90 : lo; // overlong
+            hi = c == 0xf4 ? 0x8f : hi; // beyond U+10FFFF
+        } else {
+            return 0;
+        }
+        if (std::size_t(q - p) < n || p[1] < lo || p[1] > hi) {
+            return 0;
+        }
+        for (std::size_t i = 2; i != n; ++i) {
+            if ((p[i] & 0xc0) != 0x80) {
+                return 0;
+            }
+        }
+        return n;
+    }
 
+    void write_json(up::sink& s, up::string_view value)
+    {
+        static const char hex[] = "0123456789abcdef";
+        auto begin = up::char_cast<unsigned char>(value.data());
+        auto p = begin, q = begin + value.size();
+        s.put('"');
+        while (p != q) {
+            unsigned char c = *p;
+            std::size_t n = 1;
+            if (c < 0x80 ? c >= 0x20 && c != '"' && c != '\\' : (n = utf8_length(p, q)) != 0) {
+                p += n;
+                continue;
+            }
+            s.write(up::char_cast<char>(begin), std::size_t(p - begin));
+            if (c == '"' || c == '\\') {
+                up::out(s, '\\', char(c));
+            } else if (c == '\n') {
+                up::out(s, "\\n");
+            } else if (c == '\r') {
+                up::out(s, "\\r");
+            } else if (c == '\t') {
+                up::out(s, "\\t");
+            } else if (c < 0x20) {
+                up::out(s, "\\u00", hex[c >> 4], hex[c & 0xf]);
+            } else {
+                up::out(s, "\\ufffd");
+            }
+            begin = ++p;
+        }
+        s.write(up::char_cast<char>(begin), std::size_t(p - begin));
+        s.put('"');
+    }
+
+}
+
+
+void up_insight::insight::out(up::sink& s) const
+{
+    up::out(s, display_name(_type_info), ':', _value);
+    auto p = _nested.begin(), q = _nested.end();
+    if (p != q) {
+        up::out(s, '{', *p);
+        for (++p; p != q; ++p) {
+            up::out(s, ',', *p);
+        }
+        up::out(s, '}');
+    }
+}
+
+void up_insight::insight::to_binary(up::sink& s) const
+{
+    write_binary(s, display_name(_type_info));
+    write_binary(s, _value);
+    write_vlq(s, _nested.size());
+    for (auto&& nested : _nested) {
+        nested.to_binary(s);
+    }
+}
 
-void up_insight::insight::out(std::ostream& os) const
+void up_insight::insight::to_json(up::sink& s) const
 {
-    up::out(os, up::type_display_name(_type_info), ':', _value);
+    up::out(s, "{\"type\":");
+    write_json(s, display_name(_type_info));
+    up::out(s, ",\"value\":");
+    write_json(s, _value);
     auto p = _nested.begin(), q = _nested.end();
     if (p != q) {
-        up::out(os, '{', *p);
+        up::out(s, ",\"nested\":[");
+        p->to_json(s);
         for (++p; p != q; ++p) {
-            up::out(os, ',', *p);
+            s.put(',');
+            p->to_json(s);
         }
-        up::out(os, '}');
+        s.put(']');
     }
+    s.put('}');
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "up_sink.hpp"
 #include "up_string.hpp"
 #include "up_to_string.hpp"
 
@@ -35,13 +36,28 @@ namespace up_insight
             , _value(std::forward<Value>(value))
             , _nested{std::forward<Insights>(nested)...}
         { }
+        // for a variable number of nested insights
+        template <typename Value>
+        explicit insight(const std::type_info& type_info, Value&& value, insights nested)
+            : _type_info(type_info)
+            , _value(std::forward<Value>(value))
+            , _nested(std::move(nested))
+        { }
     public: // --- operations ---
         auto type_info() const -> auto& { return _type_info; }
         auto value() const -> auto& { return _value; }
         auto nested() const -> auto& { return _nested; }
         auto to_insight() const& -> auto& { return *this; }
         auto to_insight() && -> insight&& { return std::move(*this); }
-        void out(std::ostream& os) const;
+        void out(up::sink& s) const;
+        /* Compact binary encoding, that contains for each insight the
+         * display name of the type, the value and the number of nested
+         * insights (prefixed by their lengths as up::vlq), followed by the
+         * nested insights. */
+        void to_binary(up::sink& s) const;
+        /* JSON object with the members "type", "value" and "nested" (only if
+         * not empty). Invalid UTF-8 sequences are replaced by U+FFFD. */
+        void to_json(up::sink& s) const;
     };
 
 
@@ -1,5 +1,7 @@
 #include "up_json.hpp"
 
+#include <mutex>
+
 
 class up_json::json::value::impl
 {
@@ -48,26 +50,530 @@ namespace
         { }
     };
 
-    class impl_array : public up_json::json::value::impl
+    using up_json::json;
+
+    // arrays and objects up to this size keep the flat representation
+    const constexpr std::size_t flat_size = 32;
+
+    const constexpr std::size_t trie_bits = 5;
+    const constexpr std::size_t trie_width = std::size_t(1) << trie_bits;
+    const constexpr std::size_t trie_mask = trie_width - 1;
+
+
+    // inner nodes only contain children, and leaf nodes only contain values
+    class vector_node final
+    {
+    public: // --- state ---
+        std::vector<std::shared_ptr<const vector_node>> _children;
+        json::array _values;
+    };
+
+    using vector_node_ptr = std::shared_ptr<const vector_node>;
+
+
+    /* Persistent vector based on a radix-balanced trie. Elements are only
+     * appended, so that the trie is always densely filled from the left
+     * (i.e. the relaxed variant is not required). */
+    class persistent_vector final
+    {
+    private: // --- state ---
+        vector_node_ptr _root;
+        std::size_t _size = 0;
+        std::size_t _shift = 0; // zero if the root is a leaf
+    public: // --- life ---
+        explicit persistent_vector(const json::array& values)
+        {
+            std::vector<vector_node_ptr> level;
+            for (std::size_t i = 0; i < values.size(); i += trie_width) {
+                auto node = std::make_shared<vector_node>();
+                auto last = std::min(values.size(), i + trie_width);
+                node->_values.assign(values.begin() + i, values.begin() + last);
+                level.push_back(std::move(node));
+            }
+            for (; level.size() > 1; _shift += trie_bits) {
+                std::vector<vector_node_ptr> parents;
+                for (std::size_t i = 0; i < level.size(); i += trie_width) {
+                    auto node = std::make_shared<vector_node>();
+                    auto last = std::min(level.size(), i + trie_width);
+                    node->_children.assign(level.begin() + i, level.begin() + last);
+                    parents.push_back(std::move(node));
+                }
+                level.swap(parents);
+            }
+            _root = level.empty() ? std::make_shared<vector_node>() : level.front();
+            _size = values.size();
+        }
+    public: // --- operations ---
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        auto at(std::size_t index) const -> const json::value&
+        {
+            auto node = _root.get();
+            for (auto shift = _shift; shift != 0; shift -= trie_bits) {
+                node = node->_children[(index >> shift) & trie_mask].get();
+            }
+            return node->_values[index & trie_mask];
+        }
+        auto with(std::size_t index, json::value value) const -> persistent_vector
+        {
+            auto result = *this;
+            if (index == _size) {
+                if (_size == trie_width << _shift) {
+                    // the trie is full, so that it grows by one level
+                    auto root = std::make_shared<vector_node>();
+                    root->_children.push_back(std::move(result._root));
+                    result._root = std::move(root);
+                    result._shift += trie_bits;
+                }
+                result._root = _append(result._root, result._shift, index, std::move(value));
+                ++result._size;
+            } else {
+                result._root = _assign(_root, _shift, index, std::move(value));
+            }
+            return result;
+        }
+        void materialize(json::array& values) const
+        {
+            values.reserve(_size);
+            _materialize(*_root, values);
+        }
+    private:
+        static auto _assign(const vector_node_ptr& node, std::size_t shift, std::size_t index, json::value&& value)
+            -> vector_node_ptr
+        {
+            auto result = std::make_shared<vector_node>(*node);
+            if (shift == 0) {
+                result->_values[index & trie_mask] = std::move(value);
+            } else {
+                auto&& child = result->_children[(index >> shift) & trie_mask];
+                child = _assign(child, shift - trie_bits, index, std::move(value));
+            }
+            return result;
+        }
+        static auto _append(const vector_node_ptr& node, std::size_t shift, std::size_t index, json::value&& value)
+            -> vector_node_ptr
+        {
+            auto result = node ? std::make_shared<vector_node>(*node) : std::make_shared<vector_node>();
+            if (shift == 0) {
+                result->_values.push_back(std::move(value));
+            } else {
+                auto position = (index >> shift) & trie_mask;
+                if (position == result->_children.size()) {
+                    result->_children.push_back(_append(nullptr, shift - trie_bits, index, std::move(value)));
+                } else {
+                    auto&& child = result->_children[position];
+                    child = _append(child, shift - trie_bits, index, std::move(value));
+                }
+            }
+            return result;
+        }
+        static void _materialize(const vector_node& node, json::array& values)
+        {
+            values.insert(values.end(), node._values.begin(), node._values.end());
+            for (auto&& child : node._children) {
+                _materialize(*child, values);
+            }
+        }
+    };
+
+
+    class map_entry final
+    {
+    public: // --- state ---
+        std::size_t _hash;
+        up::shared_string _key;
+        json::value _value;
+        std::size_t _order; // for restoring the insertion order
+    public: // --- life ---
+        explicit map_entry(std::size_t hash, up::shared_string key, json::value value, std::size_t order)
+            : _hash(hash), _key(std::move(key)), _value(std::move(value)), _order(order)
+        { }
+    };
+
+    using map_entry_ptr = std::shared_ptr<const map_entry>;
+
+    class map_node;
+    using map_node_ptr = std::shared_ptr<const map_node>;
+
+    // contains either a child or an entry
+    class map_slot final
+    {
+    public: // --- state ---
+        map_node_ptr _child;
+        map_entry_ptr _entry;
+    };
+
+    /* The bitmap indicates which of the (up to 32) slots for the next bits
+     * of the hash value are present. Nodes below the last bits of the hash
+     * value contain colliding entries without a bitmap. */
+    class map_node final
+    {
+    public: // --- state ---
+        std::uint32_t _bitmap = 0;
+        std::vector<map_slot> _slots;
+    };
+
+
+    /* Persistent hash map based on a hash array mapped trie. The entries
+     * are numbered consecutively, so that materialization can restore the
+     * order of the linked_map. */
+    class persistent_map final
+    {
+    private: // --- scope ---
+        static const constexpr std::size_t hash_bits = std::numeric_limits<std::size_t>::digits;
+    private: // --- state ---
+        map_node_ptr _root;
+        std::size_t _size = 0;
+        std::size_t _order = 0;
+    public: // --- life ---
+        explicit persistent_map(const json::object& values)
+        {
+            for (auto&& pair : values) {
+                *this = with(pair.first, pair.second);
+            }
+        }
+    public: // --- operations ---
+        auto size() const noexcept -> std::size_t
+        {
+            return _size;
+        }
+        auto find(up::string_view key) const -> const json::value*
+        {
+            auto entry = _find(std::hash<up::string_view>()(key), key);
+            return entry ? &entry->_value : nullptr;
+        }
+        auto with(up::shared_string key, json::value value) const -> persistent_map
+        {
+            auto hash = key.hash();
+            auto result = *this;
+            auto order = _order;
+            if (auto entry = _find(hash, key)) {
+                order = entry->_order;
+            } else {
+                ++result._size;
+                ++result._order;
+            }
+            auto entry = std::make_shared<const map_entry>(hash, std::move(key), std::move(value), order);
+            result._root = _insert(_root, 0, std::move(entry));
+            return result;
+        }
+        auto without(up::string_view key) const -> persistent_map
+        {
+            auto hash = std::hash<up::string_view>()(key);
+            auto result = *this;
+            if (_find(hash, key)) {
+                result._root = _erase(*_root, 0, hash, key);
+                --result._size;
+            } // else: nothing
+            return result;
+        }
+        void materialize(json::object& values) const
+        {
+            std::vector<const map_entry*> entries;
+            entries.reserve(_size);
+            if (_root) {
+                _collect(*_root, entries);
+            }
+            std::sort(entries.begin(), entries.end(),
+                [](const map_entry* lhs, const map_entry* rhs) { return lhs->_order < rhs->_order; });
+            for (auto&& entry : entries) {
+                values.emplace(entry->_key, entry->_value);
+            }
+        }
+    private:
+        static auto _index(std::size_t hash, std::size_t shift) noexcept -> std::uint32_t
+        {
+            return std::uint32_t(1) << ((hash >> shift) & trie_mask);
+        }
+        static auto _position(const map_node& node, std::uint32_t bit) noexcept -> std::size_t
+        {
+            return __builtin_popcount(node._bitmap & (bit - 1));
+        }
+        static bool _matches(const map_entry& entry, std::size_t hash, up::string_view key) noexcept
+        {
+            return entry._hash == hash && up::string_view(entry._key) == key;
+        }
+        auto _find(std::size_t hash, up::string_view key) const -> const map_entry*
+        {
+            auto node = _root.get();
+            for (std::size_t shift = 0; node; shift += trie_bits) {
+                if (shift >= hash_bits) {
+                    for (auto&& slot : node->_slots) {
+                        if (_matches(*slot._entry, hash, key)) {
+                            return slot._entry.get();
+                        }
+                    }
+                    return nullptr;
+                }
+                auto bit = _index(hash, shift);
+                if ((node->_bitmap & bit) == 0) {
+                    return nullptr;
+                }
+                auto&& slot = node->_slots[_position(*node, bit)];
+                if (slot._child) {
+                    node = slot._child.get();
+                } else {
+                    return _matches(*slot._entry, hash, key) ? slot._entry.get() : nullptr;
+                }
+            }
+            return nullptr;
+        }
+        static auto _insert(const map_node_ptr& node, std::size_t shift, map_entry_ptr&& entry) -> map_node_ptr
+        {
+            auto result = node ? std::make_shared<map_node>(*node) : std::make_shared<map_node>();
+            if (shift >= hash_bits) {
+                for (auto&& slot : result->_slots) {
+                    if (_matches(*slot._entry, entry->_hash, entry->_key)) {
+                        slot._entry = std::move(entry);
+                        return result;
+                    }
+                }
+                result->_slots.push_back({nullptr, std::move(entry)});
+                return result;
+            }
+            auto bit = _index(entry->_hash, shift);
+            auto position = result->_slots.begin() + _position(*result, bit);
+            if ((result->_bitmap & bit) == 0) {
+                result->_bitmap |= bit;
+                result->_slots.insert(position, {nullptr, std::move(entry)});
+            } else if (position->_child) {
+                position->_child = _insert(position->_child, shift + trie_bits, std::move(entry));
+            } else if (_matches(*position->_entry, entry->_hash, entry->_key)) {
+                position->_entry = std::move(entry);
+            } else {
+                // both entries move one level down
+                auto child = _insert(nullptr, shift + trie_bits, std::move(position->_entry));
+                position->_child = _insert(child, shift + trie_bits, std::move(entry));
+            }
+            return result;
+        }
+        // returns nullptr if the node becomes empty
+        static auto _erase(const map_node& node, std::size_t shift, std::size_t hash, up::string_view key)
+            -> map_node_ptr
+        {
+            auto result = std::make_shared<map_node>(node);
+            if (shift >= hash_bits) {
+                auto position = std::find_if(result->_slots.begin(), result->_slots.end(),
+                    [&](const map_slot& slot) { return _matches(*slot._entry, hash, key); });
+                result->_slots.erase(position);
+            } else {
+                auto bit = _index(hash, shift);
+                auto position = result->_slots.begin() + _position(*result, bit);
+                auto child = position->_child
+                    ? _erase(*position->_child, shift + trie_bits, hash, key)
+                    : nullptr;
+                if (!child) {
+                    result->_bitmap &= ~bit;
+                    result->_slots.erase(position);
+                } else if (child->_slots.size() == 1 && !child->_slots.front()._child) {
+                    // a single remaining entry moves one level up
+                    *position = {nullptr, child->_slots.front()._entry};
+                } else {
+                    position->_child = std::move(child);
+                }
+            }
+            return result->_slots.empty() ? nullptr : map_node_ptr(std::move(result));
+        }
+        static void _collect(const map_node& node, std::vector<const map_entry*>& entries)
+        {
+            for (auto&& slot : node._slots) {
+                if (slot._child) {
+                    _collect(*slot._child, entries);
+                } else {
+                    entries.push_back(slot._entry.get());
+                }
+            }
+        }
+    };
+
+
+    class impl_array_base : public up_json::json::value::impl
+    {
+    public: // --- life ---
+        explicit impl_array_base()
+            : impl(up_json::json::kind::array)
+        { }
+    public: // --- operations ---
+        virtual auto size() const -> std::size_t = 0;
+        virtual auto at(std::size_t index) const -> const json::value& = 0;
+        virtual auto values() const -> const json::array& = 0;
+        virtual auto with(std::size_t index, json::value value) const -> std::shared_ptr<const impl> = 0;
+    };
+
+    class impl_array final : public impl_array_base
     {
     public: // --- state ---
         up_json::json::array _values;
     public: // --- life ---
         explicit impl_array(up_json::json::array values)
-            : impl(up_json::json::kind::array), _values(std::move(values))
+            : _values(std::move(values))
+        { }
+    public: // --- operations ---
+        auto size() const -> std::size_t override
+        {
+            return _values.size();
+        }
+        auto at(std::size_t index) const -> const json::value& override
+        {
+            return _values[index];
+        }
+        auto values() const -> const json::array& override
+        {
+            return _values;
+        }
+        auto with(std::size_t index, json::value value) const -> std::shared_ptr<const impl> override;
+    };
+
+    class impl_persistent_array final : public impl_array_base
+    {
+    public: // --- state ---
+        persistent_vector _values;
+        mutable std::once_flag _materialized;
+        mutable up_json::json::array _cache;
+    public: // --- life ---
+        explicit impl_persistent_array(persistent_vector values)
+            : _values(std::move(values))
+        { }
+    public: // --- operations ---
+        auto size() const -> std::size_t override
+        {
+            return _values.size();
+        }
+        auto at(std::size_t index) const -> const json::value& override
+        {
+            return _values.at(index);
+        }
+        auto values() const -> const json::array& override
+        {
+            std::call_once(_materialized, [this]() { _values.materialize(_cache); });
+            return _cache;
+        }
+        auto with(std::size_t index, json::value value) const -> std::shared_ptr<const impl> override
+        {
+            return std::make_shared<const impl_persistent_array>(_values.with(index, std::move(value)));
+        }
+    };
+
+    auto impl_array::with(std::size_t index, json::value value) const -> std::shared_ptr<const impl>
+    {
+        if (_values.size() + (index == _values.size()) > flat_size) {
+            return std::make_shared<const impl_persistent_array>(persistent_vector(_values).with(index, std::move(value)));
+        }
+        auto values = _values;
+        if (index == values.size()) {
+            values.push_back(std::move(value));
+        } else {
+            values[index] = std::move(value);
+        }
+        return std::make_shared<const impl_array>(std::move(values));
+    }
+
+
+    class impl_object_base : public up_json::json::value::impl
+    {
+    public: // --- life ---
+        explicit impl_object_base()
+            : impl(up_json::json::kind::object)
         { }
+    public: // --- operations ---
+        virtual auto size() const -> std::size_t = 0;
+        virtual auto find(up::string_view key) const -> const json::value* = 0;
+        virtual auto values() const -> const json::object& = 0;
+        virtual auto with(up::shared_string key, json::value value) const -> std::shared_ptr<const impl> = 0;
+        virtual auto without(up::string_view key) const -> std::shared_ptr<const impl> = 0;
     };
 
-    class impl_object : public up_json::json::value::impl
+    class impl_object final : public impl_object_base
     {
     public: // --- state ---
         up_json::json::object _values;
     public: // --- life ---
         explicit impl_object(up_json::json::object values)
-            : impl(up_json::json::kind::object), _values(std::move(values))
+            : _values(std::move(values))
         { }
+    public: // --- operations ---
+        auto size() const -> std::size_t override
+        {
+            return _values.size();
+        }
+        auto find(up::string_view key) const -> const json::value* override
+        {
+            auto position = _values.find(key);
+            return position == _values.end() ? nullptr : &position->second;
+        }
+        auto values() const -> const json::object& override
+        {
+            return _values;
+        }
+        auto with(up::shared_string key, json::value value) const -> std::shared_ptr<const impl> override;
+        auto without(up::string_view key) const -> std::shared_ptr<const impl> override;
+    };
+
+    class impl_persistent_object final : public impl_object_base
+    {
+    public: // --- state ---
+        persistent_map _values;
+        mutable std::once_flag _materialized;
+        mutable up_json::json::object _cache;
+    public: // --- life ---
+        explicit impl_persistent_object(persistent_map values)
+            : _values(std::move(values))
+        { }
+    public: // --- operations ---
+        auto size() const -> std::size_t override
+        {
+            return _values.size();
+        }
+        auto find(up::string_view key) const -> const json::value* override
+        {
+            return _values.find(key);
+        }
+        auto values() const -> const json::object& override
+        {
+            std::call_once(_materialized, [this]() { _values.materialize(_cache); });
+            return _cache;
+        }
+        auto with(up::shared_string key, json::value value) const -> std::shared_ptr<const impl> override
+        {
+            return std::make_shared<const impl_persistent_object>(_values.with(std::move(key), std::move(value)));
+        }
+        auto without(up::string_view key) const -> std::shared_ptr<const impl> override
+        {
+            return std::make_shared<const impl_persistent_object>(_values.without(key));
+        }
     };
 
+    auto impl_object::with(up::shared_string key, json::value value) const -> std::shared_ptr<const impl>
+    {
+        auto position = _values.find(key);
+        if (_values.size() + (position == _values.end()) > flat_size) {
+            return std::make_shared<const impl_persistent_object>(
+                persistent_map(_values).with(std::move(key), std::move(value)));
+        }
+        auto values = _values;
+        if (position == _values.end()) {
+            values.emplace(std::move(key), std::move(value));
+        } else {
+            values.find(key)->second = std::move(value);
+        }
+        return std::make_shared<const impl_object>(std::move(values));
+    }
+
+    auto impl_object::without(up::string_view key) const -> std::shared_ptr<const impl>
+    {
+        if (_values.size() > flat_size) {
+            return std::make_shared<const impl_persistent_object>(persistent_map(_values).without(key));
+        }
+        auto values = _values;
+        auto position = values.find(key);
+        if (position != values.end()) {
+            values.erase(position);
+        } // else: nothing
+        return std::make_shared<const impl_object>(std::move(values));
+    }
+
     template <typename Type>
     auto cast(const std::shared_ptr<const up_json::json::value::impl>& impl)
         -> decltype(auto)
@@ -82,6 +588,10 @@ namespace
 }
 
 
+up_json::json::value::value(std::shared_ptr<const impl> impl)
+    : _impl(std::move(impl))
+{ }
+
 up_json::json::value::value(std::nullptr_t unused __attribute__((unused)))
     : _impl()
 { }
@@ -136,10 +646,52 @@ auto up_json::json::value::get_string() const -> const up::shared_string&
 
 auto up_json::json::value::get_array() const -> const array&
 {
-    return cast<impl_array>(_impl)._values;
+    return cast<impl_array_base>(_impl).values();
 }
 
 auto up_json::json::value::get_object() const -> const object&
 {
-    return cast<impl_object>(_impl)._values;
+    return cast<impl_object_base>(_impl).values();
+}
+
+auto up_json::json::value::get_size() const -> std::size_t
+{
+    if (get_kind() == kind::array) {
+        return cast<impl_array_base>(_impl).size();
+    } else {
+        return cast<impl_object_base>(_impl).size();
+    }
+}
+
+auto up_json::json::value::get_element(std::size_t index) const -> const value&
+{
+    auto&& array = cast<impl_array_base>(_impl);
+    if (index >= array.size()) {
+        throw up::make_throwable<std::out_of_range>("up-json-index");
+    }
+    return array.at(index);
+}
+
+auto up_json::json::value::find_member(up::string_view key) const -> const value*
+{
+    return cast<impl_object_base>(_impl).find(key);
+}
+
+auto up_json::json::value::with_index(std::size_t index, value value) const -> self
+{
+    auto&& array = cast<impl_array_base>(_impl);
+    if (index > array.size()) {
+        throw up::make_throwable<std::out_of_range>("up-json-index");
+    }
+    return self(array.with(index, std::move(value)));
+}
+
+auto up_json::json::value::with(up::shared_string key, value value) const -> self
+{
+    return self(cast<impl_object_base>(_impl).with(std::move(key), std::move(value)));
+}
+
+auto up_json::json::value::without(up::string_view key) const -> self
+{
+    return self(cast<impl_object_base>(_impl).without(key));
 }
@@ -18,9 +18,12 @@ namespace up_json
     public: // --- scope ---
         enum class kind : uint8_t;
         class value;
+        class key_hash;
+        class key_equal;
         using array = std::vector<value>;
-        using object = up::linked_map<up::shared_string, value>;
+        using object = up::linked_map<up::shared_string, value, key_hash, key_equal>;
         class builder;
+        class token;
     };
 
 
@@ -35,8 +38,46 @@ namespace up_json
     };
 
 
+    // transparent, so that members can be looked up with views
+    class json::key_hash final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        auto operator()(const up::shared_string& key) const noexcept -> std::size_t
+        {
+            return key.hash();
+        }
+        auto operator()(const up::string_view& key) const noexcept -> std::size_t
+        {
+            return std::hash<up::string_view>()(key);
+        }
+    };
+
+
+    class json::key_equal final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        bool operator()(const up::string_view& lhs, const up::string_view& rhs) const noexcept
+        {
+            return lhs == rhs;
+        }
+    };
+
+
     /**
      * Immutable class to represent JSON.
+     *
+     * The update operations return new values. Small arrays and objects are
+     * copied, and larger ones are converted to persistent structures (a
+     * radix-balanced trie for arrays, and a hash array mapped trie for
+     * objects), so that the updated value shares all unchanged parts with
+     * the original value, and each update only takes logarithmic time. The
+     * element and member accessors work on both representations, whereas
+     * get_array and get_object materialize persistent structures on first
+     * use (in insertion order for objects).
      */
     class json::value final
     {
@@ -47,7 +88,9 @@ namespace up_json
         /* TODO: The implementation is not yet optimized for keeping the
          * memory usage low. */
         std::shared_ptr<const impl> _impl;
-    public: // --- life ---
+    private: // --- life ---
+        explicit value(std::shared_ptr<const impl> impl);
+    public:
         // implicit
         value(std::nullptr_t);
         // implicit
@@ -82,6 +125,16 @@ namespace up_json
         auto get_string() const -> const up::shared_string&;
         auto get_array() const -> const array&;
         auto get_object() const -> const object&;
+        // number of elements of an array or members of an object
+        auto get_size() const -> std::size_t;
+        auto get_element(std::size_t index) const -> const value&;
+        // returns nullptr if the object has no such member
+        auto find_member(up::string_view key) const -> const value*;
+        // replaces or appends (if index equals the size) an element
+        auto with_index(std::size_t index, value value) const -> self;
+        // replaces (at the same position) or appends a member
+        auto with(up::shared_string key, value value) const -> self;
+        auto without(up::string_view key) const -> self;
         template <typename Visitor>
         auto accept(Visitor&& visitor) const
         {
@@ -107,6 +160,67 @@ namespace up_json
     };
 
 
+    /**
+     * Element of a streaming representation of JSON, e.g. for validating
+     * documents without building values. Strings and keys are not owned by
+     * the token.
+     */
+    class json::token final
+    {
+    public: // --- scope ---
+        using self = token;
+        enum class kind : uint8_t
+        {
+            begin_array,
+            end_array,
+            begin_object,
+            end_object,
+            key,
+            null,
+            boolean,
+            number,
+            string,
+        };
+    private: // --- state ---
+        kind _kind;
+        bool _boolean = false;
+        double _number = 0.0;
+        up::string_view _string;
+    public: // --- life ---
+        // for structural tokens and null
+        explicit token(kind kind) noexcept
+            : _kind(kind)
+        { }
+        explicit token(bool value) noexcept
+            : _kind(kind::boolean), _boolean(value)
+        { }
+        explicit token(double value) noexcept
+            : _kind(kind::number), _number(value)
+        { }
+        // for keys and strings
+        explicit token(kind kind, up::string_view value) noexcept
+            : _kind(kind), _string(value)
+        { }
+    public: // --- operations ---
+        auto get_kind() const noexcept -> kind
+        {
+            return _kind;
+        }
+        auto get_boolean() const noexcept -> bool
+        {
+            return _boolean;
+        }
+        auto get_number() const noexcept -> double
+        {
+            return _number;
+        }
+        auto get_string() const noexcept -> up::string_view
+        {
+            return _string;
+        }
+    };
+
+
     class json::builder final
     {
     public: // --- scope ---
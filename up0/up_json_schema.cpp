@@ -0,0 +1,1513 @@
+#include "up_json_schema.hpp"
+
+#include <bitset>
+#include <cctype>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+
+#include "up_exception.hpp"
+#include "up_keyword_switch.hpp"
+
+
+namespace
+{
+
+    using up_json::json;
+    using token = json::token;
+    using status = up_json_schema::json_schema::status;
+
+    const constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+
+    // subset of code points: ASCII characters and (all or none) others
+    class char_set final
+    {
+    public: // --- state ---
+        std::bitset<128> _ascii;
+        bool _others = false;
+    public: // --- operations ---
+        void add(unsigned lo, unsigned hi)
+        {
+            for (auto c = lo; c <= hi; ++c) {
+                _ascii.set(c);
+            }
+        }
+        void merge(const char_set& rhs)
+        {
+            _ascii |= rhs._ascii;
+            _others = _others || rhs._others;
+        }
+        void negate()
+        {
+            _ascii.flip();
+            _others = !_others;
+        }
+    };
+
+
+    // Thompson automaton on bytes, built from fragments with a single end state
+    class nfa final
+    {
+    public: // --- scope ---
+        class state final
+        {
+        public: // --- state ---
+            unsigned _lo = 1;
+            unsigned _hi = 0; // empty range: no byte transition
+            std::size_t _next = none;
+            std::size_t _epsilon0 = none;
+            std::size_t _epsilon1 = none;
+        };
+        class fragment final
+        {
+        public: // --- state ---
+            std::size_t _begin;
+            std::size_t _end;
+        };
+    public: // --- state ---
+        std::vector<state> _states;
+    public: // --- operations ---
+        auto empty() -> fragment
+        {
+            auto s = _make();
+            return {s, s};
+        }
+        auto range(unsigned lo, unsigned hi) -> fragment
+        {
+            auto b = _make();
+            auto e = _make();
+            _states[b]._lo = lo;
+            _states[b]._hi = hi;
+            _states[b]._next = e;
+            return {b, e};
+        }
+        auto concat(fragment lhs, fragment rhs) -> fragment
+        {
+            _link(lhs._end, rhs._begin);
+            return {lhs._begin, rhs._end};
+        }
+        auto alternate(fragment lhs, fragment rhs) -> fragment
+        {
+            auto b = _make();
+            auto e = _make();
+            _link(b, lhs._begin);
+            _link(b, rhs._begin);
+            _link(lhs._end, e);
+            _link(rhs._end, e);
+            return {b, e};
+        }
+        auto star(fragment f) -> fragment
+        {
+            auto b = _make();
+            auto e = _make();
+            _link(b, f._begin);
+            _link(b, e);
+            _link(f._end, f._begin);
+            _link(f._end, e);
+            return {b, e};
+        }
+        auto plus(fragment f) -> fragment
+        {
+            auto e = _make();
+            _link(f._end, f._begin);
+            _link(f._end, e);
+            return {f._begin, e};
+        }
+        auto optional(fragment f) -> fragment
+        {
+            auto b = _make();
+            auto e = _make();
+            _link(b, f._begin);
+            _link(b, e);
+            _link(f._end, e);
+            return {b, e};
+        }
+        auto set(const char_set& chars) -> fragment
+        {
+            up::optional<fragment> result;
+            auto add = [&](fragment f) {
+                result = result ? alternate(*result, f) : f;
+            };
+            for (unsigned c = 0; c != 128; ) {
+                if (chars._ascii.test(c)) {
+                    auto lo = c;
+                    while (c != 128 && chars._ascii.test(c)) {
+                        ++c;
+                    }
+                    add(range(lo, c - 1));
+                } else {
+                    ++c;
+                }
+            }
+            if (chars._others) {
+                // well-formed multi-byte sequences (without checking overlongs and surrogates)
+                auto tail = [this]() { return range(0x80, 0xbf); };
+                add(concat(range(0xc2, 0xdf), tail()));
+                add(concat(concat(range(0xe0, 0xef), tail()), tail()));
+                add(concat(concat(concat(range(0xf0, 0xf4), tail()), tail()), tail()));
+            }
+            return result ? *result : range(1, 0);
+        }
+        auto code_point(std::uint32_t value) -> fragment
+        {
+            if (value < 0x80) {
+                return range(value, value);
+            }
+            char buffer[4];
+            std::size_t size;
+            if (value < 0x800) {
+                buffer[0] = char(0xc0 | (value >> 6));
+                size = 2;
+            } else if (value < 0x10000) {
+                buffer[0] = char(0xe0 | (value >> 12));
+                size = 3;
+            } else {
+                buffer[0] = char(0xf0 | (value >> 18));
+                size = 4;
+            }
+            for (std::size_t i = 1; i != size; ++i) {
+                buffer[i] = char(0x80 | ((value >> (6 * (size - 1 - i))) & 0x3f));
+            }
+            return bytes(up::string_view(buffer, size));
+        }
+        auto bytes(up::string_view value) -> fragment
+        {
+            auto result = empty();
+            for (unsigned char c : value) {
+                result = concat(result, range(c, c));
+            }
+            return result;
+        }
+    private:
+        auto _make() -> std::size_t
+        {
+            _states.emplace_back();
+            return _states.size() - 1;
+        }
+        void _link(std::size_t from, std::size_t to)
+        {
+            auto&& s = _states[from];
+            (s._epsilon0 == none ? s._epsilon0 : s._epsilon1) = to;
+        }
+    };
+
+
+    /* Parses ECMAScript regular expressions into an automaton, that matches
+     * the complete input (i.e. unanchored patterns are surrounded by loops
+     * accepting arbitrary bytes). Bounded repetitions are expanded by
+     * parsing the atom multiple times. */
+    class pattern_parser final
+    {
+    private: // --- scope ---
+        using fragment = nfa::fragment;
+        static const constexpr std::size_t max_repetitions = 1000;
+        class escape final
+        {
+        public: // --- state ---
+            bool _is_set = false;
+            char_set _set;
+            std::uint32_t _code_point = 0;
+        };
+    private: // --- state ---
+        up::string_view _source;
+        std::size_t _position = 0;
+        nfa& _nfa;
+    public: // --- life ---
+        explicit pattern_parser(up::string_view source, nfa& nfa)
+            : _source(source), _nfa(nfa)
+        { }
+    public: // --- operations ---
+        auto parse() -> fragment
+        {
+            up::optional<fragment> result;
+            do {
+                bool anchored_begin = _accept('^');
+                auto f = _sequence();
+                bool anchored_end = _accept('$');
+                if (!_at_end() && _peek() != '|') {
+                    _fail();
+                }
+                if (!anchored_begin) {
+                    f = _nfa.concat(_nfa.star(_nfa.range(0x00, 0xff)), f);
+                }
+                if (!anchored_end) {
+                    f = _nfa.concat(f, _nfa.star(_nfa.range(0x00, 0xff)));
+                }
+                result = result ? _nfa.alternate(*result, f) : f;
+            } while (_accept('|'));
+            return *result;
+        }
+    private:
+        [[noreturn]]
+        void _fail() const
+        {
+            throw up::make_exception("json-schema-bad-pattern").with(_source, _position);
+        }
+        bool _at_end() const noexcept
+        {
+            return _position == _source.size();
+        }
+        auto _peek() const noexcept -> unsigned char
+        {
+            return _source[_position];
+        }
+        auto _next() -> unsigned char
+        {
+            if (_at_end()) {
+                _fail();
+            }
+            return _source[_position++];
+        }
+        bool _accept(char c) noexcept
+        {
+            if (!_at_end() && _source[_position] == c) {
+                ++_position;
+                return true;
+            } else {
+                return false;
+            }
+        }
+        auto _alternation() -> fragment
+        {
+            auto result = _sequence();
+            while (_accept('|')) {
+                result = _nfa.alternate(result, _sequence());
+            }
+            return result;
+        }
+        auto _sequence() -> fragment
+        {
+            auto result = _nfa.empty();
+            while (!_at_end() && _peek() != '|' && _peek() != ')' && _peek() != '$') {
+                if (_peek() == '^') {
+                    // anchors are only supported at the beginning and end of top-level alternatives
+                    _fail();
+                }
+                result = _nfa.concat(result, _term());
+            }
+            return result;
+        }
+        auto _term() -> fragment
+        {
+            auto start = _position;
+            auto f = _atom();
+            std::size_t min;
+            std::size_t max;
+            if (_accept('*')) {
+                f = _nfa.star(f);
+            } else if (_accept('+')) {
+                f = _nfa.plus(f);
+            } else if (_accept('?')) {
+                f = _nfa.optional(f);
+            } else if (_bounds(min, max)) {
+                f = _repeat(f, start, min, max);
+            } else {
+                return f;
+            }
+            _accept('?'); // lazy quantifiers match the same strings
+            return f;
+        }
+        bool _bounds(std::size_t& min, std::size_t& max)
+        {
+            auto start = _position;
+            if (!_accept('{') || !_number(min)) {
+                _position = start;
+                return false;
+            }
+            max = min;
+            if (_accept(',')) {
+                if (!_number(max)) {
+                    max = none;
+                }
+            }
+            if (!_accept('}')) {
+                _position = start;
+                return false;
+            }
+            if (min > max || min > max_repetitions || (max != none && max > max_repetitions)) {
+                _fail();
+            }
+            return true;
+        }
+        bool _number(std::size_t& value)
+        {
+            auto start = _position;
+            value = 0;
+            while (!_at_end() && _peek() >= '0' && _peek() <= '9') {
+                value = std::min<std::size_t>(value * 10 + (_next() - '0'), max_repetitions + 1);
+            }
+            return _position != start;
+        }
+        auto _repeat(fragment f, std::size_t start, std::size_t min, std::size_t max) -> fragment
+        {
+            auto end = _position;
+            auto copy = [&]() {
+                _position = start;
+                auto result = _atom();
+                _position = end;
+                return result;
+            };
+            auto result = _nfa.empty();
+            bool first = true;
+            auto next = [&]() {
+                auto result = first ? f : copy();
+                first = false;
+                return result;
+            };
+            for (std::size_t i = 0; i != min; ++i) {
+                result = _nfa.concat(result, next());
+            }
+            if (max == none) {
+                result = _nfa.concat(result, _nfa.star(next()));
+            } else {
+                for (std::size_t i = min; i != max; ++i) {
+                    result = _nfa.concat(result, _nfa.optional(next()));
+                }
+            }
+            return result;
+        }
+        auto _atom() -> fragment
+        {
+            auto c = _next();
+            switch (c) {
+            case '(':
+                if (_accept('?') && !_accept(':')) {
+                    // lookarounds and named groups
+                    _fail();
+                } else {
+                    auto result = _alternation();
+                    if (!_accept(')')) {
+                        _fail();
+                    }
+                    return result;
+                }
+            case '[':
+                return _nfa.set(_class());
+            case '.':
+                {
+                    char_set chars;
+                    chars.negate();
+                    chars._ascii.reset('\n');
+                    chars._ascii.reset('\r');
+                    return _nfa.set(chars);
+                }
+            case '\\':
+                {
+                    auto e = _escape(false);
+                    return e._is_set ? _nfa.set(e._set) : _nfa.code_point(e._code_point);
+                }
+            case ')':
+            case '*':
+            case '+':
+            case '?':
+                _fail();
+            default:
+                if (c < 0x80) {
+                    return _nfa.range(c, c);
+                } else {
+                    // multi-byte characters are matched as a unit
+                    auto start = _position - 1;
+                    while (!_at_end() && (_peek() & 0xc0) == 0x80) {
+                        ++_position;
+                    }
+                    return _nfa.bytes(_source.substr(start, _position - start));
+                }
+            }
+        }
+        auto _class() -> char_set
+        {
+            char_set result;
+            bool negated = _accept('^');
+            while (!_accept(']')) {
+                auto lo = _class_atom();
+                if (lo._is_set) {
+                    result.merge(lo._set);
+                } else if (_position + 1 < _source.size() && _peek() == '-' && _source[_position + 1] != ']') {
+                    ++_position;
+                    auto hi = _class_atom();
+                    if (hi._is_set || lo._code_point > hi._code_point) {
+                        _fail();
+                    }
+                    result.add(lo._code_point, hi._code_point);
+                } else {
+                    result.add(lo._code_point, lo._code_point);
+                }
+            }
+            if (negated) {
+                result.negate();
+            }
+            return result;
+        }
+        auto _class_atom() -> escape
+        {
+            escape result;
+            auto c = _next();
+            if (c == '\\') {
+                result = _escape(true);
+            } else {
+                result._code_point = c;
+            }
+            if (!result._is_set && result._code_point >= 0x80) {
+                // classes are restricted to ASCII characters
+                _fail();
+            }
+            return result;
+        }
+        auto _escape(bool in_class) -> escape
+        {
+            escape result;
+            auto c = _next();
+            auto shorthand = [&](bool negated, auto&& fill) {
+                result._is_set = true;
+                fill(result._set);
+                if (negated) {
+                    result._set.negate();
+                }
+            };
+            auto digits = [](char_set& s) { s.add('0', '9'); };
+            auto words = [](char_set& s) { s.add('0', '9'); s.add('A', 'Z'); s.add('a', 'z'); s.add('_', '_'); };
+            auto spaces = [](char_set& s) { s.add('\t', '\r'); s.add(' ', ' '); };
+            switch (c) {
+            case 'd': shorthand(false, digits); break;
+            case 'D': shorthand(true, digits); break;
+            case 'w': shorthand(false, words); break;
+            case 'W': shorthand(true, words); break;
+            case 's': shorthand(false, spaces); break;
+            case 'S': shorthand(true, spaces); break;
+            case 'n': result._code_point = '\n'; break;
+            case 'r': result._code_point = '\r'; break;
+            case 't': result._code_point = '\t'; break;
+            case 'f': result._code_point = '\f'; break;
+            case 'v': result._code_point = '\v'; break;
+            case '0': result._code_point = 0; break;
+            case 'x': result._code_point = _hex(2); break;
+            case 'u': result._code_point = _hex(4); break;
+            case 'b':
+                if (!in_class) {
+                    // word boundaries
+                    _fail();
+                }
+                result._code_point = '\b';
+                break;
+            default:
+                if (c >= 0x80 || std::isalnum(c)) {
+                    // backreferences and unknown escapes
+                    _fail();
+                }
+                result._code_point = c;
+            }
+            return result;
+        }
+        auto _hex(std::size_t size) -> std::uint32_t
+        {
+            std::uint32_t result = 0;
+            for (std::size_t i = 0; i != size; ++i) {
+                auto c = _next();
+                if (!std::isxdigit(c)) {
+                    _fail();
+                }
+                result = result * 16 + (std::isdigit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+            }
+            return result;
+        }
+    };
+
+
+    // deterministic automaton on bytes (via subset construction)
+    class pattern final
+    {
+    private: // --- scope ---
+        static const constexpr std::size_t max_states = 4096;
+    private: // --- state ---
+        std::vector<std::uint32_t> _table; // 256 transitions per state, state zero rejects
+        std::vector<bool> _accepting;
+        std::uint32_t _start;
+    public: // --- life ---
+        explicit pattern(up::string_view source)
+        {
+            nfa automaton;
+            auto f = pattern_parser(source, automaton).parse();
+            auto&& states = automaton._states;
+            auto closure = [&](std::vector<std::size_t>& set) {
+                std::vector<bool> visited(states.size());
+                std::vector<std::size_t> pending(set);
+                set.clear();
+                while (!pending.empty()) {
+                    auto s = pending.back();
+                    pending.pop_back();
+                    if (s == none || visited[s]) {
+                        continue;
+                    }
+                    visited[s] = true;
+                    set.push_back(s);
+                    pending.push_back(states[s]._epsilon0);
+                    pending.push_back(states[s]._epsilon1);
+                }
+                std::sort(set.begin(), set.end());
+            };
+            std::map<std::vector<std::size_t>, std::uint32_t> ids;
+            std::vector<std::vector<std::size_t>> sets;
+            auto identify = [&](std::vector<std::size_t>&& set) -> std::uint32_t {
+                auto position = ids.find(set);
+                if (position != ids.end()) {
+                    return position->second;
+                }
+                if (sets.size() == max_states) {
+                    throw up::make_exception("json-schema-pattern-too-complex").with(source);
+                }
+                std::uint32_t id = sets.size();
+                _accepting.push_back(std::binary_search(set.begin(), set.end(), f._end));
+                ids.emplace(set, id);
+                sets.push_back(std::move(set));
+                return id;
+            };
+            identify({}); // rejecting state
+            std::vector<std::size_t> start = {f._begin};
+            closure(start);
+            _start = identify(std::move(start));
+            for (std::size_t id = 0; id != sets.size(); ++id) {
+                _table.resize(sets.size() * 256);
+                for (unsigned c = 0; c != 256; ++c) {
+                    std::vector<std::size_t> next;
+                    for (auto s : sets[id]) {
+                        if (states[s]._lo <= c && c <= states[s]._hi) {
+                            next.push_back(states[s]._next);
+                        }
+                    }
+                    closure(next);
+                    auto target = identify(std::move(next));
+                    _table.resize(sets.size() * 256);
+                    _table[id * 256 + c] = target;
+                }
+            }
+        }
+    public: // --- operations ---
+        bool matches(up::string_view text) const noexcept
+        {
+            auto state = _start;
+            for (unsigned char c : text) {
+                state = _table[state * 256 + c];
+                if (state == 0) {
+                    return false;
+                }
+            }
+            return _accepting[state];
+        }
+    };
+
+
+    // scalar value for enum and const
+    class literal final
+    {
+    public: // --- state ---
+        json::kind _kind;
+        bool _boolean = false;
+        double _number = 0.0;
+        up::shared_string _string;
+    public: // --- life ---
+        explicit literal(const json::value& value)
+            : _kind(value.get_kind())
+        {
+            switch (_kind) {
+            case json::kind::null:
+                break;
+            case json::kind::boolean:
+                _boolean = value.get_boolean();
+                break;
+            case json::kind::number:
+                _number = value.get_number();
+                break;
+            case json::kind::string:
+                _string = value.get_string();
+                break;
+            default:
+                throw up::make_exception("json-schema-unsupported-enum");
+            }
+        }
+    public: // --- operations ---
+        bool matches(const token& t) const noexcept
+        {
+            switch (t.get_kind()) {
+            case token::kind::null:
+                return _kind == json::kind::null;
+            case token::kind::boolean:
+                return _kind == json::kind::boolean && t.get_boolean() == _boolean;
+            case token::kind::number:
+                return _kind == json::kind::number && t.get_number() == _number;
+            case token::kind::string:
+                return _kind == json::kind::string && t.get_string() == up::string_view(_string);
+            default:
+                return false;
+            }
+        }
+    };
+
+
+    class property final
+    {
+    public: // --- state ---
+        up::shared_string _key;
+        bool _declared = false; // i.e. listed in properties
+        std::size_t _schema = none;
+        std::size_t _required = none; // index of the required bit
+    };
+
+
+    // type bits (integer is a subset of number)
+    const constexpr std::uint32_t type_null = 1;
+    const constexpr std::uint32_t type_boolean = 2;
+    const constexpr std::uint32_t type_number = 4;
+    const constexpr std::uint32_t type_integer = 8;
+    const constexpr std::uint32_t type_string = 16;
+    const constexpr std::uint32_t type_array = 32;
+    const constexpr std::uint32_t type_object = 64;
+    const constexpr std::uint32_t type_all = 127;
+
+
+    // compiled schema, all references are indexes into the program
+    class node final
+    {
+    public: // --- state ---
+        bool _never = false;
+        std::uint32_t _types = type_all;
+        bool _enumerated = false;
+        std::vector<literal> _enum;
+        double _minimum = -std::numeric_limits<double>::infinity();
+        double _maximum = std::numeric_limits<double>::infinity();
+        double _exclusive_minimum = -std::numeric_limits<double>::infinity();
+        double _exclusive_maximum = std::numeric_limits<double>::infinity();
+        // draft-04 (minimum and maximum are exclusive)
+        bool _exclusive_min = false;
+        bool _exclusive_max = false;
+        double _multiple_of = 0.0;
+        std::size_t _min_length = 0;
+        std::size_t _max_length = none;
+        std::size_t _pattern = none;
+        bool _tuple = false;
+        std::size_t _items = none;
+        std::vector<std::size_t> _tuple_items;
+        std::size_t _additional_items = none;
+        std::size_t _min_items = 0;
+        std::size_t _max_items = none;
+        std::vector<property> _properties; // sorted by key
+        std::size_t _required_count = 0;
+        std::vector<std::pair<std::size_t, std::size_t>> _pattern_properties; // pattern and schema
+        std::size_t _additional_properties = none;
+        std::size_t _min_properties = 0;
+        std::size_t _max_properties = none;
+        std::vector<std::size_t> _all_of;
+        std::vector<std::size_t> _any_of;
+        std::vector<std::size_t> _one_of;
+        std::size_t _not = none;
+    public: // --- operations ---
+        auto find(up::string_view key) const noexcept -> const property*
+        {
+            auto position = std::lower_bound(_properties.begin(), _properties.end(), key,
+                [](const property& lhs, up::string_view rhs) { return up::string_view(lhs._key) < rhs; });
+            if (position != _properties.end() && up::string_view(position->_key) == key) {
+                return &*position;
+            } else {
+                return nullptr;
+            }
+        }
+        auto find_or_insert(const up::shared_string& key) -> property&
+        {
+            auto position = std::lower_bound(_properties.begin(), _properties.end(), up::string_view(key),
+                [](const property& lhs, up::string_view rhs) { return up::string_view(lhs._key) < rhs; });
+            if (position == _properties.end() || !(position->_key == key)) {
+                position = _properties.insert(position, property{key});
+            }
+            return *position;
+        }
+    };
+
+}
+
+
+class up_json_schema::json_schema::program final
+{
+public: // --- state ---
+    std::vector<node> _nodes; // the root is the first node
+    std::vector<pattern> _patterns;
+    std::vector<up::shared_string> _keywords; // of the root schema
+};
+
+
+namespace
+{
+
+    using program = up_json_schema::json_schema::program;
+
+
+    class compiler final
+    {
+    private: // --- scope ---
+        enum class keyword
+        {
+            type,
+            enum_,
+            const_,
+            minimum,
+            maximum,
+            exclusive_minimum,
+            exclusive_maximum,
+            multiple_of,
+            min_length,
+            max_length,
+            pattern,
+            items,
+            additional_items,
+            min_items,
+            max_items,
+            properties,
+            pattern_properties,
+            additional_properties,
+            required,
+            min_properties,
+            max_properties,
+            all_of,
+            any_of,
+            one_of,
+            not_,
+            // annotations and containers for referenced schemas
+            schema,
+            id,
+            id_legacy,
+            comment,
+            title,
+            description,
+            default_,
+            examples,
+            format,
+            definitions,
+            defs,
+            unknown,
+        };
+    private: // --- state ---
+        const json::value& _root;
+        program& _program;
+        std::unordered_map<std::string, std::size_t> _compiled; // by JSON pointer
+    public: // --- life ---
+        explicit compiler(const json::value& root, program& program)
+            : _root(root), _program(program)
+        { }
+    public: // --- operations ---
+        auto compile(const json::value& schema, const std::string& pointer) -> std::size_t
+        {
+            auto position = _compiled.find(pointer);
+            if (position != _compiled.end()) {
+                return position->second;
+            }
+            auto index = _program._nodes.size();
+            _program._nodes.emplace_back();
+            _compiled.emplace(pointer, index);
+            node result;
+            switch (schema.get_kind()) {
+            case json::kind::boolean:
+                result._never = !schema.get_boolean();
+                break;
+            case json::kind::object:
+                _object(schema, pointer, result);
+                break;
+            default:
+                throw up::make_exception("json-schema-bad-schema").with(up::string_view(pointer));
+            }
+            _program._nodes[index] = std::move(result);
+            return index;
+        }
+        // schemas must not refer to themselves without descending into the value
+        void check_cycles() const
+        {
+            enum class mark : uint8_t { unvisited, active, done };
+            std::vector<mark> marks(_program._nodes.size(), mark::unvisited);
+            auto visit = [&](auto&& self, std::size_t index) -> void {
+                if (index == none || marks[index] == mark::done) {
+                    return;
+                } else if (marks[index] == mark::active) {
+                    throw up::make_exception("json-schema-cyclic-reference");
+                }
+                marks[index] = mark::active;
+                auto&& n = _program._nodes[index];
+                for (auto&& list : {&n._all_of, &n._any_of, &n._one_of}) {
+                    for (auto next : *list) {
+                        self(self, next);
+                    }
+                }
+                self(self, n._not);
+                marks[index] = mark::done;
+            };
+            for (std::size_t index = 0; index != marks.size(); ++index) {
+                visit(visit, index);
+            }
+        }
+    private:
+        static auto _child(const std::string& pointer, up::string_view key) -> std::string
+        {
+            std::string result = pointer + "/";
+            for (auto c : key) {
+                result += c == '~' ? "~0" : c == '/' ? "~1" : std::string(1, c);
+            }
+            return result;
+        }
+        static auto _size(const json::value& value) -> std::size_t
+        {
+            auto number = value.get_number();
+            if (!(number >= 0.0) || number != std::floor(number)) {
+                throw up::make_exception("json-schema-bad-size");
+            }
+            return number < 1e18 ? std::size_t(number) : none;
+        }
+        auto _schemas(const json::value& value, const std::string& pointer) -> std::vector<std::size_t>
+        {
+            std::vector<std::size_t> result;
+            for (std::size_t i = 0, n = value.get_size(); i != n; ++i) {
+                result.push_back(compile(value.get_element(i), pointer + "/" + std::to_string(i)));
+            }
+            return result;
+        }
+        auto _pattern(const json::value& value) -> std::size_t
+        {
+            _program._patterns.emplace_back(up::string_view(value.get_string()));
+            return _program._patterns.size() - 1;
+        }
+        auto _resolve(up::string_view reference) -> std::size_t
+        {
+            if (reference.empty() || reference[0] != '#') {
+                throw up::make_exception("json-schema-unsupported-reference").with(reference);
+            }
+            auto pointer = std::string(reference.substr(1));
+            auto position = _compiled.find(pointer);
+            if (position != _compiled.end()) {
+                return position->second;
+            }
+            const json::value* target = &_root;
+            for (std::size_t begin = 0; begin != pointer.size(); ) {
+                if (pointer[begin] != '/') {
+                    throw up::make_exception("json-schema-bad-reference").with(reference);
+                }
+                auto end = std::min(pointer.find('/', begin + 1), pointer.size());
+                std::string segment;
+                for (auto i = begin + 1; i != end; ++i) {
+                    if (pointer[i] == '~' && i + 1 != end && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+                        segment += pointer[++i] == '0' ? '~' : '/';
+                    } else {
+                        segment += pointer[i];
+                    }
+                }
+                if (target->get_kind() == json::kind::object) {
+                    target = target->find_member(segment);
+                } else if (target->get_kind() == json::kind::array
+                    && !segment.empty() && segment.find_first_not_of("0123456789") == std::string::npos
+                    && std::stoul(segment) < target->get_size()) {
+                    target = &target->get_element(std::stoul(segment));
+                } else {
+                    target = nullptr;
+                }
+                if (target == nullptr) {
+                    throw up::make_exception("json-schema-bad-reference").with(reference);
+                }
+                begin = end;
+            }
+            return compile(*target, pointer);
+        }
+        void _object(const json::value& schema, const std::string& pointer, node& result)
+        {
+            using namespace up::literals;
+            static constexpr auto keywords = up::make_keyword_switch(
+                "type"_sl, "enum"_sl, "const"_sl, "minimum"_sl, "maximum"_sl, "exclusiveMinimum"_sl,
+                "exclusiveMaximum"_sl, "multipleOf"_sl, "minLength"_sl, "maxLength"_sl, "pattern"_sl,
+                "items"_sl, "additionalItems"_sl, "minItems"_sl, "maxItems"_sl, "properties"_sl,
+                "patternProperties"_sl, "additionalProperties"_sl, "required"_sl, "minProperties"_sl,
+                "maxProperties"_sl, "allOf"_sl, "anyOf"_sl, "oneOf"_sl, "not"_sl,
+                "$schema"_sl, "$id"_sl, "id"_sl, "$comment"_sl, "title"_sl, "description"_sl,
+                "default"_sl, "examples"_sl, "format"_sl, "definitions"_sl, "$defs"_sl);
+            if (auto reference = schema.find_member("$ref")) {
+                // all other keywords are ignored
+                result._all_of.push_back(_resolve(reference->get_string()));
+                return;
+            }
+            for (auto&& member : schema.get_object()) {
+                auto key = up::string_view(member.first);
+                auto&& value = member.second;
+                auto child = _child(pointer, key);
+                switch (keywords.find(key, keyword::type, keyword::unknown)) {
+                case keyword::type:
+                    result._types = 0;
+                    if (value.get_kind() == json::kind::array) {
+                        for (auto&& name : value.get_array()) {
+                            result._types |= _type(name.get_string());
+                        }
+                    } else {
+                        result._types = _type(value.get_string());
+                    }
+                    break;
+                case keyword::enum_:
+                    result._enumerated = true;
+                    for (auto&& item : value.get_array()) {
+                        result._enum.emplace_back(item);
+                    }
+                    break;
+                case keyword::const_:
+                    result._enumerated = true;
+                    result._enum.emplace_back(value);
+                    break;
+                case keyword::minimum:
+                    result._minimum = value.get_number();
+                    break;
+                case keyword::maximum:
+                    result._maximum = value.get_number();
+                    break;
+                case keyword::exclusive_minimum:
+                    if (value.get_kind() == json::kind::boolean) {
+                        // draft-04
+                        result._exclusive_min = value.get_boolean();
+                    } else {
+                        result._exclusive_minimum = value.get_number();
+                    }
+                    break;
+                case keyword::exclusive_maximum:
+                    if (value.get_kind() == json::kind::boolean) {
+                        result._exclusive_max = value.get_boolean();
+                    } else {
+                        result._exclusive_maximum = value.get_number();
+                    }
+                    break;
+                case keyword::multiple_of:
+                    result._multiple_of = value.get_number();
+                    if (!(result._multiple_of > 0.0)) {
+                        throw up::make_exception("json-schema-bad-multiple-of");
+                    }
+                    break;
+                case keyword::min_length:
+                    result._min_length = _size(value);
+                    break;
+                case keyword::max_length:
+                    result._max_length = _size(value);
+                    break;
+                case keyword::pattern:
+                    result._pattern = _pattern(value);
+                    break;
+                case keyword::items:
+                    if (value.get_kind() == json::kind::array) {
+                        result._tuple = true;
+                        result._tuple_items = _schemas(value, child);
+                    } else {
+                        result._items = compile(value, child);
+                    }
+                    break;
+                case keyword::additional_items:
+                    result._additional_items = compile(value, child);
+                    break;
+                case keyword::min_items:
+                    result._min_items = _size(value);
+                    break;
+                case keyword::max_items:
+                    result._max_items = _size(value);
+                    break;
+                case keyword::properties:
+                    for (auto&& item : value.get_object()) {
+                        auto index = compile(item.second, _child(child, up::string_view(item.first)));
+                        auto&& p = result.find_or_insert(item.first);
+                        p._declared = true;
+                        p._schema = index;
+                    }
+                    break;
+                case keyword::pattern_properties:
+                    for (auto&& item : value.get_object()) {
+                        auto index = compile(item.second, _child(child, up::string_view(item.first)));
+                        result._pattern_properties.emplace_back(_pattern(item.first), index);
+                    }
+                    break;
+                case keyword::additional_properties:
+                    result._additional_properties = compile(value, child);
+                    break;
+                case keyword::required:
+                    for (auto&& name : value.get_array()) {
+                        auto&& p = result.find_or_insert(name.get_string());
+                        if (p._required == none) {
+                            p._required = result._required_count++;
+                        }
+                    }
+                    break;
+                case keyword::min_properties:
+                    result._min_properties = _size(value);
+                    break;
+                case keyword::max_properties:
+                    result._max_properties = _size(value);
+                    break;
+                case keyword::all_of:
+                    result._all_of = _schemas(value, child);
+                    break;
+                case keyword::any_of:
+                    result._any_of = _schemas(value, child);
+                    break;
+                case keyword::one_of:
+                    result._one_of = _schemas(value, child);
+                    break;
+                case keyword::not_:
+                    result._not = compile(value, child);
+                    break;
+                case keyword::schema:
+                case keyword::id:
+                case keyword::id_legacy:
+                case keyword::comment:
+                case keyword::title:
+                case keyword::description:
+                case keyword::default_:
+                case keyword::examples:
+                case keyword::format:
+                case keyword::definitions:
+                case keyword::defs:
+                    break;
+                case keyword::unknown:
+                    throw up::make_exception("json-schema-unsupported-keyword").with(key);
+                }
+            }
+        }
+        static auto _type(up::string_view name) -> std::uint32_t
+        {
+            using namespace up::literals;
+            static constexpr auto names = up::make_keyword_switch(
+                "null"_sl, "boolean"_sl, "number"_sl, "integer"_sl, "string"_sl, "array"_sl, "object"_sl);
+            auto index = names.find(name);
+            if (index == names.npos) {
+                throw up::make_exception("json-schema-bad-type").with(name);
+            }
+            return std::uint32_t(1) << index;
+        }
+    };
+
+
+    /* Validates one value against one node. The matchers for the branches
+     * (allOf, anyOf, oneOf and not) receive all tokens of the value, and the
+     * matchers for the current element or member only the tokens of that
+     * element or member. The tokens are well-formed (see session). */
+    class matcher final
+    {
+    private: // --- scope ---
+        enum class role : uint8_t { all, any, one, negated };
+    private: // --- state ---
+        const program* _program;
+        const node* _node;
+        bool _started = false;
+        std::size_t _depth = 0;
+        std::size_t _count = 0;
+        bool _in_member = false;
+        std::size_t _member_depth = 0;
+        std::vector<matcher> _members;
+        std::vector<matcher> _branches;
+        std::vector<role> _roles;
+        std::size_t _any_accepted = 0;
+        std::size_t _one_accepted = 0;
+        std::vector<bool> _required;
+        std::size_t _required_seen = 0;
+        status _status = status::pending;
+    public: // --- life ---
+        explicit matcher(const program& program, std::size_t index)
+            : _program(&program), _node(&program._nodes[index])
+        { }
+    public: // --- operations ---
+        auto get_status() const noexcept -> status
+        {
+            return _status;
+        }
+        auto feed(const token& t) -> status
+        {
+            if (_status != status::pending) {
+                return _status;
+            } else if (!_feed_branches(t) || !_feed_self(t)) {
+                _status = status::rejected;
+            } else if (_depth == 0) {
+                bool any = _node->_any_of.empty() || _any_accepted != 0;
+                bool one = _node->_one_of.empty() || _one_accepted == 1;
+                _status = any && one ? status::accepted : status::rejected;
+            } // else: pending
+            return _status;
+        }
+    private:
+        bool _feed_branches(const token& t)
+        {
+            if (!_started) {
+                auto add = [this](const std::vector<std::size_t>& indexes, role r) {
+                    for (auto index : indexes) {
+                        _branches.emplace_back(*_program, index);
+                        _roles.push_back(r);
+                    }
+                };
+                add(_node->_all_of, role::all);
+                add(_node->_any_of, role::any);
+                add(_node->_one_of, role::one);
+                if (_node->_not != none) {
+                    add({_node->_not}, role::negated);
+                }
+            }
+            for (std::size_t i = 0; i != _branches.size(); ++i) {
+                auto&& branch = _branches[i];
+                if (branch.get_status() != status::pending) {
+                    continue;
+                }
+                auto s = branch.feed(t);
+                if (s == status::rejected && _roles[i] == role::all) {
+                    return false;
+                } else if (s == status::accepted) {
+                    switch (_roles[i]) {
+                    case role::all:
+                        break;
+                    case role::any:
+                        ++_any_accepted;
+                        break;
+                    case role::one:
+                        if (++_one_accepted > 1) {
+                            return false;
+                        }
+                        break;
+                    case role::negated:
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+        bool _feed_self(const token& t)
+        {
+            auto&& n = *_node;
+            if (!_started) {
+                _started = true;
+                if (n._never) {
+                    return false;
+                }
+                switch (t.get_kind()) {
+                case token::kind::null:
+                    return (n._types & type_null) && _enumerated(t);
+                case token::kind::boolean:
+                    return (n._types & type_boolean) && _enumerated(t);
+                case token::kind::number:
+                    return _number(t.get_number()) && _enumerated(t);
+                case token::kind::string:
+                    return _string(t.get_string()) && _enumerated(t);
+                case token::kind::begin_array:
+                    _depth = 1;
+                    return (n._types & type_array) && !n._enumerated;
+                case token::kind::begin_object:
+                    _depth = 1;
+                    _required.assign(n._required_count, false);
+                    return (n._types & type_object) && !n._enumerated;
+                default:
+                    return false;
+                }
+            }
+            if (!_in_member) {
+                switch (t.get_kind()) {
+                case token::kind::end_array:
+                    _depth = 0;
+                    return _count >= n._min_items;
+                case token::kind::end_object:
+                    _depth = 0;
+                    return _count >= n._min_properties && _required_seen == n._required_count;
+                case token::kind::key:
+                    return _member(t.get_string());
+                default:
+                    if (!_element()) {
+                        return false;
+                    }
+                }
+            }
+            for (auto&& member : _members) {
+                if (member.feed(t) == status::rejected) {
+                    return false;
+                }
+            }
+            switch (t.get_kind()) {
+            case token::kind::begin_array:
+            case token::kind::begin_object:
+                ++_member_depth;
+                break;
+            case token::kind::end_array:
+            case token::kind::end_object:
+                --_member_depth;
+                break;
+            default:
+                break;
+            }
+            if (_member_depth == 0) {
+                _in_member = false;
+                _members.clear();
+            }
+            return true;
+        }
+        bool _member(up::string_view key)
+        {
+            auto&& n = *_node;
+            if (++_count > n._max_properties) {
+                return false;
+            }
+            _in_member = true;
+            bool declared = false;
+            if (auto p = n.find(key)) {
+                declared = p->_declared;
+                if (p->_required != none && !_required[p->_required]) {
+                    _required[p->_required] = true;
+                    ++_required_seen;
+                }
+                if (p->_schema != none) {
+                    _members.emplace_back(*_program, p->_schema);
+                }
+            }
+            for (auto&& item : n._pattern_properties) {
+                if (_program->_patterns[item.first].matches(key)) {
+                    declared = true;
+                    _members.emplace_back(*_program, item.second);
+                }
+            }
+            if (!declared && n._additional_properties != none) {
+                _members.emplace_back(*_program, n._additional_properties);
+            }
+            return true;
+        }
+        bool _element()
+        {
+            auto&& n = *_node;
+            auto index = _count++;
+            if (_count > n._max_items) {
+                return false;
+            }
+            _in_member = true;
+            auto schema = n._items;
+            if (n._tuple) {
+                schema = index < n._tuple_items.size() ? n._tuple_items[index] : n._additional_items;
+            }
+            if (schema != none) {
+                _members.emplace_back(*_program, schema);
+            }
+            return true;
+        }
+        bool _enumerated(const token& t) const noexcept
+        {
+            if (!_node->_enumerated) {
+                return true;
+            }
+            for (auto&& item : _node->_enum) {
+                if (item.matches(t)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        bool _number(double value) const
+        {
+            auto&& n = *_node;
+            if (!(n._types & type_number) && !((n._types & type_integer) && value == std::floor(value))) {
+                return false;
+            } else if (!(value >= n._minimum && value > n._exclusive_minimum)) {
+                return false;
+            } else if (!(value <= n._maximum && value < n._exclusive_maximum)) {
+                return false;
+            } else if ((n._exclusive_min && value == n._minimum) || (n._exclusive_max && value == n._maximum)) {
+                return false;
+            } else if (n._multiple_of != 0.0) {
+                auto quotient = value / n._multiple_of;
+                return std::isfinite(quotient) && quotient == std::floor(quotient);
+            } else {
+                return true;
+            }
+        }
+        bool _string(up::string_view value) const
+        {
+            auto&& n = *_node;
+            if (!(n._types & type_string)) {
+                return false;
+            }
+            if (n._min_length != 0 || n._max_length != none) {
+                // number of code points
+                std::size_t length = 0;
+                for (unsigned char c : value) {
+                    length += (c & 0xc0) != 0x80;
+                }
+                if (length < n._min_length || length > n._max_length) {
+                    return false;
+                }
+            }
+            return n._pattern == none || _program->_patterns[n._pattern].matches(value);
+        }
+    };
+
+}
+
+
+class up_json_schema::json_schema::session::impl final
+{
+private: // --- state ---
+    std::shared_ptr<const program> _program;
+    matcher _matcher;
+    std::vector<bool> _containers; // true for objects
+    bool _expect_key = false;
+    status _status = status::pending;
+public: // --- life ---
+    explicit impl(std::shared_ptr<const program> program)
+        : _program(std::move(program)), _matcher(*_program, 0)
+    { }
+public: // --- operations ---
+    auto feed(const token& t) -> status
+    {
+        if (_status != status::pending) {
+            // tokens after the end of the value are rejected
+            _status = status::rejected;
+        } else if (!_well_formed(t)) {
+            _status = status::rejected;
+        } else {
+            _status = _matcher.feed(t);
+        }
+        return _status;
+    }
+    auto get_status() const noexcept -> status
+    {
+        return _status;
+    }
+private:
+    bool _well_formed(const token& t)
+    {
+        auto kind = t.get_kind();
+        if (_expect_key) {
+            if (kind == token::kind::key) {
+                _expect_key = false;
+                return true;
+            } else if (kind == token::kind::end_object) {
+                _containers.pop_back();
+                _value_done();
+                return true;
+            } else {
+                return false;
+            }
+        }
+        switch (kind) {
+        case token::kind::end_array:
+            if (_containers.empty() || _containers.back()) {
+                return false;
+            }
+            _containers.pop_back();
+            _value_done();
+            return true;
+        case token::kind::key:
+        case token::kind::end_object:
+            return false;
+        case token::kind::begin_array:
+            _containers.push_back(false);
+            return true;
+        case token::kind::begin_object:
+            _containers.push_back(true);
+            _expect_key = true;
+            return true;
+        default:
+            _value_done();
+            return true;
+        }
+    }
+    void _value_done() noexcept
+    {
+        _expect_key = !_containers.empty() && _containers.back();
+    }
+};
+
+
+namespace
+{
+
+    bool emit(up::json_schema::session& session, const json::value& value)
+    {
+        switch (value.get_kind()) {
+        case json::kind::null:
+            return session.feed(token(token::kind::null)) == status::pending;
+        case json::kind::boolean:
+            return session.feed(token(value.get_boolean())) == status::pending;
+        case json::kind::number:
+            return session.feed(token(value.get_number())) == status::pending;
+        case json::kind::string:
+            return session.feed(token(token::kind::string, up::string_view(value.get_string()))) == status::pending;
+        case json::kind::array:
+            if (session.feed(token(token::kind::begin_array)) != status::pending) {
+                return false;
+            }
+            for (std::size_t i = 0, n = value.get_size(); i != n; ++i) {
+                if (!emit(session, value.get_element(i))) {
+                    return false;
+                }
+            }
+            return session.feed(token(token::kind::end_array)) == status::pending;
+        case json::kind::object:
+            if (session.feed(token(token::kind::begin_object)) != status::pending) {
+                return false;
+            }
+            for (auto&& member : value.get_object()) {
+                if (session.feed(token(token::kind::key, up::string_view(member.first))) != status::pending
+                    || !emit(session, member.second)) {
+                    return false;
+                }
+            }
+            return session.feed(token(token::kind::end_object)) == status::pending;
+        }
+        up::terminate("invalid json kind", value.get_kind());
+    }
+
+}
+
+
+up_json_schema::json_schema::json_schema(const up::json::value& schema)
+{
+    auto result = std::make_shared<program>();
+    compiler c(schema, *result);
+    c.compile(schema, "");
+    c.check_cycles();
+    if (schema.get_kind() == json::kind::object) {
+        for (auto&& member : schema.get_object()) {
+            result->_keywords.push_back(member.first);
+        }
+    }
+    _program = std::move(result);
+}
+
+auto up_json_schema::json_schema::to_insight() const -> up::insight
+{
+    up::insights keywords;
+    for (auto&& keyword : _program->_keywords) {
+        keywords.emplace_back(typeid(keyword), keyword);
+    }
+    return up::insight(typeid(*this), "json-schema",
+        up::insight(typeid(_program->_keywords), "keywords", std::move(keywords)),
+        up::insight(typeid(_program->_nodes), "nodes",
+            up::invoke_to_insight_with_fallback(_program->_nodes.size())),
+        up::insight(typeid(_program->_patterns), "patterns",
+            up::invoke_to_insight_with_fallback(_program->_patterns.size())));
+}
+
+bool up_json_schema::json_schema::accepts(const up::json::value& value) const
+{
+    auto s = start();
+    emit(s, value);
+    return s.get_status() == status::accepted;
+}
+
+auto up_json_schema::json_schema::start() const -> session
+{
+    return session(_program);
+}
+
+
+void up_json_schema::json_schema::session::destroy(impl* ptr)
+{
+    std::default_delete<impl>()(ptr);
+}
+
+up_json_schema::json_schema::session::session(std::shared_ptr<const program> program)
+    : _impl(up::impl_make(std::move(program)))
+{ }
+
+auto up_json_schema::json_schema::session::feed(const up::json::token& token) -> status
+{
+    return _impl->feed(token);
+}
+
+auto up_json_schema::json_schema::session::get_status() const noexcept -> status
+{
+    return _impl->get_status();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/**
+ * Validator for JSON Schema (draft-07 subset). The schema is compiled once
+ * into a program of nodes, with sorted key tables for properties and DFAs
+ * for patterns. The program is executed incrementally on a sequence of
+ * json::token, so that streamed documents can be rejected on the first
+ * offending token, without building any json::value. The validation of a
+ * json::value uses the same program on the tokens of the value.
+ *
+ * Supported keywords: type, enum and const (scalar values), minimum,
+ * maximum, exclusiveMinimum, exclusiveMaximum, multipleOf, minLength,
+ * maxLength, pattern, items, additionalItems, minItems, maxItems,
+ * properties, patternProperties, additionalProperties, required,
+ * minProperties, maxProperties, allOf, anyOf, oneOf, not, definitions and
+ * $ref (JSON pointers within the schema). Annotations (e.g. title and
+ * format) are ignored, and all other keywords are rejected on compilation.
+ *
+ * Patterns support the usual ECMAScript syntax without backreferences,
+ * lookarounds and nested anchors. Classes and the shorthands \d, \w and \s
+ * only contain ASCII characters (i.e. non-ASCII characters can only be
+ * matched by negation or by literals).
+ */
+
+#include "up_impl_ptr.hpp"
+#include "up_insight.hpp"
+#include "up_json.hpp"
+#include "up_swap.hpp"
+
+namespace up_json_schema
+{
+
+    class json_schema final
+    {
+    public: // --- scope ---
+        using self = json_schema;
+        class program;
+        enum class status : uint8_t { pending, accepted, rejected };
+        class session;
+    private: // --- state ---
+        std::shared_ptr<const program> _program;
+    public: // --- life ---
+        explicit json_schema(const up::json::value& schema);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_program, rhs._program);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        // root keywords, and the number of compiled schemas and patterns
+        auto to_insight() const -> up::insight;
+        bool accepts(const up::json::value& value) const;
+        // validates a single value, that is passed token by token
+        auto start() const -> session;
+    };
+
+
+    class json_schema::session final
+    {
+    public: // --- scope ---
+        using self = session;
+        class impl;
+        static void destroy(impl* ptr);
+    private: // --- state ---
+        up::impl_ptr<impl, destroy> _impl;
+    public: // --- life ---
+        explicit session(std::shared_ptr<const program> program);
+        session(const self& rhs) = delete;
+        session(self&& rhs) noexcept = default;
+        ~session() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = default;
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        /* Returns pending until the value is complete. Once the value has
+         * been rejected, all further tokens are ignored. Tokens after the
+         * end of the value are rejected. */
+        auto feed(const up::json::token& token) -> status;
+        auto get_status() const noexcept -> status;
+    };
+
+}
+
+namespace up
+{
+
+    using up_json_schema::json_schema;
+
+}
@@ -0,0 +1,9 @@
+#include "up_keyword_switch.hpp"
+
+#include "up_exception.hpp"
+
+
+void up_keyword_switch::keyword_switch_failed()
+{
+    throw up::make_exception("keyword-switch-construction-failed");
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+/**
+ * Dispatching on a fixed set of keywords (e.g. header names, tags or command
+ * verbs) with a perfect hash function, that is computed at compile time from
+ * a list of string literals:
+ *
+ *     static constexpr auto verbs = up::make_keyword_switch("get"_sl, "put"_sl);
+ *     switch (verbs.find(text)) {
+ *     case 0: ... // get
+ *     case 1: ... // put
+ *     default: ... // unknown (npos)
+ *     }
+ *
+ * The lookup hashes the text (for keywords of up to 16 characters, with two
+ * loads and one multiplication), reads the displacement of its bucket and
+ * the index of its slot, and compares with the only candidate keyword. The
+ * construction fails at compile time (with a call to the non-constexpr
+ * function keyword_switch_failed) if the keywords are not unique, and at
+ * runtime if the switch is not constructed in a constant expression.
+ *
+ * The construction uses hash and displace: the keywords are distributed into
+ * buckets, and for each bucket (largest first), a displacement is searched,
+ * that maps all its keywords to free slots.
+ */
+
+#include <array>
+#include <limits>
+#include <type_traits>
+
+#include "up_string_literal.hpp"
+
+
+namespace up_keyword_switch
+{
+
+    [[noreturn]]
+    void keyword_switch_failed();
+
+
+    class keyword_hash final
+    {
+    public: // --- scope ---
+        static const constexpr uint64_t k0 = 0xa0761d6478bd642full;
+        static const constexpr uint64_t k1 = 0xe7037ed1a0b428dbull;
+        static const constexpr uint64_t k2 = 0x9e3779b97f4a7c15ull;
+        // keywords up to this size are hashed without loops
+        static const constexpr std::size_t sample_size = 16;
+    private:
+        static constexpr auto _mix(uint64_t a, uint64_t b) noexcept -> uint64_t
+        {
+            auto r = static_cast<unsigned __int128>(a) * b;
+            return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+        }
+        template <std::size_t Size>
+        static constexpr auto _read(const char* data) noexcept -> uint64_t
+        {
+            // the compiler combines the bytes into a single load
+            uint64_t result = 0;
+            for (std::size_t i = 0; i != Size; ++i) {
+                result |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return result;
+        }
+    public: // --- operations ---
+        // all bytes are taken into account for keywords up to the sample size
+        static constexpr auto sampled(const char* data, std::size_t size) noexcept -> uint64_t
+        {
+            uint64_t a = 0;
+            uint64_t b = 0;
+            if (size >= 8) {
+                a = _read<8>(data);
+                b = _read<8>(data + size - 8);
+            } else if (size >= 4) {
+                a = _read<4>(data);
+                b = _read<4>(data + size - 4);
+            } else if (size > 0) {
+                a = uint64_t(static_cast<unsigned char>(data[0])) << 16
+                    | uint64_t(static_cast<unsigned char>(data[size / 2])) << 8
+                    | uint64_t(static_cast<unsigned char>(data[size - 1]));
+            }
+            return _mix(a ^ k0, b ^ k1 ^ size);
+        }
+        // all bytes are taken into account for all sizes
+        static constexpr auto full(const char* data, std::size_t size) noexcept -> uint64_t
+        {
+            if (size <= sample_size) {
+                return sampled(data, size);
+            } else {
+                uint64_t h = k2;
+                for (std::size_t i = 0; i + 8 < size; i += 8) {
+                    h = _mix(h ^ _read<8>(data + i), k0);
+                }
+                return _mix(h ^ _read<8>(data + size - 8), k1 ^ size);
+            }
+        }
+        static constexpr auto slot(uint64_t hash, uint16_t displacement, std::size_t shift) noexcept
+            -> std::size_t
+        {
+            return static_cast<std::size_t>(((hash ^ (displacement * k2)) * k0) >> shift);
+        }
+    };
+
+
+    template <std::size_t N>
+    class keyword_switch final
+    {
+    public: // --- scope ---
+        using self = keyword_switch;
+        static_assert(N > 0 && N < std::numeric_limits<uint16_t>::max());
+        static const constexpr std::size_t npos = std::size_t(-1);
+    private:
+        static constexpr auto _log2_ceil(std::size_t n) -> std::size_t
+        {
+            std::size_t result = 0;
+            while ((std::size_t(1) << result) < n) {
+                ++result;
+            }
+            return result;
+        }
+        // load factor of at most 1/2 for slots and about 2 keywords per bucket
+        static const constexpr std::size_t slot_bits = _log2_ceil(N) + 1;
+        static const constexpr std::size_t slot_count = std::size_t(1) << slot_bits;
+        static const constexpr std::size_t bucket_count = slot_count / 4 ? slot_count / 4 : 1;
+        static const constexpr uint16_t empty = std::numeric_limits<uint16_t>::max();
+    private: // --- state ---
+        std::array<up::string_literal, N> _keywords;
+        bool _full = false;
+        std::array<uint16_t, bucket_count> _displacements = {};
+        std::array<uint16_t, slot_count> _slots = {};
+    public: // --- life ---
+        constexpr explicit keyword_switch(const std::array<up::string_literal, N>& keywords)
+            : _keywords(keywords)
+        {
+            /* Duplicates are checked explicitly, because otherwise the
+             * search for displacements would fail only after exhausting all
+             * candidates (and probably the constexpr evaluation limits). */
+            for (std::size_t i = 0; i != N; ++i) {
+                for (std::size_t j = 0; j != i; ++j) {
+                    if (_equal(_keywords[i], _keywords[j])) {
+                        keyword_switch_failed();
+                    }
+                }
+            }
+            std::array<uint64_t, N> hashes = {};
+            for (std::size_t i = 0; i != N; ++i) {
+                hashes[i] = _hash(_keywords[i].data(), _keywords[i].size(), false);
+            }
+            for (std::size_t i = 0; i != N && !_full; ++i) {
+                for (std::size_t j = 0; j != i; ++j) {
+                    if (hashes[i] == hashes[j]) {
+                        // keywords only differ in the middle
+                        _full = true;
+                        break;
+                    }
+                }
+            }
+            if (_full) {
+                for (std::size_t i = 0; i != N; ++i) {
+                    hashes[i] = _hash(_keywords[i].data(), _keywords[i].size(), true);
+                }
+            }
+            _build(hashes);
+        }
+    public: // --- operations ---
+        constexpr auto size() const noexcept -> std::size_t
+        {
+            return N;
+        }
+        constexpr auto operator[](std::size_t index) const noexcept -> up::string_literal
+        {
+            return _keywords[index];
+        }
+        // returns the index of the keyword, or npos if there is no match
+        auto find(const up::string_view& text) const noexcept -> std::size_t
+        {
+            auto hash = _hash(text.data(), text.size(), _full);
+            auto index = _slots[_slot(hash)];
+            if (index == empty) {
+                return npos;
+            }
+            auto&& keyword = _keywords[index];
+            if (up::string_view(keyword.data(), keyword.size()) == text) {
+                return index;
+            } else {
+                return npos;
+            }
+        }
+        // the enumerators must be consecutive, in the same order as the keywords
+        template <typename Enum>
+        auto find(const up::string_view& text, Enum first, Enum fallback) const noexcept -> Enum
+        {
+            static_assert(std::is_enum<Enum>::value);
+            using underlying = std::underlying_type_t<Enum>;
+            auto index = find(text);
+            if (index == npos) {
+                return fallback;
+            } else {
+                return static_cast<Enum>(static_cast<underlying>(first) + static_cast<underlying>(index));
+            }
+        }
+    private:
+        static constexpr bool _equal(up::string_literal lhs, up::string_literal rhs) noexcept
+        {
+            if (lhs.size() != rhs.size()) {
+                return false;
+            }
+            for (std::size_t i = 0; i != lhs.size(); ++i) {
+                if (lhs.data()[i] != rhs.data()[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        static constexpr auto _hash(const char* data, std::size_t size, bool full) noexcept -> uint64_t
+        {
+            return full ? keyword_hash::full(data, size) : keyword_hash::sampled(data, size);
+        }
+        constexpr auto _slot(uint64_t hash) const noexcept -> std::size_t
+        {
+            auto displacement = _displacements[hash & (bucket_count - 1)];
+            return keyword_hash::slot(hash, displacement, 64 - slot_bits);
+        }
+        constexpr void _build(const std::array<uint64_t, N>& hashes)
+        {
+            for (auto&& slot : _slots) {
+                slot = empty;
+            }
+            std::array<std::size_t, bucket_count> sizes = {};
+            for (auto&& hash : hashes) {
+                ++sizes[hash & (bucket_count - 1)];
+            }
+            for (std::size_t size = N; size != 0; --size) {
+                for (std::size_t bucket = 0; bucket != bucket_count; ++bucket) {
+                    if (sizes[bucket] == size) {
+                        _place(hashes, bucket);
+                    }
+                }
+            }
+        }
+        constexpr void _place(const std::array<uint64_t, N>& hashes, std::size_t bucket)
+        {
+            for (uint16_t displacement = 0; displacement != empty; ++displacement) {
+                _displacements[bucket] = displacement;
+                bool okay = true;
+                std::size_t placed = 0;
+                for (std::size_t i = 0; i != N && okay; ++i) {
+                    if ((hashes[i] & (bucket_count - 1)) == bucket) {
+                        auto&& slot = _slots[_slot(hashes[i])];
+                        if (slot == empty) {
+                            slot = static_cast<uint16_t>(i);
+                            ++placed;
+                        } else {
+                            okay = false;
+                        }
+                    }
+                }
+                if (okay) {
+                    return;
+                }
+                // undo the partial placement
+                for (std::size_t i = 0; i != N && placed != 0; ++i) {
+                    if ((hashes[i] & (bucket_count - 1)) == bucket) {
+                        auto&& slot = _slots[_slot(hashes[i])];
+                        if (slot == i) {
+                            slot = empty;
+                            --placed;
+                        }
+                    }
+                }
+            }
+            keyword_switch_failed();
+        }
+    };
+
+
+    template <typename..., typename... Literals>
+    constexpr auto make_keyword_switch(Literals... literals) -> keyword_switch<sizeof...(Literals)>
+    {
+        static_assert((std::is_same<Literals, up::string_literal>::value && ...));
+        return keyword_switch<sizeof...(Literals)>(std::array<up::string_literal, sizeof...(Literals)>{{literals...}});
+    }
+
+}
+
+namespace up
+{
+
+    using up_keyword_switch::keyword_switch;
+    using up_keyword_switch::make_keyword_switch;
+
+}
@@ -0,0 +1,611 @@
+#include "up_kv_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+
+#include "up_exception.hpp"
+#include "up_hash.hpp"
+#include "up_ints.hpp"
+#include "up_log_file.hpp"
+#include "up_terse_map.hpp"
+#include "up_vlq.hpp"
+
+
+namespace
+{
+
+    /* The data file starts with a header consisting of a magic number and a
+     * generation, that is incremented by each compaction. It is followed by
+     * the records, that are framed as described in up_log_file.hpp. The
+     * payload of each record consists of the key size and the value size
+     * (both as VLQ), followed by the key and the value. For erased keys, the
+     * value size is encoded as zero, and all other value sizes are
+     * incremented by one. */
+    const uint64_t data_magic = 0x617461642d766b2d; // "-kv-data"
+    const uint64_t index_magic = 0x7865646e692d766b; // "kv-index"
+    const std::size_t header_size = 16;
+    const std::size_t checksum_size = 4;
+    const std::size_t batch_size = 1 << 20;
+
+
+    void append_uint64(up::buffer& buffer, uint64_t value)
+    {
+        char data[8];
+        for (std::size_t i = 0; i != sizeof(data); ++i) {
+            data[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+        buffer.append({data, sizeof(data)});
+    }
+
+    auto checksum(const char* data, std::size_t size) -> uint32_t
+    {
+        return up::crc32({data, size});
+    }
+
+
+    // sequential decoder for the formats above
+    class decoder final
+    {
+    private: // --- state ---
+        const char* _data;
+        std::size_t _size;
+    public: // --- life ---
+        explicit decoder(const char* data, std::size_t size)
+            : _data(data), _size(size)
+        { }
+    public: // --- operations ---
+        auto data() const { return _data; }
+        auto size() const { return _size; }
+        bool uint64(uint64_t& value)
+        {
+            if (_size < 8) {
+                return false;
+            }
+            value = 0;
+            for (std::size_t i = 0; i != 8; ++i) {
+                value |= uint64_t(static_cast<unsigned char>(_data[i])) << (8 * i);
+            }
+            _skip(8);
+            return true;
+        }
+        bool uint32(uint32_t& value)
+        {
+            if (_size < 4) {
+                return false;
+            }
+            value = 0;
+            for (std::size_t i = 0; i != 4; ++i) {
+                value |= uint32_t(static_cast<unsigned char>(_data[i])) << (8 * i);
+            }
+            _skip(4);
+            return true;
+        }
+        bool vlq(uint64_t& value)
+        {
+            auto&& decoded = up::vlq::try_decode<uint64_t>({_data, _size});
+            if (std::get<0>(decoded) != up::vlq_status::complete) {
+                return false;
+            }
+            value = std::get<1>(decoded);
+            _skip(std::get<2>(decoded));
+            return true;
+        }
+        bool bytes(std::size_t size, up::chunk::from& value)
+        {
+            if (_size < size) {
+                return false;
+            }
+            value = {_data, size};
+            _skip(size);
+            return true;
+        }
+    private:
+        void _skip(std::size_t n)
+        {
+            _data += n;
+            _size -= n;
+        }
+    };
+
+
+    class record final
+    {
+    public: // --- state ---
+        up::chunk::from _key = {nullptr, 0};
+        up::chunk::from _value = {nullptr, 0};
+        bool _erased = false;
+        std::size_t _size = 0; // including the framing
+    public: // --- operations ---
+        // returns false if the payload is malformed
+        bool parse(up::chunk::from payload)
+        {
+            decoder d(payload.data(), payload.size());
+            uint64_t key_size;
+            uint64_t value_size;
+            if (!d.vlq(key_size) || !d.vlq(value_size)) {
+                return false;
+            }
+            _erased = value_size == 0;
+            uint64_t limit = up::ints::caster(d.size());
+            if (key_size > limit || value_size - !_erased != limit - key_size) {
+                return false;
+            }
+            std::size_t n = up::ints::caster(key_size);
+            std::size_t m = up::ints::caster(value_size - !_erased);
+            return d.bytes(n, _key) && d.bytes(m, _value);
+        }
+    };
+
+
+    // framing and sizes of a record (stored in place to avoid allocations)
+    class record_header final
+    {
+    public: // --- state ---
+        up_log_file::header _frame;
+        char _sizes[2 * up::vlq::max_size<uint64_t>()];
+        std::size_t _size = 0;
+    public: // --- life ---
+        explicit record_header(up::chunk::from key, const up::chunk::from* value)
+        {
+            _append_vlq(key.size());
+            _append_vlq(value ? up::ints::domain<uint64_t>::or_length_error::sum(value->size(), 1) : 0);
+            up::chunk::from none(nullptr, 0);
+            _frame = up_log_file::header(up::chunk::from_bulk(sizes(), key, value ? *value : none));
+        }
+    public: // --- operations ---
+        auto sizes() const -> up::chunk::from
+        {
+            return {_sizes, _size};
+        }
+        auto total() const -> std::size_t
+        {
+            return _frame._size + _size;
+        }
+    private:
+        void _append_vlq(uint64_t value)
+        {
+            auto&& encoded = up::vlq::encode(value);
+            std::memcpy(_sizes + _size, std::get<1>(encoded).data(), std::get<0>(encoded));
+            _size += std::get<0>(encoded);
+        }
+    };
+
+
+    class entry final
+    {
+    public: // --- state ---
+        uint64_t _offset;
+        uint64_t _size;
+    };
+
+    // transparent, so that lookups with views require no allocation
+    class key_hash final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        auto operator()(const up::shared_string& key) const noexcept -> std::size_t
+        {
+            return key.hash();
+        }
+        auto operator()(const up::string_view& key) const noexcept -> std::size_t
+        {
+            return std::hash<up::string_view>()(key);
+        }
+    };
+
+    class key_equal final
+    {
+    public: // --- scope ---
+        using is_transparent = void;
+    public: // --- operations ---
+        bool operator()(const up::string_view& lhs, const up::string_view& rhs) const noexcept
+        {
+            return lhs == rhs;
+        }
+    };
+
+    using key_index = up::terse_map<up::shared_string, entry, key_hash, key_equal>;
+
+}
+
+
+class up_kv_store::kv_store::impl final
+{
+public: // --- scope ---
+    using self = impl;
+    using option = up::fs::file::option;
+private: // --- state ---
+    up::fs::origin _directory;
+    up::fs::file::lock _lock;
+    uint64_t _generation;
+    up::fs::file _file;
+    uint64_t _end;
+    uint64_t _garbage;
+    key_index _index;
+    std::shared_timed_mutex _mutex;
+    // serializes compactions and snapshots
+    std::mutex _compaction_mutex;
+public: // --- life ---
+    explicit impl(up::fs::origin directory)
+        : _directory(std::move(directory))
+        , _lock(up_log_file::acquire_lock(_directory))
+        , _generation(0)
+        , _file(_open())
+        , _end(header_size)
+        , _garbage(0)
+    {
+        _recover();
+    }
+    impl(const self& rhs) = delete;
+    impl(self&& rhs) noexcept = delete;
+    ~impl() noexcept = default;
+public: // --- operations ---
+    auto operator=(const self& rhs) & -> self& = delete;
+    auto operator=(self&& rhs) & noexcept -> self& = delete;
+    auto to_insight() -> up::insight
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        return up::insight(typeid(*this), "kv-store-impl",
+            up::invoke_to_insight_with_fallback(_directory),
+            up::invoke_to_insight_with_fallback(_generation),
+            up::invoke_to_insight_with_fallback(_end),
+            up::invoke_to_insight_with_fallback(_garbage),
+            up::invoke_to_insight_with_fallback(_index.size()));
+    }
+    auto size() -> std::size_t
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        return _index.size();
+    }
+    auto garbage() -> uint64_t
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        return _garbage;
+    }
+    auto get(const up::string_view& key) -> up::optional<up::buffer>
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        auto p = _index.find(key);
+        if (p == _index.end()) {
+            return up::nullopt;
+        }
+        std::size_t size = up::ints::caster(p->second._size);
+        off_t offset = up::ints::caster(p->second._offset);
+        up::buffer buffer;
+        buffer.reserve(size);
+        while (buffer.available() != size) {
+            std::size_t n = _file.read_some({buffer.cold(), size - buffer.available()}, offset);
+            if (n == 0) {
+                throw up::make_exception("kv-store-truncated-record").with(p->second._offset, size);
+            }
+            buffer.produce(n);
+            offset += n;
+        }
+        up::chunk::from payload(nullptr, 0);
+        std::size_t total = 0;
+        record r;
+        if (up_log_file::parse({buffer.warm(), size}, payload, total) != up_log_file::status::complete
+            || total != size || !r.parse(payload)
+            || r._erased || up::string_view(r._key.data(), r._key.size()) != key) {
+            throw up::make_exception("kv-store-corrupt-record").with(p->second._offset, size);
+        }
+        buffer.consume(size - r._value.size());
+        return up::optional<up::buffer>(std::move(buffer));
+    }
+    void put(const up::string_view& key, up::chunk::from value)
+    {
+        up::chunk::from k(key.data(), key.size());
+        _write(k, &value);
+    }
+    bool erase(const up::string_view& key)
+    {
+        up::chunk::from k(key.data(), key.size());
+        return _write(k, nullptr);
+    }
+    void sync()
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        _file.fdatasync();
+    }
+    void save_index()
+    {
+        std::lock_guard<std::mutex> serial(_compaction_mutex);
+        _save_index();
+    }
+    void compact()
+    {
+        std::lock_guard<std::mutex> serial(_compaction_mutex);
+        /* Take a snapshot of the index and copy the corresponding records,
+         * while other threads can still read and write. */
+        std::vector<std::pair<up::shared_string, entry>> live;
+        uint64_t snapshot_end;
+        uint64_t generation;
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+            live.assign(_index.begin(), _index.end());
+            snapshot_end = _end;
+            generation = _generation + 1;
+        }
+        std::sort(live.begin(), live.end(), [](auto&& lhs, auto&& rhs) {
+            return lhs.second._offset < rhs.second._offset;
+        });
+        auto target_location = up::fs::location(_directory, "data.compact");
+        auto target = up::fs::file(target_location,
+            {option::read, option::write, option::create, option::truncate});
+        uint64_t position = 0;
+        up::buffer batch;
+        append_uint64(batch, data_magic);
+        append_uint64(batch, generation);
+        key_index result;
+        result.reserve(live.size());
+        {
+            auto source = _file.map(up::ints::caster(snapshot_end), 0, false);
+            for (auto&& item : live) {
+                std::size_t size = up::ints::caster(item.second._size);
+                result.emplace(item.first, entry{position + batch.available(), item.second._size});
+                batch.append({source.data() + item.second._offset, size});
+                if (batch.available() >= batch_size) {
+                    position += _write_all(target, batch, position);
+                }
+            }
+        }
+        position += _write_all(target, batch, position);
+        /* Copy the records written in the meantime, and replace the data
+         * file. This part blocks all other operations. */
+        std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+        uint64_t tail = _end - snapshot_end;
+        if (tail) {
+            auto source = _file.map(up::ints::caster(_end), 0, false);
+            target.write_all({source.data() + snapshot_end, up::ints::caster(tail)}, up::ints::caster(position));
+        }
+        for (auto&& item : _index) {
+            if (item.second._offset >= snapshot_end) {
+                result[item.first] = entry{item.second._offset - snapshot_end + position, item.second._size};
+            }
+        }
+        /* Records of the snapshot might have been overwritten or erased in
+         * the meantime, i.e. the garbage is computed from the merged index. */
+        uint64_t live_size = 0;
+        for (auto p = result.begin(); p != result.end(); ) {
+            if (_index.count(p->first)) {
+                live_size += p->second._size;
+                ++p;
+            } else {
+                p = result.erase(p);
+            }
+        }
+        target.fdatasync();
+        auto snapshot = up::fs::location(_directory, "index");
+        if (snapshot.exists()) {
+            snapshot.unlink();
+        }
+        target_location.exchange(up::fs::location(_directory, "data"));
+        target_location.unlink();
+        up_log_file::fsync_directory(_directory);
+        _file = std::move(target);
+        _generation = generation;
+        _end = position + tail;
+        _garbage = position + tail - header_size - live_size;
+        _index = std::move(result);
+        lock.unlock();
+        _save_index();
+    }
+private:
+    auto _open() -> up::fs::file
+    {
+        /* A left-over file of an interrupted compaction is useless. */
+        auto compact = up::fs::location(_directory, "data.compact");
+        if (compact.exists()) {
+            compact.unlink();
+        }
+        auto location = up::fs::location(_directory, "data");
+        if (!location.exists()) {
+            auto file = up::fs::file(location,
+                {option::read, option::write, option::create, option::exclusive});
+            up::buffer header;
+            append_uint64(header, data_magic);
+            append_uint64(header, 1);
+            file.write_all(header, 0);
+            file.fdatasync();
+            up_log_file::fsync_directory(_directory);
+        }
+        auto file = up::fs::file(location, {option::read, option::write});
+        char data[header_size];
+        uint64_t magic = 0;
+        decoder d(data, file.read_some({data, sizeof(data)}, 0));
+        if (!d.uint64(magic) || !d.uint64(_generation) || magic != data_magic) {
+            throw up::make_exception("kv-store-bad-data-file").with(_directory, magic);
+        }
+        return file;
+    }
+    void _recover()
+    {
+        std::size_t size = up::ints::caster(_file.stat().size());
+        _load_index(size);
+        _end = up_log_file::recover(_file, up::ints::caster(_end), "kv-store-corrupt",
+            [this](std::size_t offset, std::size_t total, up::chunk::from payload) {
+                record r;
+                if (!r.parse(payload)) {
+                    throw up::make_exception("kv-store-corrupt-record").with(offset, total);
+                }
+                r._size = total;
+                _apply(r, offset);
+            });
+    }
+    void _apply(const record& r, uint64_t offset)
+    {
+        auto key = up::string_view(r._key.data(), r._key.size());
+        auto p = _index.find(key);
+        if (p != _index.end()) {
+            _garbage += p->second._size;
+        }
+        if (r._erased) {
+            _garbage += r._size;
+            if (p != _index.end()) {
+                _index.erase(p);
+            }
+        } else if (p != _index.end()) {
+            p->second = entry{offset, r._size};
+        } else {
+            _index.emplace(up::shared_string(key), entry{offset, r._size});
+        }
+    }
+    auto _write(up::chunk::from key, const up::chunk::from* value) -> bool
+    {
+        record_header header(key, value);
+        up::chunk::from none(nullptr, 0);
+        std::size_t total = up::ints::domain<std::size_t>::or_length_error::sum(
+            header.total(), key.size(), value ? value->size() : 0);
+        std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+        if (value == nullptr && !_index.count(up::string_view(key.data(), key.size()))) {
+            return false;
+        }
+        _file.write_all(up::chunk::from_bulk(header._frame, header.sizes(), key, value ? *value : none),
+            up::ints::caster(_end));
+        record r;
+        r._key = key;
+        r._erased = value == nullptr;
+        r._size = total;
+        _apply(r, _end);
+        _end += total;
+        return true;
+    }
+    auto _write_all(const up::fs::file& file, up::buffer& buffer, uint64_t position) -> uint64_t
+    {
+        std::size_t n = buffer.available();
+        if (n) {
+            file.write_all(buffer, up::ints::caster(position));
+            buffer.consume(n);
+        }
+        return n;
+    }
+    void _load_index(std::size_t size)
+    {
+        auto location = up::fs::location(_directory, "index");
+        if (!location.exists()) {
+            return;
+        }
+        auto file = up::fs::file(location, {option::read});
+        std::size_t length = up::ints::caster(file.stat().size());
+        if (length <= checksum_size) {
+            return;
+        }
+        auto mapping = file.map(length, 0, false);
+        decoder d(mapping.data(), length - checksum_size);
+        decoder c(mapping.data() + length - checksum_size, checksum_size);
+        uint32_t crc;
+        uint64_t magic, generation, end, garbage, count;
+        if (!c.uint32(crc)
+            || crc != checksum(mapping.data(), length - checksum_size)
+            || !d.uint64(magic) || magic != index_magic
+            || !d.uint64(generation) || generation != _generation
+            || !d.uint64(end) || end > size || end < header_size
+            || !d.uint64(garbage)
+            || !d.vlq(count)) {
+            /* The snapshot is ignored, if it does not belong to the current
+             * data file. The records are scanned instead. */
+            return;
+        }
+        key_index result;
+        result.reserve(up::ints::caster(std::min<uint64_t>(count, d.size())));
+        for (uint64_t i = 0; i != count; ++i) {
+            uint64_t key_size, offset, record_size;
+            up::chunk::from key(nullptr, 0);
+            if (!d.vlq(key_size) || key_size > d.size()
+                || !d.bytes(up::ints::caster(key_size), key)
+                || !d.vlq(offset) || !d.vlq(record_size)) {
+                return;
+            }
+            result.emplace(up::shared_string(key.data(), key.size()), entry{offset, record_size});
+        }
+        _index = std::move(result);
+        _end = end;
+        _garbage = garbage;
+    }
+    void _save_index()
+    {
+        up::buffer buffer;
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+            /* The snapshot must not refer to records, that are not yet
+             * durable. */
+            _file.fdatasync();
+            append_uint64(buffer, index_magic);
+            append_uint64(buffer, _generation);
+            append_uint64(buffer, _end);
+            append_uint64(buffer, _garbage);
+            buffer.append(up::vlq::encoded<uint64_t>(_index.size()));
+            for (auto&& item : _index) {
+                buffer.append(up::vlq::encoded<uint64_t>(item.first.size()));
+                buffer.append({item.first.data(), item.first.size()});
+                buffer.append(up::vlq::encoded<uint64_t>(item.second._offset));
+                buffer.append(up::vlq::encoded<uint64_t>(item.second._size));
+            }
+        }
+        uint32_t crc = checksum(buffer.warm(), buffer.available());
+        char data[checksum_size];
+        for (std::size_t i = 0; i != checksum_size; ++i) {
+            data[i] = static_cast<char>((crc >> (8 * i)) & 0xff);
+        }
+        buffer.append({data, checksum_size});
+        auto temp = up::fs::location(_directory, "index.tmp");
+        auto file = up::fs::file(temp, {option::write, option::create, option::truncate});
+        file.write_all(buffer, 0);
+        file.fdatasync();
+        temp.rename(up::fs::location(_directory, "index"), true);
+        up_log_file::fsync_directory(_directory);
+    }
+};
+
+
+up_kv_store::kv_store::kv_store(up::fs::origin directory)
+    : _impl(std::make_shared<impl>(std::move(directory)))
+{ }
+
+auto up_kv_store::kv_store::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "kv-store", _impl->to_insight());
+}
+
+auto up_kv_store::kv_store::size() const -> std::size_t
+{
+    return _impl->size();
+}
+
+auto up_kv_store::kv_store::garbage() const -> uint64_t
+{
+    return _impl->garbage();
+}
+
+auto up_kv_store::kv_store::get(const up::string_view& key) const -> up::optional<up::buffer>
+{
+    return _impl->get(key);
+}
+
+void up_kv_store::kv_store::put(const up::string_view& key, up::chunk::from value) const
+{
+    _impl->put(key, std::move(value));
+}
+
+bool up_kv_store::kv_store::erase(const up::string_view& key) const
+{
+    return _impl->erase(key);
+}
+
+void up_kv_store::kv_store::sync() const
+{
+    _impl->sync();
+}
+
+void up_kv_store::kv_store::save_index() const
+{
+    _impl->save_index();
+}
+
+void up_kv_store::kv_store::compact() const
+{
+    _impl->compact();
+}
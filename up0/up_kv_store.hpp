@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * A kv_store is a small persistent key-value store. All keys are kept in an
+ * in-memory hash index, that maps each key to the position of its latest
+ * record in an append-only data file. Hence, a lookup requires at most one
+ * read, and an update requires exactly one write.
+ *
+ * Overwritten and erased records remain in the data file until compact is
+ * invoked. Compaction rewrites all live records into a new file, and replaces
+ * the data file atomically. It only blocks other operations while copying
+ * the records written concurrently, so it can be run in a background thread.
+ *
+ * The index can be saved as a snapshot. On startup, the snapshot is loaded
+ * and only the records written afterwards are scanned.
+ */
+
+#include "up_buffer.hpp"
+#include "up_fs.hpp"
+#include "up_optional.hpp"
+
+
+namespace up_kv_store
+{
+
+    class kv_store final
+    {
+    public: // --- scope ---
+        using self = kv_store;
+        class impl;
+    private: // --- state ---
+        std::shared_ptr<impl> _impl;
+    public: // --- life ---
+        explicit kv_store(up::fs::origin directory);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        auto size() const -> std::size_t;
+        // number of bytes in the data file used by obsolete records
+        auto garbage() const -> uint64_t;
+        auto get(const up::string_view& key) const -> up::optional<up::buffer>;
+        void put(const up::string_view& key, up::chunk::from value) const;
+        bool erase(const up::string_view& key) const;
+        void sync() const;
+        void save_index() const;
+        void compact() const;
+    };
+
+}
+
+namespace up
+{
+
+    using up_kv_store::kv_store;
+
+}
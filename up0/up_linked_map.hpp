@@ -10,6 +10,10 @@
  * std::list. However, not all list operations are implemented in the expected
  * way (e.g. splice), and it is unclear, whether all these operations are
  * actually useful.
+ *
+ * The bucket array is only allocated, when the map grows beyond small_size
+ * entries (unless a bucket count is passed to the constructor). Small maps
+ * are searched linearly along the list, comparing the cached hash values.
  */
 
 #include "up_ints.hpp"
@@ -51,6 +55,19 @@ namespace up_linked_map
         {
             up::swap_noexcept(_list_prev, rhs._list_prev);
             up::swap_noexcept(_list_next, rhs._list_next);
+            _relink(rhs);
+            rhs._relink(*this);
+        }
+    private:
+        // the first and the last node still refer to the previous root
+        void _relink(list_root& previous) noexcept
+        {
+            if (_list_next == &previous) {
+                _list_prev = _list_next = this;
+            } else {
+                _list_next->_list_prev = this;
+                _list_prev->_list_next = this;
+            }
         }
     };
 
@@ -231,6 +248,7 @@ namespace up_linked_map
         };
         using reverse_iterator = std::reverse_iterator<iterator>;
         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        static const constexpr size_type small_size = 8;
     private:
         using self = linked_map;
         class node final : public list_node, public hash_node
@@ -670,6 +688,29 @@ namespace up_linked_map
         {
             return _find_node(_hasher(key), key) ? 1 : 0;
         }
+        /* Lookups with other key types (e.g. views) without constructing a
+         * key, if both the hasher and the predicate are transparent. The
+         * hasher has to return the same values for equal keys. */
+        template <typename K, typename H = hasher, typename E = key_equal,
+            typename = typename H::is_transparent, typename = typename E::is_transparent>
+        auto find(const K& key) -> iterator
+        {
+            list_node* node = _find_node(_hasher(key), key);
+            return iterator(node ? node : &_list);
+        }
+        template <typename K, typename H = hasher, typename E = key_equal,
+            typename = typename H::is_transparent, typename = typename E::is_transparent>
+        auto find(const K& key) const -> const_iterator
+        {
+            list_node* node = _find_node(_hasher(key), key);
+            return const_iterator(node ? node : &_list);
+        }
+        template <typename K, typename H = hasher, typename E = key_equal,
+            typename = typename H::is_transparent, typename = typename E::is_transparent>
+        auto count(const K& key) const -> size_type
+        {
+            return _find_node(_hasher(key), key) ? 1 : 0;
+        }
         auto equal_range(const key_type& key) -> std::pair<iterator, iterator>
         {
             auto p = find(key);
@@ -725,6 +766,12 @@ namespace up_linked_map
             }
         }
 
+        // bucket interface
+        auto bucket_count() const noexcept -> size_type
+        {
+            return _bucket_count;
+        }
+
         // hash policy
         float load_factor() const noexcept
         {
@@ -779,9 +826,17 @@ namespace up_linked_map
         }
 
     private:
-        auto _find_node(size_type hash, const key_type& key) const -> node*
+        template <typename K>
+        auto _find_node(size_type hash, const K& key) const -> node*
         {
-            if (_bucket_count) {
+            if (_bucket_count == 0) {
+                for (auto i = _list._list_next; i != &_list; i = i->_list_next) {
+                    auto n = static_cast<node*>(i);
+                    if (n->_hash == hash && _equal(n->_value.first, key)) {
+                        return n;
+                    }
+                }
+            } else {
                 auto bucket = &_buckets[hash % _bucket_count];
                 for (auto i = bucket->_hash_next; i != bucket; i = i->_hash_next) {
                     auto n = static_cast<node*>(i);
@@ -848,7 +903,7 @@ namespace up_linked_map
         }
         auto _put_node(list_node* position, std::unique_ptr<node> n) -> iterator
         {
-            if (_bucket_count == 0 || _size >= _bucket_count * _max_load_factor) {
+            if (_bucket_count == 0 ? _size >= small_size : _size >= _bucket_count * _max_load_factor) {
                 using sizes = up::ints::domain<size_type>::or_length_error;
                 reserve(sizes::sum(_size, _size / 2, 1));
             }
@@ -857,9 +912,11 @@ namespace up_linked_map
             _list_link(position->_list_prev, node);
             _list_link(node, position);
             // link into hash chains (somewhere)
-            auto bucket = &_buckets[node->_hash % _bucket_count];
-            _hash_link(bucket->_hash_prev, node);
-            _hash_link(node, bucket);
+            if (_bucket_count) {
+                auto bucket = &_buckets[node->_hash % _bucket_count];
+                _hash_link(bucket->_hash_prev, node);
+                _hash_link(node, bucket);
+            }
             ++_size;
             return iterator(node);
         }
@@ -867,7 +924,9 @@ namespace up_linked_map
         {
             std::unique_ptr<node> n(static_cast<node*>(const_cast<list_node*>(position)));
             _list_link(n->_list_prev, n->_list_next);
-            _hash_link(n->_hash_prev, n->_hash_next);
+            if (_bucket_count) {
+                _hash_link(n->_hash_prev, n->_hash_next);
+            }
             --_size;
             return n;
         }
@@ -896,15 +955,12 @@ namespace up_linked_map
         void _do_rehash(size_type bucket_count)
         {
             auto buckets = std::make_unique<hash_root[]>(bucket_count);
-            for (size_type i = 0; i != _bucket_count; ++i) {
-                auto source = &_buckets[i];
-                for (auto i = source->_hash_next; i != source;) {
-                    auto n = static_cast<node*>(i);
-                    i = i->_hash_next;
-                    auto target = &buckets[n->_hash % bucket_count];
-                    _hash_link(target->_hash_prev, n);
-                    _hash_link(n, target);
-                }
+            // the hash chains might not exist yet (see small_size)
+            for (auto i = _list._list_next; i != &_list; i = i->_list_next) {
+                auto n = static_cast<node*>(i);
+                auto target = &buckets[n->_hash % bucket_count];
+                _hash_link(target->_hash_prev, n);
+                _hash_link(n, target);
             }
             up::swap_noexcept(bucket_count, _bucket_count);
             up::swap_noexcept(buckets, _buckets);
@@ -0,0 +1,91 @@
+#include "up_log_file.hpp"
+
+#include <cstring>
+
+#include "up_char_cast.hpp"
+#include "up_exception.hpp"
+#include "up_hash.hpp"
+#include "up_ints.hpp"
+
+
+up_log_file::header::header(up::chunk::from_bulk_t&& payload)
+{
+    auto&& encoded = up::vlq::encode(uint64_t(payload.total()));
+    _size = std::get<0>(encoded);
+    std::memcpy(_data, std::get<1>(encoded).data(), _size);
+    uint32_t crc = up::crc32(std::move(payload), up::crc32({_data, _size}));
+    for (std::size_t i = 0; i != checksum_size; ++i) {
+        _data[_size++] = static_cast<char>((crc >> (8 * i)) & 0xff);
+    }
+}
+
+
+auto up_log_file::parse(up::chunk::from chunk, up::chunk::from& payload, std::size_t& total) -> status
+{
+    auto&& decoded = up::vlq::try_decode<uint64_t>(chunk);
+    if (std::get<0>(decoded) == up::vlq_status::incomplete) {
+        return status::incomplete;
+    } else if (std::get<0>(decoded) == up::vlq_status::overflow) {
+        return status::corrupt;
+    }
+    uint64_t length = std::get<1>(decoded);
+    std::size_t length_size = std::get<2>(decoded);
+    std::size_t available = chunk.size() - length_size;
+    if (available < checksum_size || available - checksum_size < length) {
+        return status::incomplete;
+    }
+    const char* data = chunk.data() + length_size + checksum_size;
+    uint32_t crc = up::crc32({data, length}, up::crc32({chunk.data(), length_size}));
+    total = length_size + checksum_size + length;
+    auto p = up::char_cast<unsigned char>(chunk.data() + length_size);
+    for (std::size_t i = 0; i != checksum_size; ++i) {
+        if (p[i] != ((crc >> (8 * i)) & 0xff)) {
+            return status::corrupt;
+        }
+    }
+    payload = {data, length};
+    return status::complete;
+}
+
+
+auto up_log_file::acquire_lock(const up::fs::origin& directory) -> up::fs::file::lock
+{
+    using option = up::fs::file::option;
+    auto file = up::fs::file(up::fs::location(directory, "lock"), {option::read, option::write, option::create});
+    return file.acquire_lock(true, false);
+}
+
+void up_log_file::fsync_directory(const up::fs::origin& directory)
+{
+    up::fs::directory(up::fs::location(directory, ".")).fsync();
+}
+
+
+auto up_log_file::recover(const up::fs::file& file, std::size_t offset, up::source corrupt, const visitor& visitor)
+    -> std::size_t
+{
+    std::size_t size = up::ints::caster(file.stat().size());
+    if (offset == size) {
+        return offset;
+    }
+    auto mapping = file.map(size, 0, false);
+    while (offset != size) {
+        up::chunk::from payload(nullptr, 0);
+        std::size_t total = 0;
+        auto rv = parse({mapping.data() + offset, size - offset}, payload, total);
+        if (rv == status::complete) {
+            visitor(offset, total, payload);
+            offset += total;
+        } else if (rv == status::incomplete || total == size - offset) {
+            break;
+        } else {
+            /* A crash during a write can only damage the last record. */
+            throw up::make_exception(std::move(corrupt)).with(offset, size);
+        }
+    }
+    if (offset != size) {
+        file.truncate(up::ints::caster(offset));
+        file.fdatasync();
+    }
+    return offset;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+ * This file contains the parts shared by the append-only files of
+ * record_log and kv_store: the framing of the records, the lock file, and
+ * the recovery after a crash. It is not intended for other uses.
+ *
+ * Each record starts with the length of the payload (as VLQ), followed by
+ * the CRC-32 of the encoded length and the payload (little endian).
+ */
+
+#include <functional>
+
+#include "up_fs.hpp"
+#include "up_vlq.hpp"
+
+
+namespace up_log_file
+{
+
+    const std::size_t max_length_size = up::vlq::max_size<uint64_t>();
+    const std::size_t checksum_size = 4;
+    const std::size_t max_header_size = max_length_size + checksum_size;
+
+
+    class header final
+    {
+    public: // --- state ---
+        char _data[max_header_size];
+        std::size_t _size = 0;
+    public: // --- life ---
+        explicit header() = default;
+        // the chunks are consumed for computing the checksum
+        explicit header(up::chunk::from_bulk_t&& payload);
+    public: // --- operations ---
+        operator up::chunk::from() const
+        {
+            return {_data, _size};
+        }
+    };
+
+
+    enum class status : uint8_t { complete, incomplete, corrupt, };
+
+    /* Parses the record at the beginning of the given chunk. On success, the
+     * payload and the total size of the record are returned. The total size
+     * is also returned for a record with a checksum mismatch. */
+    auto parse(up::chunk::from chunk, up::chunk::from& payload, std::size_t& total) -> status;
+
+
+    // exclusive lock of the directory (held as long as the result exists)
+    auto acquire_lock(const up::fs::origin& directory) -> up::fs::file::lock;
+
+    void fsync_directory(const up::fs::origin& directory);
+
+
+    using visitor = std::function<void(std::size_t offset, std::size_t total, up::chunk::from payload)>;
+
+    /* Scans the records of the file from the given offset, and invokes the
+     * visitor for each complete record. An incomplete record at the end, or
+     * a corrupt one extending to the end (i.e. a torn write during a crash),
+     * is truncated. Any other corrupt record raises an exception with the
+     * given source, because truncating the file would silently discard all
+     * following records. Returns the end of the last complete record. */
+    auto recover(const up::fs::file& file, std::size_t offset, up::source corrupt, const visitor& visitor)
+        -> std::size_t;
+
+}
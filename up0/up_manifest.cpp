@@ -0,0 +1,541 @@
+#include "up_manifest.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "up_exception.hpp"
+#include "up_hash.hpp"
+#include "up_ints.hpp"
+#include "up_vlq.hpp"
+
+
+namespace
+{
+
+    using entry = up::manifest::entry;
+    using option = up::fs::file::option;
+
+
+    /* The binary format starts with a magic number and the number of
+     * entries. The paths are prefix compressed, i.e. each entry starts with
+     * the length of the prefix shared with the previous path and the length
+     * of the remaining suffix (both as VLQ), followed by the suffix. The
+     * kind is stored as a single byte, followed by inode, size and the
+     * modification time (in nanoseconds, zigzag encoded) as VLQ. The last
+     * field is a flag byte, optionally followed by the digest. The format
+     * ends with the CRC-32 of everything before (little endian). */
+    const uint64_t magic = 0x74736566696e616d; // "manifest"
+    const std::size_t checksum_size = 4;
+    const std::size_t read_size = 1 << 16;
+
+
+    /* Entries are ordered by path, but the separator sorts before all other
+     * characters. That way, each subtree forms a contiguous range directly
+     * after the directory itself. */
+    bool path_less(const up::string_view& lhs, const up::string_view& rhs)
+    {
+        auto&& key = [](char c) {
+            return c == '/' ? 0 : static_cast<unsigned char>(c) + 1;
+        };
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+            [&key](char a, char b) { return key(a) < key(b); });
+    }
+
+    auto entry_less = [](const entry& lhs, const entry& rhs) {
+        return path_less(lhs.path(), rhs.path());
+    };
+
+
+    auto join(const up::shared_string& directory, const up::shared_string& name) -> up::shared_string
+    {
+        if (directory.empty()) {
+            return name;
+        }
+        up::unique_string result;
+        result.reserve(directory.size() + 1 + name.size());
+        result.append(directory).append(1, '/').append(name);
+        return up::shared_string(std::move(result));
+    }
+
+    auto to_nanoseconds(up::system_time_point value) -> int64_t
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(value.time_since_epoch()).count();
+    }
+
+    auto from_nanoseconds(int64_t value) -> up::system_time_point
+    {
+        return up::system_time_point(
+            std::chrono::duration_cast<up::system_time_point::duration>(std::chrono::nanoseconds(value)));
+    }
+
+    auto stats_kind(const up::fs::stats& stats) -> up::fs::kind
+    {
+        using kind = up::fs::kind;
+        for (auto k : {kind::regular_file, kind::directory, kind::symbolic_link, kind::block_device,
+                kind::character_device, kind::named_pipe, kind::socket}) {
+            if (stats.is_kind(k)) {
+                return k;
+            }
+        }
+        return kind::unknown;
+    }
+
+    auto make_entry(const up::fs::stats& stats, up::shared_string path) -> entry
+    {
+        return entry(std::move(path), stats_kind(stats),
+            up::ints::caster(stats.inode()), up::ints::caster(stats.size()), stats.mtime());
+    }
+
+    /* Entries might be removed concurrently, e.g. between listing the
+     * directory and the following stat. The result is empty in this case,
+     * i.e. the exception is only propagated if the entry still exists. */
+    template <typename Function>
+    auto unless_gone(const up::fs::location& location, Function&& function)
+        -> up::optional<decltype(function())>
+    {
+        try {
+            return function();
+        } catch (...) {
+            if (location.exists()) {
+                throw;
+            }
+            return up::nullopt;
+        }
+    }
+
+
+    void append_fixed(up::buffer& buffer, uint64_t value, std::size_t size)
+    {
+        char data[8];
+        for (std::size_t i = 0; i != size; ++i) {
+            data[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+        buffer.append({data, size});
+    }
+
+    auto checksum(const char* data, std::size_t size) -> uint32_t
+    {
+        return up::crc32({data, size});
+    }
+
+
+    // sequential decoder, that throws on malformed input
+    class decoder final
+    {
+    private: // --- state ---
+        const char* _data;
+        std::size_t _size;
+    public: // --- life ---
+        explicit decoder(const char* data, std::size_t size)
+            : _data(data), _size(size)
+        { }
+    public: // --- operations ---
+        auto size() const { return _size; }
+        auto fixed(std::size_t size) -> uint64_t
+        {
+            auto p = bytes(size);
+            uint64_t value = 0;
+            for (std::size_t i = 0; i != size; ++i) {
+                value |= uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+            }
+            return value;
+        }
+        auto vlq() -> uint64_t
+        {
+            auto&& decoded = up::vlq::try_decode<uint64_t>({_data, _size});
+            if (std::get<0>(decoded) == up::vlq_status::incomplete) {
+                _fail("truncated");
+            } else if (std::get<0>(decoded) == up::vlq_status::overflow) {
+                _fail("vlq-overflow");
+            }
+            bytes(std::get<2>(decoded));
+            return std::get<1>(decoded);
+        }
+        auto bytes(uint64_t size) -> const char*
+        {
+            if (_size < size) {
+                _fail("truncated");
+            }
+            auto result = _data;
+            _data += size;
+            _size -= size;
+            return result;
+        }
+    private:
+        [[noreturn]]
+        void _fail(const char* reason)
+        {
+            throw up::make_exception("manifest-corrupt").with(reason, _size);
+        }
+    };
+
+
+    // computes the missing digests of the given entries in parallel
+    class hash_jobs final
+    {
+    private: // --- state ---
+        const up::fs::origin& _root;
+        std::vector<entry*> _entries;
+        std::atomic<std::size_t> _next;
+        std::exception_ptr _error;
+        std::mutex _mutex;
+    public: // --- life ---
+        explicit hash_jobs(const up::fs::origin& root, std::vector<entry*> entries)
+            : _root(root), _entries(std::move(entries)), _next(0)
+        { }
+    public: // --- operations ---
+        void run(std::size_t threads)
+        {
+            threads = std::min(threads, _entries.size());
+            std::vector<std::thread> workers;
+            workers.reserve(threads);
+            try {
+                /* The current thread is one of the workers. */
+                for (std::size_t i = 1; i < threads; ++i) {
+                    workers.emplace_back([this]() { _work(); });
+                }
+            } catch (...) {
+                _stop(std::current_exception());
+            }
+            _work();
+            for (auto&& worker : workers) {
+                worker.join();
+            }
+            if (_error) {
+                std::rethrow_exception(_error);
+            }
+        }
+    private:
+        void _stop(std::exception_ptr error)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) {
+                _error = std::move(error);
+            }
+            _next = _entries.size();
+        }
+        void _work()
+        {
+            try {
+                auto buffer = std::make_unique<char[]>(read_size);
+                for (;;) {
+                    std::size_t i = _next++;
+                    if (i >= _entries.size()) {
+                        return;
+                    }
+                    _hash(*_entries[i], buffer.get());
+                }
+            } catch (...) {
+                _stop(std::current_exception());
+            }
+        }
+        void _hash(entry& item, char* buffer)
+        {
+            auto location = up::fs::location(_root, item.path());
+            auto file = unless_gone(location, [&location]() { return up::fs::file(location, {option::read}); });
+            if (!file) {
+                return; // removed in the meantime, i.e. no digest
+            }
+            up::sha256::hasher hasher;
+            off_t offset = 0;
+            for (;;) {
+                std::size_t n = file->read_some({buffer, read_size}, offset);
+                if (n == 0) {
+                    break;
+                }
+                hasher.update({buffer, n});
+                offset += n;
+            }
+            /* If the file has been modified in the meantime, the digest is
+             * left out. It will be computed by the next scan. */
+            auto stats = file->stat();
+            uint64_t inode = up::ints::caster(stats.inode());
+            uint64_t size = up::ints::caster(stats.size());
+            if (inode == item.inode() && size == item.size() && stats.mtime() == item.mtime()) {
+                item.digest(hasher.finish());
+            }
+        }
+    };
+
+
+    class scanner final
+    {
+    private: // --- state ---
+        const up::manifest& _previous;
+        std::vector<entry> _result;
+    public: // --- life ---
+        explicit scanner(const up::manifest& previous)
+            : _previous(previous)
+        { }
+    public: // --- operations ---
+        auto result() -> std::vector<entry>& { return _result; }
+        void directory(const up::fs::origin& origin, const up::shared_string& path, const entry* previous)
+        {
+            std::vector<up::shared_string> names;
+            if (previous) {
+                /* The set of names can only be reused, if the directory has
+                 * not been replaced or modified. */
+                names = _previous_names(path);
+            } else {
+                for (auto&& item : up::fs::location(origin, ".").list()) {
+                    names.push_back(item.name());
+                }
+            }
+            for (auto&& name : names) {
+                auto location = up::fs::location(origin, name);
+                auto stats = unless_gone(location, [&location]() { return location.stat(); });
+                if (!stats) {
+                    continue; // removed in the meantime
+                }
+                auto child = join(path, name);
+                _result.push_back(make_entry(*stats, child));
+                auto& item = _result.back();
+                auto old = _previous.find(child);
+                if (old && old->digest() && old->same_metadata(item)) {
+                    item.digest(*old->digest());
+                }
+                if (item.kind() == up::fs::kind::directory) {
+                    bool unchanged = old && old->same_metadata(item);
+                    auto nested = unless_gone(location, [&]() { return origin.resolved(name); });
+                    if (nested) {
+                        directory(*nested, child, unchanged ? old : nullptr);
+                    } else {
+                        _result.pop_back();
+                    }
+                }
+            }
+        }
+    private:
+        auto _previous_names(const up::shared_string& path) -> std::vector<up::shared_string>
+        {
+            std::vector<up::shared_string> result;
+            auto&& entries = _previous.entries();
+            up::unique_string prefix(path);
+            prefix.append(1, '/');
+            auto p = std::lower_bound(entries.begin(), entries.end(), prefix,
+                [](const entry& lhs, const up::string_view& rhs) { return path_less(lhs.path(), rhs); });
+            for (; p != entries.end(); ++p) {
+                up::string_view view = p->path();
+                if (view.compare(0, prefix.size(), prefix) != 0) {
+                    break;
+                }
+                view.remove_prefix(prefix.size());
+                if (view.find('/') == up::string_view::npos) {
+                    result.emplace_back(view);
+                }
+            }
+            return result;
+        }
+    };
+
+}
+
+
+up_manifest::manifest::manifest(std::vector<entry> entries)
+    : _entries(std::move(entries))
+{
+    std::sort(_entries.begin(), _entries.end(), entry_less);
+}
+
+auto up_manifest::manifest::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "manifest",
+        up::invoke_to_insight_with_fallback(_entries.size()));
+}
+
+auto up_manifest::manifest::entries() const -> const std::vector<entry>&
+{
+    return _entries;
+}
+
+auto up_manifest::manifest::find(const up::string_view& path) const -> const entry*
+{
+    auto p = std::lower_bound(_entries.begin(), _entries.end(), path,
+        [](const entry& lhs, const up::string_view& rhs) { return path_less(lhs.path(), rhs); });
+    return p != _entries.end() && up::string_view(p->path()) == path ? &*p : nullptr;
+}
+
+auto up_manifest::manifest::compare(const self& previous) const -> changes
+{
+    changes result;
+    auto p = _entries.begin();
+    auto q = previous._entries.begin();
+    while (p != _entries.end() || q != previous._entries.end()) {
+        if (q == previous._entries.end() || (p != _entries.end() && entry_less(*p, *q))) {
+            result.emplace_back(p->path(), change::added);
+            ++p;
+        } else if (p == _entries.end() || entry_less(*q, *p)) {
+            result.emplace_back(q->path(), change::removed);
+            ++q;
+        } else {
+            bool modified;
+            if (p->kind() != q->kind()) {
+                modified = true;
+            } else if (p->kind() == up::fs::kind::directory) {
+                /* Changes of directories are reflected by their entries. */
+                modified = false;
+            } else if (p->digest() && q->digest()) {
+                auto&& a = *p->digest();
+                auto&& b = *q->digest();
+                modified = std::memcmp(a.data(), b.data(), a.size()) != 0;
+            } else {
+                modified = !p->same_metadata(*q);
+            }
+            if (modified) {
+                result.emplace_back(p->path(), change::modified);
+            }
+            ++p;
+            ++q;
+        }
+    }
+    return result;
+}
+
+auto up_manifest::manifest::encode() const -> up::buffer
+{
+    up::buffer buffer;
+    append_fixed(buffer, magic, 8);
+    buffer.append(up::vlq::encoded<uint64_t>(_entries.size()));
+    up::string_view last;
+    for (auto&& item : _entries) {
+        up::string_view path = item.path();
+        auto n = std::min(last.size(), path.size());
+        auto shared = std::mismatch(last.begin(), last.begin() + n, path.begin()).first - last.begin();
+        buffer.append(up::vlq::encoded<uint64_t>(shared));
+        buffer.append(up::vlq::encoded<uint64_t>(path.size() - shared));
+        buffer.append({path.data() + shared, path.size() - shared});
+        append_fixed(buffer, static_cast<uint8_t>(item.kind()), 1);
+        buffer.append(up::vlq::encoded<uint64_t>(item.inode()));
+        buffer.append(up::vlq::encoded<uint64_t>(item.size()));
+        int64_t mtime = to_nanoseconds(item.mtime());
+        uint64_t zigzag = (static_cast<uint64_t>(mtime) << 1) ^ static_cast<uint64_t>(mtime >> 63);
+        buffer.append(up::vlq::encoded<uint64_t>(zigzag));
+        append_fixed(buffer, item.digest() ? 1 : 0, 1);
+        if (item.digest()) {
+            buffer.append({item.digest()->data(), item.digest()->size()});
+        }
+        last = path;
+    }
+    append_fixed(buffer, checksum(buffer.warm(), buffer.available()), checksum_size);
+    return buffer;
+}
+
+auto up_manifest::manifest::decode(up::chunk::from chunk) -> self
+{
+    if (chunk.size() < checksum_size
+        || decoder(chunk.data() + chunk.size() - checksum_size, checksum_size).fixed(checksum_size)
+            != checksum(chunk.data(), chunk.size() - checksum_size)) {
+        throw up::make_exception("manifest-bad-checksum").with(chunk.size());
+    }
+    decoder d(chunk.data(), chunk.size() - checksum_size);
+    if (d.fixed(8) != magic) {
+        throw up::make_exception("manifest-bad-magic");
+    }
+    uint64_t count = d.vlq();
+    std::vector<entry> entries;
+    entries.reserve(up::ints::caster(std::min<uint64_t>(count, d.size())));
+    up::unique_string path;
+    for (uint64_t i = 0; i != count; ++i) {
+        uint64_t shared = d.vlq();
+        uint64_t suffix = d.vlq();
+        if (shared > path.size()) {
+            throw up::make_exception("manifest-corrupt").with("bad-prefix", shared, path.size());
+        }
+        path.resize(up::ints::caster(shared));
+        path.append(d.bytes(suffix), up::ints::caster(suffix));
+        auto value = d.fixed(1);
+        if (value > static_cast<uint8_t>(up::fs::kind::socket)) {
+            throw up::make_exception("manifest-corrupt").with("bad-kind", value, path);
+        }
+        auto kind = static_cast<up::fs::kind>(value);
+        uint64_t inode = d.vlq();
+        uint64_t size = d.vlq();
+        uint64_t mtime = d.vlq();
+        entries.emplace_back(up::shared_string(path), kind, inode, size,
+            from_nanoseconds(static_cast<int64_t>((mtime >> 1) ^ (~(mtime & 1) + 1))));
+        if (d.fixed(1)) {
+            entry::digest_type digest;
+            up::chunk::into into = digest;
+            std::memcpy(into.data(), d.bytes(into.size()), into.size());
+            entries.back().digest(digest);
+        }
+        if (i != 0 && !entry_less(entries[i - 1], entries[i])) {
+            throw up::make_exception("manifest-corrupt").with("bad-order", path);
+        }
+    }
+    if (d.size() != 0) {
+        throw up::make_exception("manifest-corrupt").with("trailing-data", d.size());
+    }
+    self result;
+    result._entries = std::move(entries);
+    return result;
+}
+
+auto up_manifest::manifest::load(const up::fs::origin& directory, const up::shared_string& name) -> self
+{
+    auto file = up::fs::file(up::fs::location(directory, name), {option::read});
+    std::size_t size = up::ints::caster(file.stat().size());
+    if (size == 0) {
+        return decode({nullptr, 0});
+    }
+    auto mapping = file.map(size, 0, false);
+    return decode({mapping.data(), size});
+}
+
+void up_manifest::manifest::store(const up::fs::origin& directory, const up::shared_string& name) const
+{
+    auto buffer = encode();
+    auto temp = up::fs::location(directory, up::shared_string(up::unique_string(name).append(".tmp")));
+    auto file = up::fs::file(temp, {option::write, option::create, option::truncate});
+    file.write_all(buffer, 0);
+    file.fdatasync();
+    temp.rename(up::fs::location(directory, name), true);
+    // make the rename durable
+    up::fs::directory(up::fs::location(directory, ".")).fsync();
+}
+
+auto up_manifest::manifest::scan(const up::fs::origin& root, const self& previous, std::size_t threads) -> self
+{
+    scanner s(previous);
+    /* The root directory is always listed, because there is no entry to
+     * compare with. */
+    s.directory(root, up::shared_string(), nullptr);
+    auto& entries = s.result();
+    std::sort(entries.begin(), entries.end(), entry_less);
+    if (threads) {
+        std::vector<entry*> missing;
+        for (auto&& item : entries) {
+            if (item.kind() == up::fs::kind::regular_file && !item.digest()) {
+                missing.push_back(&item);
+            }
+        }
+        hash_jobs(root, std::move(missing)).run(threads);
+    }
+    self result;
+    result._entries = std::move(entries);
+    return result;
+}
+
+
+auto up_manifest::manifest::entry::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "manifest-entry",
+        up::invoke_to_insight_with_fallback(_path),
+        up::invoke_to_insight_with_fallback(_kind),
+        up::invoke_to_insight_with_fallback(_inode),
+        up::invoke_to_insight_with_fallback(_size),
+        up::invoke_to_insight_with_fallback(_mtime));
+}
+
+bool up_manifest::manifest::entry::same_metadata(const self& rhs) const
+{
+    return _path == rhs._path
+        && _kind == rhs._kind
+        && _inode == rhs._inode
+        && _size == rhs._size
+        && _mtime == rhs._mtime;
+}
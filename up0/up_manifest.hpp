@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * A manifest describes a directory tree: For each entry, it contains the
+ * relative path, the kind, the inode, the size, the modification time, and
+ * optionally the SHA-256 digest of regular files. Manifests can be stored in
+ * a compact binary format.
+ *
+ * The main purpose is incremental change detection. When scanning a tree,
+ * the previous manifest is used to avoid work: Directories with unchanged
+ * inode and modification time are not listed again, because their set of
+ * names can not have changed. Their entries are still checked with stat,
+ * because modifying a file does not change the modification time of its
+ * directory. Digests are only recomputed for files with changed metadata,
+ * and these files are hashed in parallel.
+ */
+
+#include "up_buffer.hpp"
+#include "up_fs.hpp"
+#include "up_optional.hpp"
+#include "up_secure_hash.hpp"
+
+
+namespace up_manifest
+{
+
+    class manifest final
+    {
+    public: // --- scope ---
+        using self = manifest;
+        class entry;
+        enum class change : uint8_t { added, removed, modified, };
+        using changes = std::vector<std::pair<up::shared_string, change>>;
+    private: // --- state ---
+        // sorted by path
+        std::vector<entry> _entries;
+    public: // --- life ---
+        explicit manifest() = default;
+        explicit manifest(std::vector<entry> entries);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_entries, rhs._entries);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        auto entries() const -> const std::vector<entry>&;
+        auto find(const up::string_view& path) const -> const entry*;
+        // differences from the given previous manifest (sorted by path)
+        auto compare(const self& previous) const -> changes;
+        auto encode() const -> up::buffer;
+        static auto decode(up::chunk::from chunk) -> self;
+        static auto load(const up::fs::origin& directory, const up::shared_string& name) -> self;
+        // replaces the file atomically (using a temporary file)
+        void store(const up::fs::origin& directory, const up::shared_string& name) const;
+        /* Scans the tree below the given directory. If threads is zero, no
+         * digests are computed. Otherwise, it is the number of threads used
+         * for hashing. */
+        static auto scan(const up::fs::origin& root, const self& previous, std::size_t threads) -> self;
+    };
+
+
+    class manifest::entry final
+    {
+    public: // --- scope ---
+        using self = entry;
+        using digest_type = up::sha256::digest;
+    private: // --- state ---
+        up::shared_string _path;
+        up::fs::kind _kind;
+        uint64_t _inode;
+        uint64_t _size;
+        up::system_time_point _mtime;
+        up::optional<digest_type> _digest;
+    public: // --- life ---
+        explicit entry(
+            up::shared_string path,
+            up::fs::kind kind,
+            uint64_t inode,
+            uint64_t size,
+            up::system_time_point mtime,
+            up::optional<digest_type> digest = up::nullopt)
+            : _path(std::move(path))
+            , _kind(std::move(kind))
+            , _inode(std::move(inode))
+            , _size(std::move(size))
+            , _mtime(std::move(mtime))
+            , _digest(std::move(digest))
+        { }
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_path, rhs._path);
+            up::swap_noexcept(_kind, rhs._kind);
+            up::swap_noexcept(_inode, rhs._inode);
+            up::swap_noexcept(_size, rhs._size);
+            up::swap_noexcept(_mtime, rhs._mtime);
+            up::swap_noexcept(_digest, rhs._digest);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        auto path() const -> const up::shared_string& { return _path; }
+        auto kind() const { return _kind; }
+        auto inode() const { return _inode; }
+        auto size() const { return _size; }
+        auto mtime() const { return _mtime; }
+        auto digest() const -> const up::optional<digest_type>& { return _digest; }
+        void digest(up::optional<digest_type> value) { _digest = std::move(value); }
+        // compares everything except the digest
+        bool same_metadata(const self& rhs) const;
+    };
+
+}
+
+namespace up
+{
+
+    using up_manifest::manifest;
+
+}
@@ -16,6 +16,41 @@ up_nts::nts::nts(const up::string_view& s)
 { }
 
 up_nts::nts::nts(const char* data, size_type size)
+{
+    _assign(data, size);
+}
+
+up_nts::nts::nts(std::nullptr_t) noexcept
+{
+    _assign(nullptr);
+}
+
+up_nts::nts::~nts() noexcept
+{
+    switch (_mode()) {
+    case mode::internal:
+        break;
+    case mode::external:
+        if (_handle._padded._ref._data) {
+            ::operator delete(_handle._padded._ref._data, _handle._padded._ref._size);
+        } // else: nothing
+        break;
+    case mode::shared:
+        up::string_repr::storage_deleter<false>()(const_cast<storage*>(_handle._padded._ref._storage));
+        break;
+    }
+}
+
+up_nts::nts::operator const char*() const
+{
+    if (_mode() == mode::internal) {
+        return _handle._data.data();
+    } else {
+        return _handle._padded._ref._data;
+    }
+}
+
+void up_nts::nts::_assign(const char* data, size_type size)
 {
     if (size < handle_size) {
         std::memcpy(_handle._data.data(), data, size);
@@ -26,29 +61,25 @@ up_nts::nts::nts(const char* data, size_type size)
         _handle._padded._ref._data = static_cast<char*>(::operator new(_handle._padded._ref._size));
         std::memcpy(_handle._padded._ref._data, data, size);
         _handle._padded._ref._data[size] = 0;
-        std::memset(_handle._padded._pad.data(), 1, handle_size - sizeof(ref));
+        _handle._padded._ref._storage = nullptr;
+        std::memset(_handle._padded._pad.data(), char(mode::external), handle_size - sizeof(ref));
     }
 }
 
-up_nts::nts::nts(std::nullptr_t) noexcept
+void up_nts::nts::_assign(std::nullptr_t) noexcept
 {
     _handle._padded._ref._size = 0;
     _handle._padded._ref._data = nullptr;
-    std::memset(_handle._padded._pad.data(), 1, handle_size - sizeof(ref));
+    _handle._padded._ref._storage = nullptr;
+    std::memset(_handle._padded._pad.data(), char(mode::external), handle_size - sizeof(ref));
 }
 
-up_nts::nts::~nts() noexcept
+void up_nts::nts::_assign(const storage& storage) noexcept
 {
-    if (_handle._data[handle_size - 1] && _handle._padded._ref._data) {
-        ::operator delete(_handle._padded._ref._data, _handle._padded._ref._size);
-    } // else: nothing
-}
-
-up_nts::nts::operator const char*() const
-{
-    if (_handle._data[handle_size - 1]) {
-        return _handle._padded._ref._data;
-    } else {
-        return _handle._data.data();
-    }
+    // the contents are immutable (and NUL-terminated) as long as the storage is shared
+    storage.acquire();
+    _handle._padded._ref._size = storage.size();
+    _handle._padded._ref._data = const_cast<char*>(storage.data());
+    _handle._padded._ref._storage = &storage;
+    std::memset(_handle._padded._pad.data(), char(mode::shared), handle_size - sizeof(ref));
 }
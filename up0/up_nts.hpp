@@ -2,21 +2,31 @@
 
 #include <array>
 
+#include "up_string.hpp"
 #include "up_string_view.hpp"
 #include "up_swap.hpp"
 
 namespace up_nts
 {
 
+    /**
+     * Short strings are copied into the object, and long strings are copied
+     * to the heap. Strings with shared external storage are NUL-terminated,
+     * and they are used in place (holding a reference to the storage).
+     */
     class nts final
     {
     private: // --- scope ---
         using self = nts;
         using size_type = std::size_t;
+        using storage = up::string_repr::storage;
+        // the last byte of the handle distinguishes the modes
+        enum class mode : char { internal = 0, external = 1, shared = 2 };
         struct ref
         {
             char* _data;
             size_type _size;
+            const storage* _storage;
         };
         static const constexpr size_type handle_size = std::max<size_type>(64, sizeof(ref) * 2);
         union handle
@@ -37,6 +47,21 @@ namespace up_nts
         explicit nts(const up::string_view& s);
         explicit nts(const char* data, size_type size);
         explicit nts(std::nullptr_t) noexcept;
+        template <bool Unique, bool Nullable>
+        explicit nts(const up::string_repr::handle<Unique, Nullable>& repr)
+        {
+            if (!repr) {
+                _assign(nullptr);
+            } else if (auto ptr = repr.shared_storage(); ptr && ptr->size() >= handle_size) {
+                _assign(*ptr);
+            } else {
+                _assign(repr.data(), repr.size());
+            }
+        }
+        template <typename Repr, bool Unique>
+        explicit nts(const up::basic_string<Repr, Unique>& s)
+            : nts(s.repr())
+        { }
         nts(const self& rhs) = delete;
         nts(self&& rhs) noexcept
             : nts()
@@ -60,6 +85,14 @@ namespace up_nts
             lhs.swap(rhs);
         }
         operator const char*() const;
+    private:
+        void _assign(const char* data, size_type size);
+        void _assign(std::nullptr_t) noexcept;
+        void _assign(const storage& storage) noexcept;
+        auto _mode() const noexcept -> mode
+        {
+            return mode(_handle._data[handle_size - 1]);
+        }
     };
 
 }
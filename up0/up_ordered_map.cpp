@@ -0,0 +1 @@
+#include "up_ordered_map.hpp"
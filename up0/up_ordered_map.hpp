@@ -0,0 +1,1066 @@
+#pragma once
+
+/**
+ * An ordered_map is similar to a std::map, but it is implemented as a B+tree
+ * instead of a red-black tree. The entries are stored in wide leaf nodes,
+ * which are linked for iteration, and the inner nodes only contain the
+ * separator keys and the child pointers. Nodes are aligned to cache lines,
+ * and their size (in bytes) is a template parameter.
+ *
+ * Within an inner node, the child is found by counting the separators, that
+ * are not greater than the key. For arithmetic keys with the default
+ * comparison, this is a branch-free loop over consecutive keys, that the
+ * compiler vectorizes. Otherwise, binary search is used.
+ *
+ * Entries are relocated between and within nodes by move construction, and
+ * insertions and removals invalidate all iterators. Moving keys and mapped
+ * values must not throw. The entries are stored as pair<Key, T>, so that
+ * the keys are moved instead of copied when relocated. For that reason, the
+ * iterators do not refer to value_type. Instead, their reference type is a
+ * pair of references to the key and the mapped value, and their pointer
+ * type is a proxy holding such a pair. The inner nodes contain copies of
+ * keys. All nodes are allocated and all keys are copied before the tree is
+ * modified, so that an insertion or removal has no effect if an allocation
+ * or a copy fails.
+ *
+ * A map can be bulk-loaded from sorted input with from_sorted, which fills
+ * the leaves completely and builds the inner nodes bottom-up.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "up_ints.hpp"
+#include "up_swap.hpp"
+#include "up_utility.hpp"
+
+
+namespace up_ordered_map
+{
+
+    // pointer type of the iterators (operator-> on a pair of references)
+    template <typename Reference>
+    class arrow final
+    {
+    private: // --- state ---
+        Reference _reference;
+    public: // --- life ---
+        explicit arrow(Reference reference)
+            : _reference(reference)
+        { }
+    public: // --- operations ---
+        auto operator->() const -> const Reference*
+        {
+            return &_reference;
+        }
+    };
+
+
+    template <
+        typename Key,
+        typename T,
+        typename Compare = std::less<Key>,
+        std::size_t NodeSize = 512>
+    class ordered_map final
+    {
+    public: // --- scope ---
+        using key_type = Key;
+        using value_type = std::pair<const Key, T>;
+        using mapped_type = T;
+        using key_compare = Compare;
+        using reference = std::pair<const Key&, T&>;
+        using const_reference = std::pair<const Key&, const T&>;
+        using pointer = arrow<reference>;
+        using const_pointer = arrow<const_reference>;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+    private:
+        using self = ordered_map;
+        static const constexpr std::size_t cache_line = 64;
+        static const constexpr size_type max_depth = 48;
+        static const constexpr size_type header_size = 4 * sizeof(void*);
+        // entries are stored with a mutable key, and exposed as reference
+        using slot_type = std::pair<Key, T>;
+        static const constexpr size_type leaf_capacity = std::max(
+            size_type(4), (NodeSize - header_size) / sizeof(slot_type));
+        static const constexpr size_type inner_capacity = std::max(
+            size_type(4), (NodeSize - header_size) / (sizeof(Key) + sizeof(void*)));
+        // minimum number of entries (leaves) and separators (inner nodes) except for the root
+        static const constexpr size_type leaf_minimum = leaf_capacity / 2;
+        static const constexpr size_type inner_minimum = inner_capacity / 2;
+        static_assert(std::is_nothrow_move_constructible<slot_type>::value, "relocation must not throw");
+        static const constexpr bool vectorized =
+            std::is_arithmetic<Key>::value && std::is_same<Compare, std::less<Key>>::value;
+        class node
+        {
+        public: // --- state ---
+            size_type _count = 0;
+        };
+        class alignas(cache_line) leaf final : public node
+        {
+        public: // --- state ---
+            leaf* _prev = nullptr;
+            leaf* _next = nullptr;
+            alignas(slot_type) unsigned char _raw[leaf_capacity * sizeof(slot_type)];
+        public: // --- operations ---
+            auto slots() noexcept -> slot_type*
+            {
+                return std::launder(reinterpret_cast<slot_type*>(_raw));
+            }
+            auto slots() const noexcept -> const slot_type*
+            {
+                return std::launder(reinterpret_cast<const slot_type*>(_raw));
+            }
+        };
+        class alignas(cache_line) inner final : public node
+        {
+        public: // --- state ---
+            node* _children[inner_capacity + 1];
+            alignas(Key) unsigned char _raw[inner_capacity * sizeof(Key)];
+        public: // --- operations ---
+            auto keys() noexcept -> Key*
+            {
+                return std::launder(reinterpret_cast<Key*>(_raw));
+            }
+            auto keys() const noexcept -> const Key*
+            {
+                return std::launder(reinterpret_cast<const Key*>(_raw));
+            }
+        };
+        // path from the root to a leaf (inner nodes with the index of the child)
+        class path final
+        {
+        public: // --- state ---
+            std::pair<inner*, size_type> _steps[max_depth];
+            size_type _size = 0;
+        };
+        // nodes allocated for splitting all nodes on a path
+        class spare final
+        {
+        public: // --- state ---
+            std::unique_ptr<leaf> _leaf;
+            std::unique_ptr<inner> _inners[max_depth + 1];
+            size_type _count = 0;
+        };
+    public:
+        class iterator final
+        {
+        public: // --- scope ---
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = ordered_map::value_type;
+            using difference_type = ordered_map::difference_type;
+            using pointer = ordered_map::pointer;
+            using reference = ordered_map::reference;
+        private:
+            using self = iterator;
+            friend ordered_map;
+        private: // --- state ---
+            leaf* _leaf;
+            size_type _index;
+        public: // --- life ---
+            explicit iterator(leaf* leaf, size_type index)
+                : _leaf(leaf), _index(index)
+            { }
+        public: // --- operations ---
+            void swap(self& rhs) noexcept
+            {
+                up::swap_noexcept(_leaf, rhs._leaf);
+                up::swap_noexcept(_index, rhs._index);
+            }
+            friend void swap(self& lhs, self& rhs) noexcept
+            {
+                lhs.swap(rhs);
+            }
+            auto operator*() const -> reference
+            {
+                auto&& slot = _leaf->slots()[_index];
+                return reference(slot.first, slot.second);
+            }
+            auto operator->() const -> pointer
+            {
+                return pointer(**this);
+            }
+            auto operator++() -> self&
+            {
+                if (++_index == _leaf->_count && _leaf->_next) {
+                    _leaf = _leaf->_next;
+                    _index = 0;
+                }
+                return *this;
+            }
+            auto operator++(int) -> self
+            {
+                self result = *this;
+                ++*this;
+                return result;
+            }
+            auto operator--() -> self&
+            {
+                if (_index == 0) {
+                    _leaf = _leaf->_prev;
+                    _index = _leaf->_count;
+                }
+                --_index;
+                return *this;
+            }
+            auto operator--(int) -> self
+            {
+                self result = *this;
+                --*this;
+                return result;
+            }
+            friend bool operator==(const self& lhs, const self& rhs)
+            {
+                return lhs._leaf == rhs._leaf && lhs._index == rhs._index;
+            }
+            friend bool operator!=(const self& lhs, const self& rhs)
+            {
+                return !(lhs == rhs);
+            }
+        };
+        class const_iterator final
+        {
+        public: // --- scope ---
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = ordered_map::value_type;
+            using difference_type = ordered_map::difference_type;
+            using pointer = ordered_map::const_pointer;
+            using reference = ordered_map::const_reference;
+        private:
+            using self = const_iterator;
+            friend ordered_map;
+        private: // --- state ---
+            const leaf* _leaf;
+            size_type _index;
+        public: // --- life ---
+            explicit const_iterator(const leaf* leaf, size_type index)
+                : _leaf(leaf), _index(index)
+            { }
+            const_iterator(iterator rhs)
+                : _leaf(rhs._leaf), _index(rhs._index)
+            { }
+        public: // --- operations ---
+            void swap(self& rhs) noexcept
+            {
+                up::swap_noexcept(_leaf, rhs._leaf);
+                up::swap_noexcept(_index, rhs._index);
+            }
+            friend void swap(self& lhs, self& rhs) noexcept
+            {
+                lhs.swap(rhs);
+            }
+            auto operator*() const -> reference
+            {
+                auto&& slot = _leaf->slots()[_index];
+                return reference(slot.first, slot.second);
+            }
+            auto operator->() const -> pointer
+            {
+                return pointer(**this);
+            }
+            auto operator++() -> self&
+            {
+                if (++_index == _leaf->_count && _leaf->_next) {
+                    _leaf = _leaf->_next;
+                    _index = 0;
+                }
+                return *this;
+            }
+            auto operator++(int) -> self
+            {
+                self result = *this;
+                ++*this;
+                return result;
+            }
+            auto operator--() -> self&
+            {
+                if (_index == 0) {
+                    _leaf = _leaf->_prev;
+                    _index = _leaf->_count;
+                }
+                --_index;
+                return *this;
+            }
+            auto operator--(int) -> self
+            {
+                self result = *this;
+                --*this;
+                return result;
+            }
+            friend bool operator==(const self& lhs, const self& rhs)
+            {
+                return lhs._leaf == rhs._leaf && lhs._index == rhs._index;
+            }
+            friend bool operator!=(const self& lhs, const self& rhs)
+            {
+                return !(lhs == rhs);
+            }
+        };
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    private: // --- state ---
+        node* _root = nullptr;
+        size_type _height = 0; // number of inner levels
+        leaf* _first = nullptr;
+        leaf* _last = nullptr;
+        size_type _size = 0;
+        key_compare _less = {};
+    public: // --- life ---
+        ordered_map() noexcept = default;
+        explicit ordered_map(const key_compare& less)
+            : _less(less)
+        { }
+        template <typename InputIterator>
+        ordered_map(InputIterator first, InputIterator last, const key_compare& less = key_compare())
+            : ordered_map(less)
+        {
+            insert(first, last);
+        }
+        ordered_map(const self& rhs)
+            : ordered_map(from_sorted(rhs.begin(), rhs.end(), rhs._less))
+        { }
+        ordered_map(self&& rhs) noexcept
+            : ordered_map()
+        {
+            swap(rhs);
+        }
+        ordered_map(std::initializer_list<value_type> init, const key_compare& less = key_compare())
+            : ordered_map(init.begin(), init.end(), less)
+        { }
+        ~ordered_map() noexcept
+        {
+            clear();
+        }
+        /*
+         * Bulk-load from input sorted in strictly ascending order. An
+         * exception is thrown if the input is not sorted.
+         */
+        template <typename InputIterator>
+        static auto from_sorted(InputIterator first, InputIterator last, const key_compare& less = key_compare())
+            -> self
+        {
+            self result(less);
+            result._bulk_load(first, last);
+            return result;
+        }
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self&
+        {
+            self(rhs).swap(*this);
+            return *this;
+        }
+        auto operator=(self&& rhs) & noexcept -> self&
+        {
+            swap(rhs);
+            return *this;
+        }
+        auto operator=(std::initializer_list<value_type> init) & -> self&
+        {
+            self(init, _less).swap(*this);
+            return *this;
+        }
+
+        // size and capacity
+        bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+        auto size() const noexcept -> size_type
+        {
+            return _size;
+        }
+        auto max_size() const noexcept -> size_type
+        {
+            return ~size_type(0) / sizeof(value_type);
+        }
+
+        // iterators
+        auto begin() noexcept -> iterator
+        {
+            return iterator(_first, 0);
+        }
+        auto begin() const noexcept -> const_iterator
+        {
+            return cbegin();
+        }
+        auto end() noexcept -> iterator
+        {
+            return iterator(_last, _last ? _last->_count : 0);
+        }
+        auto end() const noexcept -> const_iterator
+        {
+            return cend();
+        }
+        auto cbegin() const noexcept -> const_iterator
+        {
+            return const_iterator(_first, 0);
+        }
+        auto cend() const noexcept -> const_iterator
+        {
+            return const_iterator(_last, _last ? _last->_count : 0);
+        }
+        auto rbegin() noexcept -> reverse_iterator
+        {
+            return reverse_iterator(end());
+        }
+        auto rbegin() const noexcept -> const_reverse_iterator
+        {
+            return crbegin();
+        }
+        auto rend() noexcept -> reverse_iterator
+        {
+            return reverse_iterator(begin());
+        }
+        auto rend() const noexcept -> const_reverse_iterator
+        {
+            return crend();
+        }
+        auto crbegin() const noexcept -> const_reverse_iterator
+        {
+            return const_reverse_iterator(cend());
+        }
+        auto crend() const noexcept -> const_reverse_iterator
+        {
+            return const_reverse_iterator(cbegin());
+        }
+
+        // modifiers
+        template <typename... Args>
+        auto emplace(Args&&... args) -> std::pair<iterator, bool>
+        {
+            slot_type value(std::forward<Args>(args)...);
+            return _insert(value.first, [&] { return std::move(value); });
+        }
+        auto insert(const value_type& obj) -> std::pair<iterator, bool>
+        {
+            return _insert(obj.first, [&] { return slot_type(obj); });
+        }
+        template <
+            typename P,
+            typename = std::enable_if_t<std::is_constructible<value_type, P>::value>>
+        auto insert(P&& obj) -> std::pair<iterator, bool>
+        {
+            return emplace(std::forward<P>(obj));
+        }
+        template <typename InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+        void insert(std::initializer_list<value_type> init)
+        {
+            insert(init.begin(), init.end());
+        }
+        auto erase(const_iterator position) -> iterator
+        {
+            auto&& key = position->first;
+            path p;
+            auto l = _descend(key, p);
+            return _erase(l, position._index, p);
+        }
+        auto erase(const key_type& key) -> size_type
+        {
+            if (_root == nullptr) {
+                return 0;
+            }
+            path p;
+            auto l = _descend(key, p);
+            auto index = _lower_bound(l, key);
+            if (index != l->_count && !_less(key, l->slots()[index].first)) {
+                _erase(l, index, p);
+                return 1;
+            } else {
+                return 0;
+            }
+        }
+        auto erase(const_iterator first, const_iterator last) -> iterator
+        {
+            if (first == cbegin() && last == cend()) {
+                clear();
+                return end();
+            }
+            // the position of last changes during removal, but not the number of entries in between
+            auto n = std::distance(first, last);
+            auto result = iterator(const_cast<leaf*>(first._leaf), first._index);
+            for (; n != 0; --n) {
+                result = erase(result);
+            }
+            return result;
+        }
+        void clear() noexcept
+        {
+            if (_root) {
+                _destroy(_root, _height);
+                _root = nullptr;
+                _height = 0;
+                _first = _last = nullptr;
+                _size = 0;
+            }
+        }
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_root, rhs._root);
+            up::swap_noexcept(_height, rhs._height);
+            up::swap_noexcept(_first, rhs._first);
+            up::swap_noexcept(_last, rhs._last);
+            up::swap_noexcept(_size, rhs._size);
+            up::swap_noexcept(_less, rhs._less);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+
+        // observers
+        auto key_comp() const -> key_compare
+        {
+            return _less;
+        }
+
+        // lookup
+        auto find(const key_type& key) -> iterator
+        {
+            auto p = lower_bound(key);
+            return p == end() || _less(key, p->first) ? end() : p;
+        }
+        auto find(const key_type& key) const -> const_iterator
+        {
+            auto p = lower_bound(key);
+            return p == end() || _less(key, p->first) ? end() : p;
+        }
+        auto count(const key_type& key) const -> size_type
+        {
+            return find(key) == end() ? 0 : 1;
+        }
+        auto lower_bound(const key_type& key) -> iterator
+        {
+            auto p = static_cast<const self*>(this)->lower_bound(key);
+            return iterator(const_cast<leaf*>(p._leaf), p._index);
+        }
+        auto lower_bound(const key_type& key) const -> const_iterator
+        {
+            if (_root == nullptr) {
+                return end();
+            }
+            auto l = _descend(key);
+            return _normalize(l, _lower_bound(l, key));
+        }
+        auto upper_bound(const key_type& key) -> iterator
+        {
+            auto p = static_cast<const self*>(this)->upper_bound(key);
+            return iterator(const_cast<leaf*>(p._leaf), p._index);
+        }
+        auto upper_bound(const key_type& key) const -> const_iterator
+        {
+            auto p = lower_bound(key);
+            return p == end() || _less(key, p->first) ? p : std::next(p);
+        }
+        auto equal_range(const key_type& key) -> std::pair<iterator, iterator>
+        {
+            auto p = find(key);
+            if (p == end()) {
+                return { p, p };
+            } else {
+                return { p, std::next(p) };
+            }
+        }
+        auto equal_range(const key_type& key) const -> std::pair<const_iterator, const_iterator>
+        {
+            auto p = find(key);
+            if (p == end()) {
+                return { p, p };
+            } else {
+                return { p, std::next(p) };
+            }
+        }
+        auto operator[](const key_type& key) -> mapped_type&
+        {
+            return _insert(key, [&] {
+                    return slot_type(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>{});
+                }).first->second;
+        }
+        auto operator[](key_type&& key) -> mapped_type&
+        {
+            return _insert(key, [&] {
+                    return slot_type(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::tuple<>{});
+                }).first->second;
+        }
+        auto at(const key_type& key) -> mapped_type&
+        {
+            auto p = find(key);
+            if (p == end()) {
+                throw up::make_throwable<std::out_of_range>("up-ordered-map-at-key-not-found");
+            } else {
+                return p->second;
+            }
+        }
+        auto at(const key_type& key) const -> const mapped_type&
+        {
+            auto p = find(key);
+            if (p == end()) {
+                throw up::make_throwable<std::out_of_range>("up-ordered-map-at-key-not-found");
+            } else {
+                return p->second;
+            }
+        }
+
+        friend bool operator==(const self& lhs, const self& rhs)
+        {
+            return lhs._size == rhs._size && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
+        friend bool operator!=(const self& lhs, const self& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        static void _relocate(slot_type* target, slot_type* source) noexcept
+        {
+            new (target) slot_type(std::move(*source));
+            source->~slot_type();
+        }
+        static void _relocate(Key* target, Key* source) noexcept
+        {
+            new (target) Key(std::move(*source));
+            source->~Key();
+        }
+        // move count elements from source to target (overlapping ranges are supported)
+        template <typename Type>
+        static void _relocate_n(Type* target, Type* source, size_type count) noexcept
+        {
+            if (target < source) {
+                for (size_type i = 0; i != count; ++i) {
+                    _relocate(target + i, source + i);
+                }
+            } else if (target > source) {
+                for (size_type i = count; i != 0; --i) {
+                    _relocate(target + i - 1, source + i - 1);
+                }
+            } // else: nothing
+        }
+        static void _destroy(leaf* l) noexcept
+        {
+            for (size_type i = 0; i != l->_count; ++i) {
+                l->slots()[i].~slot_type();
+            }
+            delete l;
+        }
+        static void _destroy(inner* in) noexcept
+        {
+            for (size_type i = 0; i != in->_count; ++i) {
+                in->keys()[i].~Key();
+            }
+            delete in;
+        }
+        static void _destroy(node* n, size_type height) noexcept
+        {
+            if (height == 0) {
+                _destroy(static_cast<leaf*>(n));
+            } else {
+                auto in = static_cast<inner*>(n);
+                for (size_type i = 0; i <= in->_count; ++i) {
+                    _destroy(in->_children[i], height - 1);
+                }
+                _destroy(in);
+            }
+        }
+        // index of the child, that might contain the key
+        auto _child_index(const inner* in, const key_type& key) const -> size_type
+        {
+            auto keys = in->keys();
+            if constexpr (vectorized) {
+                size_type result = 0;
+                for (size_type i = 0; i != in->_count; ++i) {
+                    result += !(key < keys[i]);
+                }
+                return result;
+            } else {
+                return std::upper_bound(keys, keys + in->_count, key, _less) - keys;
+            }
+        }
+        auto _lower_bound(const leaf* l, const key_type& key) const -> size_type
+        {
+            auto slots = l->slots();
+            if constexpr (vectorized) {
+                size_type result = 0;
+                for (size_type i = 0; i != l->_count; ++i) {
+                    result += slots[i].first < key;
+                }
+                return result;
+            } else {
+                auto less = [this](const slot_type& slot, const key_type& key) {
+                    return _less(slot.first, key);
+                };
+                return std::lower_bound(slots, slots + l->_count, key, less) - slots;
+            }
+        }
+        auto _descend(const key_type& key) const -> leaf*
+        {
+            auto n = _root;
+            for (size_type level = 0; level != _height; ++level) {
+                auto in = static_cast<inner*>(n);
+                n = in->_children[_child_index(in, key)];
+            }
+            return static_cast<leaf*>(n);
+        }
+        auto _descend(const key_type& key, path& p) const -> leaf*
+        {
+            auto n = _root;
+            for (size_type level = 0; level != _height; ++level) {
+                auto in = static_cast<inner*>(n);
+                auto index = _child_index(in, key);
+                p._steps[p._size++] = {in, index};
+                n = in->_children[index];
+            }
+            return static_cast<leaf*>(n);
+        }
+        // the end of a leaf is the beginning of the next leaf (except for the last leaf)
+        static auto _normalize(leaf* l, size_type index) noexcept -> iterator
+        {
+            if (index == l->_count && l->_next) {
+                return iterator(l->_next, 0);
+            } else {
+                return iterator(l, index);
+            }
+        }
+        template <typename Make>
+        auto _insert(const key_type& key, Make&& make) -> std::pair<iterator, bool>
+        {
+            if (_root == nullptr) {
+                auto l = new leaf();
+                _root = l;
+                _first = _last = l;
+            }
+            path p;
+            auto l = _descend(key, p);
+            auto index = _lower_bound(l, key);
+            if (index != l->_count && !_less(key, l->slots()[index].first)) {
+                return {iterator(l, index), false};
+            } else if (l->_count == leaf_capacity) {
+                return {_insert_split(l, index, p, make), true};
+            } else {
+                alignas(slot_type) unsigned char raw[sizeof(slot_type)];
+                auto value = new (raw) slot_type(make());
+                _insert_value(l, index, value);
+                return {iterator(l, index), true};
+            }
+        }
+        void _insert_value(leaf* l, size_type index, slot_type* value) noexcept
+        {
+            auto slots = l->slots();
+            _relocate_n(slots + index + 1, slots + index, l->_count - index);
+            _relocate(slots + index, value);
+            ++l->_count;
+            ++_size;
+        }
+        template <typename Make>
+        auto _insert_split(leaf* l, size_type index, path& p, Make&& make) -> iterator
+        {
+            // allocate all nodes up front, so that nothing changes on failure
+            spare s;
+            s._leaf.reset(new leaf());
+            auto step = p._size;
+            while (step != 0 && p._steps[step - 1].first->_count == inner_capacity) {
+                s._inners[s._count++].reset(new inner());
+                --step;
+            }
+            if (step == 0) {
+                s._inners[s._count++].reset(new inner());
+            }
+            // the right half starts with the same entry, wherever the new entry is inserted
+            Key separator(l->slots()[leaf_capacity / 2].first);
+            alignas(slot_type) unsigned char raw[sizeof(slot_type)];
+            auto value = new (raw) slot_type(make());
+            // split the leaf (the new entry is inserted into the smaller half)
+            auto right = s._leaf.release();
+            auto half = leaf_capacity / 2;
+            _relocate_n(right->slots(), l->slots() + half, leaf_capacity - half);
+            right->_count = leaf_capacity - half;
+            l->_count = half;
+            right->_prev = l;
+            right->_next = l->_next;
+            (l->_next ? l->_next->_prev : _last) = right;
+            l->_next = right;
+            _insert_child(p, separator, right, s);
+            if (index > half) {
+                index -= half;
+                l = right;
+            }
+            _insert_value(l, index, value);
+            return iterator(l, index);
+        }
+        // inserts the separator and the new right child after the last step of the path
+        // the separator is moved into the tree
+        void _insert_child(path& p, Key& separator, node* right, spare& s) noexcept
+        {
+            if (p._size == 0) {
+                auto root = s._inners[--s._count].release();
+                new (root->keys()) Key(std::move(separator));
+                root->_children[0] = _root;
+                root->_children[1] = right;
+                root->_count = 1;
+                _root = root;
+                ++_height;
+                return;
+            }
+            auto step = p._steps[--p._size];
+            auto in = step.first;
+            auto index = step.second;
+            if (in->_count != inner_capacity) {
+                _insert_separator(in, index, separator, right);
+                return;
+            }
+            /* Split the full node, so that both halves have the minimum size
+             * including the new separator. The key in the middle moves up. */
+            auto sibling = s._inners[--s._count].release();
+            auto middle = inner_capacity / 2;
+            auto keys = in->keys();
+            if (index == middle) {
+                _relocate_n(sibling->keys(), keys + middle, inner_capacity - middle);
+                sibling->_children[0] = right;
+                std::copy(in->_children + middle + 1, in->_children + inner_capacity + 1, sibling->_children + 1);
+                sibling->_count = inner_capacity - middle;
+                in->_count = middle;
+                _insert_child(p, separator, sibling, s);
+            } else {
+                auto split = index < middle ? middle - 1 : middle;
+                _relocate_n(sibling->keys(), keys + split + 1, inner_capacity - split - 1);
+                std::copy(in->_children + split + 1, in->_children + inner_capacity + 1, sibling->_children);
+                sibling->_count = inner_capacity - split - 1;
+                in->_count = split;
+                Key up(std::move(keys[split]));
+                keys[split].~Key();
+                if (index < middle) {
+                    _insert_separator(in, index, separator, right);
+                } else {
+                    _insert_separator(sibling, index - split - 1, separator, right);
+                }
+                _insert_child(p, up, sibling, s);
+            }
+        }
+        static void _insert_separator(inner* in, size_type index, Key& separator, node* right) noexcept
+        {
+            auto keys = in->keys();
+            _relocate_n(keys + index + 1, keys + index, in->_count - index);
+            new (keys + index) Key(std::move(separator));
+            std::copy_backward(in->_children + index + 1, in->_children + in->_count + 1, in->_children + in->_count + 2);
+            in->_children[index + 1] = right;
+            ++in->_count;
+        }
+        auto _erase(leaf* l, size_type index, path& p) -> iterator
+        {
+            inner* parent = nullptr;
+            size_type i = 0;
+            leaf* left = nullptr;
+            leaf* right = nullptr;
+            alignas(Key) unsigned char raw[sizeof(Key)];
+            Key* separator = nullptr;
+            bool rebalance = p._size != 0 && l->_count - 1 < leaf_minimum;
+            if (rebalance) {
+                auto step = p._steps[--p._size];
+                parent = step.first;
+                i = step.second;
+                left = i != 0 ? static_cast<leaf*>(parent->_children[i - 1]) : nullptr;
+                right = i != parent->_count ? static_cast<leaf*>(parent->_children[i + 1]) : nullptr;
+                // borrowing an entry replaces the separator with the new first key of the right node
+                if (left && left->_count > leaf_minimum) {
+                    separator = new (raw) Key(left->slots()[left->_count - 1].first);
+                } else if (right && right->_count > leaf_minimum) {
+                    separator = new (raw) Key(right->slots()[1].first);
+                }
+            }
+            auto slots = l->slots();
+            slots[index].~slot_type();
+            _relocate_n(slots + index, slots + index + 1, l->_count - index - 1);
+            --l->_count;
+            --_size;
+            if (_size == 0) {
+                clear();
+                return end();
+            } else if (!rebalance) {
+                return _normalize(l, index);
+            }
+            // rebalance with a sibling (and track the position of the next entry)
+            if (left && left->_count > leaf_minimum) {
+                _relocate_n(l->slots() + 1, l->slots(), l->_count);
+                _relocate(l->slots(), left->slots() + --left->_count);
+                ++l->_count;
+                ++index;
+                _replace_key(parent->keys() + i - 1, separator);
+            } else if (right && right->_count > leaf_minimum) {
+                _relocate(l->slots() + l->_count++, right->slots());
+                _relocate_n(right->slots(), right->slots() + 1, --right->_count);
+                _replace_key(parent->keys() + i, separator);
+            } else if (left) {
+                index += left->_count;
+                _merge_leaves(left, l, parent, i - 1, p);
+                l = left;
+            } else {
+                _merge_leaves(l, right, parent, i, p);
+            }
+            return _normalize(l, index);
+        }
+        static void _replace_key(Key* key, Key* value) noexcept
+        {
+            key->~Key();
+            _relocate(key, value);
+        }
+        // merges right into left, and removes the separator at index from the parent
+        void _merge_leaves(leaf* left, leaf* right, inner* parent, size_type index, path& p) noexcept
+        {
+            _relocate_n(left->slots() + left->_count, right->slots(), right->_count);
+            left->_count += right->_count;
+            right->_count = 0;
+            left->_next = right->_next;
+            (right->_next ? right->_next->_prev : _last) = left;
+            delete right;
+            parent->keys()[index].~Key();
+            _remove_separator(parent, index, p);
+        }
+        void _merge_inner(inner* left, inner* right, inner* parent, size_type index, path& p) noexcept
+        {
+            _relocate(left->keys() + left->_count, parent->keys() + index);
+            _relocate_n(left->keys() + left->_count + 1, right->keys(), right->_count);
+            std::copy(right->_children, right->_children + right->_count + 1, left->_children + left->_count + 1);
+            left->_count += right->_count + 1;
+            right->_count = 0;
+            delete right;
+            _remove_separator(parent, index, p);
+        }
+        // removes the (already destroyed) separator at index and the child to its right
+        void _remove_separator(inner* in, size_type index, path& p) noexcept
+        {
+            auto keys = in->keys();
+            _relocate_n(keys + index, keys + index + 1, in->_count - index - 1);
+            std::copy(in->_children + index + 2, in->_children + in->_count + 1, in->_children + index + 1);
+            --in->_count;
+            if (p._size == 0) {
+                if (in->_count == 0) {
+                    // the root has a single child
+                    _root = in->_children[0];
+                    --_height;
+                    delete in;
+                }
+                return;
+            } else if (in->_count >= inner_minimum) {
+                return;
+            }
+            auto step = p._steps[--p._size];
+            auto parent = step.first;
+            auto i = step.second;
+            auto left = i != 0 ? static_cast<inner*>(parent->_children[i - 1]) : nullptr;
+            auto right = i != parent->_count ? static_cast<inner*>(parent->_children[i + 1]) : nullptr;
+            if (left && left->_count > inner_minimum) {
+                // rotate right through the parent
+                _relocate_n(in->keys() + 1, in->keys(), in->_count);
+                std::copy_backward(in->_children, in->_children + in->_count + 1, in->_children + in->_count + 2);
+                _relocate(in->keys(), parent->keys() + i - 1);
+                in->_children[0] = left->_children[left->_count];
+                ++in->_count;
+                _relocate(parent->keys() + i - 1, left->keys() + --left->_count);
+            } else if (right && right->_count > inner_minimum) {
+                // rotate left through the parent
+                _relocate(in->keys() + in->_count, parent->keys() + i);
+                in->_children[in->_count + 1] = right->_children[0];
+                ++in->_count;
+                _relocate(parent->keys() + i, right->keys());
+                _relocate_n(right->keys(), right->keys() + 1, right->_count - 1);
+                std::copy(right->_children + 1, right->_children + right->_count + 1, right->_children);
+                --right->_count;
+            } else if (left) {
+                _merge_inner(left, in, parent, i - 1, p);
+            } else {
+                _merge_inner(in, right, parent, i, p);
+            }
+        }
+        template <typename InputIterator>
+        void _bulk_load(InputIterator first, InputIterator last)
+        {
+            std::vector<inner*> inners;
+            try {
+                // fill the leaves, and balance the last two
+                for (; first != last; ++first) {
+                    if (_last && !_less(_last->slots()[_last->_count - 1].first, first->first)) {
+                        throw up::make_throwable<std::invalid_argument>("up-ordered-map-unsorted-input");
+                    }
+                    if (_last == nullptr || _last->_count == leaf_capacity) {
+                        auto l = new leaf();
+                        l->_prev = _last;
+                        (_last ? _last->_next : _first) = l;
+                        _last = l;
+                    }
+                    new (_last->slots() + _last->_count) slot_type(*first);
+                    ++_last->_count;
+                    ++_size;
+                }
+                if (_first != _last && _last->_count < leaf_minimum) {
+                    auto left = _last->_prev;
+                    auto n = leaf_minimum - _last->_count;
+                    _relocate_n(_last->slots() + n, _last->slots(), _last->_count);
+                    _relocate_n(_last->slots(), left->slots() + left->_count - n, n);
+                    left->_count -= n;
+                    _last->_count += n;
+                }
+                // build the inner levels (nodes with the smallest keys of their subtrees)
+                std::vector<std::pair<node*, Key>> level;
+                for (auto l = _first; l; l = l->_next) {
+                    level.emplace_back(l, l->slots()[0].first);
+                }
+                while (level.size() > 1) {
+                    std::vector<std::pair<node*, Key>> parents;
+                    auto count = (level.size() + inner_capacity) / (inner_capacity + 1);
+                    parents.reserve(count);
+                    size_type offset = 0;
+                    for (size_type i = 0; i != count; ++i) {
+                        auto rest = level.size() - offset;
+                        auto n = i + 1 == count ? rest : i + 2 == count ? (rest + 1) / 2 : inner_capacity + 1;
+                        inners.push_back(nullptr);
+                        auto in = inners.back() = new inner();
+                        in->_children[0] = level[offset].first;
+                        for (size_type c = 1; c != n; ++c) {
+                            new (in->keys() + c - 1) Key(level[offset + c].second);
+                            in->_children[c] = level[offset + c].first;
+                            in->_count = c;
+                        }
+                        parents.emplace_back(in, std::move(level[offset].second));
+                        offset += n;
+                    }
+                    level = std::move(parents);
+                    ++_height;
+                }
+                if (!level.empty()) {
+                    _root = level.front().first;
+                }
+            } catch (...) {
+                for (auto in : inners) {
+                    if (in) {
+                        _destroy(in);
+                    }
+                }
+                while (_first) {
+                    _destroy(std::exchange(_first, _first->_next));
+                }
+                _last = nullptr;
+                _root = nullptr;
+                _height = 0;
+                _size = 0;
+                throw;
+            }
+        }
+    };
+
+}
+
+
+namespace up
+{
+
+    using up_ordered_map::ordered_map;
+
+}
@@ -4,10 +4,15 @@
  * This file simplifies the implementation of output functions. Instead of
  * overloading the stream operator, a class can provide a member or non-member
  * function named 'out'. However, it will only be used, if 'up::out' is used
- * to write the arguments to the std::ostream.
+ * to write the arguments to the std::ostream or to the up::sink.
+ *
+ * The 'out' functions should take an up::sink, because it is much cheaper
+ * than std::ostream. Both kinds of functions can be used with both kinds of
+ * streams, and the required adapters are created as necessary.
  */
 
 #include "up_detection_idiom.hpp"
+#include "up_sink.hpp"
 
 /**
  * The following namespace is used to find and invoke the correct overloaded,
@@ -41,6 +46,16 @@ namespace up_out
     template <typename Stream, typename Type>
     using has_free_out = up::is_detected<free_out_t, Stream, Type>;
 
+    template <typename Type>
+    using has_sink_out = std::integral_constant<bool,
+        has_member_out<up_sink::sink&, Type>() || has_free_out<up_sink::sink&, Type>()>;
+
+    template <typename Type>
+    using builtin_out_t = decltype(up_sink::format(std::declval<up_sink::sink&>(), std::declval<Type>()));
+
+    template <typename Type>
+    using has_builtin_out = up::is_detected<builtin_out_t, Type>;
+
 
     /**
      * Overloaded function template for invoking a member 'out' function. It
@@ -70,21 +85,66 @@ namespace up_out
         return up_adl_out::invoke(std::forward<Stream>(os), std::forward<Type>(value));
     }
 
+    /**
+     * Overloaded function template for invoking an 'out' function for sinks
+     * on an std::ostream. It will only take part in overload resolution if
+     * there is neither a matching member nor non-member 'out' function for
+     * the stream.
+     */
+    template <typename Stream, typename Type>
+    auto invoke_out(Stream&& os, Type&& value)
+        -> std::enable_if_t<
+            !has_member_out<Stream, Type>() && !has_free_out<Stream, Type>()
+            && has_sink_out<Type>() && std::is_convertible<Stream, std::ostream&>()>
+    {
+        up_sink::ostream_sink sink(os);
+        invoke_out(static_cast<up_sink::sink&>(sink), std::forward<Type>(value));
+    }
+
     /**
      * Overloaded function template for using stream operators instead of the
      * 'out' function. It will only take part in overload resolution if there
-     * is neither a matching member nor non-member 'out' function.
+     * is no matching 'out' function at all.
      */
     template <typename Stream, typename Type>
     auto invoke_out(Stream&& os, Type&& value)
         -> std::enable_if_t<
-            !has_member_out<Stream, Type>() && !has_free_out<Stream, Type>(),
+            !has_member_out<Stream, Type>() && !has_free_out<Stream, Type>() && !has_sink_out<Type>(),
             decltype(std::declval<Stream>() << std::declval<Type>())>
     {
         return std::forward<Stream>(os) << std::forward<Type>(value);
     }
 
 
+    /**
+     * Overloaded function template for writing to sinks. Matching 'out'
+     * functions are preferred over the built-in formatting, which is
+     * preferred over the std::ostream adapter of the sink.
+     */
+    template <typename Type>
+    auto invoke_sink_out(up_sink::sink& s, Type&& value)
+        -> std::enable_if_t<has_sink_out<Type>::value>
+    {
+        invoke_out(s, std::forward<Type>(value));
+    }
+
+    template <typename Type>
+    auto invoke_sink_out(up_sink::sink& s, Type&& value)
+        -> std::enable_if_t<!has_sink_out<Type>() && has_builtin_out<Type>()>
+    {
+        up_sink::format(s, std::forward<Type>(value));
+    }
+
+    template <typename Type>
+    auto invoke_sink_out(up_sink::sink& s, Type&& value)
+        -> std::enable_if_t<
+            !has_sink_out<Type>() && !has_builtin_out<Type>(),
+            decltype(invoke_out(std::declval<std::ostream&>(), std::declval<Type>()), void())>
+    {
+        invoke_out(s.as_ostream(), std::forward<Type>(value));
+    }
+
+
     // base case for variadic function below
     inline void out(std::ostream& os __attribute__((unused))) { }
 
@@ -102,6 +162,19 @@ namespace up_out
         out(os, std::forward<Tail>(tail)...);
     }
 
+    // base case for variadic function below
+    inline void out(up_sink::sink& s __attribute__((unused))) { }
+
+    /**
+     * Write the given arguments in that particular order to the given sink.
+     */
+    template <typename Head, typename... Tail>
+    void out(up_sink::sink& s, Head&& head, Tail&&... tail)
+    {
+        invoke_sink_out(s, std::forward<Head>(head));
+        out(s, std::forward<Tail>(tail)...);
+    }
+
 }
 
 namespace up
@@ -0,0 +1,88 @@
+#include "up_queue.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "up_exception.hpp"
+#include "up_terminate.hpp"
+
+
+namespace
+{
+
+    void close_aux(int& fd)
+    {
+        if (fd != -1) {
+            int temp = std::exchange(fd, -1);
+            int rv = ::close(temp);
+            if (rv != 0) {
+                up::terminate("bad-close", temp);
+            }
+        } // else: nothing
+    }
+
+}
+
+
+up_queue::queue_signal::queue_signal()
+    : _fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+    if (_fd == -1) {
+        throw up::make_exception("queue-eventfd-error").with(up::errno_info(errno));
+    }
+}
+
+up_queue::queue_signal::~queue_signal() noexcept
+{
+    close_aux(_fd);
+}
+
+void up_queue::queue_signal::_post()
+{
+    uint64_t value = 1;
+    for (;;) {
+        ssize_t rv = ::write(_fd, &value, sizeof(value));
+        if (rv == sizeof(value)) {
+            return;
+        } else if (rv == -1 && errno == EINTR) {
+            continue;
+        } else if (rv == -1 && errno == EAGAIN) {
+            // counter overflow, there is already a pending signal
+            return;
+        } else {
+            throw up::make_exception("queue-eventfd-error").with(rv, up::errno_info(errno));
+        }
+    }
+}
+
+void up_queue::queue_signal::_drain()
+{
+    uint64_t value;
+    for (;;) {
+        ssize_t rv = ::read(_fd, &value, sizeof(value));
+        if (rv == sizeof(value)) {
+            return;
+        } else if (rv == -1 && errno == EINTR) {
+            continue;
+        } else if (rv == -1 && errno == EAGAIN) {
+            // drained by another waiter
+            return;
+        } else {
+            throw up::make_exception("queue-eventfd-error").with(rv, up::errno_info(errno));
+        }
+    }
+}
+
+
+auto up_queue::queue_capacity(std::size_t capacity) -> std::size_t
+{
+    const auto limit = std::numeric_limits<std::size_t>::max() / 4 + 1;
+    if (capacity == 0 || capacity > limit) {
+        throw up::make_exception("queue-bad-capacity").with(capacity);
+    }
+    std::size_t result = 1;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return result;
+}
@@ -0,0 +1,403 @@
+#pragma once
+
+/**
+ * Bounded lock-free queues for passing objects (e.g. buffers, streams or
+ * connections) between threads: spsc_queue supports a single producer and a
+ * single consumer, and mpsc_queue supports any number of producers and a
+ * single consumer. The capacity is rounded up to a power of two, and the
+ * element type has to be nothrow move constructible (it need not be
+ * copyable).
+ *
+ * The try operations never block. The batch operations move multiple
+ * elements with a single update of the shared indexes (and at most one
+ * wake-up). The blocking operations wait with a stream patience on an
+ * eventfd, i.e. they support timeouts and they can be combined with other
+ * patience classes (e.g. executor::patience). The eventfd is only written,
+ * if the other side is actually waiting. A wake-up is passed on to further
+ * waiters, as long as the condition they are waiting for holds.
+ *
+ * The head (consumer side) and tail (producer side) are placed on separate
+ * cache lines.
+ */
+
+#include <atomic>
+
+#include "up_optional.hpp"
+#include "up_stream.hpp"
+
+
+namespace up_queue
+{
+
+    // wakes up threads waiting on the empty or full queue
+    class queue_signal final
+    {
+    public: // --- scope ---
+        using self = queue_signal;
+    private: // --- state ---
+        int _fd;
+        std::atomic<std::size_t> _waiting = {0};
+    public: // --- life ---
+        explicit queue_signal();
+        queue_signal(const self& rhs) = delete;
+        queue_signal(self&& rhs) noexcept = delete;
+        ~queue_signal() noexcept;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        // waits until the condition is satisfied, or the other side notifies
+        template <typename Condition>
+        void wait(up::stream::patience& patience, Condition&& condition)
+        {
+            // see notify: either the waiter or the notifier sees the other
+            _waiting.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            try {
+                if (!condition()) {
+                    patience(up::stream::native_handle(_fd), up::stream::patience::operation::read);
+                    _drain();
+                    /* The signal might have been posted for multiple waiters
+                     * (e.g. producers of an mpsc_queue), and the others might
+                     * not have started polling before the drain. */
+                    if (_waiting.load() > 1 && condition()) {
+                        _post();
+                    }
+                }
+            } catch (...) {
+                _waiting.fetch_sub(1);
+                throw;
+            }
+            _waiting.fetch_sub(1);
+        }
+        void notify()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_waiting.load(std::memory_order_relaxed) != 0) {
+                _post();
+            }
+        }
+    private:
+        void _post();
+        void _drain();
+    };
+
+
+    template <typename Type>
+    class queue_slot final
+    {
+    public: // --- state ---
+        union
+        {
+            Type _value;
+        };
+    public: // --- life ---
+        explicit queue_slot() noexcept { }
+        queue_slot(const queue_slot& rhs) = delete;
+        queue_slot(queue_slot&& rhs) noexcept = delete;
+        ~queue_slot() noexcept { }
+    public: // --- operations ---
+        auto operator=(const queue_slot& rhs) & -> queue_slot& = delete;
+        auto operator=(queue_slot&& rhs) & noexcept -> queue_slot& = delete;
+        void construct(Type&& value) noexcept
+        {
+            new (&_value) Type(std::move(value));
+        }
+        // passes the value to the consumer, and destroys it in any case
+        template <typename Consumer>
+        void consume(Consumer& consumer)
+        {
+            try {
+                consumer(std::move(_value));
+            } catch (...) {
+                _value.~Type();
+                throw;
+            }
+            _value.~Type();
+        }
+    };
+
+    auto queue_capacity(std::size_t capacity) -> std::size_t;
+
+
+    template <typename Type>
+    class spsc_queue final
+    {
+    public: // --- scope ---
+        using self = spsc_queue;
+        using value_type = Type;
+        static_assert(std::is_nothrow_move_constructible<Type>::value);
+    private: // --- state ---
+        alignas(64) std::atomic<std::size_t> _head = {0};
+        std::size_t _cached_tail = 0; // used by the consumer
+        alignas(64) std::atomic<std::size_t> _tail = {0};
+        std::size_t _cached_head = 0; // used by the producer
+        alignas(64) std::size_t _mask;
+        std::unique_ptr<queue_slot<Type>[]> _slots;
+        queue_signal _filled;
+        queue_signal _drained;
+    public: // --- life ---
+        explicit spsc_queue(std::size_t capacity)
+            : _mask(queue_capacity(capacity) - 1), _slots(new queue_slot<Type>[_mask + 1])
+        { }
+        spsc_queue(const self& rhs) = delete;
+        spsc_queue(self&& rhs) noexcept = delete;
+        ~spsc_queue() noexcept
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            auto tail = _tail.load(std::memory_order_relaxed);
+            for (; head != tail; ++head) {
+                _slots[head & _mask]._value.~Type();
+            }
+        }
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        auto capacity() const noexcept -> std::size_t
+        {
+            return _mask + 1;
+        }
+        // only a snapshot
+        auto size() const noexcept -> std::size_t
+        {
+            return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+        }
+        /* The following operations are intended for the producer. The bulk
+         * operation moves from a prefix of the values, and returns its size. */
+        bool try_push(Type&& value)
+        {
+            return try_push_bulk(&value, 1) != 0;
+        }
+        auto try_push_bulk(Type* values, std::size_t count) -> std::size_t
+        {
+            auto tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _cached_head + count > capacity()) {
+                _cached_head = _head.load(std::memory_order_acquire);
+            }
+            count = std::min(count, capacity() - (tail - _cached_head));
+            for (std::size_t i = 0; i != count; ++i) {
+                _slots[(tail + i) & _mask].construct(std::move(values[i]));
+            }
+            if (count != 0) {
+                _tail.store(tail + count, std::memory_order_release);
+                _filled.notify();
+            }
+            return count;
+        }
+        void push(Type&& value, up::stream::patience& patience)
+        {
+            while (!try_push(std::move(value))) {
+                _drained.wait(patience, [this]() { return size() < capacity(); });
+            }
+        }
+        void push(Type&& value, up::stream::patience&& patience)
+        {
+            push(std::move(value), patience);
+        }
+        /* The following operations are intended for the consumer. The bulk
+         * operation passes up to count values to the consumer function, and
+         * returns their number. */
+        auto try_pop() -> up::optional<Type>
+        {
+            up::optional<Type> result;
+            try_pop_bulk(1, [&](Type&& value) { result.emplace(std::move(value)); });
+            return result;
+        }
+        template <typename Consumer>
+        auto try_pop_bulk(std::size_t count, Consumer&& consumer) -> std::size_t
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            if (_cached_tail - head < count) {
+                _cached_tail = _tail.load(std::memory_order_acquire);
+            }
+            count = std::min(count, _cached_tail - head);
+            std::size_t done = 0;
+            try {
+                for (; done != count; ++done) {
+                    _slots[(head + done) & _mask].consume(consumer);
+                }
+            } catch (...) {
+                _release(head, done + 1);
+                throw;
+            }
+            _release(head, count);
+            return count;
+        }
+        auto pop(up::stream::patience& patience) -> Type
+        {
+            for (;;) {
+                if (auto result = try_pop()) {
+                    return std::move(*result);
+                }
+                _filled.wait(patience, [this]() { return size() != 0; });
+            }
+        }
+        auto pop(up::stream::patience&& patience) -> Type
+        {
+            return pop(patience);
+        }
+    private:
+        void _release(std::size_t head, std::size_t count)
+        {
+            if (count != 0) {
+                _head.store(head + count, std::memory_order_release);
+                _drained.notify();
+            }
+        }
+    };
+
+
+    /* Producers claim consecutive positions by advancing the tail, and
+     * publish each element with the sequence number of its slot (based on
+     * the bounded queue of Dmitry Vyukov). The consumer frees the slots by
+     * advancing the head. */
+    template <typename Type>
+    class mpsc_queue final
+    {
+    public: // --- scope ---
+        using self = mpsc_queue;
+        using value_type = Type;
+        static_assert(std::is_nothrow_move_constructible<Type>::value);
+    private:
+        class slot final
+        {
+        public: // --- state ---
+            std::atomic<std::size_t> _sequence = {0};
+            queue_slot<Type> _item;
+        };
+    private: // --- state ---
+        alignas(64) std::atomic<std::size_t> _head = {0};
+        alignas(64) std::atomic<std::size_t> _tail = {0};
+        alignas(64) std::size_t _mask;
+        std::unique_ptr<slot[]> _slots;
+        queue_signal _filled;
+        queue_signal _drained;
+    public: // --- life ---
+        explicit mpsc_queue(std::size_t capacity)
+            : _mask(queue_capacity(capacity) - 1), _slots(new slot[_mask + 1])
+        { }
+        mpsc_queue(const self& rhs) = delete;
+        mpsc_queue(self&& rhs) noexcept = delete;
+        ~mpsc_queue() noexcept
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            auto tail = _tail.load(std::memory_order_relaxed);
+            for (; head != tail; ++head) {
+                _slots[head & _mask]._item._value.~Type();
+            }
+        }
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        auto capacity() const noexcept -> std::size_t
+        {
+            return _mask + 1;
+        }
+        // only a snapshot (including claimed, but not yet published positions)
+        auto size() const noexcept -> std::size_t
+        {
+            auto head = _head.load(std::memory_order_acquire);
+            return _tail.load(std::memory_order_acquire) - head;
+        }
+        /* The following operations can be used by all producers. The bulk
+         * operation moves from a prefix of the values, and returns its size. */
+        bool try_push(Type&& value)
+        {
+            return try_push_bulk(&value, 1) != 0;
+        }
+        auto try_push_bulk(Type* values, std::size_t count) -> std::size_t
+        {
+            auto tail = _tail.load(std::memory_order_relaxed);
+            std::size_t claimed;
+            do {
+                // all positions before the head have been released by the consumer
+                auto head = _head.load(std::memory_order_acquire);
+                claimed = std::min(count, head + capacity() - tail);
+                if (claimed == 0) {
+                    return 0;
+                }
+            } while (!_tail.compare_exchange_weak(tail, tail + claimed,
+                std::memory_order_relaxed, std::memory_order_relaxed));
+            for (std::size_t i = 0; i != claimed; ++i) {
+                auto&& item = _slots[(tail + i) & _mask];
+                item._item.construct(std::move(values[i]));
+                item._sequence.store(tail + i + 1, std::memory_order_release);
+            }
+            _filled.notify();
+            return claimed;
+        }
+        void push(Type&& value, up::stream::patience& patience)
+        {
+            while (!try_push(std::move(value))) {
+                _drained.wait(patience, [this]() { return size() < capacity(); });
+            }
+        }
+        void push(Type&& value, up::stream::patience&& patience)
+        {
+            push(std::move(value), patience);
+        }
+        /* The following operations are intended for the consumer. The bulk
+         * operation passes up to count values to the consumer function, and
+         * returns their number. */
+        auto try_pop() -> up::optional<Type>
+        {
+            up::optional<Type> result;
+            try_pop_bulk(1, [&](Type&& value) { result.emplace(std::move(value)); });
+            return result;
+        }
+        template <typename Consumer>
+        auto try_pop_bulk(std::size_t count, Consumer&& consumer) -> std::size_t
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            std::size_t done = 0;
+            try {
+                for (; done != count; ++done) {
+                    auto&& item = _slots[(head + done) & _mask];
+                    if (item._sequence.load(std::memory_order_acquire) != head + done + 1) {
+                        break;
+                    }
+                    item._item.consume(consumer);
+                }
+            } catch (...) {
+                _release(head, done + 1);
+                throw;
+            }
+            _release(head, done);
+            return done;
+        }
+        auto pop(up::stream::patience& patience) -> Type
+        {
+            for (;;) {
+                if (auto result = try_pop()) {
+                    return std::move(*result);
+                }
+                _filled.wait(patience, [this]() { return _published(); });
+            }
+        }
+        auto pop(up::stream::patience&& patience) -> Type
+        {
+            return pop(patience);
+        }
+    private:
+        bool _published() const noexcept
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            return _slots[head & _mask]._sequence.load(std::memory_order_acquire) == head + 1;
+        }
+        void _release(std::size_t head, std::size_t count)
+        {
+            if (count != 0) {
+                _head.store(head + count, std::memory_order_release);
+                _drained.notify();
+            }
+        }
+    };
+
+}
+
+namespace up
+{
+
+    using up_queue::spsc_queue;
+    using up_queue::mpsc_queue;
+
+}
@@ -0,0 +1,430 @@
+#include "up_record_log.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+#include "up_buffer.hpp"
+#include "up_defer.hpp"
+#include "up_exception.hpp"
+#include "up_ints.hpp"
+#include "up_log_file.hpp"
+#include "up_optional.hpp"
+
+
+namespace
+{
+
+    using up_log_file::header;
+    using up_log_file::status;
+
+    // records larger than this are written directly instead of buffered
+    const std::size_t direct_write_threshold = 1 << 16;
+
+
+    auto segment_name(uint64_t base) -> up::shared_string
+    {
+        char buffer[32];
+        int rv = std::snprintf(buffer, sizeof(buffer), "%016" PRIx64 ".log", base);
+        return up::shared_string(buffer, up::ints::caster(rv));
+    }
+
+    auto parse_segment_name(const up::string_view& name) -> up::optional<uint64_t>
+    {
+        const std::size_t digits = 16;
+        if (name.size() != digits + 4 || name.substr(digits) != up::string_view(".log")) {
+            return up::nullopt;
+        }
+        uint64_t result = 0;
+        for (std::size_t i = 0; i != digits; ++i) {
+            char c = name[i];
+            if (c >= '0' && c <= '9') {
+                result = (result << 4) | (c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                result = (result << 4) | (c - 'a' + 10);
+            } else {
+                return up::nullopt;
+            }
+        }
+        return result;
+    }
+
+    auto list_segments(const up::fs::origin& directory) -> std::vector<uint64_t>
+    {
+        std::vector<uint64_t> result;
+        up::fs::location(directory, ".").list([&result](up::fs::directory_entry entry) {
+            auto base = parse_segment_name(entry.name());
+            if (base) {
+                result.push_back(*base);
+            }
+            return false;
+        });
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    auto segment_location(const up::fs::origin& directory, uint64_t base)
+    {
+        return up::fs::location(directory, segment_name(base));
+    }
+
+}
+
+
+class up_record_log::record_log::impl final
+{
+public: // --- scope ---
+    using self = impl;
+    using option = up::fs::file::option;
+private: // --- state ---
+    up::fs::origin _directory;
+    std::size_t _segment_size;
+    up::fs::file::lock _lock;
+    uint64_t _base;
+    uint64_t _end;
+    up::fs::file _file;
+    uint64_t _written;
+    uint64_t _synced;
+    up::buffer _pending;
+    bool _busy = false;
+    bool _failed = false;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+public: // --- life ---
+    explicit impl(up::fs::origin directory, std::size_t segment_size)
+        : _directory(std::move(directory))
+        , _segment_size(std::move(segment_size))
+        , _lock(up_log_file::acquire_lock(_directory))
+        , _base(0)
+        , _end(0)
+        , _file(_recover())
+        , _written(_end)
+        , _synced(_end)
+    { }
+    impl(const self& rhs) = delete;
+    impl(self&& rhs) noexcept = delete;
+    ~impl() noexcept = default;
+public: // --- operations ---
+    auto operator=(const self& rhs) & -> self& = delete;
+    auto operator=(self&& rhs) & noexcept -> self& = delete;
+    auto to_insight() -> up::insight
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return up::insight(typeid(*this), "record-log-impl",
+            up::invoke_to_insight_with_fallback(_directory),
+            up::invoke_to_insight_with_fallback(_base),
+            up::invoke_to_insight_with_fallback(_end),
+            up::invoke_to_insight_with_fallback(_written),
+            up::invoke_to_insight_with_fallback(_synced));
+    }
+    auto end() -> uint64_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _end;
+    }
+    auto append(up::chunk::from record) -> uint64_t
+    {
+        header prefix(up::chunk::from_bulk(record));
+        std::size_t total = up::ints::domain<std::size_t>::or_length_error::sum(prefix._size, record.size());
+        bool direct = record.size() >= direct_write_threshold;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (direct && _busy) {
+            _condition.wait(lock);
+        }
+        _check_failed();
+        if (_end - _base >= _segment_size) {
+            _rotate(lock);
+        }
+        uint64_t result = _end;
+        if (direct) {
+            _end += total;
+            _flush(lock, false, prefix, record);
+        } else {
+            _pending.reserve(total);
+            _pending.append(prefix).append(record);
+            _end += total;
+        }
+        return result;
+    }
+    void commit(bool sync)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t target = _end;
+        for (;;) {
+            if ((sync ? _synced : _written) >= target) {
+                return;
+            } else if (_failed) {
+                _check_failed();
+            } else if (_busy) {
+                _condition.wait(lock);
+            } else {
+                /* This thread becomes the leader, and writes all records
+                 * appended so far, including those of waiting threads. */
+                _flush(lock, sync);
+            }
+        }
+    }
+    void remove_before(uint64_t offset)
+    {
+        uint64_t base;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            base = _base;
+        }
+        auto segments = list_segments(_directory);
+        for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+            if (segments[i + 1] > offset || segments[i] >= base) {
+                break;
+            }
+            segment_location(_directory, segments[i]).unlink();
+        }
+    }
+private:
+    auto _recover() -> up::fs::file
+    {
+        auto segments = list_segments(_directory);
+        if (segments.empty()) {
+            return up::fs::file(segment_location(_directory, _base),
+                {option::read, option::write, option::create});
+        }
+        _base = segments.back();
+        auto file = up::fs::file(segment_location(_directory, _base), {option::read, option::write});
+        std::size_t valid = up_log_file::recover(file, 0, "record-log-corrupt",
+            [](std::size_t, std::size_t, up::chunk::from) noexcept { });
+        _end = _base + valid;
+        return file;
+    }
+    void _flush(std::unique_lock<std::mutex>& lock, bool sync)
+    {
+        _flush(lock, sync, header(), up::chunk::from(nullptr, 0));
+    }
+    void _flush(std::unique_lock<std::mutex>& lock, bool sync, const header& prefix, up::chunk::from record)
+    {
+        /* The mutex is released during the I/O operations, so that other
+         * threads can continue to append records. The flag _busy prevents
+         * concurrent writes and the rotation of the segment. */
+        _busy = true;
+        up::buffer pending;
+        pending.swap(_pending);
+        off_t offset = up::ints::caster(_written - _base);
+        uint64_t end = _end;
+        lock.unlock();
+        {
+            bool failed = true;
+            UP_DEFER {
+                lock.lock();
+                if (failed) {
+                    _fail();
+                }
+                _busy = false;
+                _condition.notify_all();
+            };
+            up::chunk::from chunk = pending;
+            if (chunk.size() + prefix._size + record.size()) {
+                _file.write_all(up::chunk::from_bulk(chunk, prefix, record), offset);
+            }
+            if (sync) {
+                _file.fdatasync();
+            }
+            failed = false;
+        }
+        _written = end;
+        if (sync) {
+            _synced = end;
+        }
+    }
+    void _fail() noexcept
+    {
+        /* The content of the file after the last successful write is unknown,
+         * and retrying a failed fdatasync is not reliable (the kernel might
+         * have dropped the dirty pages). For that reason, all records that
+         * have not been written are discarded, and the log rejects all
+         * further operations. The next recovery truncates partial records. */
+        _failed = true;
+        _end = _written;
+        up::buffer().swap(_pending);
+    }
+    void _check_failed() const
+    {
+        if (_failed) {
+            throw up::make_exception("record-log-failed").with(_base, _written);
+        }
+    }
+    void _rotate(std::unique_lock<std::mutex>& lock)
+    {
+        while (_end - _base >= _segment_size) {
+            _check_failed();
+            if (_busy) {
+                _condition.wait(lock);
+            } else if (_synced != _end) {
+                _flush(lock, true);
+            } else {
+                _file = up::fs::file(segment_location(_directory, _end),
+                    {option::read, option::write, option::create, option::exclusive});
+                up_log_file::fsync_directory(_directory);
+                _base = _end;
+            }
+        }
+    }
+};
+
+
+up_record_log::record_log::record_log(up::fs::origin directory, std::size_t segment_size)
+    : _impl(std::make_shared<impl>(std::move(directory), std::move(segment_size)))
+{ }
+
+auto up_record_log::record_log::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "record-log", _impl->to_insight());
+}
+
+auto up_record_log::record_log::end() const -> uint64_t
+{
+    return _impl->end();
+}
+
+auto up_record_log::record_log::append(up::chunk::from record) const -> uint64_t
+{
+    return _impl->append(std::move(record));
+}
+
+void up_record_log::record_log::commit(bool sync) const
+{
+    _impl->commit(sync);
+}
+
+void up_record_log::record_log::remove_before(uint64_t offset) const
+{
+    _impl->remove_before(offset);
+}
+
+
+class up_record_log::record_log::reader::impl final
+{
+public: // --- scope ---
+    using self = impl;
+private: // --- state ---
+    up::fs::origin _directory;
+    uint64_t _base;
+    uint64_t _offset;
+    up::optional<up::fs::file> _file;
+    up::optional<up::fs::file::mapping> _mapping;
+public: // --- life ---
+    explicit impl(up::fs::origin directory, uint64_t offset)
+        : _directory(std::move(directory)), _base(0), _offset(std::move(offset))
+    {
+        auto segments = list_segments(_directory);
+        auto p = std::upper_bound(segments.begin(), segments.end(), _offset);
+        if (p == segments.begin()) {
+            throw up::make_exception("record-log-bad-offset").with(_offset);
+        }
+        _open(*--p);
+    }
+    impl(const self& rhs) = delete;
+    impl(self&& rhs) noexcept = delete;
+    ~impl() noexcept = default;
+public: // --- operations ---
+    auto operator=(const self& rhs) & -> self& = delete;
+    auto operator=(self&& rhs) & noexcept -> self& = delete;
+    auto to_insight() const -> up::insight
+    {
+        return up::insight(typeid(*this), "record-log-reader-impl",
+            up::invoke_to_insight_with_fallback(_directory),
+            up::invoke_to_insight_with_fallback(_base),
+            up::invoke_to_insight_with_fallback(_offset));
+    }
+    auto offset() const -> uint64_t
+    {
+        return _offset;
+    }
+    auto read() -> up::chunk::from
+    {
+        for (;;) {
+            up::chunk::from payload(nullptr, 0);
+            std::size_t total;
+            switch (_parse(payload, total)) {
+            case status::complete:
+                _offset += total;
+                return payload;
+            case status::corrupt:
+                throw up::make_exception("record-log-corrupt-record").with(_base, _offset);
+            case status::incomplete:
+                break; // ... and continue
+            }
+            /* Refresh the mapping, because the writer might have appended
+             * further records in the meantime. If there is nothing new at
+             * the end of the segment, check for the next segment. The size
+             * has to be checked again afterwards, because the writer might
+             * have completed the segment in between. */
+            if (_remap()) {
+                continue;
+            } else if (_mapped_size() != _offset - _base) {
+                return {nullptr, 0};
+            } else if (!segment_location(_directory, _offset).exists()) {
+                return {nullptr, 0};
+            } else if (!_remap()) {
+                _open(_offset);
+            }
+        }
+    }
+private:
+    void _open(uint64_t base)
+    {
+        _mapping = up::nullopt;
+        _file.emplace(segment_location(_directory, base), up::fs::file::options{up::fs::file::option::read});
+        _base = base;
+        _remap();
+        if (_mapped_size() < _offset - _base) {
+            throw up::make_exception("record-log-bad-offset").with(_base, _offset);
+        }
+    }
+    auto _mapped_size() const -> std::size_t
+    {
+        return _mapping ? _mapping->size() : 0;
+    }
+    bool _remap()
+    {
+        std::size_t size = up::ints::caster(_file->stat().size());
+        if (size <= _mapped_size()) {
+            return false;
+        }
+        _mapping.emplace(_file->map(size, 0, false));
+        return true;
+    }
+    auto _parse(up::chunk::from& payload, std::size_t& total) const -> status
+    {
+        std::size_t position = up::ints::caster(_offset - _base);
+        std::size_t size = _mapped_size();
+        if (position == size) {
+            return status::incomplete;
+        }
+        return up_log_file::parse({_mapping->data() + position, size - position}, payload, total);
+    }
+};
+
+
+void up_record_log::record_log::reader::destroy(impl* ptr)
+{
+    std::default_delete<impl>()(ptr);
+}
+
+up_record_log::record_log::reader::reader(up::fs::origin directory, uint64_t offset)
+    : _impl(up::impl_make(std::move(directory), std::move(offset)))
+{ }
+
+auto up_record_log::record_log::reader::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "record-log-reader", _impl->to_insight());
+}
+
+auto up_record_log::record_log::reader::offset() const -> uint64_t
+{
+    return _impl->offset();
+}
+
+auto up_record_log::record_log::reader::read() -> up::chunk::from
+{
+    return _impl->read();
+}
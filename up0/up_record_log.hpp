@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * A record_log is a durable, append-only sequence of binary records. The log
+ * is stored in a directory as a sequence of segment files, that are named
+ * after the offset of their first record. Each record is prefixed with its
+ * length (encoded as VLQ) and a CRC-32 of the length and the payload.
+ *
+ * Records are identified by their offset, which stays the same when old
+ * segments are removed. Appended records are buffered, and written to the
+ * file on commit. Concurrent commits are combined, so that only one thread
+ * performs the write and the synchronization on behalf of all others (group
+ * commit).
+ *
+ * Readers are independent from the writer, i.e. they might run in a
+ * different process. They map the segments into memory, and the records are
+ * returned as views into the mapping.
+ */
+
+#include "up_fs.hpp"
+
+
+namespace up_record_log
+{
+
+    class record_log final
+    {
+    public: // --- scope ---
+        using self = record_log;
+        class impl;
+        class reader;
+    private: // --- state ---
+        std::shared_ptr<impl> _impl;
+    public: // --- life ---
+        /* Opens or creates the log in the given directory. An incomplete or
+         * corrupt record at the end of the log (e.g. after a crash) is
+         * truncated. A corrupt record followed by further records raises an
+         * exception instead. The segment size is a soft limit. */
+        explicit record_log(up::fs::origin directory, std::size_t segment_size);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        // offset following the last appended record
+        auto end() const -> uint64_t;
+        // returns the offset of the record
+        auto append(up::chunk::from record) const -> uint64_t;
+        /* Write all appended records, and optionally wait for durability. If
+         * an I/O operation fails, all records that have not been written are
+         * discarded, and the log rejects all further appends. Later commits
+         * return without error only if nothing is left to write (or sync). */
+        void commit(bool sync = true) const;
+        // remove segments that contain only records before the offset
+        void remove_before(uint64_t offset) const;
+    };
+
+
+    class record_log::reader final
+    {
+    public: // --- scope ---
+        using self = reader;
+        class impl;
+        static void destroy(impl* ptr);
+    private: // --- state ---
+        up::impl_ptr<impl, destroy> _impl;
+    public: // --- life ---
+        // the offset has to be the beginning of a record
+        explicit reader(up::fs::origin directory, uint64_t offset);
+        reader(const self& rhs) = delete;
+        reader(self&& rhs) noexcept = default;
+        ~reader() noexcept = default;
+    public: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = default;
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        // offset of the next record
+        auto offset() const -> uint64_t;
+        /* Returns the next record, or a chunk with a null data pointer if
+         * there is no further complete record yet. The returned chunk stays
+         * valid until the next invocation. */
+        auto read() -> up::chunk::from;
+    };
+
+}
+
+namespace up
+{
+
+    using up_record_log::record_log;
+
+}
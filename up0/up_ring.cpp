@@ -0,0 +1,354 @@
+#include "up_ring.hpp"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "up_exception.hpp"
+#include "up_ints.hpp"
+
+
+namespace
+{
+
+    /* All words in the shared memory are accessed with the atomic builtins,
+     * because the memory is not owned by any object of this process. */
+    template <typename Type>
+    auto load(const Type& value, int order = __ATOMIC_ACQUIRE) -> Type
+    {
+        return __atomic_load_n(&value, order);
+    }
+
+    template <typename Type>
+    void store(Type& value, Type desired, int order = __ATOMIC_RELEASE)
+    {
+        __atomic_store_n(&value, desired, order);
+    }
+
+
+    void futex_wait(uint32_t& word, uint32_t expected)
+    {
+        /* The call returns with EAGAIN if the word no longer contains the
+         * expected value, and with EINTR if interrupted. In both cases, the
+         * caller will check the condition again. */
+        long rv = ::syscall(SYS_futex, &word, FUTEX_WAIT, expected, nullptr, nullptr, 0);
+        if (rv == -1 && errno != EAGAIN && errno != EINTR) {
+            throw up::make_exception("ring-futex-error").with(up::errno_info(errno));
+        }
+    }
+
+    void futex_wake(uint32_t& word, int count)
+    {
+        long rv = ::syscall(SYS_futex, &word, FUTEX_WAKE, count, nullptr, nullptr, 0);
+        if (rv == -1) {
+            throw up::make_exception("ring-futex-error").with(up::errno_info(errno));
+        }
+    }
+
+
+    // layout of the first page of the memory file
+    struct header final
+    {
+        uint64_t _magic;
+        uint32_t _version;
+        uint32_t _reserved;
+        uint64_t _capacity;
+        // consumer side
+        alignas(64) uint64_t _head;
+        uint32_t _space_signal;
+        uint32_t _producers_waiting;
+        // producer side
+        alignas(64) uint64_t _tail;
+        uint32_t _data_signal;
+        uint32_t _consumer_waiting;
+    };
+
+    const uint64_t magic = 0x676e69722d7075; // "up-ring"
+    const uint32_t version = 1;
+    const std::size_t header_size = 4096;
+    static_assert(sizeof(header) <= header_size);
+
+    /* Each message is prefixed by a record header with the size and flags.
+     * Records are aligned to the size of the record header. A padding record
+     * is used, if a message does not fit into the remaining space before the
+     * end of the ring. The second word of the record header is written on
+     * reservation, so that commits can be checked against it. */
+    const std::size_t record_size = sizeof(uint64_t);
+    const uint32_t committed_flag = uint32_t(1) << 31;
+    const uint32_t padding_flag = uint32_t(1) << 30;
+    const uint32_t reserved_flag = uint32_t(1) << 31;
+    const uint32_t size_mask = padding_flag - 1;
+
+    auto record_total(std::size_t size) -> std::size_t
+    {
+        return (record_size + size + record_size - 1) & ~(record_size - 1);
+    }
+
+}
+
+
+class up_ring::ring::impl final
+{
+public: // --- scope ---
+    using self = impl;
+private: // --- state ---
+    up::fs::file _file;
+    up::fs::file::mapping _mapping;
+    header* _header;
+    char* _data;
+    std::size_t _capacity;
+public: // --- life ---
+    explicit impl(up::fs::file file, up::fs::file::mapping mapping)
+        : _file(std::move(file))
+        , _mapping(std::move(mapping))
+        , _header(reinterpret_cast<header*>(_mapping.data()))
+        , _data(_mapping.data() + header_size)
+        , _capacity(_mapping.size() - header_size)
+    { }
+    impl(const self& rhs) = delete;
+    impl(self&& rhs) noexcept = delete;
+    ~impl() noexcept = default;
+public: // --- operations ---
+    auto operator=(const self& rhs) & -> self& = delete;
+    auto operator=(self&& rhs) & noexcept -> self& = delete;
+    auto to_insight() const -> up::insight
+    {
+        return up::insight(typeid(*this), "ring-impl",
+            up::invoke_to_insight_with_fallback(_capacity),
+            up::invoke_to_insight_with_fallback(load(_header->_head)),
+            up::invoke_to_insight_with_fallback(load(_header->_tail)));
+    }
+    auto file() const -> const up::fs::file&
+    {
+        return _file;
+    }
+    auto capacity() const -> std::size_t
+    {
+        return _capacity;
+    }
+    auto max_message_size() const -> std::size_t
+    {
+        /* Limiting messages to half of the capacity guarantees, that a
+         * message and the preceding padding fit into an empty ring. */
+        return std::min<std::size_t>(_capacity / 2 - record_size, size_mask);
+    }
+    auto reserve(std::size_t size, bool blocking) const -> up::chunk::into
+    {
+        if (size > max_message_size()) {
+            throw up::make_exception("ring-message-too-large").with(size, max_message_size());
+        }
+        std::size_t total = record_total(size);
+        uint64_t tail = load(_header->_tail, __ATOMIC_RELAXED);
+        for (;;) {
+            std::size_t offset = tail & (_capacity - 1);
+            std::size_t padding = (_capacity - offset < total) ? _capacity - offset : 0;
+            uint32_t signal = load(_header->_space_signal);
+            uint64_t head = load(_header->_head);
+            if (tail + padding + total - head > _capacity) {
+                if (!blocking) {
+                    return {nullptr, 0};
+                }
+                _wait_for_space(signal, tail + padding + total - _capacity);
+                tail = load(_header->_tail, __ATOMIC_RELAXED);
+            } else if (__atomic_compare_exchange_n(&_header->_tail, &tail, tail + padding + total,
+                    true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                if (padding) {
+                    _publish(offset, committed_flag | padding_flag | uint32_t(padding - record_size));
+                }
+                offset = (tail + padding) & (_capacity - 1);
+                store(_reservation(offset), reserved_flag | uint32_t(size), __ATOMIC_RELAXED);
+                return {_data + offset + record_size, size};
+            } // else: retry with updated tail
+        }
+    }
+    void commit(up::chunk::into chunk) const
+    {
+        // pointer comparisons are only well-defined within the same mapping
+        auto address = reinterpret_cast<std::uintptr_t>(chunk.data());
+        auto begin = reinterpret_cast<std::uintptr_t>(_data) + record_size;
+        if (address < begin || address - begin >= _capacity || (address - begin) % record_size) {
+            throw up::make_exception("ring-bad-commit").with(chunk.size());
+        }
+        std::size_t offset = address - begin;
+        if (load(_reservation(offset), __ATOMIC_RELAXED) != (reserved_flag | chunk.size())
+            || (load(_record(offset)) & committed_flag)) {
+            throw up::make_exception("ring-bad-commit").with(offset, chunk.size());
+        }
+        _publish(offset, committed_flag | uint32_t(chunk.size()));
+    }
+    auto peek(bool blocking) const -> up::chunk::from
+    {
+        for (;;) {
+            uint64_t head = load(_header->_head, __ATOMIC_RELAXED);
+            std::size_t offset = head & (_capacity - 1);
+            uint32_t& word = _record(offset);
+            uint32_t signal = load(_header->_data_signal);
+            uint32_t value = load(word);
+            if ((value & committed_flag) == 0) {
+                if (!blocking) {
+                    return {nullptr, 0};
+                }
+                /* The flag has to be set before checking the record again.
+                 * Otherwise, a wake-up might get lost. */
+                store(_header->_consumer_waiting, uint32_t(1), __ATOMIC_SEQ_CST);
+                if ((load(word, __ATOMIC_SEQ_CST) & committed_flag) == 0) {
+                    futex_wait(_header->_data_signal, signal);
+                }
+                store(_header->_consumer_waiting, uint32_t(0), __ATOMIC_RELAXED);
+            } else if (value & padding_flag) {
+                _release(head, offset, _checked_total(head, offset, value));
+            } else {
+                _checked_total(head, offset, value);
+                return {_data + offset + record_size, value & size_mask};
+            }
+        }
+    }
+    void consume() const
+    {
+        uint64_t head = load(_header->_head, __ATOMIC_RELAXED);
+        std::size_t offset = head & (_capacity - 1);
+        uint32_t value = load(_record(offset));
+        if ((value & committed_flag) == 0 || (value & padding_flag)) {
+            throw up::make_exception("ring-nothing-to-consume").with(head);
+        }
+        _release(head, offset, _checked_total(head, offset, value));
+    }
+private:
+    auto _checked_total(uint64_t head, std::size_t offset, uint32_t value) const -> std::size_t
+    {
+        /* The record header is written by other processes. An invalid size
+         * would result in accesses outside of the mapping. Padding records
+         * always extend to the end of the ring. */
+        std::size_t size = value & size_mask;
+        std::size_t total = record_total(size);
+        if ((value & padding_flag)
+            ? total != _capacity - offset
+            : (size > max_message_size() || total > _capacity - offset)) {
+            throw up::make_exception("ring-corrupted").with(head, value);
+        }
+        return total;
+    }
+    auto _record(std::size_t offset) const -> uint32_t&
+    {
+        return *reinterpret_cast<uint32_t*>(_data + offset);
+    }
+    auto _reservation(std::size_t offset) const -> uint32_t&
+    {
+        return *reinterpret_cast<uint32_t*>(_data + offset + sizeof(uint32_t));
+    }
+    void _publish(std::size_t offset, uint32_t value) const
+    {
+        store(_record(offset), value, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&_header->_data_signal, 1, __ATOMIC_SEQ_CST);
+        if (load(_header->_consumer_waiting, __ATOMIC_SEQ_CST)) {
+            futex_wake(_header->_data_signal, 1);
+        }
+    }
+    void _release(uint64_t head, std::size_t offset, std::size_t total) const
+    {
+        /* Released space is cleared, so that producers always find
+         * uncommitted record headers in reserved space. */
+        std::memset(_data + offset, 0, total);
+        store(_header->_head, head + total, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&_header->_space_signal, 1, __ATOMIC_SEQ_CST);
+        if (load(_header->_producers_waiting, __ATOMIC_SEQ_CST)) {
+            futex_wake(_header->_space_signal, INT_MAX);
+        }
+    }
+    void _wait_for_space(uint32_t signal, uint64_t required) const
+    {
+        __atomic_add_fetch(&_header->_producers_waiting, 1, __ATOMIC_SEQ_CST);
+        if (load(_header->_head, __ATOMIC_SEQ_CST) < required) {
+            futex_wait(_header->_space_signal, signal);
+        }
+        __atomic_sub_fetch(&_header->_producers_waiting, 1, __ATOMIC_RELAXED);
+    }
+};
+
+
+up_ring::ring::ring(up::fs::context context, const up::string_view& name, std::size_t capacity)
+    : _impl(nullptr)
+{
+    if (capacity < header_size || (capacity & (capacity - 1))) {
+        throw up::make_exception("ring-bad-capacity").with(capacity);
+    }
+    auto length = up::ints::domain<std::size_t>::or_length_error::sum(header_size, capacity);
+    auto file = up::fs::file(up::fs::file::memory, std::move(context), name);
+    file.truncate(up::ints::caster(length));
+    auto mapping = file.map(length, 0, true);
+    auto p = reinterpret_cast<header*>(mapping.data());
+    p->_version = version;
+    p->_capacity = capacity;
+    store(p->_magic, magic);
+    /* Prevent other processes from changing the size of the file. Otherwise,
+     * accessing the mapping might raise SIGBUS. */
+    using seal = up::fs::file::seal;
+    file.add_seals({seal::shrink, seal::grow, seal::seal});
+    _impl = std::make_shared<const impl>(std::move(file), std::move(mapping));
+}
+
+up_ring::ring::ring(up::fs::file file)
+    : _impl(nullptr)
+{
+    using seal = up::fs::file::seal;
+    if (!file.has_seals({seal::shrink, seal::grow})) {
+        throw up::make_exception("ring-unsealed-file");
+    }
+    std::size_t length = up::ints::caster(file.stat().size());
+    if (length <= header_size) {
+        throw up::make_exception("ring-bad-file").with(length);
+    }
+    auto mapping = file.map(length, 0, true);
+    auto p = reinterpret_cast<header*>(mapping.data());
+    /* The capacity is used as a mask for the offsets, i.e. an invalid value
+     * would result in accesses outside of the mapping. */
+    if (load(p->_magic) != magic || p->_version != version || p->_capacity != length - header_size
+        || p->_capacity < header_size || (p->_capacity & (p->_capacity - 1))) {
+        throw up::make_exception("ring-bad-file").with(length, p->_version, p->_capacity);
+    }
+    _impl = std::make_shared<const impl>(std::move(file), std::move(mapping));
+}
+
+auto up_ring::ring::to_insight() const -> up::insight
+{
+    return up::insight(typeid(*this), "ring", _impl->to_insight());
+}
+
+auto up_ring::ring::file() const -> const up::fs::file&
+{
+    return _impl->file();
+}
+
+auto up_ring::ring::capacity() const -> std::size_t
+{
+    return _impl->capacity();
+}
+
+auto up_ring::ring::max_message_size() const -> std::size_t
+{
+    return _impl->max_message_size();
+}
+
+auto up_ring::ring::reserve(std::size_t size, bool blocking) const -> up::chunk::into
+{
+    return _impl->reserve(size, blocking);
+}
+
+void up_ring::ring::commit(up::chunk::into chunk) const
+{
+    _impl->commit(std::move(chunk));
+}
+
+auto up_ring::ring::peek(bool blocking) const -> up::chunk::from
+{
+    return _impl->peek(blocking);
+}
+
+void up_ring::ring::consume() const
+{
+    _impl->consume();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/**
+ * A ring is a message queue in shared memory, that can be used to pass
+ * messages between processes without copying and without system calls in the
+ * common case. The ring lives in a sealed memory file, which can be passed to
+ * other processes over unix domain sockets.
+ *
+ * Messages are written in place: A producer reserves space for a message,
+ * writes the message directly into the shared memory, and commits it. The
+ * consumer peeks at the oldest message, which is a view into the shared
+ * memory, and consumes it after processing. Any number of producers is
+ * supported, but at most one consumer per ring.
+ *
+ * Waiting producers and consumers are woken up with futexes on the shared
+ * mapping. They are only used if a peer is actually waiting.
+ */
+
+#include "up_fs.hpp"
+
+
+namespace up_ring
+{
+
+    class ring final
+    {
+    public: // --- scope ---
+        using self = ring;
+        class impl;
+    private: // --- state ---
+        std::shared_ptr<const impl> _impl;
+    public: // --- life ---
+        // create a new ring with the given capacity (power of two)
+        explicit ring(up::fs::context context, const up::string_view& name, std::size_t capacity);
+        // attach to an existing ring, e.g. created by another process
+        explicit ring(up::fs::file file);
+    public: // --- operations ---
+        void swap(self& rhs) noexcept
+        {
+            up::swap_noexcept(_impl, rhs._impl);
+        }
+        friend void swap(self& lhs, self& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+        auto to_insight() const -> up::insight;
+        auto file() const -> const up::fs::file&;
+        auto capacity() const -> std::size_t;
+        auto max_message_size() const -> std::size_t;
+        /* The following operations are intended for producers. If not
+         * blocking and there is not enough space, reserve returns a chunk
+         * with a null data pointer. */
+        auto reserve(std::size_t size, bool blocking = true) const -> up::chunk::into;
+        void commit(up::chunk::into chunk) const;
+        /* The following operations are intended for the consumer. If not
+         * blocking and there is no message, peek returns a chunk with a null
+         * data pointer. */
+        auto peek(bool blocking = true) const -> up::chunk::from;
+        void consume() const;
+    };
+
+}
+
+namespace up
+{
+
+    using up_ring::ring;
+
+}
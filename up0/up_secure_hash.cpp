@@ -1,8 +1,11 @@
 #include "up_secure_hash.hpp"
 
+#include <memory>
+
 #include "openssl/md5.h"
 #include "openssl/sha.h"
 
+#include "up_blake3.hpp"
 #include "up_char_cast.hpp"
 #include "up_exception.hpp"
 
@@ -84,6 +87,21 @@ namespace
         auto final(unsigned char* data) { return SHA512_Final(data, &_ctx); }
     };
 
+    template <>
+    struct raw_context<shm::blake3> final
+    {
+        static_assert(secure_hash_digest_size(shm::blake3) == up_blake3::blake3_hasher::digest_size);
+        // the state is large (about 1.8KB), and it is kept on the heap
+        std::unique_ptr<up_blake3::blake3_hasher> _hasher;
+        auto init() { _hasher = std::make_unique<up_blake3::blake3_hasher>(); return 1; }
+        auto update(const char* data, std::size_t size) { _hasher->update({data, size}); return 1; }
+        auto final(unsigned char* data)
+        {
+            _hasher->finish({up::char_cast<char>(data), up_blake3::blake3_hasher::digest_size});
+            return 1;
+        }
+    };
+
 
     template <shm Mechanism>
     void do_secure_hash(up::chunk::from* chunks, std::size_t count, up::chunk::into result)
@@ -117,6 +135,7 @@ auto up_secure_hash::to_string(secure_hash_mechanism mechanism) -> up::unique_st
     case secure_hash_mechanism::sha256: return "sha256";
     case secure_hash_mechanism::sha384: return "sha384";
     case secure_hash_mechanism::sha512: return "sha512";
+    case secure_hash_mechanism::blake3: return "blake3";
     default:
         throw up::make_exception("invalid-secure-hash-mechanism").with(mechanism);
     }
@@ -144,6 +163,9 @@ void up_secure_hash::secure_hash_aux(secure_hash_mechanism mechanism, up::chunk:
     case secure_hash_mechanism::sha512:
         do_secure_hash<secure_hash_mechanism::sha512>(chunks, count, result);
         break;
+    case secure_hash_mechanism::blake3:
+        do_secure_hash<secure_hash_mechanism::blake3>(chunks, count, result);
+        break;
     default:
         throw up::make_exception("invalid-secure-hash-mechanism").with(mechanism);
     }
@@ -159,6 +181,14 @@ auto up_secure_hash::secure_hash(secure_hash_mechanism mechanism, up::chunk::fro
 }
 
 
+auto up_secure_hash::blake3_parallel(up::chunk::from chunk, std::size_t threads) -> blake3::digest
+{
+    blake3::digest result;
+    up_blake3::blake3_hasher::hash(chunk, result, threads);
+    return result;
+}
+
+
 class up_secure_hash::secure_hasher_aux::impl
 {
 public: // --- scope ---
@@ -168,7 +198,7 @@ public: // --- scope ---
 protected: // --- life ---
     explicit impl() noexcept = default;
     impl(const self& rhs) = delete;
-    impl(self&& rhs) noexcept = delete;
+    impl(self&& rhs) noexcept = default;
 public:
     virtual ~impl() noexcept = default;
 public: // --- operations ---
@@ -191,6 +221,7 @@ public: // --- life ---
             throw up::make_exception("bad-secure-hash-init").with(Mechanism);
         }
     }
+    derived(derived&& rhs) noexcept = default;
 private: // --- operations ---
     void update(up::chunk::from chunk) override
     {
@@ -210,33 +241,35 @@ private: // --- operations ---
 };
 
 
-
-void up_secure_hash::secure_hasher_aux::destroy(impl* ptr)
-{
-    std::default_delete<impl>()(ptr);
-}
-
 up_secure_hash::secure_hasher_aux::secure_hasher_aux(secure_hash_mechanism mechanism)
     : _impl()
 {
+    /* The size of the OpenSSL contexts might change between versions. So
+     * only check that the largest one fits (see also emplace). */
+    static_assert(impl_size >= sizeof(impl::derived<secure_hash_mechanism::sha512>), "impl_size too small for sha512");
+    static_assert(impl_align % alignof(impl::derived<secure_hash_mechanism::sha512>) == 0,
+        "impl_align insufficient for sha512");
     switch (mechanism) {
     case secure_hash_mechanism::md5:
-        _impl = up::impl_make<impl::derived<secure_hash_mechanism::md5>>();
+        _impl.emplace<impl::derived<secure_hash_mechanism::md5>>();
         break;
     case secure_hash_mechanism::sha1:
-        _impl = up::impl_make<impl::derived<secure_hash_mechanism::sha1>>();
+        _impl.emplace<impl::derived<secure_hash_mechanism::sha1>>();
         break;
     case secure_hash_mechanism::sha224:
-        _impl = up::impl_make<impl::derived<secure_hash_mechanism::sha224>>();
+        _impl.emplace<impl::derived<secure_hash_mechanism::sha224>>();
         break;
     case secure_hash_mechanism::sha256:
-        _impl = up::impl_make<impl::derived<secure_hash_mechanism::sha256>>();
+        _impl.emplace<impl::derived<secure_hash_mechanism::sha256>>();
         break;
     case secure_hash_mechanism::sha384:
-        _impl = up::impl_make<impl::derived<secure_hash_mechanism::sha384>>();
+        _impl.emplace<impl::derived<secure_hash_mechanism::sha384>>();
         break;
     case secure_hash_mechanism::sha512:
-        _impl = up::impl_make<impl::derived<secure_hash_mechanism::sha512>>();
+        _impl.emplace<impl::derived<secure_hash_mechanism::sha512>>();
+        break;
+    case secure_hash_mechanism::blake3:
+        _impl.emplace<impl::derived<secure_hash_mechanism::blake3>>();
         break;
     default:
         throw up::make_exception("invalid-secure-hash-mechanism").with(mechanism);
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
+
 #include "up_chunk.hpp"
+#include "up_codec.hpp"
 #include "up_impl_ptr.hpp"
 #include "up_string.hpp"
 #include "up_swap.hpp"
@@ -9,7 +12,7 @@ namespace up_secure_hash
 {
 
     // TODO: Add SHA-3 (aka Keccak) as soon as OpenSSL supports it.
-    enum class secure_hash_mechanism { md5, sha1, sha224, sha256, sha384, sha512, };
+    enum class secure_hash_mechanism { md5, sha1, sha224, sha256, sha384, sha512, blake3, };
 
     auto to_string(secure_hash_mechanism mechanism) -> up::unique_string;
 
@@ -21,6 +24,7 @@ namespace up_secure_hash
             : mechanism == secure_hash_mechanism::sha256 ? 32
             : mechanism == secure_hash_mechanism::sha384 ? 48
             : mechanism == secure_hash_mechanism::sha512 ? 64
+            : mechanism == secure_hash_mechanism::blake3 ? 32
             : 0;
     }
 
@@ -57,6 +61,10 @@ namespace up_secure_hash
         {
             return up::chunk::from(_data.get(), _size);
         }
+        auto to_hex() const -> up::unique_string
+        {
+            return up::hex_encode(*this);
+        }
         operator up::chunk::into()
         {
             return up::chunk::into(_data.get(), _size);
@@ -83,9 +91,14 @@ namespace up_secure_hash
     public: // --- scope ---
         using self = secure_hasher_aux;
         class impl;
-        static void destroy(impl* ptr);
+    private:
+        /* Storage for the largest implementation (sha384 and sha512). The
+         * state of blake3 is kept on the heap, and emplace checks that each
+         * implementation fits. */
+        static const constexpr std::size_t impl_size = 224;
+        static const constexpr std::size_t impl_align = 8;
     private: // --- state ---
-        up::impl_ptr<impl, destroy> _impl;
+        up::fast_impl<impl, impl_size, impl_align> _impl;
     public: // --- life --
         explicit secure_hasher_aux(secure_hash_mechanism mechanism);
         secure_hasher_aux(const self&) = delete;
@@ -173,6 +186,10 @@ namespace up_secure_hash
             {
                 return up::chunk::from(_data.data(), secure_hash_digest_size(Mechanism));
             }
+            auto to_hex() const -> up::unique_string
+            {
+                return up::hex_encode(*this);
+            }
             operator up::chunk::into()
             {
                 return up::chunk::into(_data.data(), secure_hash_digest_size(Mechanism));
@@ -232,6 +249,11 @@ namespace up_secure_hash
     using sha256 = secure_hash_algorithm<secure_hash_mechanism::sha256>;
     using sha384 = secure_hash_algorithm<secure_hash_mechanism::sha384>;
     using sha512 = secure_hash_algorithm<secure_hash_mechanism::sha512>;
+    using blake3 = secure_hash_algorithm<secure_hash_mechanism::blake3>;
+
+    /* BLAKE3 is a tree hash. For large inputs, the subtrees can be computed
+     * by multiple threads. The result is the same as for blake3::hash. */
+    auto blake3_parallel(up::chunk::from chunk, std::size_t threads) -> blake3::digest;
 
 }
 
@@ -251,5 +273,7 @@ namespace up
     using up_secure_hash::sha256;
     using up_secure_hash::sha384;
     using up_secure_hash::sha512;
+    using up_secure_hash::blake3;
+    using up_secure_hash::blake3_parallel;
 
 }
@@ -0,0 +1,142 @@
+#include "up_sink.hpp"
+
+#include <algorithm>
+#include <locale>
+#include <streambuf>
+
+#include "up_buffer.hpp"
+#include "up_exception.hpp"
+
+
+class up_sink::sink::adapter final : public std::streambuf
+{
+private: // --- state ---
+    sink& _sink;
+    std::ostream _os;
+public: // --- life ---
+    explicit adapter(sink& sink)
+        : _sink(sink), _os(this)
+    {
+        _os.imbue(std::locale::classic());
+        // propagate exceptions from the sink (instead of setting badbit)
+        _os.exceptions(std::ios_base::badbit);
+    }
+public: // --- operations ---
+    auto os() -> std::ostream&
+    {
+        return _os;
+    }
+protected:
+    auto overflow(int_type c) -> int_type override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            _sink.put(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+    auto xsputn(const char_type* s, std::streamsize n) -> std::streamsize override
+    {
+        _sink.write(s, std::size_t(n));
+        return n;
+    }
+};
+
+
+void up_sink::sink::destroy(adapter* ptr)
+{
+    std::default_delete<adapter>()(ptr);
+}
+
+auto up_sink::sink::as_ostream() -> std::ostream&
+{
+    if (!_adapter) {
+        _adapter = up::impl_make(*this);
+    }
+    return _adapter->os();
+}
+
+
+up_sink::buffer_sink::~buffer_sink() noexcept
+{
+    _buffer.produce(std::size_t(cursor() - _begin));
+}
+
+void up_sink::buffer_sink::flush()
+{
+    _buffer.produce(std::size_t(cursor() - _begin));
+    _begin = nullptr;
+    window(nullptr, nullptr);
+}
+
+void up_sink::buffer_sink::_overflow(const char* data, std::size_t size)
+{
+    flush();
+    // grow geometrically, to amortize the costs of repeated overflows
+    _buffer.reserve(std::max(size, _buffer.available() + 64));
+    _begin = _buffer.cold();
+    std::memcpy(_begin, data, size);
+    window(_begin + size, _begin + _buffer.capacity());
+}
+
+
+up_sink::ostream_sink::~ostream_sink() noexcept
+{
+    try {
+        _os.write(_data, cursor() - _data);
+    } catch (...) {
+        up::suppress_current_exception("ostream-sink-destructor");
+    }
+}
+
+void up_sink::ostream_sink::flush()
+{
+    // reset first, so that the destructor does not write the data again
+    auto size = cursor() - _data;
+    window(_data, _data + sizeof(_data));
+    _os.write(_data, size);
+}
+
+void up_sink::ostream_sink::_overflow(const char* data, std::size_t size)
+{
+    flush();
+    if (size < sizeof(_data)) {
+        std::memcpy(_data, data, size);
+        window(_data + size, _data + sizeof(_data));
+    } else {
+        _os.write(data, std::streamsize(size));
+    }
+}
+
+
+void up_sink::format(sink& s, const char* value)
+{
+    if (value) {
+        s.write(value, std::strlen(value));
+    }
+}
+
+void up_sink::format(sink& s, double value)
+{
+    // same as the default of std::ostream (i.e. %g)
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    s.write(buffer, std::size_t(result.ptr - buffer));
+}
+
+void up_sink::format(sink& s, long double value)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    s.write(buffer, std::size_t(result.ptr - buffer));
+}
+
+void up_sink::format(sink& s, const void* value)
+{
+    if (value) {
+        char buffer[2 + 2 * sizeof(value)] = {'0', 'x'};
+        auto result = std::to_chars(buffer + 2, buffer + sizeof(buffer), reinterpret_cast<std::uintptr_t>(value), 16);
+        s.write(buffer, std::size_t(result.ptr - buffer));
+    } else {
+        s.put('0');
+    }
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+/**
+ * Lightweight, append-only text output as an alternative to std::ostream.
+ * There are no locales, no sentries and no virtual function calls per
+ * insertion: the sink writes into a window of contiguous memory, and only an
+ * overflow of the window is dispatched to the concrete sink. The function
+ * 'up::out' prefers 'out' functions for sinks, and it uses an std::ostream
+ * adapter for all types, that only support std::ostream.
+ *
+ * The built-in formatting of arithmetic types (see 'format') produces the
+ * same result as the default formatting of std::ostream with the classic
+ * locale.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+#include "up_impl_ptr.hpp"
+#include "up_string_view.hpp"
+
+namespace up_buffer
+{
+
+    class buffer;
+
+}
+
+namespace up_sink
+{
+
+    class sink
+    {
+    public: // --- scope ---
+        using self = sink;
+        class adapter;
+        static void destroy(adapter* ptr);
+    private: // --- state ---
+        char* _cursor = nullptr;
+        char* _limit = nullptr;
+        // lazily created std::ostream writing to this sink
+        up::impl_ptr<adapter, destroy> _adapter;
+    protected: // --- life ---
+        explicit sink() noexcept = default;
+        sink(const self& rhs) = delete;
+        sink(self&& rhs) noexcept = delete;
+        ~sink() noexcept = default;
+    protected: // --- operations ---
+        auto operator=(const self& rhs) & -> self& = delete;
+        auto operator=(self&& rhs) & noexcept -> self& = delete;
+        // set the range of memory, that is written next
+        void window(char* cursor, char* limit) noexcept
+        {
+            _cursor = cursor;
+            _limit = limit;
+        }
+        auto cursor() const noexcept -> char*
+        {
+            return _cursor;
+        }
+    public:
+        void put(char c)
+        {
+            if (_cursor != _limit) {
+                *_cursor++ = c;
+            } else {
+                _overflow(&c, 1);
+            }
+        }
+        void write(const char* data, std::size_t size)
+        {
+            if (size <= std::size_t(_limit - _cursor)) {
+                if (size) {
+                    std::memcpy(_cursor, data, size);
+                    _cursor += size;
+                }
+            } else {
+                _overflow(data, size);
+            }
+        }
+        // stream manipulators only affect values written through the adapter
+        auto as_ostream() -> std::ostream&;
+    private:
+        /* Called if the data does not fit into the window. The function has
+         * to take the data, and it might change the window. */
+        virtual void _overflow(const char* data, std::size_t size) = 0;
+    };
+
+
+    /**
+     * Appends to the cold range of a buffer. The data is produced on flush
+     * and on destruction, and the buffer must not be modified in between.
+     */
+    class buffer_sink final : public sink
+    {
+    public: // --- scope ---
+        using self = buffer_sink;
+    private: // --- state ---
+        up_buffer::buffer& _buffer;
+        char* _begin = nullptr;
+    public: // --- life ---
+        explicit buffer_sink(up_buffer::buffer& buffer) noexcept
+            : _buffer(buffer)
+        { }
+        ~buffer_sink() noexcept;
+    public: // --- operations ---
+        void flush();
+    private:
+        void _overflow(const char* data, std::size_t size) override;
+    };
+
+
+    /**
+     * Writes to embedded storage (e.g. on the stack), and silently truncates
+     * the output at the given size.
+     */
+    template <std::size_t Size>
+    class fixed_sink final : public sink
+    {
+    public: // --- scope ---
+        using self = fixed_sink;
+    private: // --- state ---
+        bool _truncated = false;
+        char _data[Size];
+    public: // --- life ---
+        explicit fixed_sink() noexcept
+        {
+            window(_data, _data + Size);
+        }
+    public: // --- operations ---
+        auto to_string_view() const noexcept -> up::string_view
+        {
+            return up::string_view(_data, std::size_t(cursor() - _data));
+        }
+        bool truncated() const noexcept
+        {
+            return _truncated;
+        }
+    private:
+        void _overflow(const char* data, std::size_t size) override
+        {
+            auto count = std::min(size, std::size_t(_data + Size - cursor()));
+            std::memcpy(cursor(), data, count);
+            window(cursor() + count, _data + Size);
+            if (count != size) {
+                _truncated = true;
+            }
+        }
+    };
+
+
+    /**
+     * Adapter for using sinks with std::ostream. The data is collected in
+     * embedded storage, and written on flush and on destruction. Errors on
+     * destruction are suppressed, i.e. flush has to be called explicitly to
+     * observe them.
+     */
+    class ostream_sink final : public sink
+    {
+    public: // --- scope ---
+        using self = ostream_sink;
+    private: // --- state ---
+        std::ostream& _os;
+        char _data[256];
+    public: // --- life ---
+        explicit ostream_sink(std::ostream& os) noexcept
+            : _os(os)
+        {
+            window(_data, _data + sizeof(_data));
+        }
+        ~ostream_sink() noexcept;
+    public: // --- operations ---
+        void flush();
+    private:
+        void _overflow(const char* data, std::size_t size) override;
+    };
+
+
+    /**
+     * Built-in formatting of primitive types, that is used by 'up::out' for
+     * sinks, if there is neither a member nor a non-member 'out' function.
+     */
+
+    inline void format(sink& s, char value)
+    {
+        s.put(value);
+    }
+
+    inline void format(sink& s, signed char value)
+    {
+        s.put(char(value));
+    }
+
+    inline void format(sink& s, unsigned char value)
+    {
+        s.put(char(value));
+    }
+
+    inline void format(sink& s, bool value)
+    {
+        s.put(value ? '1' : '0');
+    }
+
+    // null pointers are ignored
+    void format(sink& s, const char* value);
+
+    inline void format(sink& s, up::string_view value)
+    {
+        s.write(value.data(), value.size());
+    }
+
+    inline void format(sink& s, const std::string& value)
+    {
+        s.write(value.data(), value.size());
+    }
+
+    template <typename Integer>
+    auto format(sink& s, Integer value)
+        -> std::enable_if_t<
+            std::is_integral<Integer>()
+            && !std::is_same<Integer, bool>()
+            && !std::is_same<Integer, char>()
+            && !std::is_same<Integer, signed char>()
+            && !std::is_same<Integer, unsigned char>()>
+    {
+        char buffer[std::numeric_limits<Integer>::digits10 + 3];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        s.write(buffer, std::size_t(result.ptr - buffer));
+    }
+
+    void format(sink& s, double value);
+
+    void format(sink& s, long double value);
+
+    inline void format(sink& s, float value)
+    {
+        format(s, double(value));
+    }
+
+    void format(sink& s, const void* value);
+
+}
+
+namespace up
+{
+
+    using up_sink::sink;
+    using up_sink::buffer_sink;
+    using up_sink::fixed_sink;
+    using up_sink::ostream_sink;
+
+}
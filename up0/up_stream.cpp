@@ -273,13 +273,11 @@ class up_stream::stream::deadline_patience::impl final
 {
 public: // --- scope ---
     using self = impl;
-    static auto make(up::impl_ptr<self, destroy>&& old, int clockid, const up::duration& duration, bool absolute)
-        -> up::impl_ptr<self, destroy>
+    template <typename Storage>
+    static void assign(Storage& storage, int clockid, const up::duration& duration, bool absolute)
     {
-        if (old && old->update(clockid, duration, absolute)) {
-            return std::move(old);
-        } else {
-            return up::impl_make(clockid, duration, absolute);
+        if (!storage || !storage->update(clockid, duration, absolute)) {
+            storage.emplace(clockid, duration, absolute);
         }
     }
 private: // --- fields ---
@@ -292,7 +290,9 @@ public: // --- life ---
         update(clockid, duration, absolute);
     }
     impl(const self& rhs) = delete;
-    impl(self&& rhs) noexcept = delete;
+    impl(self&& rhs) noexcept
+        : _clockid(rhs._clockid), _fd(std::exchange(rhs._fd, -1))
+    { }
     ~impl() noexcept
     {
         close_aux(_fd);
@@ -342,42 +342,46 @@ public: // --- operations ---
 };
 
 
-void up_stream::stream::deadline_patience::destroy(impl* ptr)
-{
-    std::default_delete<impl>()(ptr);
-}
-
 up_stream::stream::deadline_patience::deadline_patience()
     : _impl()
-{ }
+{
+    static_assert(impl_size == sizeof(impl), "impl_size does not match implementation");
+    static_assert(impl_align == alignof(impl), "impl_align does not match implementation");
+}
 
 up_stream::stream::deadline_patience::deadline_patience(const up::system_time_point& expires_at)
-    : _impl(up::impl_make(CLOCK_REALTIME, expires_at.time_since_epoch(), true))
-{ }
+    : _impl()
+{
+    _impl.emplace(CLOCK_REALTIME, expires_at.time_since_epoch(), true);
+}
 
 up_stream::stream::deadline_patience::deadline_patience(const up::steady_time_point& expires_at)
-    : _impl(up::impl_make(CLOCK_MONOTONIC, expires_at.time_since_epoch(), true))
-{ }
+    : _impl()
+{
+    _impl.emplace(CLOCK_MONOTONIC, expires_at.time_since_epoch(), true);
+}
 
 up_stream::stream::deadline_patience::deadline_patience(const up::duration& expires_from_now)
-    : _impl(up::impl_make(CLOCK_MONOTONIC, expires_from_now, false))
-{ }
+    : _impl()
+{
+    _impl.emplace(CLOCK_MONOTONIC, expires_from_now, false);
+}
 
 auto up_stream::stream::deadline_patience::operator=(const up::system_time_point& expires_at) & -> self&
 {
-    _impl = impl::make(std::move(_impl), CLOCK_REALTIME, expires_at.time_since_epoch(), true);
+    impl::assign(_impl, CLOCK_REALTIME, expires_at.time_since_epoch(), true);
     return *this;
 }
 
 auto up_stream::stream::deadline_patience::operator=(const up::steady_time_point& expires_at) & -> self&
 {
-    _impl = impl::make(std::move(_impl), CLOCK_MONOTONIC, expires_at.time_since_epoch(), true);
+    impl::assign(_impl, CLOCK_MONOTONIC, expires_at.time_since_epoch(), true);
     return *this;
 }
 
 auto up_stream::stream::deadline_patience::operator=(const up::duration& expires_from_now) & -> self&
 {
-    _impl = impl::make(std::move(_impl), CLOCK_MONOTONIC, expires_from_now, false);
+    impl::assign(_impl, CLOCK_MONOTONIC, expires_from_now, false);
     return *this;
 }
 
@@ -143,9 +143,12 @@ namespace up_stream
     public: // --- scope ---
         using self = deadline_patience;
         class impl;
-        static void destroy(impl* ptr);
+    private:
+        // layout of the implementation (clock id and timer file descriptor)
+        static const constexpr std::size_t impl_size = 2 * sizeof(int);
+        static const constexpr std::size_t impl_align = alignof(int);
     private: // --- state ---
-        up::impl_ptr<impl, destroy> _impl;
+        up::fast_impl<impl, impl_size, impl_align> _impl;
     public: // --- life ---
         explicit deadline_patience();
         explicit deadline_patience(const up::system_time_point& expires_at);
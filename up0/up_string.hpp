@@ -715,6 +715,12 @@ namespace up_string
         using base::operator string_view;
         using base::repr;
 
+        // same as std::hash, memoized in heap-allocated storage
+        auto hash() const noexcept -> size_type
+        {
+            return Repr::hash();
+        }
+
         auto to_string() const& -> const self&
         {
             return *this;
@@ -1146,6 +1152,12 @@ namespace up_string
         using base::operator string_view;
         using base::repr;
 
+        // same as std::hash (contents are mutable, so there is no memoization)
+        auto hash() const noexcept -> size_type
+        {
+            return Repr::hash();
+        }
+
         auto to_string() const& -> const self&
         {
             return *this;
@@ -1724,8 +1736,7 @@ namespace std
         auto operator()(const up_string::basic_string<Repr, Unique>& value) const noexcept
             -> result_type
         {
-            using string_view = typename up_string::basic_string<Repr, Unique>::string_view;
-            return hash<string_view>()(value.operator string_view());
+            return value.hash();
         }
     };
 
@@ -1,10 +1,6 @@
 #include "up_string_literal.hpp"
 
-#include <ostream>
-
-void up_string_literal::string_literal::out(std::ostream& os) const
+void up_string_literal::string_literal::out(up::sink& s) const
 {
-    if (_data) {
-        os.write(_data, _size);
-    }
+    s.write(_data, _size);
 }
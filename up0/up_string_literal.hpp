@@ -1,5 +1,6 @@
 #pragma once
 
+#include "up_sink.hpp"
 #include "up_string.hpp"
 
 namespace up_string_literal
@@ -27,11 +28,11 @@ namespace up_string_literal
             : _data(data), _size(size)
         { }
     public: // --- operations ---
-        auto data() const noexcept
+        constexpr auto data() const noexcept
         {
             return _data;
         }
-        auto size() const noexcept
+        constexpr auto size() const noexcept
         {
             return _size;
         }
@@ -39,7 +40,7 @@ namespace up_string_literal
         {
             return up::unique_string(_data, _size);
         }
-        void out(std::ostream& os) const;
+        void out(up::sink& s) const;
     public: // --- friends ---
         friend constexpr auto operator "" _sl(
             const char* data, std::size_t size) noexcept -> string_literal;
@@ -58,24 +58,35 @@ namespace up_string_repr
     };
 
 
+    /**
+     * The storage memoizes the hash value of its contents, which is computed
+     * lazily on first use. The cache is only used by shared handles, because
+     * the contents are immutable as long as the storage is shared. The value
+     * zero means not yet computed.
+     *
+     * The contents are always followed by a NUL character (not included in
+     * the capacity), so that shared contents can be passed to system calls
+     * without copying them (see up::nts).
+     */
     class string_repr::storage final
     {
     private: // --- scope ---
         using self = storage;
-        static const constexpr size_type self_size = sizeof(size_type) * 3;
+        static const constexpr size_type self_size = sizeof(size_type) * 4;
         friend string_repr;
     public:
         static auto max_size() -> size_type
         {
-            return std::numeric_limits<size_type>::max() - self_size;
+            return std::numeric_limits<size_type>::max() - self_size - 1;
         }
     private: // --- state --
         mutable std::atomic<size_type> _n_refs;
         size_type _capacity;
         size_type _size;
+        mutable std::atomic<size_type> _hash;
     private: // --- life ---
         explicit storage(size_type n_refs, size_type capacity, size_type size) noexcept
-            : _n_refs(n_refs), _capacity(capacity), _size(size)
+            : _n_refs(n_refs), _capacity(capacity), _size(size), _hash(0)
         {
             static_assert(noexcept(decltype(_n_refs)(n_refs)));
             static_assert(noexcept(decltype(_capacity)(capacity)));
@@ -114,6 +125,21 @@ namespace up_string_repr
         void set_size(size_type size) noexcept
         {
             _size = size;
+            data()[size] = 0;
+        }
+        auto hash() const noexcept -> size_type
+        {
+            // concurrent computations store the same value
+            auto result = _hash.load(std::memory_order_relaxed);
+            if (result == 0) {
+                result = std::hash<up::string_view>()(up::string_view(data(), _size));
+                _hash.store(result, std::memory_order_relaxed);
+            }
+            return result;
+        }
+        void reset_hash() noexcept
+        {
+            _hash.store(0, std::memory_order_relaxed);
         }
         auto data() const noexcept -> const char*
         {
@@ -138,7 +164,7 @@ namespace up_string_repr
         {
             if (Unique || ptr->release()) {
                 static_assert(std::is_standard_layout<storage>::value);
-                size_type size = sizeof(storage) + ptr->_capacity; // no overflow check required
+                size_type size = sizeof(storage) + ptr->_capacity + 1; // no overflow check required
                 ptr->~storage();
                 ::operator delete(static_cast<void*>(ptr), size);
             } // else: nothing
@@ -154,11 +180,13 @@ namespace up_string_repr
     {
         static_assert(std::is_standard_layout<storage>::value);
         using sizes = up::ints::domain<size_type>::or_length_error;
-        void* raw = ::operator new(sizes::add(sizeof(storage), capacity));
-        return [raw](auto&&... args) {
+        void* raw = ::operator new(sizes::sum(sizeof(storage), capacity, 1));
+        auto result = [raw](auto&&... args) {
             static_assert(noexcept(storage(std::forward<decltype(args)>(args)...)));
             return storage_ptr<Unique>(new (raw) storage(std::forward<decltype(args)>(args)...));
         }(size_type(1), capacity, size);
+        result->data()[size] = 0;
+        return result;
     }
 
     extern template auto string_repr::make_storage<false>(size_type capacity, size_type size) -> storage_ptr<false>;
@@ -268,7 +296,8 @@ namespace up_string_repr
             } else if (U || !Unique) {
                 // nothing
             } else if (_sso._external._ptr->unique()) {
-                // nothing
+                // contents become mutable
+                _sso._external._ptr->reset_hash();
             } else {
                 _sso._external._ptr = clone_storage<true>(*storage_ptr<U>(_sso._external._ptr)).release();
             }
@@ -356,10 +385,31 @@ namespace up_string_repr
                 return _sso._external._ptr->data();
             }
         }
+        auto hash() const noexcept(!Nullable) -> size_type
+        {
+            _check_not_null();
+            if (_sso._external._tag != tag_external) {
+                return std::hash<up::string_view>()(up::string_view(_sso._internal._data, _sso._internal._tag));
+            } else if (Unique) {
+                auto ptr = _sso._external._ptr;
+                return std::hash<up::string_view>()(up::string_view(ptr->data(), ptr->size()));
+            } else {
+                return _sso._external._ptr->hash();
+            }
+        }
         explicit operator bool() const noexcept
         {
             return !_is_null();
         }
+        // returns the storage, if it is external and shared (i.e. immutable and NUL-terminated)
+        auto shared_storage() const noexcept -> const storage*
+        {
+            if (Unique || _sso._external._tag != tag_external) {
+                return nullptr;
+            } else {
+                return _sso._external._ptr;
+            }
+        }
     private:
         bool _is_null() const noexcept
         {
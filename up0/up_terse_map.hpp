@@ -8,6 +8,13 @@
  * It supports most operations of std::unordered_map, except for operations
  * which make no sense for open addressing, i.e. that would require a node
  * based data structure.
+ *
+ * With the template parameter Small, the map can store a small number of
+ * entries within the object (instead of the heap). In this mode, the entries
+ * are placed from the front and searched linearly, filtered by the one byte
+ * tags, which are stored consecutively. The map switches to the hashed layout
+ * on the heap, when the inline capacity is exceeded. Note that moving a map
+ * in small mode moves the entries, i.e. it invalidates iterators.
  */
 
 #include "up_ints.hpp"
@@ -18,15 +25,57 @@
 namespace up_terse_map
 {
 
+    // inline storage for tags and values with the same layout as on the heap
+    template <std::size_t Small, typename Value>
+    class small_buffer
+    {
+    protected: // --- scope ---
+        static constexpr auto _aligned_size(std::size_t n) -> std::size_t
+        {
+            auto r = n % alignof(Value);
+            return r == 0 ? n : n - r + alignof(Value);
+        }
+        static const constexpr std::size_t small_capacity = Small;
+    private: // --- state ---
+        // tags (including the overflow tag), padding and values
+        alignas(Value) char _small_data[_aligned_size(Small + 1) + Small * sizeof(Value)];
+    protected: // --- operations ---
+        auto _small() noexcept -> char*
+        {
+            return _small_data;
+        }
+        auto _small() const noexcept -> const char*
+        {
+            return _small_data;
+        }
+    };
+
+    template <typename Value>
+    class small_buffer<0, Value>
+    {
+    protected: // --- scope ---
+        static const constexpr std::size_t small_capacity = 0;
+    protected: // --- operations ---
+        auto _small() const noexcept -> char*
+        {
+            return nullptr;
+        }
+    };
+
+
     template <
         typename Key,
         typename T,
         typename Hash = std::hash<Key>,
-        typename Pred = std::equal_to<Key>>
-    class terse_map final
+        typename Pred = std::equal_to<Key>,
+        std::size_t Small = 0>
+    class terse_map final : private small_buffer<Small, std::pair<const Key, T>>
     {
     private: // --- scope ---
         using self = terse_map;
+        using small_base = small_buffer<Small, std::pair<const Key, T>>;
+        using small_base::small_capacity;
+        using small_base::_small;
         enum class tag : uint8_t { overflow = 253, upper = 254, removed = 254, pristine = 255, };
         static auto skip_distance(const tag* from)
         {
@@ -173,7 +222,7 @@ namespace up_terse_map
         size_type _capacity = 0;
         size_type _size = 0;
         size_type _removed = 0;
-        std::unique_ptr<char[]> _raw = {};
+        char* _raw = nullptr; // either heap or small buffer
         hasher _hasher = {};
         key_equal _equal = {};
         float _max_load_factor = 0.8f;
@@ -185,15 +234,22 @@ namespace up_terse_map
             const key_equal& equal = key_equal())
             : _hasher(hash), _equal(equal)
         {
-            if (capacity) {
+            if (capacity == 0) {
+                // nothing
+            } else if (capacity <= small_capacity) {
+                _capacity = small_capacity;
+                _raw = _small();
+                std::uninitialized_fill_n(_tags(), _capacity, tag::pristine);
+                new (_tags() + _capacity) tag(tag::overflow);
+            } else {
                 // conservative overflow check (covering the following ops)
                 using sizes = up::ints::domain<size_type>::or_length_error;
                 sizes::mul(sizes::add(alignof(value_type), capacity), sizes::add(sizeof(value_type), sizeof(tag)));
                 capacity += (_aligned(_tag_size(capacity)) - _tag_size(capacity)) / sizeof(tag);
-                _raw = std::make_unique<char[]>(_aligned(_tag_size(capacity)) + _capacity * sizeof(value_type));
+                _capacity = capacity;
+                _raw = new char[_aligned(_tag_size(_capacity)) + _capacity * sizeof(value_type)];
                 std::uninitialized_fill_n(_tags(), _capacity, tag::pristine);
                 new (_tags() + _capacity) tag(tag::overflow);
-                _capacity = capacity;
             }
         }
         template <typename InputIterator>
@@ -218,10 +274,10 @@ namespace up_terse_map
             _max_load_factor = rhs._max_load_factor;
             insert(rhs.begin(), rhs.end());
         }
-        terse_map(self&& rhs) noexcept
+        terse_map(self&& rhs) noexcept(_nothrow_relocate())
             : terse_map()
         {
-            swap(rhs);
+            _steal(rhs);
         }
         terse_map(std::initializer_list<value_type> init)
             : terse_map(init.begin(), init.end())
@@ -236,11 +292,7 @@ namespace up_terse_map
         ~terse_map() noexcept
         {
             clear();
-            if (_raw) {
-                for (size_type i = 0; i <= _capacity; ++i) {
-                    _tags()[i].~tag();
-                }
-            }
+            _free();
         }
     public: // --- operations ---
         auto operator=(const self& rhs) & -> self&
@@ -248,7 +300,7 @@ namespace up_terse_map
             self(rhs).swap(*this);
             return *this;
         }
-        auto operator=(self&& rhs) & noexcept -> self&
+        auto operator=(self&& rhs) & noexcept(_nothrow_relocate()) -> self&
         {
             swap(rhs);
             return *this;
@@ -383,17 +435,25 @@ namespace up_terse_map
         {
             erase(begin(), end());
         }
-        void swap(self& rhs) noexcept
+        void swap(self& rhs) noexcept(_nothrow_relocate())
         {
-            up::swap_noexcept(_capacity, rhs._capacity);
-            up::swap_noexcept(_size, rhs._size);
-            up::swap_noexcept(_removed, rhs._removed);
-            up::swap_noexcept(_raw, rhs._raw);
-            up::swap_noexcept(_hasher, rhs._hasher);
-            up::swap_noexcept(_equal, rhs._equal);
-            up::swap_noexcept(_max_load_factor, rhs._max_load_factor);
+            if (this == &rhs) {
+                // nothing
+            } else if (_is_small() || rhs._is_small()) {
+                self temp(std::move(*this));
+                _steal(rhs);
+                rhs._steal(temp);
+            } else {
+                up::swap_noexcept(_capacity, rhs._capacity);
+                up::swap_noexcept(_size, rhs._size);
+                up::swap_noexcept(_removed, rhs._removed);
+                up::swap_noexcept(_raw, rhs._raw);
+                up::swap_noexcept(_hasher, rhs._hasher);
+                up::swap_noexcept(_equal, rhs._equal);
+                up::swap_noexcept(_max_load_factor, rhs._max_load_factor);
+            }
         }
-        friend void swap(self& lhs, self& rhs) noexcept
+        friend void swap(self& lhs, self& rhs) noexcept(self::_nothrow_relocate())
         {
             lhs.swap(rhs);
         }
@@ -424,6 +484,30 @@ namespace up_terse_map
             auto p = find(key);
             return p == end() ? 0 : 1;
         }
+        /* Lookups with other key types (e.g. views) without constructing a
+         * key, if both the hasher and the predicate are transparent. The
+         * hasher has to return the same values for equal keys. */
+        template <typename K, typename H = hasher, typename E = key_equal,
+            typename = typename H::is_transparent, typename = typename E::is_transparent>
+        auto find(const K& key) -> iterator
+        {
+            auto index = _find_aux(_hasher(key), key).first;
+            return iterator(_tags() + index, _values() + index);
+        }
+        template <typename K, typename H = hasher, typename E = key_equal,
+            typename = typename H::is_transparent, typename = typename E::is_transparent>
+        auto find(const K& key) const -> const_iterator
+        {
+            auto index = _find_aux(_hasher(key), key).first;
+            return const_iterator(_tags() + index, _values() + index);
+        }
+        template <typename K, typename H = hasher, typename E = key_equal,
+            typename = typename H::is_transparent, typename = typename E::is_transparent>
+        auto count(const K& key) const -> size_type
+        {
+            auto p = find(key);
+            return p == end() ? 0 : 1;
+        }
         auto equal_range(const key_type& key) -> std::pair<iterator, iterator>
         {
             auto p = find(key);
@@ -505,10 +589,9 @@ namespace up_terse_map
         void rehash(size_type requested_capacity)
         {
             if (requested_capacity == 0 && _size == 0) {
-                _capacity = 0;
-                _raw.reset(nullptr);
+                _free();
             } else {
-                auto minimum = size_type(7);
+                auto minimum = small_capacity ? small_capacity : size_type(7);
                 if (requested_capacity > _capacity) {
                     _do_rehash(std::max(requested_capacity, minimum));
                 } else {
@@ -544,6 +627,71 @@ namespace up_terse_map
         }
 
     private:
+        static constexpr bool _nothrow_relocate()
+        {
+            return Small == 0 || std::is_nothrow_move_constructible<value_type>::value;
+        }
+        bool _is_small() const noexcept
+        {
+            return Small != 0 && _raw == _small();
+        }
+        // maximum number of used and removed entries
+        auto _limit() const noexcept
+        {
+            return _is_small() ? float(_capacity) : _capacity * _max_load_factor;
+        }
+        void _free() noexcept
+        {
+            if (_raw) {
+                for (size_type i = 0; i <= _capacity; ++i) {
+                    _tags()[i].~tag();
+                }
+                if (!_is_small()) {
+                    delete[] _raw;
+                }
+                _raw = nullptr;
+                _capacity = 0;
+                _removed = 0;
+            }
+        }
+        // requires that this map has no storage, and leaves rhs without storage
+        void _steal(self& rhs) noexcept(_nothrow_relocate())
+        {
+            up::swap_noexcept(_hasher, rhs._hasher);
+            up::swap_noexcept(_equal, rhs._equal);
+            up::swap_noexcept(_max_load_factor, rhs._max_load_factor);
+            if (!rhs._is_small()) {
+                up::swap_noexcept(_capacity, rhs._capacity);
+                up::swap_noexcept(_size, rhs._size);
+                up::swap_noexcept(_removed, rhs._removed);
+                up::swap_noexcept(_raw, rhs._raw);
+            } else {
+                /* Used entries are marked as removed until they have been
+                 * moved, so that the map stays consistent if a move throws. */
+                _raw = _small();
+                _capacity = rhs._capacity;
+                _removed = rhs._removed + rhs._size;
+                auto tags = _tags();
+                auto values = _values();
+                auto rhs_tags = rhs._tags();
+                auto rhs_values = rhs._values();
+                for (size_type i = 0; i != _capacity; ++i) {
+                    auto t = rhs_tags[i];
+                    new (tags + i) tag(t < tag::upper ? tag::removed : t);
+                }
+                new (tags + _capacity) tag(tag::overflow);
+                for (size_type i = 0; i != _capacity; ++i) {
+                    if (rhs_tags[i] < tag::upper) {
+                        new (values + i) value_type(std::move(rhs_values[i]));
+                        tags[i] = rhs_tags[i];
+                        ++_size;
+                        --_removed;
+                    }
+                }
+                rhs.clear();
+                rhs._free();
+            }
+        }
         auto _aligned(size_type n) const
         {
             auto r = n % alignof(value_type);
@@ -555,30 +703,35 @@ namespace up_terse_map
         }
         auto _tags()
         {
-            return _raw ? reinterpret_cast<tag*>(_raw.get()) : nullptr;
+            return _raw ? reinterpret_cast<tag*>(_raw) : nullptr;
         }
         auto _tags() const
         {
-            return _raw ? reinterpret_cast<const tag*>(_raw.get()) : nullptr;
+            return _raw ? reinterpret_cast<const tag*>(_raw) : nullptr;
         }
         auto _values()
         {
             return _raw
-                ? reinterpret_cast<value_type*>(_raw.get() + _aligned(_tag_size(_capacity)))
+                ? reinterpret_cast<value_type*>(_raw + _aligned(_tag_size(_capacity)))
                 : nullptr;
         }
         auto _values() const
         {
             return _raw
-                ? reinterpret_cast<const value_type*>(_raw.get() + _aligned(_tag_size(_capacity)))
+                ? reinterpret_cast<const value_type*>(_raw + _aligned(_tag_size(_capacity)))
                 : nullptr;
         }
-        auto _find_aux(size_type hash, const key_type& key) const -> std::pair<size_type, size_type>
+        template <typename K>
+        auto _find_aux(size_type hash, const K& key) const -> std::pair<size_type, size_type>
         {
+            if (_capacity == 0) {
+                return { 0, 0 };
+            }
             auto tags = _tags();
             auto values = _values();
             auto quick = tag(hash % up::to_underlying_type(tag::upper));
-            auto initial = hash % _capacity;
+            // linear search in small mode
+            auto initial = _is_small() ? 0 : hash % _capacity;
             using pair = std::pair<size_type, size_type>;
             size_type empty = _capacity;
             for (auto range : {pair(initial, _capacity), pair(0, initial)}) {
@@ -617,24 +770,26 @@ namespace up_terse_map
             auto index = _find_aux(hash, key);
             if (index.first != _capacity) {
                 return {iterator(tags + index.first, values + index.first), false};
-            } else if (tags[index.second] == tag::removed) {
+            } else if (index.second != _capacity && tags[index.second] == tag::removed) {
                 new (values + index.second) value_type(
                     std::forward<K>(key), std::forward<M>(mapped));
                 tags[index.second] = tag(hash % up::to_underlying_type(tag::upper));
                 ++_size;
                 --_removed;
                 return {iterator(tags + index.second, values + index.second), true};
-            } else if (_size + _removed < _capacity * _max_load_factor) {
+            } else if (_size + _removed < _limit()) {
                 new (values + index.second) value_type(
                     std::forward<K>(key), std::forward<M>(mapped));
                 tags[index.second] = tag(hash % up::to_underlying_type(tag::upper));
                 ++_size;
                 return {iterator(tags + index.second, values + index.second), true};
-            } else if (_capacity == 0 || _size >= _capacity * _max_load_factor) {
+            } else if (_capacity == 0 || _size >= _limit()) {
                 using sizes = up::ints::domain<size_type>::or_length_error;
                 reserve(sizes::sum(_size, _size / 2, 1));
                 return _insert_final(std::forward<K>(key), std::forward<M>(mapped));
             } else {
+                // too many removed entries
+                _do_rehash(_capacity);
                 return _insert_final(std::forward<K>(key), std::forward<M>(mapped));
             }
         }
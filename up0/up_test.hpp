@@ -138,6 +138,22 @@ namespace up_test
                 _passed(location, "condition"_sl);
             }
         }
+        template <typename Exception, typename Function>
+        static void check_throws(location location, Function&& function)
+        {
+            using namespace up::literals;
+            bool thrown = false;
+            try {
+                std::forward<Function>(function)();
+            } catch (const Exception&) {
+                thrown = true;
+            }
+            if (thrown) {
+                _passed(location, "throws"_sl);
+            } else {
+                _failed(location, "throws"_sl, {});
+            }
+        }
     private:
         static void _passed(location location, up::string_literal type);
         static void _failed(location location, up::string_literal type, up::insights insights);
@@ -187,3 +203,8 @@ namespace up
     do { \
         ::up_test::check::check_true({__FILE__, __LINE__, __PRETTY_FUNCTION__}, __VA_ARGS__); \
     } while (false)
+
+#define UP_TEST_THROWS(exception, ...) \
+    do { \
+        ::up_test::check::check_throws<exception>({__FILE__, __LINE__, __PRETTY_FUNCTION__}, __VA_ARGS__); \
+    } while (false)
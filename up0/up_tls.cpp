@@ -766,7 +766,7 @@ public: // --- operations ---
         }
         if (_certificate_chain_pathname) {
             rv = ::SSL_CTX_use_certificate_chain_file(
-                ctx, up::nts(up::to_string_view(_certificate_chain_pathname.repr())));
+                ctx, up::nts(_certificate_chain_pathname.repr()));
             if (rv != 1) {
                 raise_ssl_error("tls-certificate-chain-error", rv);
             }
@@ -1246,7 +1246,7 @@ private: // --- scope ---
         auxiliary* auxiliary) -> ssl_ptr
     {
         ssl_ptr ssl = make_ssl(ssl_ctx);
-        if (hostname && !SSL_set_tlsext_host_name(ssl.get(), static_cast<const char*>(up::nts(up::to_string_view(hostname.repr()))))) {
+        if (hostname && !SSL_set_tlsext_host_name(ssl.get(), static_cast<const char*>(up::nts(hostname.repr())))) {
             raise_ssl_error("tls-hostname-error", up::to_string_view(hostname.repr()));
         }
         openssl_process::instance().ssl_put_ptr(ssl.get(), auxiliary);
@@ -12,6 +12,9 @@
  * - and for storing unsigned integers in a machine independent format.
  */
 
+#include <algorithm>
+
+#include "up_char_cast.hpp"
 #include "up_chunk.hpp"
 
 
@@ -27,15 +30,23 @@ namespace up_vlq
     void raise_vlq_incomplete_error(std::size_t offset, uintmax_t value);
 
 
+    enum class vlq_status : uint8_t { complete, incomplete, overflow, };
+
+
     template <typename Integral, typename Type, int bits = std::numeric_limits<Type>::digits - 1>
     class basic_vlq final
     {
-    private: // --- scope ---
+    public: // --- scope ---
+        // maximal number of elements of an encoded value
+        static const constexpr std::size_t max_size = (std::numeric_limits<Integral>::digits - 1) / bits + 1;
+    private:
         static_assert(std::is_unsigned<Integral>{});
         static_assert(std::is_unsigned<Type>{});
         static_assert(bits < std::numeric_limits<Type>::digits);
-        using array = std::array<Type, (std::numeric_limits<Integral>::digits - 1) / bits + 1>;
+        using array = std::array<Type, max_size>;
         using tuple = std::tuple<std::size_t, array>;
+        static const constexpr std::size_t digits = std::numeric_limits<Integral>::digits;
+        static const constexpr Integral limit = Integral(1) << (digits - bits); // for overflow checking
         /* This function encodes the given value into exactly N bytes. N
          * should be sufficiently large. If it is too large, the unnecessary
          * leading bytes will be zero. However, it is an error to invoke the
@@ -81,26 +92,41 @@ namespace up_vlq
             constexpr bool finish = N * bits >= std::numeric_limits<Integral>::digits;
             return encode_aux<N>(value, std::bool_constant<finish>{});
         }
-        static auto decode(const Type* array, std::size_t size)
-            -> std::tuple<Integral, std::size_t>
+        /* Decodes the value at the beginning of the array without throwing,
+         * and looks at no more than max_size elements. The result contains
+         * the status, the (partial) value and the number of elements used
+         * (or the position of the overflow). */
+        static auto try_decode(const Type* array, std::size_t size) noexcept
+            -> std::tuple<vlq_status, Integral, std::size_t>
         {
-            constexpr std::size_t digits = std::numeric_limits<Integral>::digits;
             constexpr std::size_t safe = digits / bits;
             constexpr Integral _1 = 1;
             constexpr Integral msb = _1 << bits; // most significant bit
             constexpr Integral mask = msb - _1; // mask for other bits
-            constexpr Integral limit = _1 << (digits - bits); // for overflow checking
+            std::size_t n = std::min(size, max_size);
             Integral result = 0;
-            for (std::size_t i = 0; i != size; ++i) {
+            for (std::size_t i = 0; i != n; ++i) {
                 if (i >= safe && result >= limit) {
-                    raise_vlq_overflow_error(i, result, limit);
+                    return std::make_tuple(vlq_status::overflow, result, i);
                 }
                 result = (result << bits) | (array[i] & mask);
-                if (array[i] & msb) {
-                    return std::make_tuple(result, i + 1);
+                if ((array[i] & msb) == 0) {
+                    return std::make_tuple(vlq_status::complete, result, i + 1);
                 }
             }
-            raise_vlq_incomplete_error(size, result);
+            return std::make_tuple(n == max_size ? vlq_status::overflow : vlq_status::incomplete, result, n);
+        }
+        static auto decode(const Type* array, std::size_t size)
+            -> std::tuple<Integral, std::size_t>
+        {
+            auto&& decoded = try_decode(array, size);
+            if (std::get<0>(decoded) == vlq_status::complete) {
+                return std::make_tuple(std::get<1>(decoded), std::get<2>(decoded));
+            } else if (std::get<0>(decoded) == vlq_status::overflow) {
+                raise_vlq_overflow_error(std::get<2>(decoded), std::get<1>(decoded), limit);
+            } else {
+                raise_vlq_incomplete_error(size, std::get<1>(decoded));
+            }
         }
     };
 
@@ -111,6 +137,14 @@ namespace up_vlq
         static_assert(std::numeric_limits<unsigned char>::digits == 8);
         static_assert(std::numeric_limits<unsigned char>::max() == 255);
     public:
+        using status = vlq_status;
+        template <typename Integral>
+        class encoded;
+        template <typename Integral>
+        static constexpr auto max_size() -> std::size_t
+        {
+            return basic_vlq<Integral, unsigned char>::max_size;
+        }
         template <typename Integral>
         static auto encode(Integral value)
         {
@@ -119,7 +153,33 @@ namespace up_vlq
         template <typename Integral>
         static auto decode(up::chunk::from chunk)
         {
-            return basic_vlq<Integral, unsigned char>::decode(chunk.data(), chunk.size());
+            return basic_vlq<Integral, unsigned char>::decode(
+                up::char_cast<unsigned char>(chunk.data()), chunk.size());
+        }
+        // reports incomplete and overflowed input with the status instead of an exception
+        template <typename Integral>
+        static auto try_decode(up::chunk::from chunk) noexcept
+        {
+            return basic_vlq<Integral, unsigned char>::try_decode(
+                up::char_cast<unsigned char>(chunk.data()), chunk.size());
+        }
+    };
+
+
+    // encoded value, that can be used as a chunk
+    template <typename Integral>
+    class vlq::encoded final
+    {
+    private: // --- state ---
+        decltype(vlq::encode(Integral())) _encoded;
+    public: // --- life ---
+        explicit encoded(Integral value)
+            : _encoded(vlq::encode(value))
+        { }
+    public: // --- operations ---
+        operator up::chunk::from() const
+        {
+            return {up::char_cast<char>(std::get<1>(_encoded).data()), std::get<0>(_encoded)};
         }
     };
 
@@ -129,5 +189,6 @@ namespace up
 {
 
     using up_vlq::vlq;
+    using up_vlq::vlq_status;
 
 }